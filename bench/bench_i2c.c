@@ -0,0 +1,139 @@
+/**
+ * @file bench_i2c.c
+ * @brief Host benchmark of the i2c_bus locking, several tasks hammering their own devices on one bus.
+ *
+ * The driver in components/bus runs unchanged on the FreeRTOS and I2C backends of the simulator,
+ * which put the calling thread to sleep for the time the bytes take at the bus clock. Each task
+ * reads from its own device model, the workload is the one of the on-target test in
+ * components/bus/test/i2c_bus_stress.c.
+ *
+ * It prints the throughput and latency per task, the fairness of the share each task got, the
+ * tasks that starved, the transfers that timed out after CONFIG_I2C_MS_TO_WAIT and the wait
+ * distribution of the bus mutex. The exit status is 2 if a task starved or a transfer timed out,
+ * so a change of the locking can be checked from a script.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "driver/i2c.h"
+#include "i2c_bus.h"
+#include "i2c_bus_stress.h"
+
+#include "sim.h"
+
+// First address of the device models, task i reads from BENCH_FIRST_ADDRESS + i
+#define BENCH_FIRST_ADDRESS 0x20
+
+typedef struct {
+    sim_i2c_device_t dev;
+    uint8_t next;       // Value of the next byte read
+} bench_device_t;
+
+static bench_device_t devices[I2C_BUS_STRESS_MAX_TASKS];
+static uint8_t addresses[I2C_BUS_STRESS_MAX_TASKS];
+
+static uint32_t clk_speed = 400000;
+
+static i2c_bus_stress_config_t config = {
+    .tasks = 4,
+    .addresses = addresses,
+    .mem_address = 0x00,
+    .length = 16,
+    .hog_length = 0,
+    .think_ms = 0,
+    .duration_ms = 2000,
+    .starve_ms = CONFIG_I2C_MS_TO_WAIT / 2,
+    .priority = 5,
+};
+
+/**
+ * @brief Device model that answers every read with a counter, writes select nothing.
+ */
+static void bench_device_start(sim_i2c_device_t* dev, bool read) {
+}
+
+static void bench_device_write(sim_i2c_device_t* dev, uint8_t byte) {
+}
+
+static uint8_t bench_device_read(sim_i2c_device_t* dev) {
+    return ((bench_device_t*)dev)->next++;
+}
+
+static void bench_device_stop(sim_i2c_device_t* dev) {
+}
+
+/**
+ * @brief Prints the usage and exits.
+ *
+ * @param name Name of the binary.
+ */
+static void usage(const char* name) {
+    fprintf(stderr,
+            "Usage: %s [-t tasks] [-n bytes] [-H bytes] [-w ms] [-d ms] [-s ms] [-c hz]\n"
+            "  -t tasks on the bus, at most %d, each with its own device\n"
+            "  -n bytes per read, -H bytes per read of task 0 to make it hog the bus\n"
+            "  -w delay between two reads of a task, -d length of the run\n"
+            "  -s gap without the bus after which a task counts as starved, -c bus clock\n",
+            name, I2C_BUS_STRESS_MAX_TASKS);
+    exit(1);
+}
+
+int main(int argc, char** argv) {
+    int opt;
+    while ((opt = getopt(argc, argv, "t:n:H:w:d:s:c:")) != -1) {
+        switch (opt) {
+        case 't': config.tasks = atoi(optarg); break;
+        case 'n': config.length = atoi(optarg); break;
+        case 'H': config.hog_length = atoi(optarg); break;
+        case 'w': config.think_ms = atoi(optarg); break;
+        case 'd': config.duration_ms = atoi(optarg); break;
+        case 's': config.starve_ms = atoi(optarg); break;
+        case 'c': clk_speed = atoi(optarg); break;
+        default: usage(argv[0]);
+        }
+    }
+    if (config.tasks < 1 || config.tasks > I2C_BUS_STRESS_MAX_TASKS || config.length == 0 || config.duration_ms == 0
+        || clk_speed == 0 || clk_speed > 400000) {
+        usage(argv[0]);
+    }
+
+    for (int i = 0; i < config.tasks; i++) {
+        devices[i].dev.address = BENCH_FIRST_ADDRESS + i;
+        devices[i].dev.start = bench_device_start;
+        devices[i].dev.write = bench_device_write;
+        devices[i].dev.read = bench_device_read;
+        devices[i].dev.stop = bench_device_stop;
+        sim_i2c_attach(&devices[i].dev);
+        addresses[i] = BENCH_FIRST_ADDRESS + i;
+    }
+    config.address_num = config.tasks;
+
+    i2c_config_t conf = {
+        .mode = I2C_MODE_MASTER,
+        .sda_io_num = 21,
+        .sda_pullup_en = GPIO_PULLUP_ENABLE,
+        .scl_io_num = 22,
+        .scl_pullup_en = GPIO_PULLUP_ENABLE,
+        .master.clk_speed = clk_speed,
+    };
+    i2c_bus_handle_t bus = i2c_bus_create(I2C_NUM_0, &conf);
+    if (bus == NULL) {
+        fprintf(stderr, "Error creating the bus\n");
+        return 1;
+    }
+
+    i2c_bus_stress_result_t result;
+    esp_err_t ret = i2c_bus_stress_run(bus, &config, &result);
+    if (ret != ESP_OK) {
+        fprintf(stderr, "Error running the workload: %s\n", esp_err_to_name(ret));
+        return 1;
+    }
+    i2c_bus_stress_print(&config, &result);
+
+    i2c_bus_delete(&bus);
+    return result.starved > 0 || result.timeouts > 0 ? 2 : 0;
+}
@@ -0,0 +1,469 @@
+/**
+ * @file bench_mqtt.c
+ * @brief Host benchmark of the station data path, from a publish to the updated data of the views.
+ *
+ * Two MQTT connections go to one broker, server/broker.py or any other. The publisher sends data
+ * messages in the format of server.py with two extra fields, a sequence number and the send time.
+ * The subscriber passes every message to telemetry_parse() from the firmware, like
+ * mqtt_event_handler() does, and takes the time once the store is updated. The extra fields come
+ * after the visibility, so the firmware parser ignores them.
+ *
+ * At the end it prints the latency percentiles, the received rate and the lost messages.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "telemetry.h"
+
+// MQTT control packet types
+#define MQTT_CONNECT 1
+#define MQTT_PUBLISH 3
+#define MQTT_PUBACK 4
+#define MQTT_SUBSCRIBE 8
+
+// Maximum buffer size for data, the same as in main.c
+#define MAX_BUFF 256
+
+// Time the subscriber waits for the last messages after the publisher is done
+#define DRAIN_TIMEOUT_NS 2000000000LL
+
+typedef struct {
+    const char* host;
+    const char* port;
+    const char* topic;
+    int count;      // Messages to publish
+    int rate;       // Messages per second, 0 as fast as possible
+    int qos;
+} bench_config_t;
+
+// Display model of the subscriber, the same buffers as in main.c
+static char TEMPERATURE[MAX_BUFF];
+static char HUMIDITY[MAX_BUFF];
+static char VISIBILITY[MAX_BUFF];
+
+static const telemetry_store_t TELEMETRY = {
+    .temperature = TEMPERATURE,
+    .humidity = HUMIDITY,
+    .visibility = VISIBILITY,
+    .size = MAX_BUFF,
+};
+
+static bench_config_t config = {
+    .host = "127.0.0.1",
+    .port = "1883",
+    .topic = "bench/test",
+    .count = 10000,
+    .rate = 1000,
+    .qos = 0,
+};
+
+// Latency of every message by sequence number, -1 if not received
+static int64_t* latency_ns;
+
+static int64_t first_send_ns;
+static volatile int64_t last_recv_ns;
+static volatile int received;
+
+/**
+ * @brief Returns the monotonic time, shared by both threads.
+ *
+ * @return Time in nanoseconds.
+ */
+static int64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief Exits the benchmark with an error message.
+ *
+ * @param message The error message.
+ */
+static void exit_error(const char* message) {
+    fprintf(stderr, "%s\n", message);
+    exit(1);
+}
+
+/**
+ * @brief Writes the whole buffer to the socket.
+ *
+ * @param fd Socket.
+ * @param data Buffer.
+ * @param len Length of the buffer.
+ */
+static void send_all(int fd, const uint8_t* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, 0);
+        if (n <= 0) {
+            exit_error("Error when sending to the broker");
+        }
+        data += n;
+        len -= n;
+    }
+}
+
+/**
+ * @brief Reads exactly len bytes from the socket.
+ *
+ * @param fd Socket.
+ * @param data Buffer.
+ * @param len Number of bytes.
+ * @return False if the connection was closed.
+ */
+static bool recv_all(int fd, uint8_t* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = recv(fd, data, len, 0);
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+/**
+ * @brief Sends one packet with its fixed header.
+ *
+ * @param fd Socket.
+ * @param header First byte of the fixed header.
+ * @param body Variable header and payload.
+ * @param len Length of the body.
+ */
+static void mqtt_send(int fd, uint8_t header, const uint8_t* body, size_t len) {
+    uint8_t buff[5 + 2 * MAX_BUFF];
+    size_t pos = 0;
+
+    buff[pos++] = header;
+    size_t remaining = len;
+    do {
+        uint8_t byte = remaining % 128;
+        remaining /= 128;
+        buff[pos++] = remaining ? byte | 0x80 : byte;
+    } while (remaining);
+
+    memcpy(buff + pos, body, len);
+    send_all(fd, buff, pos + len);
+}
+
+/**
+ * @brief Reads one packet.
+ *
+ * @param fd Socket.
+ * @param header First byte of the fixed header.
+ * @param body Buffer of 2 * MAX_BUFF bytes for the rest of the packet.
+ * @return Length of the body, -1 if the connection was closed or the packet is too long.
+ */
+static int mqtt_recv(int fd, uint8_t* header, uint8_t* body) {
+    size_t len = 0;
+    int shift = 0;
+    uint8_t byte;
+
+    if (!recv_all(fd, header, 1)) {
+        return -1;
+    }
+
+    do {
+        if (!recv_all(fd, &byte, 1)) {
+            return -1;
+        }
+        len |= (size_t)(byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+
+    if (len > 2 * MAX_BUFF || !recv_all(fd, body, len)) {
+        return -1;
+    }
+
+    return len;
+}
+
+/**
+ * @brief Appends a length prefixed string.
+ *
+ * @param buff Buffer.
+ * @param pos Position in the buffer.
+ * @param text String.
+ * @return Position after the string.
+ */
+static size_t put_str(uint8_t* buff, size_t pos, const char* text) {
+    size_t len = strlen(text);
+    buff[pos++] = len >> 8;
+    buff[pos++] = len & 0xff;
+    memcpy(buff + pos, text, len);
+    return pos + len;
+}
+
+/**
+ * @brief Opens an MQTT connection with a clean session and waits for the CONNACK.
+ *
+ * @param client_id Client identifier.
+ * @return Socket of the connection.
+ */
+static int mqtt_connect(const char* client_id) {
+    struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+    struct addrinfo* res;
+
+    if (getaddrinfo(config.host, config.port, &hints, &res) != 0) {
+        exit_error("Error resolving the broker");
+    }
+
+    int fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (fd < 0 || connect(fd, res->ai_addr, res->ai_addrlen) != 0) {
+        exit_error("Error connecting to the broker, is server/broker.py running?");
+    }
+    freeaddrinfo(res);
+
+    // Small messages, do not let Nagle hold them back
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    uint8_t body[MAX_BUFF];
+    size_t pos = put_str(body, 0, "MQTT");
+    body[pos++] = 4;        // Protocol level 3.1.1
+    body[pos++] = 0x02;     // Clean session
+    body[pos++] = 0;
+    body[pos++] = 60;       // Keep alive
+    pos = put_str(body, pos, client_id);
+    mqtt_send(fd, MQTT_CONNECT << 4, body, pos);
+
+    uint8_t header;
+    if (mqtt_recv(fd, &header, body) != 2 || header >> 4 != 2 || body[1] != 0) {
+        exit_error("Broker refused the connection");
+    }
+
+    return fd;
+}
+
+/**
+ * @brief Drops the PUBACKs of a QoS 1 publisher, so the socket does not fill up.
+ *
+ * @param param Socket of the publisher.
+ */
+static void* puback_task(void* param) {
+    int fd = (int)(intptr_t)param;
+    uint8_t header;
+    uint8_t body[2 * MAX_BUFF];
+
+    while (mqtt_recv(fd, &header, body) >= 0) {
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Updates the display model with every data message and records its latency.
+ *
+ * @param param Socket of the subscriber.
+ */
+static void* subscriber_task(void* param) {
+    int fd = (int)(intptr_t)param;
+    uint8_t header;
+    uint8_t body[2 * MAX_BUFF];
+    int len;
+
+    while ((len = mqtt_recv(fd, &header, body)) >= 0) {
+        if (header >> 4 != MQTT_PUBLISH) {
+            continue;
+        }
+
+        int qos = (header >> 1) & 0x03;
+        int pos = 2 + ((body[0] << 8) | body[1]);
+        if (qos) {
+            // Acknowledge like esp-mqtt does, before the event handler runs
+            mqtt_send(fd, MQTT_PUBACK << 4, body + pos, 2);
+            pos += 2;
+        }
+
+        const char* payload = (const char*)body + pos;
+        int payload_len = len - pos;
+
+        // The firmware data path, see mqtt_event_handler()
+        if (telemetry_parse(&TELEMETRY, payload, payload_len) != TELEMETRY_DATA) {
+            continue;
+        }
+        int64_t t_recv = now_ns();
+
+        // Sequence number and send time follow the visibility
+        char buff[2 * MAX_BUFF];
+        memcpy(buff, payload, payload_len);
+        buff[payload_len] = '\0';
+
+        char* fields = strrchr(buff, ',');
+        char* seq_field = NULL;
+        if (fields != NULL) {
+            *fields = '\0';
+            seq_field = strrchr(buff, ',');
+        }
+        if (seq_field == NULL) {
+            continue;
+        }
+
+        long seq = strtol(seq_field + 1, NULL, 10);
+        int64_t t_send = strtoll(fields + 1, NULL, 10);
+        if (seq < 0 || seq >= config.count || latency_ns[seq] >= 0) {
+            continue;
+        }
+
+        latency_ns[seq] = t_recv - t_send;
+        last_recv_ns = t_recv;
+        received++;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Compares two latencies for qsort.
+ */
+static int compare_latency(const void* a, const void* b) {
+    int64_t x = *(const int64_t*)a;
+    int64_t y = *(const int64_t*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Prints the usage and exits.
+ *
+ * @param name Name of the binary.
+ */
+static void usage(const char* name) {
+    fprintf(stderr,
+            "Usage: %s [-h host] [-p port] [-t topic] [-n count] [-r rate] [-q qos]\n"
+            "  -r 0 publishes as fast as possible, -q is 0 or 1\n", name);
+    exit(1);
+}
+
+int main(int argc, char** argv) {
+    int opt;
+    while ((opt = getopt(argc, argv, "h:p:t:n:r:q:")) != -1) {
+        switch (opt) {
+        case 'h': config.host = optarg; break;
+        case 'p': config.port = optarg; break;
+        case 't': config.topic = optarg; break;
+        case 'n': config.count = atoi(optarg); break;
+        case 'r': config.rate = atoi(optarg); break;
+        case 'q': config.qos = atoi(optarg); break;
+        default: usage(argv[0]);
+        }
+    }
+    if (config.count <= 0 || config.rate < 0 || config.qos < 0 || config.qos > 1) {
+        usage(argv[0]);
+    }
+
+    latency_ns = malloc(config.count * sizeof(int64_t));
+    if (latency_ns == NULL) {
+        exit_error("Error allocating the results");
+    }
+    for (int i = 0; i < config.count; i++) {
+        latency_ns[i] = -1;
+    }
+
+    // Subscribe first, the SUBACK tells the subscription is in place before the first publish
+    int sub_fd = mqtt_connect("bench_sub");
+    uint8_t body[2 * MAX_BUFF];
+    size_t pos = 0;
+    body[pos++] = 0;
+    body[pos++] = 1;    // Packet identifier
+    pos = put_str(body, pos, config.topic);
+    body[pos++] = config.qos;
+    mqtt_send(sub_fd, (MQTT_SUBSCRIBE << 4) | 0x02, body, pos);
+
+    uint8_t header;
+    if (mqtt_recv(sub_fd, &header, body) < 0 || header >> 4 != 9) {
+        exit_error("Broker refused the subscription");
+    }
+
+    int pub_fd = mqtt_connect("bench_pub");
+
+    pthread_t sub_thread, puback_thread;
+    pthread_create(&sub_thread, NULL, subscriber_task, (void*)(intptr_t)sub_fd);
+    if (config.qos) {
+        pthread_create(&puback_thread, NULL, puback_task, (void*)(intptr_t)pub_fd);
+    }
+
+    printf("Publishing %d messages on %s at %s, QoS %d\n", config.count, config.topic,
+           config.rate ? "a fixed rate" : "full speed", config.qos);
+
+    first_send_ns = now_ns();
+    for (int i = 0; i < config.count; i++) {
+        if (config.rate) {
+            // Pace against the start, so a slow send does not shift the later ones
+            int64_t due = first_send_ns + (int64_t)i * 1000000000LL / config.rate;
+            int64_t wait = due - now_ns();
+            if (wait > 0) {
+                struct timespec ts = { wait / 1000000000LL, wait % 1000000000LL };
+                nanosleep(&ts, NULL);
+            }
+        }
+
+        char payload[MAX_BUFF];
+        int payload_len = snprintf(payload, sizeof(payload), "%s 24.4 C,46.3 %%,98.2 %%,%d,%lld",
+                                   PREFIX_DATA, i, (long long)now_ns());
+
+        pos = put_str(body, 0, config.topic);
+        if (config.qos) {
+            uint16_t id = i % 0xffff + 1;
+            body[pos++] = id >> 8;
+            body[pos++] = id & 0xff;
+        }
+        memcpy(body + pos, payload, payload_len);
+        mqtt_send(pub_fd, (MQTT_PUBLISH << 4) | (config.qos << 1), body, pos + payload_len);
+    }
+    int64_t last_send_ns = now_ns();
+
+    // Give the last messages time to arrive, then stop the subscriber
+    while (received < config.count && now_ns() - last_send_ns < DRAIN_TIMEOUT_NS) {
+        usleep(1000);
+    }
+    shutdown(sub_fd, SHUT_RDWR);
+    shutdown(pub_fd, SHUT_RDWR);
+    pthread_join(sub_thread, NULL);
+    if (config.qos) {
+        pthread_join(puback_thread, NULL);
+    }
+
+    int n = 0;
+    for (int i = 0; i < config.count; i++) {
+        if (latency_ns[i] >= 0) {
+            latency_ns[n++] = latency_ns[i];
+        }
+    }
+
+    if (n == 0) {
+        exit_error("No message received");
+    }
+
+    qsort(latency_ns, n, sizeof(int64_t), compare_latency);
+
+    const double percentiles[] = { 50, 90, 99, 99.9 };
+    printf("Received %d/%d, lost %d\n", n, config.count, config.count - n);
+    printf("Throughput %.0f msg/s\n", n * 1e9 / (double)(last_recv_ns - first_send_ns));
+    printf("Latency publish -> display model (us):");
+    for (size_t i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); i++) {
+        int idx = (int)(percentiles[i] / 100.0 * (n - 1));
+        printf(" p%g=%.1f", percentiles[i], latency_ns[idx] / 1000.0);
+    }
+    printf(" max=%.1f\n", latency_ns[n - 1] / 1000.0);
+    printf("Last data: %s | %s | %s\n", TEMPERATURE, HUMIDITY, VISIBILITY);
+
+    close(sub_fd);
+    close(pub_fd);
+    free(latency_ns);
+    return n == config.count ? 0 : 2;
+}
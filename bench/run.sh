@@ -0,0 +1,19 @@
+#!/bin/sh
+# Builds the benchmark, runs it against server/broker.py on a free local port and stops the broker.
+# Arguments go to bench_mqtt, e.g. ./bench/run.sh -n 20000 -r 0 -q 1
+set -e
+
+DIR=$(cd "$(dirname "$0")" && pwd)
+PORT=${BENCH_PORT:-18830}
+
+cmake -S "$DIR" -B "$DIR/build" -DCMAKE_BUILD_TYPE=Release > /dev/null
+cmake --build "$DIR/build" > /dev/null
+
+python3 "$DIR/../server/broker.py" --port "$PORT" &
+BROKER=$!
+trap 'kill $BROKER 2> /dev/null' EXIT
+
+# Wait for the broker to listen
+sleep 1
+
+"$DIR/build/bench_mqtt" -p "$PORT" "$@"
@@ -7,6 +7,7 @@
 
 #include <stdio.h>
 #include "driver/i2c.h"
+#include "esp_timer.h"
 #include "apds9960.h"
 
 #define APDS9960_TIMEOUT_MS_DEFAULT   (1000)
@@ -33,6 +34,9 @@ typedef struct {
     uint8_t down_cnt;              /*< counter of down gesture >*/
     uint8_t left_cnt;              /*< counter of left gesture >*/
     uint8_t right_cnt;             /*< counter of right gesture >*/
+    int64_t valid_us;              /*< first valid poll of the gesture in progress >*/
+    int64_t fifo_us;               /*< end of its first FIFO read >*/
+    apds9960_gesture_timing_t timing; /*< timing of the last gesture returned >*/
 } apds9960_dev_t;
 
 static float __powf(const float x, const float y)
@@ -148,6 +152,8 @@ void apds9960_reset_counts(apds9960_handle_t sensor)
     sens->down_cnt = 0;
     sens->left_cnt = 0;
     sens->right_cnt = 0;
+    sens->valid_us = 0;
+    sens->fifo_us = 0;
 }
 
 esp_err_t apds9960_set_timeout(apds9960_handle_t sensor, uint32_t tout_ms)
@@ -299,15 +305,11 @@ apds9960_again_t apds9960_get_ambient_light_gain(apds9960_handle_t sensor)
 
 esp_err_t apds9960_enable_gesture_interrupt(apds9960_handle_t sensor, bool en)
 {
-    esp_err_t ret;
+    // GIEN lives in GCONF4, GEN in the ENABLE register only starts or stops the gesture engine
     apds9960_dev_t *sens = (apds9960_dev_t *) sensor;
-    sens->_enable_t.gen = en;
-    ret = i2c_bus_write_byte(sens->i2c_dev, APDS9960_MODE_ENABLE,
-                             ((sens->_enable_t.gen << 6) | (sens->_enable_t.pien << 5) | (sens->_enable_t.aien << 4)
-                              | (sens->_enable_t.wen << 3) | (sens->_enable_t.pen << 2) | (sens->_enable_t.aen << 1)
-                              | sens->_enable_t.pon));
-    apds9960_clear_interrupt(sensor);
-    return ret;
+    sens->_gconf4_t.gien = en;
+    return i2c_bus_write_byte(sens->i2c_dev, APDS9960_GCONF4,
+                              (sens->_gconf4_t.gien << 1) | sens->_gconf4_t.gmode);
 }
 
 esp_err_t apds9960_enable_proximity_engine(apds9960_handle_t sensor, bool en)
@@ -632,12 +634,20 @@ uint8_t apds9960_read_gesture(apds9960_handle_t sensor)
         gestureReceived = 0;
 
         if (!apds9960_gesture_valid(sensor)) {
+            /* a partial gesture ends here, the next one must not inherit its counts or stamps */
+            apds9960_reset_counts(sensor);
             return 0;
         }
+        if (sens->valid_us == 0) {
+            sens->valid_us = esp_timer_get_time();
+        }
 
         vTaskDelay(30 / portTICK_RATE_MS);
         i2c_bus_read_byte(sens->i2c_dev, APDS9960_GFLVL, &toRead);
         i2c_bus_read_bytes(sens->i2c_dev, APDS9960_GFIFO_U, toRead, buf);
+        if (sens->fifo_us == 0) {
+            sens->fifo_us = esp_timer_get_time();
+        }
 
         if (abs((int) buf[0] - (int) buf[1]) > 13) {
             up_down_diff += (int) buf[0] - (int) buf[1];
@@ -684,12 +694,24 @@ uint8_t apds9960_read_gesture(apds9960_handle_t sensor)
         }
 
         if (gestureReceived || xTaskGetTickCount() - t > (300 / portTICK_RATE_MS)) {
+            if (gestureReceived) {
+                sens->timing.valid_us = sens->valid_us;
+                sens->timing.fifo_us = sens->fifo_us;
+                sens->timing.classified_us = esp_timer_get_time();
+            }
             apds9960_reset_counts(sensor);
             return gestureReceived;
         }
     }
 }
 
+esp_err_t apds9960_get_gesture_timing(apds9960_handle_t sensor, apds9960_gesture_timing_t *timing)
+{
+    apds9960_dev_t *sens = (apds9960_dev_t *) sensor;
+    *timing = sens->timing;
+    return ESP_OK;
+}
+
 bool apds9960_gesture_valid(apds9960_handle_t sensor)
 {
     uint8_t data;
@@ -724,6 +724,30 @@ esp_err_t apds9960_set_gesture_offset(apds9960_handle_t sensor,
  */
 uint8_t apds9960_read_gesture(apds9960_handle_t sensor);
 
+/**
+ * @brief Timing of a gesture, in microseconds of esp_timer_get_time()
+ */
+typedef struct {
+    int64_t valid_us;       /*!< first poll that found the gesture valid */
+    int64_t fifo_us;        /*!< end of the first FIFO read of the gesture */
+    int64_t classified_us;  /*!< direction of the gesture known */
+} apds9960_gesture_timing_t;
+
+/**
+ * @brief Get the timing of the last gesture apds9960_read_gesture returned
+ *
+ * A gesture can span several calls of apds9960_read_gesture, its first valid poll is kept with the
+ * direction counts until they are reset, which also happens when the sensor no longer reports a
+ * valid gesture.
+ *
+ * @param sensor object handle of apds9960
+ * @param timing timing of the gesture
+ *
+ * @return
+ *     - ESP_OK Success
+ */
+esp_err_t apds9960_get_gesture_timing(apds9960_handle_t sensor, apds9960_gesture_timing_t *timing);
+
 /**
  * @brief Reset some temp counts of gesture detection
  *
@@ -761,6 +785,9 @@ esp_err_t apds9960_set_gesture_pulse(apds9960_handle_t sensor,
 /**
  * @brief Turns gesture-related interrupts on or off
  *
+ * With the interrupt on, INT is pulled low once the gesture FIFO holds more datasets than the FIFO
+ * threshold and released when the FIFO has been read empty.
+ *
  * @param sensor object handle of apds9960
  * @param en true to enable interrupts, false to disable interrupts
  *
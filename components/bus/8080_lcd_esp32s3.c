@@ -19,15 +19,23 @@
 #include "esp32s3/rom/lldesc.h"
 #include "esp32s3/rom/gpio.h"
 #include "driver/gpio.h"
+#include "hal/gpio_ll.h"
 #include "soc/gpio_periph.h"
 #include "soc/system_reg.h"
 #include "soc/lcd_cam_struct.h"
 #include "soc/lcd_cam_reg.h"
 #include "soc/gdma_struct.h"
-#include "soc/gdma_periph.h"
-#include "soc/gdma_reg.h"
+#if (ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0))
+#include "esp_memory_utils.h"
+#else
+#include "soc/soc_memory_layout.h"
+#endif
+#if CONFIG_LCD_DMA_PSRAM_EDMA
+#include "esp32s3/rom/cache.h"
+#endif
 
 #include "i2s_lcd_driver.h"
+#include "i2s_lcd_priv.h"
 
 static const char *TAG = "ESP32S3_LCD";
 
@@ -36,7 +44,9 @@ static const char *TAG = "ESP32S3_LCD";
         return (ret);                                                                   \
     }
 
-#define LCD_CAM_DMA_NODE_BUFFER_MAX_SIZE  (4000)
+#define LCD_CAM_EDMA_BLOCK_SIZE  (16)  // out_ext_mem_bk_size is left at 0 by lcd_start
+#define LCD_TRANS_SEG_MAX  (I2S_LCD_TRANS_MAX * 2)  // Command and parameters of every transaction
+#define LCD_TRANS_BUFFER_SIZE  (I2S_LCD_TRANS_MAX * (I2S_LCD_TRANS_PARAM_MAX + 4))
 
 #if (ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0))
 #define ets_delay_us esp_rom_delay_us
@@ -55,7 +65,16 @@ typedef struct {
     uint8_t  width;
     bool swap_data;
     uint8_t dma_num;
-    intr_handle_t dma_out_intr_handle;
+    intr_handle_t lcd_intr_handle;
+    i2s_lcd_common_t common;        // Idle semaphore, asynchronous write and counters
+    bool async_zero_copy;
+    lldesc_t trans_dma[LCD_TRANS_SEG_MAX];  // One descriptor per command or parameter segment of i2s_lcd_write_trans
+    uint8_t trans_rs[LCD_TRANS_SEG_MAX];
+    uint32_t trans_buffer[LCD_TRANS_BUFFER_SIZE / 4];
+    uint32_t trans_seg_cnt;         // Segments still to be started from the ISR, 0 once the block data is reached
+    uint32_t trans_seg_pos;
+    int rs_io_num;
+    uint32_t rs_level;
 } lcd_cam_obj_t;
 
 typedef struct {
@@ -65,21 +84,6 @@ typedef struct {
 } i2s_lcd_driver_t;
 
 
-static void IRAM_ATTR dma_isr(void *arg)
-{
-    BaseType_t woken = pdFALSE;
-    lcd_cam_obj_t *lcd_cam_obj = (lcd_cam_obj_t *)arg;
-    uint32_t out_status = GDMA.channel[lcd_cam_obj->dma_num].out.int_st.val;
-    if (out_status & GDMA_OUT_EOF_CH0_INT_ST) {
-        GDMA.channel[lcd_cam_obj->dma_num].out.int_clr.val = GDMA_OUT_EOF_CH0_INT_ST;
-        xQueueSendFromISR(lcd_cam_obj->event_queue, &out_status, &woken);
-    }
-
-    if (woken == pdTRUE) {
-        portYIELD_FROM_ISR();
-    }
-}
-
 static void lcd_dma_set_int(lcd_cam_obj_t *lcd_cam_obj)
 {
     // Generate a data DMA linked list
@@ -94,7 +98,7 @@ static void lcd_dma_set_int(lcd_cam_obj_t *lcd_cam_obj)
     lcd_cam_obj->dma[lcd_cam_obj->dma_node_cnt - 1].empty = (uint32_t)NULL;
 }
 
-static void lcd_dma_set_left(lcd_cam_obj_t *lcd_cam_obj, int pos, size_t len)
+static void IRAM_ATTR lcd_dma_set_left(lcd_cam_obj_t *lcd_cam_obj, int pos, size_t len)
 {
     int end_pos = 0, size = 0;
     // Processing data length is an integer multiple of lcd_cam_obj->lcd.dma_node_buffer_size
@@ -112,9 +116,13 @@ static void lcd_dma_set_left(lcd_cam_obj_t *lcd_cam_obj, int pos, size_t len)
     lcd_cam_obj->dma[end_pos].empty = (uint32_t)NULL;
 }
 
-static void lcd_start(uint32_t dma_num, uint32_t addr, size_t len)
+/*
+ * Every transfer is started once the previous one has left the bus, i.e. after its trans done interrupt,
+ * so lcd_start has already cleared and RS can be switched right away.
+ */
+static void IRAM_ATTR lcd_start(uint32_t dma_num, uint32_t addr, size_t len)
 {
-    while (LCD_CAM.lcd_user.lcd_start);
+    LCD_CAM.lc_dma_int_clr.lcd_trans_done_int_clr = 1;
     LCD_CAM.lcd_user.lcd_reset = 1;
     LCD_CAM.lcd_user.lcd_reset = 0;
     LCD_CAM.lcd_misc.lcd_afifo_reset = 1;
@@ -130,7 +138,6 @@ static void lcd_start(uint32_t dma_num, uint32_t addr, size_t len)
     GDMA.channel[dma_num].out.conf0.out_data_burst_en = 1;
     GDMA.channel[dma_num].out.peri_sel.sel = 5;
     GDMA.channel[dma_num].out.pri.tx_pri = 1;
-    GDMA.channel[dma_num].out.int_ena.out_eof = 1;
     GDMA.channel[dma_num].out.link.addr = addr;
     GDMA.channel[dma_num].out.link.start = 1;
     ets_delay_us(1);
@@ -138,6 +145,237 @@ static void lcd_start(uint32_t dma_num, uint32_t addr, size_t len)
     LCD_CAM.lcd_user.lcd_start = 1;
 }
 
+static void IRAM_ATTR lcd_set_rs(lcd_cam_obj_t *lcd_cam_obj, uint32_t level)
+{
+    if (lcd_cam_obj->rs_level != level) {
+        gpio_ll_set_level(&GPIO, lcd_cam_obj->rs_io_num, level);
+        lcd_cam_obj->rs_level = level;
+    }
+}
+
+static void IRAM_ATTR lcd_trans_start_seg(lcd_cam_obj_t *lcd_cam_obj, uint32_t pos)
+{
+    lcd_set_rs(lcd_cam_obj, lcd_cam_obj->trans_rs[pos]);
+    LCD_CAM.lcd_user.lcd_8bits_order = 0;
+    lcd_start(lcd_cam_obj->dma_num, ((uint32_t)&lcd_cam_obj->trans_dma[pos]) & 0xfffff, 0);
+}
+
+#if CONFIG_LCD_DMA_ZERO_COPY
+static void IRAM_ATTR lcd_dma_set_zero_copy(lcd_cam_obj_t *lcd_cam_obj, int pos, const uint8_t *data, size_t len)
+{
+    // Point the nodes of one half directly at the caller's buffer, len <= dma_half_buffer_size
+    int start_pos = (pos % 2) * lcd_cam_obj->dma_half_node_cnt;
+    int x = start_pos;
+    while (len) {
+        size_t size = len > lcd_cam_obj->dma_node_buffer_size ? lcd_cam_obj->dma_node_buffer_size : len;
+        lcd_cam_obj->dma[x].size = size;
+        lcd_cam_obj->dma[x].length = size;
+        lcd_cam_obj->dma[x].buf = (uint8_t *)data;
+        lcd_cam_obj->dma[x].eof = 0;
+        lcd_cam_obj->dma[x].empty = (uint32_t)&lcd_cam_obj->dma[x + 1];
+        data += size;
+        len -= size;
+        x++;
+    }
+    // Process the tail node to make it a DMA tail
+    lcd_cam_obj->dma[x - 1].eof = 1;
+    lcd_cam_obj->dma[x - 1].empty = (uint32_t)NULL;
+}
+
+static bool lcd_dma_zero_copy_capable(lcd_cam_obj_t *lcd_cam_obj, const uint8_t *data, size_t len)
+{
+    // GDMA burst mode needs word aligned address and length
+    if ((uint32_t)data % 4 || len % 4) {
+        return false;
+    }
+    if (esp_ptr_dma_capable(data)) {
+        return true;
+    }
+#if CONFIG_LCD_DMA_PSRAM_EDMA
+    // EDMA reads PSRAM in blocks, every node has to start and end on a block boundary
+    return esp_ptr_external_ram(data) && ((uint32_t)data % LCD_CAM_EDMA_BLOCK_SIZE == 0) && (len % LCD_CAM_EDMA_BLOCK_SIZE == 0)
+           && (lcd_cam_obj->dma_node_buffer_size % LCD_CAM_EDMA_BLOCK_SIZE == 0);
+#else
+    return false;
+#endif
+}
+
+static void lcd_dma_sync_zero_copy(const uint8_t *data, size_t len)
+{
+#if CONFIG_LCD_DMA_PSRAM_EDMA
+    // EDMA bypasses the cache, write back what the CPU has rendered so far
+    if (esp_ptr_external_ram(data)) {
+        Cache_WriteBack_Addr((uint32_t)data, len);
+    }
+#endif
+}
+
+static void lcd_write_data_zero_copy(lcd_cam_obj_t *lcd_cam_obj, const uint8_t *data, size_t len)
+{
+    int event  = 0;
+    int x = 0;
+    uint32_t half_buffer_size = lcd_cam_obj->dma_half_buffer_size;
+    lcd_dma_sync_zero_copy(data, len);
+    LCD_CAM.lcd_user.lcd_8bits_order = lcd_cam_obj->swap_data ? 1 : 0;
+    // Start signal
+    xQueueSend(lcd_cam_obj->event_queue, &event, 0);
+    // Descriptors of one half are rebuilt while the other half is transferred
+    for (x = 0; len; x++) {
+        size_t size = len > half_buffer_size ? half_buffer_size : len;
+        lcd_dma_set_zero_copy(lcd_cam_obj, x, data, size);
+        data += size;
+        len -= size;
+        if (x && uxQueueMessagesWaiting(lcd_cam_obj->event_queue)) {
+            lcd_cam_obj->common.stall_cnt++;
+        }
+        xQueueReceive(lcd_cam_obj->event_queue, (void *)&event, portMAX_DELAY);
+        lcd_start(lcd_cam_obj->dma_num, ((uint32_t)&lcd_cam_obj->dma[(x % 2) * lcd_cam_obj->dma_half_node_cnt]) & 0xfffff, size);
+    }
+    xQueueReceive(lcd_cam_obj->event_queue, (void *)&event, portMAX_DELAY);
+    LCD_PERF_WRITE_END(&lcd_cam_obj->common.perf);
+}
+#endif
+
+static void IRAM_ATTR lcd_async_fill(lcd_cam_obj_t *lcd_cam_obj, uint32_t slot)
+{
+    size_t size = lcd_cam_obj->common.async_left < lcd_cam_obj->dma_half_buffer_size ? lcd_cam_obj->common.async_left : lcd_cam_obj->dma_half_buffer_size;
+#if CONFIG_LCD_DMA_ZERO_COPY
+    if (lcd_cam_obj->async_zero_copy) {
+        lcd_dma_set_zero_copy(lcd_cam_obj, slot, lcd_cam_obj->common.async_data, size);
+    } else
+#endif
+    {
+        memcpy((uint8_t *)lcd_cam_obj->dma[(slot % 2) * lcd_cam_obj->dma_half_node_cnt].buf, lcd_cam_obj->common.async_data, size);
+        if (size < lcd_cam_obj->dma_half_buffer_size) {
+            lcd_dma_set_left(lcd_cam_obj, slot, size);
+        }
+    }
+    lcd_cam_obj->common.async_data += size;
+    lcd_cam_obj->common.async_left -= size;
+}
+
+static void IRAM_ATTR lcd_async_done_isr(lcd_cam_obj_t *lcd_cam_obj, BaseType_t *woken)
+{
+    if (lcd_cam_obj->trans_seg_cnt) {
+        if (lcd_cam_obj->trans_seg_pos < lcd_cam_obj->trans_seg_cnt) {
+            lcd_trans_start_seg(lcd_cam_obj, lcd_cam_obj->trans_seg_pos++);
+            return;
+        }
+        // All commands are out, the block data and any later write go at data level
+        lcd_cam_obj->trans_seg_cnt = 0;
+        lcd_set_rs(lcd_cam_obj, LCD_DATA_LEV);
+        LCD_CAM.lcd_user.lcd_8bits_order = lcd_cam_obj->swap_data ? 1 : 0;
+    }
+    if (lcd_cam_obj->common.async_pending) {
+        // Start the half filled ahead of time, then refill the half which has just been sent
+        uint32_t slot = lcd_cam_obj->common.async_slot++;
+        lcd_start(lcd_cam_obj->dma_num, ((uint32_t)&lcd_cam_obj->dma[(slot % 2) * lcd_cam_obj->dma_half_node_cnt]) & 0xfffff, 0);
+        lcd_cam_obj->common.async_pending = false;
+        if (lcd_cam_obj->common.async_left) {
+            lcd_async_fill(lcd_cam_obj, lcd_cam_obj->common.async_slot);
+            lcd_cam_obj->common.async_pending = true;
+            // The half started above has already drained, the bus sat idle until this refill
+            if (LCD_CAM.lc_dma_int_raw.lcd_trans_done_int_raw) {
+                lcd_cam_obj->common.stall_cnt++;
+            }
+        }
+        return;
+    }
+    i2s_lcd_async_done_isr(&lcd_cam_obj->common, woken);
+}
+
+static void IRAM_ATTR lcd_isr(void *arg)
+{
+    BaseType_t woken = pdFALSE;
+    lcd_cam_obj_t *lcd_cam_obj = (lcd_cam_obj_t *)arg;
+    LCD_PERF_ISR_START();
+    uint32_t status = LCD_CAM.lc_dma_int_st.val;
+    // Unlike the DMA EOF, trans done is only raised once the last word has left the bus
+    if (status & LCD_CAM_LCD_TRANS_DONE_INT_ST) {
+        LCD_CAM.lc_dma_int_clr.val = LCD_CAM_LCD_TRANS_DONE_INT_ST;
+        lcd_cam_obj->common.isr_cnt++;
+        if (lcd_cam_obj->common.async_busy) {
+            lcd_async_done_isr(lcd_cam_obj, &woken);
+        } else {
+            xQueueSendFromISR(lcd_cam_obj->event_queue, &status, &woken);
+        }
+    }
+
+    LCD_PERF_ISR_END(&lcd_cam_obj->common.perf);
+    if (woken == pdTRUE) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+static void lcd_write_async(lcd_cam_obj_t *lcd_cam_obj, i2s_lcd_handle_t handle, const uint8_t *data, size_t len, i2s_lcd_trans_done_cb_t done_cb, void *user_ctx)
+{
+    i2s_lcd_async_begin(&lcd_cam_obj->common, handle, data, len, done_cb, user_ctx);
+    lcd_dma_set_int(lcd_cam_obj);
+    LCD_CAM.lcd_user.lcd_8bits_order = lcd_cam_obj->swap_data ? 1 : 0;
+#if CONFIG_LCD_DMA_ZERO_COPY
+    lcd_cam_obj->async_zero_copy = lcd_dma_zero_copy_capable(lcd_cam_obj, data, len);
+    if (lcd_cam_obj->async_zero_copy) {
+        lcd_dma_sync_zero_copy(data, len);
+    }
+#endif
+    // Fill both halves here, the ISR takes over refilling from the third one on
+    lcd_async_fill(lcd_cam_obj, 0);
+    lcd_cam_obj->common.async_slot = 1;
+    lcd_cam_obj->common.async_pending = false;
+    if (lcd_cam_obj->common.async_left) {
+        lcd_async_fill(lcd_cam_obj, 1);
+        lcd_cam_obj->common.async_pending = true;
+    }
+    lcd_cam_obj->common.async_busy = true;
+    lcd_start(lcd_cam_obj->dma_num, ((uint32_t)&lcd_cam_obj->dma[0]) & 0xfffff, 0);
+}
+
+static uint8_t *lcd_trans_add_seg(void *arg, uint8_t *out, const uint8_t *in, size_t len, uint32_t rs_level)
+{
+    lcd_cam_obj_t *lcd_cam_obj = (lcd_cam_obj_t *)arg;
+    // Segments are sent in memory order, the swap_data setting only applies to block data
+    uint32_t pos = lcd_cam_obj->trans_seg_cnt++;
+    memcpy(out, in, len);
+    lcd_cam_obj->trans_dma[pos].size = len;
+    lcd_cam_obj->trans_dma[pos].length = len;
+    lcd_cam_obj->trans_dma[pos].buf = out;
+    lcd_cam_obj->trans_dma[pos].eof = 1;
+    lcd_cam_obj->trans_dma[pos].empty = (uint32_t)NULL;
+    lcd_cam_obj->trans_rs[pos] = rs_level;
+    return out + ((len + 3) & ~3);
+}
+
+static void lcd_write_trans(lcd_cam_obj_t *lcd_cam_obj, const i2s_lcd_trans_t *trans, uint32_t count, bool stream)
+{
+    const i2s_lcd_trans_t *last = &trans[count - 1];
+    size_t bytes = stream ? last->length : 0;
+    xSemaphoreTake(lcd_cam_obj->common.idle_sem, portMAX_DELAY);
+    lcd_cam_obj->trans_seg_cnt = 0;
+    bytes += i2s_lcd_trans_pack(trans, count, lcd_cam_obj->width == 16 ? 2 : 1, (uint8_t *)lcd_cam_obj->trans_buffer, lcd_trans_add_seg, lcd_cam_obj);
+    LCD_PERF_WRITE_START(&lcd_cam_obj->common.perf, bytes);
+    lcd_cam_obj->common.async_cb = NULL;
+    lcd_cam_obj->common.async_left = 0;
+    lcd_cam_obj->common.async_pending = false;
+    if (stream) {
+        // The first half waits for the ISR to run out of segments
+        lcd_dma_set_int(lcd_cam_obj);
+#if CONFIG_LCD_DMA_ZERO_COPY
+        lcd_cam_obj->async_zero_copy = lcd_dma_zero_copy_capable(lcd_cam_obj, last->data, last->length);
+        if (lcd_cam_obj->async_zero_copy) {
+            lcd_dma_sync_zero_copy(last->data, last->length);
+        }
+#endif
+        lcd_cam_obj->common.async_data = last->data;
+        lcd_cam_obj->common.async_left = last->length;
+        lcd_async_fill(lcd_cam_obj, 0);
+        lcd_cam_obj->common.async_slot = 0;
+        lcd_cam_obj->common.async_pending = true;
+    }
+    lcd_cam_obj->trans_seg_pos = 1;
+    lcd_cam_obj->common.async_busy = true;
+    lcd_trans_start_seg(lcd_cam_obj, 0);
+}
+
 static void lcd_write_data(lcd_cam_obj_t *lcd_cam_obj, const uint8_t *data, size_t len)
 {
     int event  = 0;
@@ -146,6 +384,14 @@ static void lcd_write_data(lcd_cam_obj_t *lcd_cam_obj, const uint8_t *data, size
         ESP_LOGE(TAG, "wrong len!");
         return;
     }
+    i2s_lcd_async_wait(&lcd_cam_obj->common, portMAX_DELAY);
+    LCD_PERF_WRITE_START(&lcd_cam_obj->common.perf, len);
+#if CONFIG_LCD_DMA_ZERO_COPY
+    if (lcd_dma_zero_copy_capable(lcd_cam_obj, data, len)) {
+        lcd_write_data_zero_copy(lcd_cam_obj, data, len);
+        return;
+    }
+#endif
     lcd_dma_set_int(lcd_cam_obj);
     uint32_t half_buffer_size = lcd_cam_obj->dma_half_buffer_size;
     cnt = len / half_buffer_size;
@@ -163,6 +409,9 @@ static void lcd_write_data(lcd_cam_obj_t *lcd_cam_obj, const uint8_t *data, size
             memcpy(out, in, half_buffer_size);
         }
         data += half_buffer_size;
+        if (x && uxQueueMessagesWaiting(lcd_cam_obj->event_queue)) {
+            lcd_cam_obj->common.stall_cnt++;
+        }
         xQueueReceive(lcd_cam_obj->event_queue, (void *)&event, portMAX_DELAY);
         lcd_start(lcd_cam_obj->dma_num, ((uint32_t)&lcd_cam_obj->dma[(x % 2) * lcd_cam_obj->dma_half_node_cnt]) & 0xfffff, half_buffer_size);
     }
@@ -187,10 +436,14 @@ static void lcd_write_data(lcd_cam_obj_t *lcd_cam_obj, const uint8_t *data, size
         }
 
         lcd_dma_set_left(lcd_cam_obj, x, left);
+        if (x && uxQueueMessagesWaiting(lcd_cam_obj->event_queue)) {
+            lcd_cam_obj->common.stall_cnt++;
+        }
         xQueueReceive(lcd_cam_obj->event_queue, (void *)&event, portMAX_DELAY);
         lcd_start(lcd_cam_obj->dma_num, ((uint32_t)&lcd_cam_obj->dma[(x % 2) * lcd_cam_obj->dma_half_node_cnt]) & 0xfffff, left);
     }
     xQueueReceive(lcd_cam_obj->event_queue, (void *)&event, portMAX_DELAY);
+    LCD_PERF_WRITE_END(&lcd_cam_obj->common.perf);
 }
 
 static esp_err_t lcd_cam_config(const i2s_lcd_config_t *config, uint32_t dma_num)
@@ -246,7 +499,10 @@ static esp_err_t lcd_cam_config(const i2s_lcd_config_t *config, uint32_t dma_num
     GDMA.channel[dma_num].out.conf0.out_data_burst_en = 1;
     GDMA.channel[dma_num].out.peri_sel.sel = (config->data_width == 1) ? 1 : 5;
     GDMA.channel[dma_num].out.pri.tx_pri = 1;
-    GDMA.channel[dma_num].out.int_ena.out_eof = 1;
+
+    LCD_CAM.lc_dma_int_clr.val = ~0;
+    LCD_CAM.lc_dma_int_ena.val = 0;
+    LCD_CAM.lc_dma_int_ena.lcd_trans_done_int_ena = 1;
 
     return ESP_OK;
 }
@@ -266,36 +522,49 @@ static void lcd_set_pin(const i2s_lcd_config_t *config)
     }
 }
 
-static esp_err_t lcd_dma_config(lcd_cam_obj_t *lcd_cam_obj, const i2s_lcd_config_t *config)
+static void lcd_dma_free(lcd_cam_obj_t *lcd_cam_obj)
 {
-    int cnt = 0;
-    if (LCD_CAM_DMA_NODE_BUFFER_MAX_SIZE % 2 != 0) {
-        ESP_LOGE(TAG, "need 2-byte aligned data length");
-        return ESP_FAIL;
+    if (lcd_cam_obj->dma) {
+        free(lcd_cam_obj->dma);
+        lcd_cam_obj->dma = NULL;
     }
-
-    if (config->buffer_size >= LCD_CAM_DMA_NODE_BUFFER_MAX_SIZE * 2) {
-        lcd_cam_obj->dma_node_buffer_size = LCD_CAM_DMA_NODE_BUFFER_MAX_SIZE;
-        for (cnt = 0; cnt < config->buffer_size - 8; cnt++) { // Find a buffer size that can divide dma_size
-            if ((config->buffer_size - cnt) % (lcd_cam_obj->dma_node_buffer_size * 2) == 0) {
-                break;
-            }
-        }
-        lcd_cam_obj->dma_buffer_size = config->buffer_size - cnt;
-    } else {
-        lcd_cam_obj->dma_node_buffer_size = config->buffer_size / 2;
-        lcd_cam_obj->dma_buffer_size = lcd_cam_obj->dma_node_buffer_size * 2;
+    if (lcd_cam_obj->dma_buffer) {
+        free(lcd_cam_obj->dma_buffer);
+        lcd_cam_obj->dma_buffer = NULL;
     }
+}
 
-    lcd_cam_obj->dma_half_buffer_size = lcd_cam_obj->dma_buffer_size / 2;
-
-    lcd_cam_obj->dma_node_cnt = (lcd_cam_obj->dma_buffer_size) / lcd_cam_obj->dma_node_buffer_size; // Number of DMA nodes
-    lcd_cam_obj->dma_half_node_cnt = lcd_cam_obj->dma_node_cnt / 2;
+static esp_err_t lcd_dma_config(lcd_cam_obj_t *lcd_cam_obj, uint32_t max_dma_buffer_size, uint32_t dma_node_size)
+{
+    i2s_lcd_dma_layout_t layout;
+    esp_err_t ret = i2s_lcd_dma_layout_calc(max_dma_buffer_size, dma_node_size, &layout);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    dma_node_size = layout.node_size;
+    uint32_t dma_buffer_size = layout.buffer_size;
+    uint32_t dma_node_cnt = dma_buffer_size / dma_node_size; // Number of DMA nodes
+
+    // Allocate the new layout before releasing the current one, so a failure leaves the driver usable
+    lldesc_t *dma = (lldesc_t *)heap_caps_malloc(dma_node_cnt * sizeof(lldesc_t), MALLOC_CAP_DMA);
+    // The ping-pong buffer is also the bounce buffer for PSRAM frames, keep it in internal RAM
+    uint8_t *dma_buffer = (uint8_t *)heap_caps_malloc(dma_buffer_size * sizeof(uint8_t), MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+    if (dma == NULL || dma_buffer == NULL) {
+        ESP_LOGE(TAG, "dma buffer malloc error");
+        free(dma);
+        free(dma_buffer);
+        return ESP_ERR_NO_MEM;
+    }
+    lcd_dma_free(lcd_cam_obj);
+    lcd_cam_obj->dma = dma;
+    lcd_cam_obj->dma_buffer = dma_buffer;
+    lcd_cam_obj->dma_node_buffer_size = dma_node_size;
+    lcd_cam_obj->dma_buffer_size = dma_buffer_size;
+    lcd_cam_obj->dma_half_buffer_size = dma_buffer_size / 2;
+    lcd_cam_obj->dma_node_cnt = dma_node_cnt;
+    lcd_cam_obj->dma_half_node_cnt = dma_node_cnt / 2;
 
     ESP_LOGI(TAG, "lcd_buffer_size: %"PRIu32", lcd_dma_size: %"PRIu32", lcd_dma_node_cnt: %"PRIu32"", lcd_cam_obj->dma_buffer_size, lcd_cam_obj->dma_node_buffer_size, lcd_cam_obj->dma_node_cnt);
-
-    lcd_cam_obj->dma    = (lldesc_t *)heap_caps_malloc(lcd_cam_obj->dma_node_cnt * sizeof(lldesc_t), MALLOC_CAP_DMA);
-    lcd_cam_obj->dma_buffer = (uint8_t *)heap_caps_malloc(lcd_cam_obj->dma_buffer_size * sizeof(uint8_t), MALLOC_CAP_DMA);
     return ESP_OK;
 }
 
@@ -306,6 +575,12 @@ esp_err_t lcd_cam_deinit(i2s_lcd_driver_t *drv)
         return ESP_FAIL;
     }
 
+    if (drv->i2s_lcd_obj->common.idle_sem) {
+        if (drv->i2s_lcd_obj->lcd_intr_handle) { // A transfer can only be in flight once init has completed
+            i2s_lcd_async_wait(&drv->i2s_lcd_obj->common, portMAX_DELAY);
+        }
+        vSemaphoreDelete(drv->i2s_lcd_obj->common.idle_sem);
+    }
     if (drv->i2s_lcd_obj->event_queue) {
         vQueueDelete(drv->i2s_lcd_obj->event_queue);
     }
@@ -316,9 +591,10 @@ esp_err_t lcd_cam_deinit(i2s_lcd_driver_t *drv)
         free(drv->i2s_lcd_obj->dma_buffer);
     }
 
-    if (drv->i2s_lcd_obj->dma_out_intr_handle) {
-        esp_intr_free(drv->i2s_lcd_obj->dma_out_intr_handle);
+    if (drv->i2s_lcd_obj->lcd_intr_handle) {
+        esp_intr_free(drv->i2s_lcd_obj->lcd_intr_handle);
     }
+    LCD_CAM.lc_dma_int_ena.lcd_trans_done_int_ena = 0;
     GDMA.channel[drv->i2s_lcd_obj->dma_num].out.link.start = 0x0;
     free(drv->i2s_lcd_obj);
     drv->i2s_lcd_obj = NULL;
@@ -370,7 +646,7 @@ static esp_err_t lcd_cam_init(i2s_lcd_driver_t *drv, const i2s_lcd_config_t *con
     }
 
     lcd_set_pin(config);
-    ret |= lcd_dma_config(lcd_cam_obj, config);
+    ret |= lcd_dma_config(lcd_cam_obj, config->buffer_size, config->dma_node_size);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "lcd config fail!");
         lcd_cam_deinit(drv);
@@ -378,18 +654,20 @@ static esp_err_t lcd_cam_init(i2s_lcd_driver_t *drv, const i2s_lcd_config_t *con
     }
 
     lcd_cam_obj->event_queue = xQueueCreate(1, sizeof(int));
+    lcd_cam_obj->common.idle_sem = xSemaphoreCreateBinary();
     lcd_cam_obj->width = config->data_width;
     lcd_cam_obj->swap_data = config->swap_data;
-    if (lcd_cam_obj->event_queue == NULL) {
+    if (lcd_cam_obj->event_queue == NULL || lcd_cam_obj->common.idle_sem == NULL) {
         ESP_LOGE(TAG, "lcd config fail!");
         lcd_cam_deinit(drv);
         return ESP_FAIL;
     }
+    xSemaphoreGive(lcd_cam_obj->common.idle_sem);
 
-    ret |= esp_intr_alloc_intrstatus(gdma_periph_signals.groups[0].pairs[lcd_cam_obj->dma_num].tx_irq_id,
+    ret |= esp_intr_alloc_intrstatus(ETS_LCD_CAM_INTR_SOURCE,
                                      ESP_INTR_FLAG_LOWMED | ESP_INTR_FLAG_SHARED | ESP_INTR_FLAG_IRAM,
-                                     (uint32_t)&GDMA.channel[lcd_cam_obj->dma_num].out.int_st, GDMA_OUT_EOF_CH0_INT_ST,
-                                     dma_isr, lcd_cam_obj, &lcd_cam_obj->dma_out_intr_handle);
+                                     (uint32_t)&LCD_CAM.lc_dma_int_st, LCD_CAM_LCD_TRANS_DONE_INT_ST,
+                                     lcd_isr, lcd_cam_obj, &lcd_cam_obj->lcd_intr_handle);
 
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "lcd_cam intr alloc fail!");
@@ -446,6 +724,8 @@ i2s_lcd_handle_t i2s_lcd_driver_init(const i2s_lcd_config_t *config)
     gpio_set_direction(config->pin_num_rs, GPIO_MODE_OUTPUT);
     gpio_set_level(config->pin_num_rs, LCD_DATA_LEV);
     i2s_lcd_drv->rs_io_num = config->pin_num_rs;
+    i2s_lcd_drv->i2s_lcd_obj->rs_io_num = config->pin_num_rs;
+    i2s_lcd_drv->i2s_lcd_obj->rs_level = LCD_DATA_LEV;
 
     return (i2s_lcd_handle_t)i2s_lcd_drv;
 }
@@ -472,6 +752,7 @@ esp_err_t i2s_lcd_write_cmd(i2s_lcd_handle_t handle, uint16_t cmd)
 {
     i2s_lcd_driver_t *i2s_lcd_drv = (i2s_lcd_driver_t *)handle;
     LCD_CHECK(NULL != i2s_lcd_drv, "handle pointer invalid", ESP_ERR_INVALID_ARG);
+    i2s_lcd_async_wait(&i2s_lcd_drv->i2s_lcd_obj->common, portMAX_DELAY);
     gpio_set_level(i2s_lcd_drv->rs_io_num, LCD_CMD_LEV);
     lcd_write_data(i2s_lcd_drv->i2s_lcd_obj, (uint8_t *)&cmd, i2s_lcd_drv->i2s_lcd_obj->width == 16 ? 2 : 1);
     gpio_set_level(i2s_lcd_drv->rs_io_num, LCD_DATA_LEV);
@@ -482,6 +763,7 @@ esp_err_t i2s_lcd_write_command(i2s_lcd_handle_t handle, const uint8_t *cmd, uin
 {
     i2s_lcd_driver_t *i2s_lcd_drv = (i2s_lcd_driver_t *)handle;
     LCD_CHECK(NULL != i2s_lcd_drv, "handle pointer invalid", ESP_ERR_INVALID_ARG);
+    i2s_lcd_async_wait(&i2s_lcd_drv->i2s_lcd_obj->common, portMAX_DELAY);
     gpio_set_level(i2s_lcd_drv->rs_io_num, LCD_CMD_LEV);
     lcd_write_data(i2s_lcd_drv->i2s_lcd_obj, cmd, length);
     gpio_set_level(i2s_lcd_drv->rs_io_num, LCD_DATA_LEV);
@@ -497,6 +779,84 @@ esp_err_t i2s_lcd_write(i2s_lcd_handle_t handle, const uint8_t *data, uint32_t l
     return ESP_OK;
 }
 
+esp_err_t i2s_lcd_write_async(i2s_lcd_handle_t handle, const uint8_t *data, uint32_t length, i2s_lcd_trans_done_cb_t done_cb, void *user_ctx)
+{
+    i2s_lcd_driver_t *i2s_lcd_drv = (i2s_lcd_driver_t *)handle;
+    LCD_CHECK(NULL != i2s_lcd_drv, "handle pointer invalid", ESP_ERR_INVALID_ARG);
+    LCD_CHECK(NULL != data, "data pointer invalid", ESP_ERR_INVALID_ARG);
+    LCD_CHECK(length > 0 && 0 == length % (i2s_lcd_drv->i2s_lcd_obj->width == 16 ? 4 : 2), "wrong len!", ESP_ERR_INVALID_SIZE);
+#if CONFIG_LCD_DMA_ZERO_COPY
+    if (!esp_ptr_internal(data) && !lcd_dma_zero_copy_capable(i2s_lcd_drv->i2s_lcd_obj, data, length)) {
+#else
+    if (!esp_ptr_internal(data)) {
+#endif
+        // PSRAM and flash can't be read from the IRAM interrupt while the cache is disabled,
+        // stream them through the internal bounce buffers from this task instead
+        lcd_write_data(i2s_lcd_drv->i2s_lcd_obj, data, length);
+        if (done_cb) {
+            // Called from this task, there is no interrupt to yield from
+            (void)done_cb(handle, user_ctx);
+        }
+        return ESP_OK;
+    }
+    lcd_write_async(i2s_lcd_drv->i2s_lcd_obj, handle, data, length, done_cb, user_ctx);
+    return ESP_OK;
+}
+
+esp_err_t i2s_lcd_write_trans(i2s_lcd_handle_t handle, const i2s_lcd_trans_t *trans, uint32_t count)
+{
+    i2s_lcd_driver_t *i2s_lcd_drv = (i2s_lcd_driver_t *)handle;
+    LCD_CHECK(NULL != i2s_lcd_drv, "handle pointer invalid", ESP_ERR_INVALID_ARG);
+    uint32_t bus_bytes = i2s_lcd_drv->i2s_lcd_obj->width == 16 ? 2 : 1;
+    esp_err_t ret = i2s_lcd_trans_check(trans, count, bus_bytes);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    const i2s_lcd_trans_t *last = &trans[count - 1];
+    bool stream = false;
+    if (last->length) {
+#if CONFIG_LCD_DMA_ZERO_COPY
+        stream = esp_ptr_internal(last->data) || lcd_dma_zero_copy_capable(i2s_lcd_drv->i2s_lcd_obj, last->data, last->length);
+#else
+        stream = esp_ptr_internal(last->data);
+#endif
+    }
+    lcd_write_trans(i2s_lcd_drv->i2s_lcd_obj, trans, count, stream);
+    if (last->length && !stream) {
+        // PSRAM and flash can't be copied from the IRAM interrupt, write them from this task once the commands are out
+        lcd_write_data(i2s_lcd_drv->i2s_lcd_obj, last->data, last->length);
+    }
+    return ESP_OK;
+}
+
+esp_err_t i2s_lcd_set_dma_layout(i2s_lcd_handle_t handle, uint32_t buffer_size, uint32_t node_size)
+{
+    i2s_lcd_driver_t *i2s_lcd_drv = (i2s_lcd_driver_t *)handle;
+    LCD_CHECK(NULL != i2s_lcd_drv, "handle pointer invalid", ESP_ERR_INVALID_ARG);
+    lcd_cam_obj_t *lcd_cam_obj = i2s_lcd_drv->i2s_lcd_obj;
+    // Holding idle_sem keeps asynchronous writes out while the buffers are replaced
+    xSemaphoreTake(lcd_cam_obj->common.idle_sem, portMAX_DELAY);
+    esp_err_t ret = lcd_dma_config(lcd_cam_obj, buffer_size, node_size);
+    xSemaphoreGive(lcd_cam_obj->common.idle_sem);
+    return ret;
+}
+
+esp_err_t i2s_lcd_get_dma_layout(i2s_lcd_handle_t handle, i2s_lcd_dma_layout_t *layout)
+{
+    i2s_lcd_driver_t *i2s_lcd_drv = (i2s_lcd_driver_t *)handle;
+    LCD_CHECK(NULL != i2s_lcd_drv, "handle pointer invalid", ESP_ERR_INVALID_ARG);
+    LCD_CHECK(NULL != layout, "layout pointer invalid", ESP_ERR_INVALID_ARG);
+    layout->buffer_size = i2s_lcd_drv->i2s_lcd_obj->dma_buffer_size;
+    layout->node_size = i2s_lcd_drv->i2s_lcd_obj->dma_node_buffer_size;
+    return ESP_OK;
+}
+
+i2s_lcd_common_t *i2s_lcd_get_common(i2s_lcd_handle_t handle)
+{
+    i2s_lcd_driver_t *i2s_lcd_drv = (i2s_lcd_driver_t *)handle;
+    return i2s_lcd_drv ? &i2s_lcd_drv->i2s_lcd_obj->common : NULL;
+}
+
 esp_err_t i2s_lcd_acquire(i2s_lcd_handle_t handle)
 {
     i2s_lcd_driver_t *i2s_lcd_drv = (i2s_lcd_driver_t *)handle;
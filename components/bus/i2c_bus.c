@@ -14,6 +14,10 @@
 #include "esp_log.h"
 #include "i2c_bus.h"
 
+#if CONFIG_I2C_BUS_STATS
+#include "esp_timer.h"
+#endif
+
 #define I2C_ACK_CHECK_EN 0x1     /*!< I2C master will check ack from slave*/
 #define I2C_ACK_CHECK_DIS 0x0     /*!< I2C master will not check ack from slave */
 #define I2C_BUS_FLG_DEFAULT (0)
@@ -28,6 +32,11 @@ typedef struct {
     i2c_config_t conf_active;    /*!<I2C active configuration */
     SemaphoreHandle_t mutex;    /* mutex to achive thread-safe*/
     int32_t ref_counter;    /*reference count*/
+    uint32_t error_counter;    /*failed transfers since the bus was created*/
+#if CONFIG_I2C_BUS_STATS
+    i2c_bus_stats_t stats;    /*lock statistics since the bus was created or reset*/
+    int64_t taken_us;    /*time the transfer in progress took the mutex*/
+#endif
 } i2c_bus_t;
 
 typedef struct {
@@ -54,8 +63,8 @@ static i2c_bus_t s_i2c_bus[I2C_NUM_MAX];
         return (ret); \
     }
 
-#define I2C_BUS_MUTEX_TAKE(mutex, ret) if (!xSemaphoreTake(mutex, I2C_BUS_MUTEX_TICKS_TO_WAIT)) { \
-        ESP_LOGE(TAG, "i2c_bus take mutex timeout, max wait = %"PRIu32"ms", I2C_BUS_MUTEX_TICKS_TO_WAIT); \
+#define I2C_BUS_MUTEX_TAKE(bus, ret) if (!i2c_bus_mutex_take(bus)) { \
+        ESP_LOGE(TAG, "i2c_bus take mutex timeout, max wait = %"PRIu32"ms", (uint32_t)I2C_BUS_MS_TO_WAIT); \
         return (ret); \
     }
 
@@ -69,11 +78,23 @@ static i2c_bus_t s_i2c_bus[I2C_NUM_MAX];
         return (ret); \
     }
 
+#define I2C_BUS_MUTEX_RELEASE(bus, ret) if (!i2c_bus_mutex_give(bus)) { \
+        ESP_LOGE(TAG, "i2c_bus give mutex failed"); \
+        return (ret); \
+    }
+
 static esp_err_t i2c_driver_reinit(i2c_port_t port, const i2c_config_t *conf);
 static esp_err_t i2c_driver_deinit(i2c_port_t port);
 static esp_err_t i2c_bus_write_reg8(i2c_bus_device_handle_t dev_handle, uint8_t mem_address, size_t data_len, const uint8_t *data);
 static esp_err_t i2c_bus_read_reg8(i2c_bus_device_handle_t dev_handle, uint8_t mem_address, size_t data_len, uint8_t *data);
 inline static bool i2c_config_compare(i2c_port_t port, const i2c_config_t *conf);
+static bool i2c_bus_mutex_take(i2c_bus_t *i2c_bus);
+static bool i2c_bus_mutex_give(i2c_bus_t *i2c_bus);
+
+#if CONFIG_I2C_BUS_STATS
+/* guards the statistics of all buses, a timed out task updates them without the mutex */
+static portMUX_TYPE s_i2c_bus_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+#endif
 /**************************************** Public Functions (Application level)*********************************************/
 
 i2c_bus_handle_t i2c_bus_create(i2c_port_t port, const i2c_config_t *conf)
@@ -91,7 +112,13 @@ i2c_bus_handle_t i2c_bus_create(i2c_port_t port, const i2c_config_t *conf)
     } else {
         s_i2c_bus[port].mutex = xSemaphoreCreateMutex();
         I2C_BUS_CHECK(s_i2c_bus[port].mutex != NULL, "i2c_bus xSemaphoreCreateMutex failed", NULL);
+        /* names the mutex in scheduling traces, a no-op without a queue registry */
+        vQueueAddToRegistry(s_i2c_bus[port].mutex, port == I2C_NUM_0 ? "i2c0_bus" : "i2c1_bus");
         s_i2c_bus[port].ref_counter = 0;
+        s_i2c_bus[port].error_counter = 0;
+#if CONFIG_I2C_BUS_STATS
+        memset(&s_i2c_bus[port].stats, 0, sizeof(i2c_bus_stats_t));
+#endif
     }
 
     esp_err_t ret = i2c_driver_reinit(port, conf);
@@ -116,6 +143,7 @@ esp_err_t i2c_bus_delete(i2c_bus_handle_t *p_bus)
 
     esp_err_t ret = i2c_driver_deinit(i2c_bus->i2c_port);
     I2C_BUS_CHECK(ret == ESP_OK, "deinit error", ret);
+    vQueueUnregisterQueue(i2c_bus->mutex);
     vSemaphoreDelete(i2c_bus->mutex);
     *p_bus = NULL;
     return ESP_OK;
@@ -165,6 +193,45 @@ uint8_t i2c_bus_get_created_device_num(i2c_bus_handle_t bus_handle)
     return i2c_bus->ref_counter;
 }
 
+uint32_t i2c_bus_get_error_count(i2c_bus_handle_t bus_handle)
+{
+    I2C_BUS_CHECK(bus_handle != NULL, "Null Bus Handle", 0);
+    i2c_bus_t *i2c_bus = (i2c_bus_t *)bus_handle;
+    I2C_BUS_INIT_CHECK(i2c_bus->is_init, 0);
+    return i2c_bus->error_counter;
+}
+
+esp_err_t i2c_bus_get_stats(i2c_bus_handle_t bus_handle, i2c_bus_stats_t *stats)
+{
+    I2C_BUS_CHECK(bus_handle != NULL, "Null Bus Handle", ESP_ERR_INVALID_ARG);
+    I2C_BUS_CHECK(stats != NULL, "pointer = NULL error", ESP_ERR_INVALID_ARG);
+#if CONFIG_I2C_BUS_STATS
+    i2c_bus_t *i2c_bus = (i2c_bus_t *)bus_handle;
+    I2C_BUS_INIT_CHECK(i2c_bus->is_init, ESP_ERR_INVALID_STATE);
+    portENTER_CRITICAL(&s_i2c_bus_stats_lock);
+    *stats = i2c_bus->stats;
+    portEXIT_CRITICAL(&s_i2c_bus_stats_lock);
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t i2c_bus_reset_stats(i2c_bus_handle_t bus_handle)
+{
+    I2C_BUS_CHECK(bus_handle != NULL, "Null Bus Handle", ESP_ERR_INVALID_ARG);
+#if CONFIG_I2C_BUS_STATS
+    i2c_bus_t *i2c_bus = (i2c_bus_t *)bus_handle;
+    I2C_BUS_INIT_CHECK(i2c_bus->is_init, ESP_ERR_INVALID_STATE);
+    portENTER_CRITICAL(&s_i2c_bus_stats_lock);
+    memset(&i2c_bus->stats, 0, sizeof(i2c_bus_stats_t));
+    portEXIT_CRITICAL(&s_i2c_bus_stats_lock);
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
 i2c_bus_device_handle_t i2c_bus_device_create(i2c_bus_handle_t bus_handle, uint8_t dev_addr, uint32_t clk_speed)
 {
     I2C_BUS_CHECK(bus_handle != NULL, "Null Bus Handle", NULL);
@@ -320,9 +387,12 @@ esp_err_t i2c_bus_cmd_begin(i2c_bus_device_handle_t dev_handle, i2c_cmd_handle_t
     I2C_BUS_CHECK(cmd != NULL, "I2C command error", ESP_ERR_INVALID_ARG);
     i2c_bus_device_t *i2c_device = (i2c_bus_device_t *)dev_handle;
     I2C_BUS_INIT_CHECK(i2c_device->i2c_bus->is_init, ESP_ERR_INVALID_STATE);
-    I2C_BUS_MUTEX_TAKE(i2c_device->i2c_bus->mutex, ESP_ERR_TIMEOUT);
+    I2C_BUS_MUTEX_TAKE(i2c_device->i2c_bus, ESP_ERR_TIMEOUT);
     esp_err_t ret = i2c_master_cmd_begin_with_conf(i2c_device->i2c_bus->i2c_port, cmd, I2C_BUS_TICKS_TO_WAIT, &i2c_device->conf);
-    I2C_BUS_MUTEX_GIVE(i2c_device->i2c_bus->mutex, ESP_FAIL);
+    if (ret != ESP_OK) {
+        i2c_device->i2c_bus->error_counter++;
+    }
+    I2C_BUS_MUTEX_RELEASE(i2c_device->i2c_bus, ESP_FAIL);
     return ret;
 }
 
@@ -332,7 +402,7 @@ static esp_err_t i2c_bus_read_reg8(i2c_bus_device_handle_t dev_handle, uint8_t m
     I2C_BUS_CHECK(data != NULL, "data pointer error", ESP_ERR_INVALID_ARG);
     i2c_bus_device_t *i2c_device = (i2c_bus_device_t *)dev_handle;
     I2C_BUS_INIT_CHECK(i2c_device->i2c_bus->is_init, ESP_ERR_INVALID_STATE);
-    I2C_BUS_MUTEX_TAKE(i2c_device->i2c_bus->mutex, ESP_ERR_TIMEOUT);
+    I2C_BUS_MUTEX_TAKE(i2c_device->i2c_bus, ESP_ERR_TIMEOUT);
     i2c_cmd_handle_t cmd = i2c_cmd_link_create();
 
     if (mem_address != NULL_I2C_MEM_ADDR) {
@@ -346,8 +416,11 @@ static esp_err_t i2c_bus_read_reg8(i2c_bus_device_handle_t dev_handle, uint8_t m
     i2c_master_read(cmd, data, data_len, I2C_MASTER_LAST_NACK);
     i2c_master_stop(cmd);
     esp_err_t ret = i2c_master_cmd_begin_with_conf(i2c_device->i2c_bus->i2c_port, cmd, I2C_BUS_TICKS_TO_WAIT, &i2c_device->conf);
+    if (ret != ESP_OK) {
+        i2c_device->i2c_bus->error_counter++;
+    }
     i2c_cmd_link_delete(cmd);
-    I2C_BUS_MUTEX_GIVE(i2c_device->i2c_bus->mutex, ESP_FAIL);
+    I2C_BUS_MUTEX_RELEASE(i2c_device->i2c_bus, ESP_FAIL);
     return ret;
 }
 
@@ -360,7 +433,7 @@ esp_err_t i2c_bus_read_reg16(i2c_bus_device_handle_t dev_handle, uint16_t mem_ad
     uint8_t memAddress8[2];
     memAddress8[0] = (uint8_t)((mem_address >> 8) & 0x00FF);
     memAddress8[1] = (uint8_t)(mem_address & 0x00FF);
-    I2C_BUS_MUTEX_TAKE(i2c_device->i2c_bus->mutex, ESP_ERR_TIMEOUT);
+    I2C_BUS_MUTEX_TAKE(i2c_device->i2c_bus, ESP_ERR_TIMEOUT);
     i2c_cmd_handle_t cmd = i2c_cmd_link_create();
 
     if (mem_address != NULL_I2C_MEM_ADDR) {
@@ -374,8 +447,11 @@ esp_err_t i2c_bus_read_reg16(i2c_bus_device_handle_t dev_handle, uint16_t mem_ad
     i2c_master_read(cmd, data, data_len, I2C_MASTER_LAST_NACK);
     i2c_master_stop(cmd);
     esp_err_t ret = i2c_master_cmd_begin_with_conf(i2c_device->i2c_bus->i2c_port, cmd, I2C_BUS_TICKS_TO_WAIT, &i2c_device->conf);
+    if (ret != ESP_OK) {
+        i2c_device->i2c_bus->error_counter++;
+    }
     i2c_cmd_link_delete(cmd);
-    I2C_BUS_MUTEX_GIVE(i2c_device->i2c_bus->mutex, ESP_FAIL);
+    I2C_BUS_MUTEX_RELEASE(i2c_device->i2c_bus, ESP_FAIL);
     return ret;
 }
 
@@ -385,7 +461,7 @@ static esp_err_t i2c_bus_write_reg8(i2c_bus_device_handle_t dev_handle, uint8_t
     I2C_BUS_CHECK(data != NULL, "data pointer error", ESP_ERR_INVALID_ARG);
     i2c_bus_device_t *i2c_device = (i2c_bus_device_t *)dev_handle;
     I2C_BUS_INIT_CHECK(i2c_device->i2c_bus->is_init, ESP_ERR_INVALID_STATE);
-    I2C_BUS_MUTEX_TAKE(i2c_device->i2c_bus->mutex, ESP_ERR_TIMEOUT);
+    I2C_BUS_MUTEX_TAKE(i2c_device->i2c_bus, ESP_ERR_TIMEOUT);
     i2c_cmd_handle_t cmd = i2c_cmd_link_create();
     i2c_master_start(cmd);
     i2c_master_write_byte(cmd, (i2c_device->dev_addr << 1) | I2C_MASTER_WRITE, I2C_ACK_CHECK_EN);
@@ -397,8 +473,11 @@ static esp_err_t i2c_bus_write_reg8(i2c_bus_device_handle_t dev_handle, uint8_t
     i2c_master_write(cmd, (uint8_t *)data, data_len, I2C_ACK_CHECK_EN);
     i2c_master_stop(cmd);
     esp_err_t ret = i2c_master_cmd_begin_with_conf(i2c_device->i2c_bus->i2c_port, cmd, I2C_BUS_TICKS_TO_WAIT, &i2c_device->conf);
+    if (ret != ESP_OK) {
+        i2c_device->i2c_bus->error_counter++;
+    }
     i2c_cmd_link_delete(cmd);
-    I2C_BUS_MUTEX_GIVE(i2c_device->i2c_bus->mutex, ESP_FAIL);
+    I2C_BUS_MUTEX_RELEASE(i2c_device->i2c_bus, ESP_FAIL);
     return ret;
 }
 
@@ -411,7 +490,7 @@ esp_err_t i2c_bus_write_reg16(i2c_bus_device_handle_t dev_handle, uint16_t mem_a
     uint8_t memAddress8[2];
     memAddress8[0] = (uint8_t)((mem_address >> 8) & 0x00FF);
     memAddress8[1] = (uint8_t)(mem_address & 0x00FF);
-    I2C_BUS_MUTEX_TAKE(i2c_device->i2c_bus->mutex, ESP_ERR_TIMEOUT);
+    I2C_BUS_MUTEX_TAKE(i2c_device->i2c_bus, ESP_ERR_TIMEOUT);
     i2c_cmd_handle_t cmd = i2c_cmd_link_create();
     i2c_master_start(cmd);
     i2c_master_write_byte(cmd, (i2c_device->dev_addr << 1) | I2C_MASTER_WRITE, I2C_ACK_CHECK_EN);
@@ -423,12 +502,75 @@ esp_err_t i2c_bus_write_reg16(i2c_bus_device_handle_t dev_handle, uint16_t mem_a
     i2c_master_write(cmd, (uint8_t *)data, data_len, I2C_ACK_CHECK_EN);
     i2c_master_stop(cmd);
     esp_err_t ret = i2c_master_cmd_begin_with_conf(i2c_device->i2c_bus->i2c_port, cmd, I2C_BUS_TICKS_TO_WAIT, &i2c_device->conf);
+    if (ret != ESP_OK) {
+        i2c_device->i2c_bus->error_counter++;
+    }
     i2c_cmd_link_delete(cmd);
-    I2C_BUS_MUTEX_GIVE(i2c_device->i2c_bus->mutex, ESP_FAIL);
+    I2C_BUS_MUTEX_RELEASE(i2c_device->i2c_bus, ESP_FAIL);
     return ret;
 }
 
 /**************************************** Private Functions*********************************************/
+
+#if CONFIG_I2C_BUS_STATS
+/* bucket of a mutex wait in i2c_bus_stats_t */
+inline static int i2c_bus_stats_bucket(uint32_t wait_us)
+{
+    int bucket = 0;
+
+    while (bucket < I2C_BUS_STATS_BUCKETS - 1 && wait_us >= (16UL << bucket)) {
+        bucket++;
+    }
+
+    return bucket;
+}
+#endif
+
+/* takes the bus for one transfer, with CONFIG_I2C_BUS_STATS it also times the wait */
+static bool i2c_bus_mutex_take(i2c_bus_t *i2c_bus)
+{
+#if CONFIG_I2C_BUS_STATS
+    int64_t start = esp_timer_get_time();
+    bool taken = xSemaphoreTake(i2c_bus->mutex, I2C_BUS_MUTEX_TICKS_TO_WAIT) == pdTRUE;
+    int64_t now = esp_timer_get_time();
+    uint32_t wait_us = (uint32_t)(now - start);
+
+    portENTER_CRITICAL(&s_i2c_bus_stats_lock);
+    if (taken) {
+        i2c_bus->stats.takes++;
+        i2c_bus->stats.wait_us += wait_us;
+        if (wait_us > i2c_bus->stats.wait_max_us) {
+            i2c_bus->stats.wait_max_us = wait_us;
+        }
+        i2c_bus->stats.wait_hist[i2c_bus_stats_bucket(wait_us)]++;
+        i2c_bus->taken_us = now;
+    } else {
+        i2c_bus->stats.timeouts++;
+    }
+    portEXIT_CRITICAL(&s_i2c_bus_stats_lock);
+
+    return taken;
+#else
+    return xSemaphoreTake(i2c_bus->mutex, I2C_BUS_MUTEX_TICKS_TO_WAIT) == pdTRUE;
+#endif
+}
+
+/* gives the bus back after a transfer, with CONFIG_I2C_BUS_STATS it also adds the time it was held */
+static bool i2c_bus_mutex_give(i2c_bus_t *i2c_bus)
+{
+#if CONFIG_I2C_BUS_STATS
+    int64_t held_us = esp_timer_get_time() - i2c_bus->taken_us;
+
+    portENTER_CRITICAL(&s_i2c_bus_stats_lock);
+    i2c_bus->stats.hold_us += held_us;
+    if (held_us > i2c_bus->stats.hold_max_us) {
+        i2c_bus->stats.hold_max_us = (uint32_t)held_us;
+    }
+    portEXIT_CRITICAL(&s_i2c_bus_stats_lock);
+#endif
+    return xSemaphoreGive(i2c_bus->mutex) == pdTRUE;
+}
+
 static esp_err_t i2c_driver_reinit(i2c_port_t port, const i2c_config_t *conf)
 {
     I2C_BUS_CHECK(port < I2C_NUM_MAX, "i2c port error", ESP_ERR_INVALID_ARG);
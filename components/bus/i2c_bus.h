@@ -13,6 +13,22 @@
 typedef void *i2c_bus_handle_t; /*!< i2c bus handle */
 typedef void *i2c_bus_device_handle_t; /*!< i2c device handle */
 
+#define I2C_BUS_STATS_BUCKETS 16 /*!< buckets of the mutex wait histogram, bucket i counts the waits below 2^(i+4) us */
+
+/**
+ * @brief Lock statistics of a bus, see CONFIG_I2C_BUS_STATS
+ *
+ */
+typedef struct {
+    uint32_t takes;              /*!< Transfers which got the bus mutex */
+    uint32_t timeouts;           /*!< Transfers which gave up after CONFIG_I2C_MS_TO_WAIT, ESP_ERR_TIMEOUT */
+    uint64_t wait_us;            /*!< Time spent waiting for the mutex by the transfers which got it */
+    uint32_t wait_max_us;        /*!< Longest wait for the mutex */
+    uint64_t hold_us;            /*!< Time the mutex was held by transfers */
+    uint32_t hold_max_us;        /*!< Longest transfer holding the mutex */
+    uint32_t wait_hist[I2C_BUS_STATS_BUCKETS]; /*!< Waits by length, the last bucket counts everything above */
+} i2c_bus_stats_t;
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -73,6 +89,39 @@ uint32_t i2c_bus_get_current_clk_speed(i2c_bus_handle_t bus_handle);
  */
 uint8_t i2c_bus_get_created_device_num(i2c_bus_handle_t bus_handle);
 
+/**
+ * @brief Get the number of failed transfers on the bus since it was created.
+ *
+ * @param bus_handle I2C bus handle
+ * @return uint32_t number of transfers that did not return ESP_OK
+ */
+uint32_t i2c_bus_get_error_count(i2c_bus_handle_t bus_handle);
+
+/**
+ * @brief Get the lock statistics of the bus, see CONFIG_I2C_BUS_STATS
+ *
+ * @param bus_handle I2C bus handle
+ * @param stats Returned statistics, accumulated since the bus was created or i2c_bus_reset_stats
+ * @return esp_err_t
+ *     - ESP_OK Success
+ *     - ESP_ERR_INVALID_ARG bus_handle or stats is invalid
+ *     - ESP_ERR_INVALID_STATE the bus is not inited
+ *     - ESP_ERR_NOT_SUPPORTED CONFIG_I2C_BUS_STATS is disabled
+ */
+esp_err_t i2c_bus_get_stats(i2c_bus_handle_t bus_handle, i2c_bus_stats_t *stats);
+
+/**
+ * @brief Clear the lock statistics of the bus
+ *
+ * @param bus_handle I2C bus handle
+ * @return esp_err_t
+ *     - ESP_OK Success
+ *     - ESP_ERR_INVALID_ARG bus_handle is invalid
+ *     - ESP_ERR_INVALID_STATE the bus is not inited
+ *     - ESP_ERR_NOT_SUPPORTED CONFIG_I2C_BUS_STATS is disabled
+ */
+esp_err_t i2c_bus_reset_stats(i2c_bus_handle_t bus_handle);
+
 /**
  * @brief Create an I2C device on specific bus.
  *        Dynamic configuration must be enable to achieve multiple devices with different configs on a single bus.
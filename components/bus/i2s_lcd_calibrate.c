@@ -0,0 +1,138 @@
+/*
+ * SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#include "sdkconfig.h"
+#if CONFIG_IDF_TARGET_ESP32 || CONFIG_IDF_TARGET_ESP32S2 || CONFIG_IDF_TARGET_ESP32S3
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "i2s_lcd_driver.h"
+#include "i2s_lcd_priv.h"
+
+static const char *TAG = "I2S_LCD_CALIBRATE";
+
+#define I2S_CHECK(a, str, ret) if (!(a)) {                                              \
+        ESP_LOGE(TAG,"%s:%d (%s):%s", __FILE__, __LINE__, __FUNCTION__, str);       \
+        return (ret);                                                                   \
+    }
+
+#define CALIBRATE_MIN_BYTES  (256 * 1024)  /*!< Data streamed per candidate layout */
+#define CALIBRATE_MIN_ROUNDS (4)           /*!< Writes of the workload per candidate layout */
+
+/* Multiples of 16, so that PSRAM buffers can still be read by EDMA on ESP32-S3 */
+static const uint32_t s_node_sizes[] = {1024, 2048, 4000};
+
+static bool lcd_calibration_better(const i2s_lcd_calibration_t *a, const i2s_lcd_calibration_t *b)
+{
+    if (a->stalls != b->stalls) {
+        return a->stalls < b->stalls;
+    }
+    if (a->bytes_per_sec > b->bytes_per_sec + b->bytes_per_sec / 50) {
+        return true;
+    }
+    if (b->bytes_per_sec > a->bytes_per_sec + a->bytes_per_sec / 50) {
+        return false;
+    }
+    return a->isr_per_sec < b->isr_per_sec;
+}
+
+static esp_err_t lcd_calibrate_layout(i2s_lcd_handle_t handle, const uint8_t *data, uint32_t length, uint32_t rounds,
+                                      i2s_lcd_calibrate_write_t write_fn, void *user_ctx, i2s_lcd_calibration_t *result)
+{
+    uint32_t isr_start, stall_start, isr_end, stall_end;
+    esp_err_t ret = i2s_lcd_get_dma_layout(handle, &result->layout);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ret = i2s_lcd_get_dma_counters(handle, &isr_start, &stall_start);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    int64_t start = esp_timer_get_time();
+    for (uint32_t i = 0; i < rounds && ret == ESP_OK; i++) {
+        ret = write_fn ? write_fn(handle, data, length, user_ctx) : i2s_lcd_write(handle, data, length);
+    }
+    // An asynchronous write is only measured once it has left the bus
+    esp_err_t wait_ret = i2s_lcd_wait_done(handle, portMAX_DELAY);
+    int64_t elapsed = esp_timer_get_time() - start;
+    esp_err_t cnt_ret = i2s_lcd_get_dma_counters(handle, &isr_end, &stall_end);
+    if (ret == ESP_OK) {
+        ret = wait_ret;
+    }
+    if (ret == ESP_OK) {
+        ret = cnt_ret;
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "buffer: %"PRIu32", node: %"PRIu32", write failed: %s",
+                 result->layout.buffer_size, result->layout.node_size, esp_err_to_name(ret));
+        return ret;
+    }
+    if (elapsed <= 0) {
+        elapsed = 1;
+    }
+
+    result->bytes_per_sec = (uint64_t)length * rounds * 1000000 / elapsed;
+    result->isr_per_sec = (uint64_t)(isr_end - isr_start) * 1000000 / elapsed;
+    result->stalls = stall_end - stall_start;
+    ESP_LOGI(TAG, "buffer: %"PRIu32", node: %"PRIu32", %"PRIu32" B/s, %"PRIu32" isr/s, %"PRIu32" stalls",
+             result->layout.buffer_size, result->layout.node_size, result->bytes_per_sec, result->isr_per_sec, result->stalls);
+    return ESP_OK;
+}
+
+esp_err_t i2s_lcd_calibrate(i2s_lcd_handle_t handle, const uint8_t *data, uint32_t length, uint32_t max_buffer_size,
+                            i2s_lcd_calibrate_write_t write_fn, void *user_ctx, i2s_lcd_calibration_t *result)
+{
+    I2S_CHECK(NULL != handle, "handle pointer invalid", ESP_ERR_INVALID_ARG);
+    I2S_CHECK(NULL != data && length > 0, "data pointer invalid", ESP_ERR_INVALID_ARG);
+
+    uint32_t rounds = CALIBRATE_MIN_BYTES / length;
+    if (rounds < CALIBRATE_MIN_ROUNDS) {
+        rounds = CALIBRATE_MIN_ROUNDS;
+    }
+
+    i2s_lcd_calibration_t best = {0};
+    bool found = false;
+    esp_err_t ret = ESP_FAIL;
+    for (int i = 0; i < sizeof(s_node_sizes) / sizeof(s_node_sizes[0]); i++) {
+        uint32_t node_size = s_node_sizes[i];
+        for (uint32_t buffer_size = node_size * 2; buffer_size <= max_buffer_size; buffer_size *= 2) {
+            i2s_lcd_calibration_t candidate;
+            // A layout which can't be applied or written is skipped, the last error is kept for the caller
+            esp_err_t err = i2s_lcd_set_dma_layout(handle, buffer_size, node_size);
+            if (err == ESP_OK) {
+                err = lcd_calibrate_layout(handle, data, length, rounds, write_fn, user_ctx, &candidate);
+            }
+            if (err != ESP_OK) {
+                ret = err;
+                continue;
+            }
+            if (!found || lcd_calibration_better(&candidate, &best)) {
+                best = candidate;
+                found = true;
+            }
+        }
+    }
+    if (!found) {
+        ESP_LOGE(TAG, "no layout could be applied and measured: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    ret = i2s_lcd_set_dma_layout(handle, best.layout.buffer_size, best.layout.node_size);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "best layout could not be applied: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    ESP_LOGI(TAG, "best layout, buffer: %"PRIu32", node: %"PRIu32"", best.layout.buffer_size, best.layout.node_size);
+    if (result) {
+        *result = best;
+    }
+    return ESP_OK;
+}
+
+#endif
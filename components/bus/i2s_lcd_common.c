@@ -0,0 +1,161 @@
+/*
+ * SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#include "sdkconfig.h"
+#if CONFIG_IDF_TARGET_ESP32 || CONFIG_IDF_TARGET_ESP32S2 || CONFIG_IDF_TARGET_ESP32S3
+
+#include <stdio.h>
+#include <inttypes.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "i2s_lcd_driver.h"
+#include "i2s_lcd_priv.h"
+
+static const char *TAG = "I2S_LCD_COMMON";
+
+#define I2S_CHECK(a, str, ret) if (!(a)) {                                              \
+        ESP_LOGE(TAG,"%s:%d (%s):%s", __FILE__, __LINE__, __FUNCTION__, str);       \
+        return (ret);                                                                   \
+    }
+
+#define LCD_CAM_DMA_NODE_BUFFER_MAX_SIZE  (4000) // 4-byte aligned
+
+esp_err_t i2s_lcd_dma_layout_calc(uint32_t max_buffer_size, uint32_t node_size, i2s_lcd_dma_layout_t *layout)
+{
+    if (node_size == 0) {
+        // Largest node which still gives two halves
+        node_size = max_buffer_size / 2;
+        if (node_size > LCD_CAM_DMA_NODE_BUFFER_MAX_SIZE) {
+            node_size = LCD_CAM_DMA_NODE_BUFFER_MAX_SIZE;
+        }
+        node_size -= node_size % 4;
+    }
+    if (node_size == 0 || node_size > LCD_CAM_DMA_NODE_BUFFER_MAX_SIZE || node_size % 4 != 0) {
+        ESP_LOGE(TAG, "unsupported dma node size: %"PRIu32"", node_size);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (max_buffer_size < node_size * 2) {
+        ESP_LOGE(TAG, "buffer size %"PRIu32" is smaller than 2 dma nodes", max_buffer_size);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // Largest size up to max_buffer_size which splits into two halves of whole nodes
+    layout->buffer_size = max_buffer_size - max_buffer_size % (node_size * 2);
+    layout->node_size = node_size;
+    return ESP_OK;
+}
+
+esp_err_t i2s_lcd_trans_check(const i2s_lcd_trans_t *trans, uint32_t count, uint32_t bus_bytes)
+{
+    I2S_CHECK(NULL != trans, "trans pointer invalid", ESP_ERR_INVALID_ARG);
+    I2S_CHECK(count > 0 && count <= I2S_LCD_TRANS_MAX, "too many transactions", ESP_ERR_INVALID_SIZE);
+    for (uint32_t i = 0; i < count; i++) {
+        I2S_CHECK(0 == trans[i].param_len || NULL != trans[i].param, "param pointer invalid", ESP_ERR_INVALID_ARG);
+        I2S_CHECK(trans[i].param_len <= I2S_LCD_TRANS_PARAM_MAX && 0 == trans[i].param_len % bus_bytes, "wrong param len!", ESP_ERR_INVALID_SIZE);
+        I2S_CHECK(0 == trans[i].length || i == count - 1, "only the last transaction can carry data", ESP_ERR_INVALID_ARG);
+    }
+    const i2s_lcd_trans_t *last = &trans[count - 1];
+    if (last->length) {
+        I2S_CHECK(NULL != last->data, "data pointer invalid", ESP_ERR_INVALID_ARG);
+        I2S_CHECK(0 == last->length % (bus_bytes * 2), "wrong len!", ESP_ERR_INVALID_SIZE);
+    }
+    return ESP_OK;
+}
+
+size_t i2s_lcd_trans_pack(const i2s_lcd_trans_t *trans, uint32_t count, uint32_t bus_bytes, uint8_t *out, i2s_lcd_trans_seg_cb_t add_seg, void *arg)
+{
+    size_t bytes = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        out = add_seg(arg, out, (const uint8_t *)&trans[i].cmd, bus_bytes, LCD_CMD_LEV);
+        if (trans[i].param_len) {
+            out = add_seg(arg, out, trans[i].param, trans[i].param_len, LCD_DATA_LEV);
+        }
+        bytes += bus_bytes + trans[i].param_len;
+    }
+    return bytes;
+}
+
+esp_err_t i2s_lcd_async_wait(i2s_lcd_common_t *common, TickType_t ticks_to_wait)
+{
+    if (pdTRUE != xSemaphoreTake(common->idle_sem, ticks_to_wait)) {
+        return ESP_ERR_TIMEOUT;
+    }
+    xSemaphoreGive(common->idle_sem);
+    return ESP_OK;
+}
+
+void i2s_lcd_async_begin(i2s_lcd_common_t *common, i2s_lcd_handle_t handle, const uint8_t *data, size_t len, i2s_lcd_trans_done_cb_t done_cb, void *user_ctx)
+{
+    xSemaphoreTake(common->idle_sem, portMAX_DELAY);
+    LCD_PERF_WRITE_START(&common->perf, len);
+    common->async_data = data;
+    common->async_left = len;
+    common->async_cb = done_cb;
+    common->async_ctx = user_ctx;
+    common->async_handle = handle;
+}
+
+/**< Public functions */
+
+esp_err_t i2s_lcd_wait_done(i2s_lcd_handle_t handle, TickType_t ticks_to_wait)
+{
+    i2s_lcd_common_t *common = i2s_lcd_get_common(handle);
+    I2S_CHECK(NULL != common, "handle pointer invalid", ESP_ERR_INVALID_ARG);
+    return i2s_lcd_async_wait(common, ticks_to_wait);
+}
+
+esp_err_t i2s_lcd_get_dma_counters(i2s_lcd_handle_t handle, uint32_t *isr_cnt, uint32_t *stall_cnt)
+{
+    i2s_lcd_common_t *common = i2s_lcd_get_common(handle);
+    I2S_CHECK(NULL != common, "handle pointer invalid", ESP_ERR_INVALID_ARG);
+    I2S_CHECK(NULL != isr_cnt && NULL != stall_cnt, "counter pointer invalid", ESP_ERR_INVALID_ARG);
+    *isr_cnt = common->isr_cnt;
+    *stall_cnt = common->stall_cnt;
+    return ESP_OK;
+}
+
+esp_err_t i2s_lcd_get_stats(i2s_lcd_handle_t handle, i2s_lcd_stats_t *stats)
+{
+#if CONFIG_LCD_PERF_STATS
+    i2s_lcd_common_t *common = i2s_lcd_get_common(handle);
+    I2S_CHECK(NULL != common, "handle pointer invalid", ESP_ERR_INVALID_ARG);
+    I2S_CHECK(NULL != stats, "stats pointer invalid", ESP_ERR_INVALID_ARG);
+    const i2s_lcd_perf_t *perf = &common->perf;
+    stats->transfers = perf->transfers;
+    stats->bytes = perf->bytes;
+    stats->busy_us = perf->busy_us;
+    stats->bytes_per_sec = perf->busy_us ? perf->bytes * 1000000 / perf->busy_us : 0;
+    stats->isr_count = common->isr_cnt;
+    stats->isr_cycles = perf->isr_cycles;
+    stats->isr_cycles_max = perf->isr_cycles_max;
+    stats->underruns = common->stall_cnt;
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t i2s_lcd_reset_stats(i2s_lcd_handle_t handle)
+{
+#if CONFIG_LCD_PERF_STATS
+    i2s_lcd_common_t *common = i2s_lcd_get_common(handle);
+    I2S_CHECK(NULL != common, "handle pointer invalid", ESP_ERR_INVALID_ARG);
+    // Keep the counters consistent with each other, no transfer may be in flight
+    xSemaphoreTake(common->idle_sem, portMAX_DELAY);
+    memset(&common->perf, 0, sizeof(common->perf));
+    common->isr_cnt = 0;
+    common->stall_cnt = 0;
+    xSemaphoreGive(common->idle_sem);
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+#endif
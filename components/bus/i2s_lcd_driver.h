@@ -7,6 +7,7 @@
 #ifndef   __I2S_LCD_DRIVER_H__
 #define   __I2S_LCD_DRIVER_H__
 
+#include "freertos/FreeRTOS.h"
 #include "driver/i2s.h"
 
 #ifdef __cplusplus
@@ -17,8 +18,26 @@ extern "C"
 #define LCD_CMD_LEV   (0)
 #define LCD_DATA_LEV  (1)
 
+#define I2S_LCD_TRANS_MAX        (4)    /*!< Maximum number of transactions in one i2s_lcd_write_trans call */
+#define I2S_LCD_TRANS_PARAM_MAX  (16)   /*!< Maximum number of parameter bytes of one transaction */
+
 typedef void * i2s_lcd_handle_t; /** Handle of i2s lcd driver */
 
+/**
+ * @brief Callback invoked from the DMA interrupt when an asynchronous write has completed
+ *
+ * A PSRAM or flash write which i2s_lcd_write_async has to stream from the calling task calls it from that task
+ * instead, before i2s_lcd_write_async returns. The FromISR functions may still be used there, the return
+ * value is ignored in that case.
+ *
+ * @param handle Handle of i2s lcd driver
+ * @param user_ctx User context passed to i2s_lcd_write_async
+ *
+ * @return Whether a higher priority task has been woken up by this callback (e.g. by vTaskNotifyGiveFromISR),
+ *         only used when called from the interrupt
+ */
+typedef bool (*i2s_lcd_trans_done_cb_t)(i2s_lcd_handle_t handle, void *user_ctx);
+
 /**
  * @brief Configuration of i2s lcd mode
  * 
@@ -33,8 +52,68 @@ typedef struct {
     i2s_port_t i2s_port;         /*!< I2S port number */
     bool swap_data;              /*!< Swap the 2 bytes of RGB565 color */
     uint32_t buffer_size;        /*!< DMA buffer size */
+    uint32_t dma_node_size;      /*!< Size of the buffer behind one DMA descriptor, 0 picks the largest one which fits */
 } i2s_lcd_config_t;
 
+/**
+ * @brief One command of i2s_lcd_write_trans with its parameters and block data
+ *
+ */
+typedef struct {
+    uint16_t cmd;                /*!< Command, written with RS at command level */
+    const uint8_t *param;        /*!< Parameters written after the command in memory order, never swapped, can be NULL */
+    uint32_t param_len;          /*!< Length of param in bytes, at most I2S_LCD_TRANS_PARAM_MAX */
+    const uint8_t *data;         /*!< Block data written after the parameters like i2s_lcd_write, only allowed in the last transaction */
+    uint32_t length;             /*!< Length of data in bytes */
+} i2s_lcd_trans_t;
+
+/**
+ * @brief Layout of the ping-pong DMA buffer
+ *
+ */
+typedef struct {
+    uint32_t buffer_size;        /*!< Size of both halves together */
+    uint32_t node_size;          /*!< Size of the buffer behind one DMA descriptor */
+} i2s_lcd_dma_layout_t;
+
+/**
+ * @brief Result of i2s_lcd_calibrate
+ *
+ */
+typedef struct {
+    i2s_lcd_dma_layout_t layout; /*!< Best layout found */
+    uint32_t bytes_per_sec;      /*!< Throughput of the workload with this layout */
+    uint32_t isr_per_sec;        /*!< DMA interrupt rate with this layout */
+    uint32_t stalls;             /*!< Halves which were refilled only after the other one had run dry */
+} i2s_lcd_calibration_t;
+
+/**
+ * @brief Writes the calibration workload once, see i2s_lcd_calibrate
+ *
+ * @param handle Handle of i2s lcd driver
+ * @param data Workload passed to i2s_lcd_calibrate
+ * @param length Length of the workload
+ * @param user_ctx User context passed to i2s_lcd_calibrate
+ *
+ * @return ESP_OK on success, any other value skips the layout being measured
+ */
+typedef esp_err_t (*i2s_lcd_calibrate_write_t)(i2s_lcd_handle_t handle, const uint8_t *data, uint32_t length, void *user_ctx);
+
+/**
+ * @brief Performance counters, see CONFIG_LCD_PERF_STATS
+ *
+ */
+typedef struct {
+    uint32_t transfers;          /*!< Writes, including single command and data words */
+    uint64_t bytes;              /*!< Bytes written */
+    uint64_t busy_us;            /*!< Time from the start to the end of all writes */
+    uint32_t bytes_per_sec;      /*!< Achieved throughput, bytes / busy_us */
+    uint32_t isr_count;          /*!< DMA EOF interrupts, LCD trans done interrupts on ESP32-S3 */
+    uint64_t isr_cycles;         /*!< CPU cycles spent in the DMA interrupt, divide by the CPU MHz for microseconds */
+    uint32_t isr_cycles_max;     /*!< Longest single DMA interrupt in CPU cycles */
+    uint32_t underruns;          /*!< Halves refilled only after the other one had run dry, the bus idled for the CPU */
+} i2s_lcd_stats_t;
+
 /**
  * @brief Initilize i2s lcd driver. 
  *
@@ -94,6 +173,10 @@ esp_err_t i2s_lcd_write_command(i2s_lcd_handle_t handle, const uint8_t *cmd, uin
 
 /**
  * @brief Write block data to LCD
+ *
+ * @note On ESP32-S3 with CONFIG_LCD_DMA_ZERO_COPY enabled, a buffer in internal DMA-capable RAM
+ *       whose address and length are 4-byte aligned is transferred in place without being copied.
+ *       The buffer must not be modified until this function returns.
  * 
  * @param handle  Handle of i2s lcd driver
  * @param data Pointer of data
@@ -105,6 +188,159 @@ esp_err_t i2s_lcd_write_command(i2s_lcd_handle_t handle, const uint8_t *cmd, uin
  */
 esp_err_t i2s_lcd_write(i2s_lcd_handle_t handle, const uint8_t *data, uint32_t length);
 
+/**
+ * @brief Start writing block data to LCD without waiting for the transfer to finish
+ *
+ * The first ping-pong halves are prepared by the caller, the remaining ones are refilled from the DMA
+ * interrupt, so the calling task is free to render the next frame while this one is transferred.
+ * Only one asynchronous write can be in flight, a new one (or any blocking write) waits for the
+ * previous transfer to complete.
+ *
+ * @note The data buffer must stay valid and unchanged until done_cb is called or i2s_lcd_wait_done returns.
+ *       Length must be a multiple of 2 bytes for 8-bit bus and a multiple of 4 bytes for 16-bit bus.
+ * @note Only data in internal RAM is copied from the DMA interrupt, which also runs while the flash cache
+ *       is disabled. Data in PSRAM or flash (e.g. a const table) is streamed through the internal ping-pong
+ *       buffers from the calling task and returns once it has completed, done_cb is then called from the
+ *       calling task and its return value is ignored. On ESP32-S3 with CONFIG_LCD_DMA_PSRAM_EDMA, 16-byte
+ *       aligned PSRAM buffers are read by DMA directly and stay asynchronous.
+ *
+ * @param handle  Handle of i2s lcd driver
+ * @param data Pointer of data
+ * @param length length of data
+ * @param done_cb Callback invoked on completion, from ISR context except for the PSRAM and flash case above, can be NULL
+ * @param user_ctx User context passed to done_cb
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG handle is invalid
+ *      - ESP_ERR_INVALID_SIZE length is not supported
+ */
+esp_err_t i2s_lcd_write_async(i2s_lcd_handle_t handle, const uint8_t *data, uint32_t length, i2s_lcd_trans_done_cb_t done_cb, void *user_ctx);
+
+/**
+ * @brief Write a sequence of commands, their parameters and block data as one transfer
+ *
+ * Every command and parameter block is copied behind its own DMA descriptor before the transfer starts.
+ * The DMA interrupt starts them one after another and switches RS once the previous segment has left
+ * the bus, then streams the block data of the last transaction like i2s_lcd_write_async. A window
+ * update (CASET, RASET, RAMWR and pixels) thus costs the calling task no DMA round trip at all.
+ * Returns once the transfer has started, like i2s_lcd_write_async.
+ *
+ * @note Parameter length must be a multiple of the bus width. Block data has the same length
+ *       restrictions as i2s_lcd_write_async and must stay valid until i2s_lcd_wait_done returns.
+ *       Block data in PSRAM or flash is written from the calling task once the commands are out, as with
+ *       i2s_lcd_write_async.
+ *
+ * @param handle  Handle of i2s lcd driver
+ * @param trans Transactions, written in order
+ * @param count Number of transactions, at most I2S_LCD_TRANS_MAX
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG handle or trans is invalid, or block data is not in the last transaction
+ *      - ESP_ERR_INVALID_SIZE a length is not supported
+ */
+esp_err_t i2s_lcd_write_trans(i2s_lcd_handle_t handle, const i2s_lcd_trans_t *trans, uint32_t count);
+
+/**
+ * @brief Wait for the asynchronous write in flight to finish
+ *
+ * @param handle  Handle of i2s lcd driver
+ * @param ticks_to_wait Maximum time to wait
+ *
+ * @return
+ *      - ESP_OK on success, or no transfer in flight
+ *      - ESP_ERR_INVALID_ARG handle is invalid
+ *      - ESP_ERR_TIMEOUT transfer did not finish in time
+ */
+esp_err_t i2s_lcd_wait_done(i2s_lcd_handle_t handle, TickType_t ticks_to_wait);
+
+/**
+ * @brief Change the layout of the ping-pong DMA buffer at runtime
+ *
+ * The buffer is rounded down to the largest size which splits into two halves of whole nodes.
+ * The new buffer is allocated before the old one is freed, on failure the current layout is kept.
+ *
+ * @note Waits for an asynchronous write in flight. Blocking writes from other tasks must be kept out by the caller,
+ *       e.g. with i2s_lcd_acquire.
+ *
+ * @param handle Handle of i2s lcd driver
+ * @param buffer_size Maximum size of the DMA buffer
+ * @param node_size Size of the buffer behind one DMA descriptor, multiple of 4 and at most 4000, 0 picks the largest one
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG handle or node size is invalid
+ *      - ESP_ERR_INVALID_SIZE buffer can't hold two nodes
+ *      - ESP_ERR_NO_MEM the new buffer can't be allocated
+ */
+esp_err_t i2s_lcd_set_dma_layout(i2s_lcd_handle_t handle, uint32_t buffer_size, uint32_t node_size);
+
+/**
+ * @brief Get the current layout of the ping-pong DMA buffer
+ *
+ * @param handle Handle of i2s lcd driver
+ * @param layout Returned layout
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG handle or layout is invalid
+ */
+esp_err_t i2s_lcd_get_dma_layout(i2s_lcd_handle_t handle, i2s_lcd_dma_layout_t *layout);
+
+/**
+ * @brief Find the DMA buffer layout which suits a workload best and apply it
+ *
+ * Every candidate layout up to max_buffer_size is applied in turn and the workload is written repeatedly
+ * with write_fn, measuring throughput, interrupt rate and refill stalls until i2s_lcd_wait_done returns.
+ * Layouts without stalls win, then the highest throughput, layouts within 2% of each other are ranked by
+ * fewer interrupts. Layouts which can't be applied or whose writes fail are skipped.
+ *
+ * @note The workload is really sent to the LCD, open a suitable window before calling this.
+ *
+ * @param handle Handle of i2s lcd driver
+ * @param data Workload, typically one transfer as issued by the UI
+ * @param length Length of the workload
+ * @param max_buffer_size Largest DMA buffer the application can spare
+ * @param write_fn Write the application uses, e.g. i2s_lcd_write_async or i2s_lcd_write_trans, NULL for i2s_lcd_write
+ * @param user_ctx User context passed to write_fn
+ * @param result Best layout and its measurements, can be NULL
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG handle or data is invalid
+ *      - ESP_FAIL no candidate layout fits into max_buffer_size
+ *      - Error of the last failed candidate if no layout could be applied and measured,
+ *        or of applying the best layout at the end
+ */
+esp_err_t i2s_lcd_calibrate(i2s_lcd_handle_t handle, const uint8_t *data, uint32_t length, uint32_t max_buffer_size,
+                            i2s_lcd_calibrate_write_t write_fn, void *user_ctx, i2s_lcd_calibration_t *result);
+
+/**
+ * @brief Get the performance counters of the driver
+ *
+ * @param handle Handle of i2s lcd driver
+ * @param stats Returned counters, accumulated since init or the last i2s_lcd_reset_stats
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG handle or stats is invalid
+ *      - ESP_ERR_NOT_SUPPORTED CONFIG_LCD_PERF_STATS is disabled
+ */
+esp_err_t i2s_lcd_get_stats(i2s_lcd_handle_t handle, i2s_lcd_stats_t *stats);
+
+/**
+ * @brief Clear the performance counters, waits for an asynchronous write in flight
+ *
+ * @param handle Handle of i2s lcd driver
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG handle is invalid
+ *      - ESP_ERR_NOT_SUPPORTED CONFIG_LCD_PERF_STATS is disabled
+ */
+esp_err_t i2s_lcd_reset_stats(i2s_lcd_handle_t handle);
+
 /**
  * @brief acquire a lock
  * 
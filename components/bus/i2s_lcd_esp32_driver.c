@@ -26,7 +26,15 @@
 #include "soc/i2s_struct.h"
 #include "hal/gpio_ll.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#if (ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0))
+#include "esp_memory_utils.h"
+#else
+#include "soc/soc_memory_layout.h"
+#endif
 #include "i2s_lcd_driver.h"
+#include "i2s_lcd_priv.h"
+#include "i2s_lcd_pack.h"
 
 #if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
 #include "esp_private/periph_ctrl.h"
@@ -46,8 +54,10 @@ static const char *TAG = "ESP32_I2S_LCD";
 #define portTICK_RATE_MS portTICK_PERIOD_MS
 #endif
 
-#define LCD_CAM_DMA_NODE_BUFFER_MAX_SIZE  (4000) // 4-byte aligned
 #define LCD_DATA_MAX_WIDTH (24)  /*!< Maximum width of LCD data bus */
+#define LCD_TRANS_SEG_MAX  (I2S_LCD_TRANS_MAX * 3)  // Command, parameter words and the odd parameter tail of every transaction
+#define LCD_TRANS_BUFFER_SIZE  (I2S_LCD_TRANS_MAX * (I2S_LCD_TRANS_PARAM_MAX * 2 + 8))
+#define LCD_IDLE_TIMEOUT_US  (10)  // Time the last word may take to leave the bus once the FIFO is empty
 
 typedef struct {
     uint32_t dma_buffer_size;
@@ -62,6 +72,16 @@ typedef struct {
     bool swap_data;
     intr_handle_t lcd_cam_intr_handle;
     i2s_dev_t *i2s_dev;
+    i2s_lcd_common_t common;        // Idle semaphore, asynchronous write and counters
+    bool async_drain;               // tx_rempty is armed, the next half or segment waits for the FIFO to drain
+    lldesc_t trans_dma[LCD_TRANS_SEG_MAX];  // One descriptor per command or parameter segment of i2s_lcd_write_trans
+    uint8_t trans_fifo_mode[LCD_TRANS_SEG_MAX];
+    uint8_t trans_rs[LCD_TRANS_SEG_MAX];
+    uint32_t trans_buffer[LCD_TRANS_BUFFER_SIZE / 4];
+    uint32_t trans_seg_cnt;         // Segments still to be started from the ISR, 0 once the block data is reached
+    uint32_t trans_seg_pos;
+    int rs_io_num;
+    uint32_t rs_level;
 } i2s_lcd_obj_t;
 
 typedef struct {
@@ -71,27 +91,6 @@ typedef struct {
     SemaphoreHandle_t mutex;
 } i2s_lcd_driver_t;
 
-static void IRAM_ATTR i2s_isr(void *arg)
-{
-    BaseType_t HPTaskAwoken = pdFALSE;
-    i2s_lcd_obj_t *i2s_lcd_obj = (i2s_lcd_obj_t *)arg;
-    i2s_dev_t *i2s_dev = i2s_lcd_obj->i2s_dev;
-
-    typeof(i2s_dev->int_st) status = i2s_dev->int_st;
-    i2s_dev->int_clr.val = status.val;
-    if (status.val == 0) {
-        return;
-    }
-
-    if (status.out_eof) {
-        xQueueSendFromISR(i2s_lcd_obj->event_queue, (void *)&status.val, &HPTaskAwoken);
-    }
-
-    if (HPTaskAwoken == pdTRUE) {
-        portYIELD_FROM_ISR();
-    }
-}
-
 static void lcd_dma_set_int(i2s_lcd_obj_t *i2s_lcd_obj)
 {
     // Generate a data DMA linked list
@@ -106,7 +105,7 @@ static void lcd_dma_set_int(i2s_lcd_obj_t *i2s_lcd_obj)
     i2s_lcd_obj->dma[i2s_lcd_obj->dma_node_cnt - 1].empty = (uint32_t)NULL;
 }
 
-static void lcd_dma_set_left(i2s_lcd_obj_t *i2s_lcd_obj, int pos, size_t len)
+static void IRAM_ATTR lcd_dma_set_left(i2s_lcd_obj_t *i2s_lcd_obj, int pos, size_t len)
 {
     int end_pos = 0, size = 0;
     // Processing data length is an integer multiple of i2s_lcd_obj->dma_node_buffer_size
@@ -124,9 +123,15 @@ static void lcd_dma_set_left(i2s_lcd_obj_t *i2s_lcd_obj, int pos, size_t len)
     i2s_lcd_obj->dma[end_pos].empty = (uint32_t)NULL;
 }
 
-static void lcd_i2s_start(i2s_dev_t *i2s_dev, uint8_t fifo_mode, uint32_t addr, size_t len)
+/* Task context only, the interrupt waits for tx_rempty instead, see lcd_async_eof_isr */
+static void lcd_i2s_wait_idle(i2s_dev_t *i2s_dev)
 {
     while (!i2s_dev->state.tx_idle);
+}
+
+/* The transmitter has to be idle, a reset would drop the words of the previous transfer still in the FIFO */
+static void IRAM_ATTR lcd_i2s_start(i2s_dev_t *i2s_dev, uint8_t fifo_mode, uint32_t addr, size_t len)
+{
     i2s_dev->fifo_conf.tx_fifo_mod = fifo_mode;
     i2s_dev->conf.tx_start = 0;
     i2s_dev->conf.tx_reset = 1;
@@ -141,14 +146,239 @@ static void lcd_i2s_start(i2s_dev_t *i2s_dev, uint8_t fifo_mode, uint32_t addr,
     i2s_dev->conf.tx_start = 1;
 }
 
+static void IRAM_ATTR lcd_set_rs(i2s_lcd_obj_t *i2s_lcd_obj, uint32_t level)
+{
+    // Callers have waited for the previous segment to leave the bus, from tx_rempty in the interrupt
+    if (i2s_lcd_obj->rs_level != level) {
+        gpio_ll_set_level(&GPIO, i2s_lcd_obj->rs_io_num, level);
+        i2s_lcd_obj->rs_level = level;
+    }
+}
+
+static void IRAM_ATTR lcd_trans_start_seg(i2s_lcd_obj_t *i2s_lcd_obj, uint32_t pos)
+{
+    lcd_set_rs(i2s_lcd_obj, i2s_lcd_obj->trans_rs[pos]);
+    lcd_i2s_start(i2s_lcd_obj->i2s_dev, i2s_lcd_obj->trans_fifo_mode[pos], ((uint32_t)&i2s_lcd_obj->trans_dma[pos]) & 0xfffff, 0);
+}
+
+static void IRAM_ATTR lcd_async_fill(i2s_lcd_obj_t *i2s_lcd_obj, uint32_t slot)
+{
+    uint32_t *out = (uint32_t *)i2s_lcd_obj->dma[(slot % 2) * i2s_lcd_obj->dma_half_node_cnt].buf;
+    size_t in_size, out_size;
+    if (8 == i2s_lcd_obj->width) {
+        in_size = i2s_lcd_obj->dma_half_buffer_size >> 1;
+        in_size = i2s_lcd_obj->common.async_left < in_size ? i2s_lcd_obj->common.async_left : in_size;
+        out_size = in_size * 2;
+        i2s_lcd_pack_8bit(out, i2s_lcd_obj->common.async_data, in_size, i2s_lcd_obj->swap_data);
+    } else {
+        in_size = i2s_lcd_obj->dma_half_buffer_size;
+        in_size = i2s_lcd_obj->common.async_left < in_size ? i2s_lcd_obj->common.async_left : in_size;
+        out_size = in_size;
+        i2s_lcd_pack_16bit(out, i2s_lcd_obj->common.async_data, in_size, i2s_lcd_obj->swap_data);
+    }
+    i2s_lcd_obj->common.async_data += in_size;
+    i2s_lcd_obj->common.async_left -= in_size;
+    if (out_size < i2s_lcd_obj->dma_half_buffer_size) {
+        lcd_dma_set_left(i2s_lcd_obj, slot, out_size);
+    }
+}
+
+static void IRAM_ATTR lcd_async_next_isr(i2s_lcd_obj_t *i2s_lcd_obj, BaseType_t *HPTaskAwoken)
+{
+    if (i2s_lcd_obj->trans_seg_cnt) {
+        if (i2s_lcd_obj->trans_seg_pos < i2s_lcd_obj->trans_seg_cnt) {
+            lcd_trans_start_seg(i2s_lcd_obj, i2s_lcd_obj->trans_seg_pos++);
+            return;
+        }
+        // All commands are out, the block data and any later write go at data level
+        i2s_lcd_obj->trans_seg_cnt = 0;
+        lcd_set_rs(i2s_lcd_obj, LCD_DATA_LEV);
+    }
+    if (i2s_lcd_obj->common.async_pending) {
+        // Start the half filled ahead of time, then refill the half which has just been sent
+        uint32_t slot = i2s_lcd_obj->common.async_slot++;
+        lcd_i2s_start(i2s_lcd_obj->i2s_dev, 1, ((uint32_t)&i2s_lcd_obj->dma[(slot % 2) * i2s_lcd_obj->dma_half_node_cnt]) & 0xfffff, 0);
+        i2s_lcd_obj->common.async_pending = false;
+        if (i2s_lcd_obj->common.async_left) {
+            lcd_async_fill(i2s_lcd_obj, i2s_lcd_obj->common.async_slot);
+            i2s_lcd_obj->common.async_pending = true;
+            // The half started above has already drained, the bus sat idle until this refill
+            if (i2s_lcd_obj->i2s_dev->int_raw.out_eof) {
+                i2s_lcd_obj->common.stall_cnt++;
+            }
+        }
+        return;
+    }
+    i2s_lcd_async_done_isr(&i2s_lcd_obj->common, HPTaskAwoken);
+}
+
+/*
+ * EOF only means that DMA has read the descriptors, the FIFO still drains to the bus. Rather than spinning on
+ * tx_idle here, the next half or segment is started from tx_rempty once there is one to start.
+ */
+static void IRAM_ATTR lcd_async_eof_isr(i2s_lcd_obj_t *i2s_lcd_obj, BaseType_t *HPTaskAwoken)
+{
+    i2s_dev_t *i2s_dev = i2s_lcd_obj->i2s_dev;
+    if ((i2s_lcd_obj->trans_seg_cnt || i2s_lcd_obj->common.async_pending) && !i2s_dev->state.tx_idle) {
+        i2s_lcd_obj->async_drain = true;
+        i2s_dev->int_clr.tx_rempty = 1;
+        i2s_dev->int_ena.tx_rempty = 1;
+        return;
+    }
+    lcd_async_next_isr(i2s_lcd_obj, HPTaskAwoken);
+}
+
+static void IRAM_ATTR lcd_async_rempty_isr(i2s_lcd_obj_t *i2s_lcd_obj, BaseType_t *HPTaskAwoken)
+{
+    i2s_dev_t *i2s_dev = i2s_lcd_obj->i2s_dev;
+    i2s_dev->int_ena.tx_rempty = 0;
+    i2s_lcd_obj->async_drain = false;
+    // Only the word in the shift register is left, a transmitter which doesn't get idle counts as an underrun
+    int64_t start = esp_timer_get_time();
+    while (!i2s_dev->state.tx_idle) {
+        if (esp_timer_get_time() - start > LCD_IDLE_TIMEOUT_US) {
+            i2s_lcd_obj->common.stall_cnt++;
+            break;
+        }
+    }
+    lcd_async_next_isr(i2s_lcd_obj, HPTaskAwoken);
+}
+
+static void IRAM_ATTR i2s_isr(void *arg)
+{
+    BaseType_t HPTaskAwoken = pdFALSE;
+    i2s_lcd_obj_t *i2s_lcd_obj = (i2s_lcd_obj_t *)arg;
+    i2s_dev_t *i2s_dev = i2s_lcd_obj->i2s_dev;
+
+    typeof(i2s_dev->int_st) status = i2s_dev->int_st;
+    i2s_dev->int_clr.val = status.val;
+    if (status.val == 0) {
+        return;
+    }
+
+    LCD_PERF_ISR_START();
+
+    if (status.out_eof) {
+        i2s_lcd_obj->common.isr_cnt++;
+        if (i2s_lcd_obj->common.async_busy) {
+            lcd_async_eof_isr(i2s_lcd_obj, &HPTaskAwoken);
+        } else {
+            xQueueSendFromISR(i2s_lcd_obj->event_queue, (void *)&status.val, &HPTaskAwoken);
+        }
+    }
+    if (status.tx_rempty && i2s_lcd_obj->async_drain) {
+        lcd_async_rempty_isr(i2s_lcd_obj, &HPTaskAwoken);
+    }
+
+    LCD_PERF_ISR_END(&i2s_lcd_obj->common.perf);
+    if (HPTaskAwoken == pdTRUE) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+static void lcd_write_async(i2s_lcd_obj_t *i2s_lcd_obj, i2s_lcd_handle_t handle, const uint8_t *data, size_t len, i2s_lcd_trans_done_cb_t done_cb, void *user_ctx)
+{
+    i2s_lcd_async_begin(&i2s_lcd_obj->common, handle, data, len, done_cb, user_ctx);
+    lcd_dma_set_int(i2s_lcd_obj);
+    // Fill both halves here, the ISR takes over refilling from the third one on
+    lcd_async_fill(i2s_lcd_obj, 0);
+    i2s_lcd_obj->common.async_slot = 1;
+    i2s_lcd_obj->common.async_pending = false;
+    if (i2s_lcd_obj->common.async_left) {
+        lcd_async_fill(i2s_lcd_obj, 1);
+        i2s_lcd_obj->common.async_pending = true;
+    }
+    i2s_lcd_obj->common.async_busy = true;
+    lcd_i2s_wait_idle(i2s_lcd_obj->i2s_dev);
+    lcd_i2s_start(i2s_lcd_obj->i2s_dev, 1, ((uint32_t)&i2s_lcd_obj->dma[0]) & 0xfffff, 0);
+}
+
+static uint8_t *lcd_trans_add_seg(i2s_lcd_obj_t *i2s_lcd_obj, uint8_t *out, uint8_t fifo_mode, size_t size, uint32_t rs_level)
+{
+    uint32_t pos = i2s_lcd_obj->trans_seg_cnt++;
+    i2s_lcd_obj->trans_dma[pos].size = size;
+    i2s_lcd_obj->trans_dma[pos].length = size;
+    i2s_lcd_obj->trans_dma[pos].buf = out;
+    i2s_lcd_obj->trans_dma[pos].eof = 1;
+    i2s_lcd_obj->trans_dma[pos].empty = (uint32_t)NULL;
+    i2s_lcd_obj->trans_fifo_mode[pos] = fifo_mode;
+    i2s_lcd_obj->trans_rs[pos] = rs_level;
+    return out + size;
+}
+
+/*
+ * Pack bytes into segments of the FIFO layout without swapping, a trailing bus word which doesn't fill
+ * a whole FIFO word goes into its own segment sent with tx_fifo_mod = 3, like the tail of i2s_write_8bit_data.
+ */
+static uint8_t *lcd_trans_pack(void *arg, uint8_t *out, const uint8_t *in, size_t len, uint32_t rs_level)
+{
+    i2s_lcd_obj_t *i2s_lcd_obj = (i2s_lcd_obj_t *)arg;
+    size_t cnt;
+    if (8 == i2s_lcd_obj->width) {
+        cnt = len - len % 2;
+        if (cnt) {
+            i2s_lcd_pack_8bit((uint32_t *)out, in, cnt, false);
+            out = lcd_trans_add_seg(i2s_lcd_obj, out, 1, cnt * 2, rs_level);
+        }
+        if (len % 2) {
+            memset(out, 0, 4);
+            out[3] = in[cnt];
+            out = lcd_trans_add_seg(i2s_lcd_obj, out, 3, 4, rs_level);
+        }
+    } else {
+        cnt = len - len % 4;
+        if (cnt) {
+            i2s_lcd_pack_16bit((uint32_t *)out, in, cnt, false);
+            out = lcd_trans_add_seg(i2s_lcd_obj, out, 1, cnt, rs_level);
+        }
+        if (len % 4) {
+            memset(out, 0, 4);
+            out[2] = in[cnt];
+            out[3] = in[cnt + 1];
+            out = lcd_trans_add_seg(i2s_lcd_obj, out, 3, 4, rs_level);
+        }
+    }
+    return out;
+}
+
+static void lcd_write_trans(i2s_lcd_obj_t *i2s_lcd_obj, const i2s_lcd_trans_t *trans, uint32_t count)
+{
+    const i2s_lcd_trans_t *last = &trans[count - 1];
+    // Only internal RAM can be read from the IRAM interrupt, block data in PSRAM or flash follows once the commands are out
+    bool stream = last->length && esp_ptr_internal(last->data);
+    size_t bytes = stream ? last->length : 0;
+    xSemaphoreTake(i2s_lcd_obj->common.idle_sem, portMAX_DELAY);
+    i2s_lcd_obj->trans_seg_cnt = 0;
+    bytes += i2s_lcd_trans_pack(trans, count, i2s_lcd_obj->width == 16 ? 2 : 1, (uint8_t *)i2s_lcd_obj->trans_buffer, lcd_trans_pack, i2s_lcd_obj);
+    LCD_PERF_WRITE_START(&i2s_lcd_obj->common.perf, bytes);
+    i2s_lcd_obj->common.async_cb = NULL;
+    i2s_lcd_obj->common.async_left = 0;
+    i2s_lcd_obj->common.async_pending = false;
+    if (stream) {
+        // The first half waits for the ISR to run out of segments
+        lcd_dma_set_int(i2s_lcd_obj);
+        i2s_lcd_obj->common.async_data = last->data;
+        i2s_lcd_obj->common.async_left = last->length;
+        lcd_async_fill(i2s_lcd_obj, 0);
+        i2s_lcd_obj->common.async_slot = 0;
+        i2s_lcd_obj->common.async_pending = true;
+    }
+    i2s_lcd_obj->trans_seg_pos = 1;
+    i2s_lcd_obj->common.async_busy = true;
+    lcd_i2s_wait_idle(i2s_lcd_obj->i2s_dev);
+    lcd_trans_start_seg(i2s_lcd_obj, 0);
+}
+
 static void i2s_write_8bit_data(i2s_lcd_obj_t *i2s_lcd_obj, uint8_t *data, size_t len)
 {
     int event  = 0;
-    int x = 0, y = 0, left = 0, cnt = 0;
+    int x = 0, left = 0, cnt = 0;
     if (len <= 0) {
         ESP_LOGE(TAG, "wrong len!");
         return;
     }
+    i2s_lcd_async_wait(&i2s_lcd_obj->common, portMAX_DELAY);
+    LCD_PERF_WRITE_START(&i2s_lcd_obj->common.perf, len);
     len = len * 2;
     lcd_dma_set_int(i2s_lcd_obj);
     uint8_t fifo_mode = 1;
@@ -159,19 +389,14 @@ static void i2s_write_8bit_data(i2s_lcd_obj_t *i2s_lcd_obj, uint8_t *data, size_
     for (x = 0; x < cnt; x++) {
         uint8_t *out = (uint8_t *)i2s_lcd_obj->dma[(x % 2) * i2s_lcd_obj->dma_half_node_cnt].buf;
         uint8_t *in  = data;
-        if (!i2s_lcd_obj->swap_data) { // data will be swapped when fifo_mode=1, so negate the lcd.swap_data
-            for (y = 0; y < i2s_lcd_obj->dma_half_buffer_size; y += 4) {
-                out[y + 3] = in[(y >> 1) + 0];
-                out[y + 1] = in[(y >> 1) + 1];
-            }
-        } else {
-            for (y = 0; y < i2s_lcd_obj->dma_half_buffer_size; y += 4) {
-                out[y + 1] = in[(y >> 1) + 0];
-                out[y + 3] = in[(y >> 1) + 1];
-            }
-        }
+        // data will be swapped when fifo_mode=1, the kernel negates the lcd.swap_data
+        i2s_lcd_pack_8bit((uint32_t *)out, in, i2s_lcd_obj->dma_half_buffer_size >> 1, i2s_lcd_obj->swap_data);
         data += i2s_lcd_obj->dma_half_buffer_size >> 1;
+        if (x && uxQueueMessagesWaiting(i2s_lcd_obj->event_queue)) {
+            i2s_lcd_obj->common.stall_cnt++;
+        }
         xQueueReceive(i2s_lcd_obj->event_queue, (void *)&event, portMAX_DELAY);
+        lcd_i2s_wait_idle(i2s_lcd_obj->i2s_dev);
         lcd_i2s_start(i2s_lcd_obj->i2s_dev, fifo_mode, ((uint32_t)&i2s_lcd_obj->dma[(x % 2) * i2s_lcd_obj->dma_half_node_cnt]) & 0xfffff, i2s_lcd_obj->dma_half_buffer_size);
     }
     left = len % i2s_lcd_obj->dma_half_buffer_size;
@@ -183,17 +408,7 @@ static void i2s_write_8bit_data(i2s_lcd_obj_t *i2s_lcd_obj, uint8_t *data, size_
             cnt = left - left % 4;
             left = left % 4;
             data += cnt >> 1;
-            if (!i2s_lcd_obj->swap_data) { // data will be swapped when fifo_mode=1, so negate the lcd.swap_data
-                for (y = 0; y < cnt; y += 4) {
-                    out[y + 3] = in[(y >> 1) + 0];
-                    out[y + 1] = in[(y >> 1) + 1];
-                }
-            } else {
-                for (y = 0; y < cnt; y += 4) {
-                    out[y + 1] = in[(y >> 1) + 0];
-                    out[y + 3] = in[(y >> 1) + 1];
-                }
-            }
+            i2s_lcd_pack_8bit((uint32_t *)out, in, cnt >> 1, i2s_lcd_obj->swap_data);
         } else {
             cnt = 4;
             left = 0;
@@ -205,21 +420,28 @@ static void i2s_write_8bit_data(i2s_lcd_obj_t *i2s_lcd_obj, uint8_t *data, size_
         //     printf("%02x, ", out[i]);
         // } printf("]\n");
         lcd_dma_set_left(i2s_lcd_obj, x, cnt);
+        if (x && uxQueueMessagesWaiting(i2s_lcd_obj->event_queue)) {
+            i2s_lcd_obj->common.stall_cnt++;
+        }
         xQueueReceive(i2s_lcd_obj->event_queue, (void *)&event, portMAX_DELAY);
+        lcd_i2s_wait_idle(i2s_lcd_obj->i2s_dev);
         lcd_i2s_start(i2s_lcd_obj->i2s_dev, fifo_mode, ((uint32_t)&i2s_lcd_obj->dma[(x % 2) * i2s_lcd_obj->dma_half_node_cnt]) & 0xfffff, cnt);
         x++;
     }
     xQueueReceive(i2s_lcd_obj->event_queue, (void *)&event, portMAX_DELAY);
+    LCD_PERF_WRITE_END(&i2s_lcd_obj->common.perf);
 }
 
 static void i2s_write_16bit_data(i2s_lcd_obj_t *i2s_lcd_obj, uint8_t *data, size_t len)
 {
     int event  = 0;
-    int x = 0, y = 0, left = 0, cnt = 0;
+    int x = 0, left = 0, cnt = 0;
     if (len <= 0 || len % 2 != 0) {
         ESP_LOGE(TAG, "wrong len!");
         return;
     }
+    i2s_lcd_async_wait(&i2s_lcd_obj->common, portMAX_DELAY);
+    LCD_PERF_WRITE_START(&i2s_lcd_obj->common.perf, len);
     lcd_dma_set_int(i2s_lcd_obj);
     uint8_t fifo_mode = 1;
     // Start signal
@@ -229,23 +451,13 @@ static void i2s_write_16bit_data(i2s_lcd_obj_t *i2s_lcd_obj, uint8_t *data, size
     for (x = 0; x < cnt; x++) {
         uint8_t *out = (uint8_t *)i2s_lcd_obj->dma[(x % 2) * i2s_lcd_obj->dma_half_node_cnt].buf;
         uint8_t *in  = data;
-        if (i2s_lcd_obj->swap_data) {
-            for (y = 0; y < i2s_lcd_obj->dma_half_buffer_size; y += 4) {
-                out[y + 3] = in[y + 0];
-                out[y + 2] = in[y + 1];
-                out[y + 1] = in[y + 2];
-                out[y + 0] = in[y + 3];
-            }
-        } else {
-            for (y = 0; y < i2s_lcd_obj->dma_half_buffer_size; y += 4) {
-                out[y + 2] = in[y + 0];
-                out[y + 3] = in[y + 1];
-                out[y + 0] = in[y + 2];
-                out[y + 1] = in[y + 3];
-            }
-        }
+        i2s_lcd_pack_16bit((uint32_t *)out, in, i2s_lcd_obj->dma_half_buffer_size, i2s_lcd_obj->swap_data);
         data += i2s_lcd_obj->dma_half_buffer_size;
+        if (x && uxQueueMessagesWaiting(i2s_lcd_obj->event_queue)) {
+            i2s_lcd_obj->common.stall_cnt++;
+        }
         xQueueReceive(i2s_lcd_obj->event_queue, (void *)&event, portMAX_DELAY);
+        lcd_i2s_wait_idle(i2s_lcd_obj->i2s_dev);
         lcd_i2s_start(i2s_lcd_obj->i2s_dev, fifo_mode, ((uint32_t)&i2s_lcd_obj->dma[(x % 2) * i2s_lcd_obj->dma_half_node_cnt]) & 0xfffff, i2s_lcd_obj->dma_half_buffer_size);
     }
     left = len % i2s_lcd_obj->dma_half_buffer_size;
@@ -257,21 +469,7 @@ static void i2s_write_16bit_data(i2s_lcd_obj_t *i2s_lcd_obj, uint8_t *data, size
             cnt = left - left % 4;
             left = left % 4;
             data += cnt;
-            if (i2s_lcd_obj->swap_data) {
-                for (y = 0; y < cnt; y += 4) {
-                    out[y + 3] = in[y + 0];
-                    out[y + 2] = in[y + 1];
-                    out[y + 1] = in[y + 2];
-                    out[y + 0] = in[y + 3];
-                }
-            } else {
-                for (y = 0; y < cnt; y += 4) {
-                    out[y + 2] = in[y + 0];
-                    out[y + 3] = in[y + 1];
-                    out[y + 0] = in[y + 2];
-                    out[y + 1] = in[y + 3];
-                }
-            }
+            i2s_lcd_pack_16bit((uint32_t *)out, in, cnt, i2s_lcd_obj->swap_data);
         } else {
             cnt = 4;
             left = 0;
@@ -285,11 +483,16 @@ static void i2s_write_16bit_data(i2s_lcd_obj_t *i2s_lcd_obj, uint8_t *data, size
             }
         }
         lcd_dma_set_left(i2s_lcd_obj, x, cnt);
+        if (x && uxQueueMessagesWaiting(i2s_lcd_obj->event_queue)) {
+            i2s_lcd_obj->common.stall_cnt++;
+        }
         xQueueReceive(i2s_lcd_obj->event_queue, (void *)&event, portMAX_DELAY);
+        lcd_i2s_wait_idle(i2s_lcd_obj->i2s_dev);
         lcd_i2s_start(i2s_lcd_obj->i2s_dev, fifo_mode, ((uint32_t)&i2s_lcd_obj->dma[(x % 2) * i2s_lcd_obj->dma_half_node_cnt]) & 0xfffff, cnt);
         x++;
     }
     xQueueReceive(i2s_lcd_obj->event_queue, (void *)&event, portMAX_DELAY);
+    LCD_PERF_WRITE_END(&i2s_lcd_obj->common.perf);
 }
 
 static esp_err_t i2s_lcd_reg_config(i2s_dev_t *i2s_dev, uint16_t data_width, uint32_t clk_freq)
@@ -375,34 +578,48 @@ static esp_err_t lcd_set_pin(const i2s_lcd_config_t *config)
     return ESP_OK;
 }
 
-static esp_err_t lcd_dma_config(i2s_lcd_obj_t *i2s_lcd_obj, uint32_t max_dma_buffer_size)
+static void lcd_dma_free(i2s_lcd_obj_t *i2s_lcd_obj)
 {
-    int cnt = 0;
-    if (LCD_CAM_DMA_NODE_BUFFER_MAX_SIZE % 2 != 0) {
-        ESP_LOGE(TAG, "ESP32 only supports 2-byte aligned data length");
-        return ESP_FAIL;
+    if (i2s_lcd_obj->dma) {
+        free(i2s_lcd_obj->dma);
+        i2s_lcd_obj->dma = NULL;
     }
-    if (max_dma_buffer_size >= LCD_CAM_DMA_NODE_BUFFER_MAX_SIZE * 2) {
-        i2s_lcd_obj->dma_node_buffer_size = LCD_CAM_DMA_NODE_BUFFER_MAX_SIZE;
-        for (cnt = 0; cnt < max_dma_buffer_size - 8; cnt++) { // Find a buffer size that can divide dma_size
-            if ((max_dma_buffer_size - cnt) % (i2s_lcd_obj->dma_node_buffer_size * 2) == 0) {
-                break;
-            }
-        }
-        i2s_lcd_obj->dma_buffer_size = max_dma_buffer_size - cnt;
-    } else {
-        i2s_lcd_obj->dma_node_buffer_size = max_dma_buffer_size / 2;
-        i2s_lcd_obj->dma_buffer_size = i2s_lcd_obj->dma_node_buffer_size * 2;
+    if (i2s_lcd_obj->dma_buffer) {
+        free(i2s_lcd_obj->dma_buffer);
+        i2s_lcd_obj->dma_buffer = NULL;
     }
+}
 
-    i2s_lcd_obj->dma_half_buffer_size = i2s_lcd_obj->dma_buffer_size / 2;
-    i2s_lcd_obj->dma_node_cnt = (i2s_lcd_obj->dma_buffer_size) / i2s_lcd_obj->dma_node_buffer_size; // Number of DMA nodes
-    i2s_lcd_obj->dma_half_node_cnt = i2s_lcd_obj->dma_node_cnt / 2;
+static esp_err_t lcd_dma_config(i2s_lcd_obj_t *i2s_lcd_obj, uint32_t max_dma_buffer_size, uint32_t dma_node_size)
+{
+    i2s_lcd_dma_layout_t layout;
+    esp_err_t ret = i2s_lcd_dma_layout_calc(max_dma_buffer_size, dma_node_size, &layout);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    dma_node_size = layout.node_size;
+    uint32_t dma_buffer_size = layout.buffer_size;
+    uint32_t dma_node_cnt = dma_buffer_size / dma_node_size; // Number of DMA nodes
+
+    // Allocate the new layout before releasing the current one, so a failure leaves the driver usable
+    lldesc_t *dma = (lldesc_t *)heap_caps_calloc(dma_node_cnt, sizeof(lldesc_t), MALLOC_CAP_DMA | MALLOC_CAP_8BIT);
+    uint8_t *dma_buffer = (uint8_t *)heap_caps_calloc(dma_buffer_size, sizeof(uint8_t), MALLOC_CAP_DMA | MALLOC_CAP_8BIT);
+    if (dma == NULL || dma_buffer == NULL) {
+        ESP_LOGE(TAG, "dma buffer malloc error");
+        free(dma);
+        free(dma_buffer);
+        return ESP_ERR_NO_MEM;
+    }
+    lcd_dma_free(i2s_lcd_obj);
+    i2s_lcd_obj->dma = dma;
+    i2s_lcd_obj->dma_buffer = dma_buffer;
+    i2s_lcd_obj->dma_node_buffer_size = dma_node_size;
+    i2s_lcd_obj->dma_buffer_size = dma_buffer_size;
+    i2s_lcd_obj->dma_half_buffer_size = dma_buffer_size / 2;
+    i2s_lcd_obj->dma_node_cnt = dma_node_cnt;
+    i2s_lcd_obj->dma_half_node_cnt = dma_node_cnt / 2;
 
     ESP_LOGI(TAG, "lcd_buffer_size: %"PRIu32", lcd_dma_size: %"PRIu32", lcd_dma_node_cnt: %"PRIu32"", i2s_lcd_obj->dma_buffer_size, i2s_lcd_obj->dma_node_buffer_size, i2s_lcd_obj->dma_node_cnt);
-
-    i2s_lcd_obj->dma    = (lldesc_t *)heap_caps_calloc(i2s_lcd_obj->dma_node_cnt, sizeof(lldesc_t), MALLOC_CAP_DMA | MALLOC_CAP_8BIT);
-    i2s_lcd_obj->dma_buffer = (uint8_t *)heap_caps_calloc(i2s_lcd_obj->dma_buffer_size, sizeof(uint8_t), MALLOC_CAP_DMA | MALLOC_CAP_8BIT);
     return ESP_OK;
 }
 
@@ -412,6 +629,12 @@ esp_err_t lcd_cam_deinit(i2s_lcd_driver_t *drv)
         return ESP_FAIL;
     }
 
+    if (drv->i2s_lcd_obj->common.idle_sem) {
+        if (drv->i2s_lcd_obj->lcd_cam_intr_handle) { // A transfer can only be in flight once init has completed
+            i2s_lcd_async_wait(&drv->i2s_lcd_obj->common, portMAX_DELAY);
+        }
+        vSemaphoreDelete(drv->i2s_lcd_obj->common.idle_sem);
+    }
     if (drv->i2s_lcd_obj->event_queue) {
         vQueueDelete(drv->i2s_lcd_obj->event_queue);
     }
@@ -462,7 +685,7 @@ static esp_err_t lcd_cam_init(i2s_lcd_driver_t *drv, const i2s_lcd_config_t *con
         }
 
         ret |= lcd_set_pin(config);
-        ret |= lcd_dma_config(i2s_lcd_obj, config->buffer_size);
+        ret |= lcd_dma_config(i2s_lcd_obj, config->buffer_size, config->dma_node_size);
 
         if (ret != ESP_OK) {
             ESP_LOGE(TAG, "lcd config fail!");
@@ -470,13 +693,15 @@ static esp_err_t lcd_cam_init(i2s_lcd_driver_t *drv, const i2s_lcd_config_t *con
         }
 
         i2s_lcd_obj->event_queue = xQueueCreate(1, sizeof(int));
+        i2s_lcd_obj->common.idle_sem = xSemaphoreCreateBinary();
         i2s_lcd_obj->width = config->data_width;
         i2s_lcd_obj->swap_data = config->swap_data;;
 
-        if (i2s_lcd_obj->event_queue == NULL) {
+        if (i2s_lcd_obj->event_queue == NULL || i2s_lcd_obj->common.idle_sem == NULL) {
             ESP_LOGE(TAG, "lcd config fail!");
             break;
         }
+        xSemaphoreGive(i2s_lcd_obj->common.idle_sem);
 
         if (I2S_NUM_0 == config->i2s_port) {
             ret |= esp_intr_alloc(ETS_I2S0_INTR_SOURCE, ESP_INTR_FLAG_LOWMED | ESP_INTR_FLAG_IRAM, i2s_isr, i2s_lcd_obj, &i2s_lcd_obj->lcd_cam_intr_handle);
@@ -544,7 +769,10 @@ i2s_lcd_handle_t i2s_lcd_driver_init(const i2s_lcd_config_t *config)
 
     gpio_pad_select_gpio(config->pin_num_rs);
     gpio_set_direction(config->pin_num_rs, GPIO_MODE_OUTPUT);
+    gpio_set_level(config->pin_num_rs, LCD_DATA_LEV);
     i2s_lcd_drv->rs_io_num = config->pin_num_rs;
+    i2s_lcd_drv->i2s_lcd_obj->rs_io_num = config->pin_num_rs;
+    i2s_lcd_drv->i2s_lcd_obj->rs_level = LCD_DATA_LEV;
     return (i2s_lcd_handle_t)i2s_lcd_drv;
 }
 
@@ -570,6 +798,7 @@ esp_err_t i2s_lcd_write_cmd(i2s_lcd_handle_t handle, uint16_t cmd)
 {
     i2s_lcd_driver_t *i2s_lcd_drv = (i2s_lcd_driver_t *)handle;
     I2S_CHECK(NULL != i2s_lcd_drv, "handle pointer invalid", ESP_ERR_INVALID_ARG);
+    i2s_lcd_async_wait(&i2s_lcd_drv->i2s_lcd_obj->common, portMAX_DELAY);
     gpio_set_level(i2s_lcd_drv->rs_io_num, LCD_CMD_LEV);
     i2s_lcd_drv->i2s_write_data_func(i2s_lcd_drv->i2s_lcd_obj, (uint8_t *)&cmd, i2s_lcd_drv->i2s_lcd_obj->width == 16 ? 2 : 1);
     gpio_set_level(i2s_lcd_drv->rs_io_num, LCD_DATA_LEV);
@@ -580,6 +809,7 @@ esp_err_t i2s_lcd_write_command(i2s_lcd_handle_t handle, const uint8_t *cmd, uin
 {
     i2s_lcd_driver_t *i2s_lcd_drv = (i2s_lcd_driver_t *)handle;
     I2S_CHECK(NULL != i2s_lcd_drv, "handle pointer invalid", ESP_ERR_INVALID_ARG);
+    i2s_lcd_async_wait(&i2s_lcd_drv->i2s_lcd_obj->common, portMAX_DELAY);
     gpio_set_level(i2s_lcd_drv->rs_io_num, LCD_CMD_LEV);
     i2s_lcd_drv->i2s_write_data_func(i2s_lcd_drv->i2s_lcd_obj, (uint8_t *)cmd, length);
     gpio_set_level(i2s_lcd_drv->rs_io_num, LCD_DATA_LEV);
@@ -595,6 +825,71 @@ esp_err_t i2s_lcd_write(i2s_lcd_handle_t handle, const uint8_t *data, uint32_t l
     return ESP_OK;
 }
 
+esp_err_t i2s_lcd_write_async(i2s_lcd_handle_t handle, const uint8_t *data, uint32_t length, i2s_lcd_trans_done_cb_t done_cb, void *user_ctx)
+{
+    i2s_lcd_driver_t *i2s_lcd_drv = (i2s_lcd_driver_t *)handle;
+    I2S_CHECK(NULL != i2s_lcd_drv, "handle pointer invalid", ESP_ERR_INVALID_ARG);
+    I2S_CHECK(NULL != data, "data pointer invalid", ESP_ERR_INVALID_ARG);
+    I2S_CHECK(length > 0 && 0 == length % (i2s_lcd_drv->i2s_lcd_obj->width == 16 ? 4 : 2), "wrong len!", ESP_ERR_INVALID_SIZE);
+    if (!esp_ptr_internal(data)) {
+        // PSRAM and flash can't be read from the IRAM interrupt while the cache is disabled,
+        // stream them through the internal bounce buffers from this task instead
+        i2s_lcd_drv->i2s_write_data_func(i2s_lcd_drv->i2s_lcd_obj, (uint8_t *)data, length);
+        if (done_cb) {
+            // Called from this task, there is no interrupt to yield from
+            (void)done_cb(handle, user_ctx);
+        }
+        return ESP_OK;
+    }
+    lcd_write_async(i2s_lcd_drv->i2s_lcd_obj, handle, data, length, done_cb, user_ctx);
+    return ESP_OK;
+}
+
+esp_err_t i2s_lcd_write_trans(i2s_lcd_handle_t handle, const i2s_lcd_trans_t *trans, uint32_t count)
+{
+    i2s_lcd_driver_t *i2s_lcd_drv = (i2s_lcd_driver_t *)handle;
+    I2S_CHECK(NULL != i2s_lcd_drv, "handle pointer invalid", ESP_ERR_INVALID_ARG);
+    uint32_t bus_bytes = i2s_lcd_drv->i2s_lcd_obj->width == 16 ? 2 : 1;
+    esp_err_t ret = i2s_lcd_trans_check(trans, count, bus_bytes);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    const i2s_lcd_trans_t *last = &trans[count - 1];
+    lcd_write_trans(i2s_lcd_drv->i2s_lcd_obj, trans, count);
+    if (last->length && !esp_ptr_internal(last->data)) {
+        i2s_lcd_drv->i2s_write_data_func(i2s_lcd_drv->i2s_lcd_obj, (uint8_t *)last->data, last->length);
+    }
+    return ESP_OK;
+}
+
+esp_err_t i2s_lcd_set_dma_layout(i2s_lcd_handle_t handle, uint32_t buffer_size, uint32_t node_size)
+{
+    i2s_lcd_driver_t *i2s_lcd_drv = (i2s_lcd_driver_t *)handle;
+    I2S_CHECK(NULL != i2s_lcd_drv, "handle pointer invalid", ESP_ERR_INVALID_ARG);
+    i2s_lcd_obj_t *i2s_lcd_obj = i2s_lcd_drv->i2s_lcd_obj;
+    // Holding idle_sem keeps asynchronous writes out while the buffers are replaced
+    xSemaphoreTake(i2s_lcd_obj->common.idle_sem, portMAX_DELAY);
+    esp_err_t ret = lcd_dma_config(i2s_lcd_obj, buffer_size, node_size);
+    xSemaphoreGive(i2s_lcd_obj->common.idle_sem);
+    return ret;
+}
+
+esp_err_t i2s_lcd_get_dma_layout(i2s_lcd_handle_t handle, i2s_lcd_dma_layout_t *layout)
+{
+    i2s_lcd_driver_t *i2s_lcd_drv = (i2s_lcd_driver_t *)handle;
+    I2S_CHECK(NULL != i2s_lcd_drv, "handle pointer invalid", ESP_ERR_INVALID_ARG);
+    I2S_CHECK(NULL != layout, "layout pointer invalid", ESP_ERR_INVALID_ARG);
+    layout->buffer_size = i2s_lcd_drv->i2s_lcd_obj->dma_buffer_size;
+    layout->node_size = i2s_lcd_drv->i2s_lcd_obj->dma_node_buffer_size;
+    return ESP_OK;
+}
+
+i2s_lcd_common_t *i2s_lcd_get_common(i2s_lcd_handle_t handle)
+{
+    i2s_lcd_driver_t *i2s_lcd_drv = (i2s_lcd_driver_t *)handle;
+    return i2s_lcd_drv ? &i2s_lcd_drv->i2s_lcd_obj->common : NULL;
+}
+
 esp_err_t i2s_lcd_acquire(i2s_lcd_handle_t handle)
 {
     i2s_lcd_driver_t *i2s_lcd_drv = (i2s_lcd_driver_t *)handle;
@@ -15,6 +15,7 @@
 #include "freertos/task.h"
 #include "freertos/semphr.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "driver/gpio.h"
 #include "esp32s2/rom/gpio.h"
 #if (ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0))
@@ -23,10 +24,17 @@
 #include "soc/gpio_periph.h"
 #include "driver/i2s.h"
 #include "soc/i2s_struct.h"
+#include "hal/gpio_ll.h"
 #include "esp_heap_caps.h"
 #include "esp32s2/rom/lldesc.h"
 #include "soc/system_reg.h"
+#if (ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0))
+#include "esp_memory_utils.h"
+#else
+#include "soc/soc_memory_layout.h"
+#endif
 #include "i2s_lcd_driver.h"
+#include "i2s_lcd_priv.h"
 
 
 static const char *TAG = "ESP32S2_I2S_LCD";
@@ -36,8 +44,10 @@ static const char *TAG = "ESP32S2_I2S_LCD";
         return (ret);                                                                   \
     }
 
-#define LCD_CAM_DMA_NODE_BUFFER_MAX_SIZE  (4000) // 4-byte aligned
 #define LCD_DATA_MAX_WIDTH (24)  /*!< Maximum width of LCD data bus */
+#define LCD_TRANS_SEG_MAX  (I2S_LCD_TRANS_MAX * 2)  // Command and parameters of every transaction
+#define LCD_TRANS_BUFFER_SIZE  (I2S_LCD_TRANS_MAX * (I2S_LCD_TRANS_PARAM_MAX + 4))
+#define LCD_IDLE_TIMEOUT_US  (10)  // Time the last word may take to leave the bus once the FIFO is empty
 
 #if (ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0))
 #define ets_delay_us esp_rom_delay_us
@@ -57,6 +67,15 @@ typedef struct {
     bool swap_data;
     intr_handle_t lcd_cam_intr_handle;
     i2s_dev_t *i2s_dev;
+    i2s_lcd_common_t common;        // Idle semaphore, asynchronous write and counters
+    bool async_drain;               // tx_rempty is armed, the next half or segment waits for the FIFO to drain
+    lldesc_t trans_dma[LCD_TRANS_SEG_MAX];  // One descriptor per command or parameter segment of i2s_lcd_write_trans
+    uint8_t trans_rs[LCD_TRANS_SEG_MAX];
+    uint32_t trans_buffer[LCD_TRANS_BUFFER_SIZE / 4];
+    uint32_t trans_seg_cnt;         // Segments still to be started from the ISR, 0 once the block data is reached
+    uint32_t trans_seg_pos;
+    int rs_io_num;
+    uint32_t rs_level;
 } i2s_lcd_obj_t;
 
 typedef struct {
@@ -65,27 +84,6 @@ typedef struct {
     SemaphoreHandle_t mutex;
 } i2s_lcd_driver_t;
 
-static void IRAM_ATTR i2s_isr(void *arg)
-{
-    BaseType_t HPTaskAwoken = pdFALSE;
-    i2s_lcd_obj_t *i2s_lcd_obj = (i2s_lcd_obj_t*)arg;
-    i2s_dev_t *i2s_dev = i2s_lcd_obj->i2s_dev;
-
-    typeof(i2s_dev->int_st) status = i2s_dev->int_st;
-    i2s_dev->int_clr.val = status.val;
-    if (status.val == 0) {
-        return;
-    }
-
-    if (status.out_eof) {
-        xQueueSendFromISR(i2s_lcd_obj->event_queue, (void*)&status.val, &HPTaskAwoken);
-    }
-
-    if (HPTaskAwoken == pdTRUE) {
-        portYIELD_FROM_ISR();
-    }
-}
-
 static void lcd_dma_set_int(i2s_lcd_obj_t *i2s_lcd_obj)
 {
     // Generate a data DMA linked list
@@ -100,7 +98,7 @@ static void lcd_dma_set_int(i2s_lcd_obj_t *i2s_lcd_obj)
     i2s_lcd_obj->dma[i2s_lcd_obj->dma_node_cnt - 1].empty = (uint32_t)NULL; 
 }
 
-static void lcd_dma_set_left(i2s_lcd_obj_t *i2s_lcd_obj, int pos, size_t len)
+static void IRAM_ATTR lcd_dma_set_left(i2s_lcd_obj_t *i2s_lcd_obj, int pos, size_t len)
 {
     int end_pos = 0, size = 0;
     // Processing data length is an integer multiple of i2s_lcd_obj->dma_node_buffer_size
@@ -118,9 +116,15 @@ static void lcd_dma_set_left(i2s_lcd_obj_t *i2s_lcd_obj, int pos, size_t len)
     i2s_lcd_obj->dma[end_pos].empty = (uint32_t)NULL;
 }
 
-static void lcd_i2s_start(i2s_dev_t *i2s_dev, uint32_t addr, size_t len)
+/* Task context only, the interrupt waits for tx_rempty instead, see lcd_async_eof_isr */
+static void lcd_i2s_wait_idle(i2s_dev_t *i2s_dev)
 {
     while (!i2s_dev->state.tx_idle);
+}
+
+/* The transmitter has to be idle, a reset would drop the words of the previous transfer still in the FIFO */
+static void IRAM_ATTR lcd_i2s_start(i2s_dev_t *i2s_dev, uint32_t addr, size_t len)
+{
     i2s_dev->conf.tx_start = 0;
     i2s_dev->conf.tx_reset = 1;
     i2s_dev->conf.tx_reset = 0;
@@ -132,6 +136,194 @@ static void lcd_i2s_start(i2s_dev_t *i2s_dev, uint32_t addr, size_t len)
     i2s_dev->conf.tx_start = 1;
 }
 
+static void IRAM_ATTR lcd_set_rs(i2s_lcd_obj_t *i2s_lcd_obj, uint32_t level)
+{
+    // Callers have waited for the previous segment to leave the bus, from tx_rempty in the interrupt
+    if (i2s_lcd_obj->rs_level != level) {
+        gpio_ll_set_level(&GPIO, i2s_lcd_obj->rs_io_num, level);
+        i2s_lcd_obj->rs_level = level;
+    }
+}
+
+static void IRAM_ATTR lcd_trans_start_seg(i2s_lcd_obj_t *i2s_lcd_obj, uint32_t pos)
+{
+    lcd_set_rs(i2s_lcd_obj, i2s_lcd_obj->trans_rs[pos]);
+    lcd_i2s_start(i2s_lcd_obj->i2s_dev, ((uint32_t)&i2s_lcd_obj->trans_dma[pos]) & 0xfffff, 0);
+}
+
+static void IRAM_ATTR lcd_async_fill(i2s_lcd_obj_t *i2s_lcd_obj, uint32_t slot)
+{
+    uint8_t *out = (uint8_t *)i2s_lcd_obj->dma[(slot % 2) * i2s_lcd_obj->dma_half_node_cnt].buf;
+    const uint8_t *in = i2s_lcd_obj->common.async_data;
+    size_t size = i2s_lcd_obj->common.async_left < i2s_lcd_obj->dma_half_buffer_size ? i2s_lcd_obj->common.async_left : i2s_lcd_obj->dma_half_buffer_size;
+    if (i2s_lcd_obj->swap_data) {
+        for (size_t y = 0; y < size; y += 2) {
+            out[y + 1] = in[y + 0];
+            out[y + 0] = in[y + 1];
+        }
+    } else {
+        memcpy(out, in, size);
+    }
+    if (size < i2s_lcd_obj->dma_half_buffer_size) {
+        lcd_dma_set_left(i2s_lcd_obj, slot, size);
+    }
+    i2s_lcd_obj->common.async_data += size;
+    i2s_lcd_obj->common.async_left -= size;
+}
+
+static void IRAM_ATTR lcd_async_next_isr(i2s_lcd_obj_t *i2s_lcd_obj, BaseType_t *HPTaskAwoken)
+{
+    if (i2s_lcd_obj->trans_seg_cnt) {
+        if (i2s_lcd_obj->trans_seg_pos < i2s_lcd_obj->trans_seg_cnt) {
+            lcd_trans_start_seg(i2s_lcd_obj, i2s_lcd_obj->trans_seg_pos++);
+            return;
+        }
+        // All commands are out, the block data and any later write go at data level
+        i2s_lcd_obj->trans_seg_cnt = 0;
+        lcd_set_rs(i2s_lcd_obj, LCD_DATA_LEV);
+    }
+    if (i2s_lcd_obj->common.async_pending) {
+        // Start the half filled ahead of time, then refill the half which has just been sent
+        uint32_t slot = i2s_lcd_obj->common.async_slot++;
+        lcd_i2s_start(i2s_lcd_obj->i2s_dev, ((uint32_t)&i2s_lcd_obj->dma[(slot % 2) * i2s_lcd_obj->dma_half_node_cnt]) & 0xfffff, 0);
+        i2s_lcd_obj->common.async_pending = false;
+        if (i2s_lcd_obj->common.async_left) {
+            lcd_async_fill(i2s_lcd_obj, i2s_lcd_obj->common.async_slot);
+            i2s_lcd_obj->common.async_pending = true;
+            // The half started above has already drained, the bus sat idle until this refill
+            if (i2s_lcd_obj->i2s_dev->int_raw.out_eof) {
+                i2s_lcd_obj->common.stall_cnt++;
+            }
+        }
+        return;
+    }
+    i2s_lcd_async_done_isr(&i2s_lcd_obj->common, HPTaskAwoken);
+}
+
+/*
+ * EOF only means that DMA has read the descriptors, the FIFO still drains to the bus. Rather than spinning on
+ * tx_idle here, the next half or segment is started from tx_rempty once there is one to start.
+ */
+static void IRAM_ATTR lcd_async_eof_isr(i2s_lcd_obj_t *i2s_lcd_obj, BaseType_t *HPTaskAwoken)
+{
+    i2s_dev_t *i2s_dev = i2s_lcd_obj->i2s_dev;
+    if ((i2s_lcd_obj->trans_seg_cnt || i2s_lcd_obj->common.async_pending) && !i2s_dev->state.tx_idle) {
+        i2s_lcd_obj->async_drain = true;
+        i2s_dev->int_clr.tx_rempty = 1;
+        i2s_dev->int_ena.tx_rempty = 1;
+        return;
+    }
+    lcd_async_next_isr(i2s_lcd_obj, HPTaskAwoken);
+}
+
+static void IRAM_ATTR lcd_async_rempty_isr(i2s_lcd_obj_t *i2s_lcd_obj, BaseType_t *HPTaskAwoken)
+{
+    i2s_dev_t *i2s_dev = i2s_lcd_obj->i2s_dev;
+    i2s_dev->int_ena.tx_rempty = 0;
+    i2s_lcd_obj->async_drain = false;
+    // Only the word in the shift register is left, a transmitter which doesn't get idle counts as an underrun
+    int64_t start = esp_timer_get_time();
+    while (!i2s_dev->state.tx_idle) {
+        if (esp_timer_get_time() - start > LCD_IDLE_TIMEOUT_US) {
+            i2s_lcd_obj->common.stall_cnt++;
+            break;
+        }
+    }
+    lcd_async_next_isr(i2s_lcd_obj, HPTaskAwoken);
+}
+
+static void IRAM_ATTR i2s_isr(void *arg)
+{
+    BaseType_t HPTaskAwoken = pdFALSE;
+    i2s_lcd_obj_t *i2s_lcd_obj = (i2s_lcd_obj_t*)arg;
+    i2s_dev_t *i2s_dev = i2s_lcd_obj->i2s_dev;
+
+    typeof(i2s_dev->int_st) status = i2s_dev->int_st;
+    i2s_dev->int_clr.val = status.val;
+    if (status.val == 0) {
+        return;
+    }
+
+    LCD_PERF_ISR_START();
+
+    if (status.out_eof) {
+        i2s_lcd_obj->common.isr_cnt++;
+        if (i2s_lcd_obj->common.async_busy) {
+            lcd_async_eof_isr(i2s_lcd_obj, &HPTaskAwoken);
+        } else {
+            xQueueSendFromISR(i2s_lcd_obj->event_queue, (void*)&status.val, &HPTaskAwoken);
+        }
+    }
+    if (status.tx_rempty && i2s_lcd_obj->async_drain) {
+        lcd_async_rempty_isr(i2s_lcd_obj, &HPTaskAwoken);
+    }
+
+    LCD_PERF_ISR_END(&i2s_lcd_obj->common.perf);
+    if (HPTaskAwoken == pdTRUE) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+static void lcd_write_async(i2s_lcd_obj_t *i2s_lcd_obj, i2s_lcd_handle_t handle, const uint8_t *data, size_t len, i2s_lcd_trans_done_cb_t done_cb, void *user_ctx)
+{
+    i2s_lcd_async_begin(&i2s_lcd_obj->common, handle, data, len, done_cb, user_ctx);
+    lcd_dma_set_int(i2s_lcd_obj);
+    // Fill both halves here, the ISR takes over refilling from the third one on
+    lcd_async_fill(i2s_lcd_obj, 0);
+    i2s_lcd_obj->common.async_slot = 1;
+    i2s_lcd_obj->common.async_pending = false;
+    if (i2s_lcd_obj->common.async_left) {
+        lcd_async_fill(i2s_lcd_obj, 1);
+        i2s_lcd_obj->common.async_pending = true;
+    }
+    i2s_lcd_obj->common.async_busy = true;
+    lcd_i2s_wait_idle(i2s_lcd_obj->i2s_dev);
+    lcd_i2s_start(i2s_lcd_obj->i2s_dev, ((uint32_t)&i2s_lcd_obj->dma[0]) & 0xfffff, 0);
+}
+
+static uint8_t *lcd_trans_add_seg(void *arg, uint8_t *out, const uint8_t *in, size_t len, uint32_t rs_level)
+{
+    i2s_lcd_obj_t *i2s_lcd_obj = (i2s_lcd_obj_t *)arg;
+    // Segments are copied in memory order, the swap_data setting only applies to block data
+    uint32_t pos = i2s_lcd_obj->trans_seg_cnt++;
+    memcpy(out, in, len);
+    i2s_lcd_obj->trans_dma[pos].size = len;
+    i2s_lcd_obj->trans_dma[pos].length = len;
+    i2s_lcd_obj->trans_dma[pos].buf = out;
+    i2s_lcd_obj->trans_dma[pos].eof = 1;
+    i2s_lcd_obj->trans_dma[pos].empty = (uint32_t)NULL;
+    i2s_lcd_obj->trans_rs[pos] = rs_level;
+    return out + ((len + 3) & ~3);
+}
+
+static void lcd_write_trans(i2s_lcd_obj_t *i2s_lcd_obj, const i2s_lcd_trans_t *trans, uint32_t count)
+{
+    const i2s_lcd_trans_t *last = &trans[count - 1];
+    // Only internal RAM can be read from the IRAM interrupt, block data in PSRAM or flash follows once the commands are out
+    bool stream = last->length && esp_ptr_internal(last->data);
+    size_t bytes = stream ? last->length : 0;
+    xSemaphoreTake(i2s_lcd_obj->common.idle_sem, portMAX_DELAY);
+    i2s_lcd_obj->trans_seg_cnt = 0;
+    bytes += i2s_lcd_trans_pack(trans, count, i2s_lcd_obj->width == 16 ? 2 : 1, (uint8_t *)i2s_lcd_obj->trans_buffer, lcd_trans_add_seg, i2s_lcd_obj);
+    LCD_PERF_WRITE_START(&i2s_lcd_obj->common.perf, bytes);
+    i2s_lcd_obj->common.async_cb = NULL;
+    i2s_lcd_obj->common.async_left = 0;
+    i2s_lcd_obj->common.async_pending = false;
+    if (stream) {
+        // The first half waits for the ISR to run out of segments
+        lcd_dma_set_int(i2s_lcd_obj);
+        i2s_lcd_obj->common.async_data = last->data;
+        i2s_lcd_obj->common.async_left = last->length;
+        lcd_async_fill(i2s_lcd_obj, 0);
+        i2s_lcd_obj->common.async_slot = 0;
+        i2s_lcd_obj->common.async_pending = true;
+    }
+    i2s_lcd_obj->trans_seg_pos = 1;
+    i2s_lcd_obj->common.async_busy = true;
+    lcd_i2s_wait_idle(i2s_lcd_obj->i2s_dev);
+    lcd_trans_start_seg(i2s_lcd_obj, 0);
+}
+
 static void i2s_write_data(i2s_lcd_obj_t *i2s_lcd_obj, uint8_t *data, size_t len)
 {
     int event  = 0;
@@ -140,6 +332,8 @@ static void i2s_write_data(i2s_lcd_obj_t *i2s_lcd_obj, uint8_t *data, size_t len
         ESP_LOGE(TAG, "wrong len!");
         return;
     }
+    i2s_lcd_async_wait(&i2s_lcd_obj->common, portMAX_DELAY);
+    LCD_PERF_WRITE_START(&i2s_lcd_obj->common.perf, len);
     lcd_dma_set_int(i2s_lcd_obj);
     uint32_t half_buffer_size = i2s_lcd_obj->dma_half_buffer_size;
     cnt = len / half_buffer_size;
@@ -164,7 +358,11 @@ static void i2s_write_data(i2s_lcd_obj_t *i2s_lcd_obj, uint8_t *data, size_t len
             memcpy(out, in, half_buffer_size);
         }
         data += half_buffer_size;
+        if (x && uxQueueMessagesWaiting(i2s_lcd_obj->event_queue)) {
+            i2s_lcd_obj->common.stall_cnt++;
+        }
         xQueueReceive(i2s_lcd_obj->event_queue, (void *)&event, portMAX_DELAY);
+        lcd_i2s_wait_idle(i2s_lcd_obj->i2s_dev);
         lcd_i2s_start(i2s_lcd_obj->i2s_dev, ((uint32_t)&i2s_lcd_obj->dma[(x % 2) * i2s_lcd_obj->dma_half_node_cnt]) & 0xfffff, half_buffer_size);
     }
     left = len % half_buffer_size;
@@ -188,10 +386,15 @@ static void i2s_write_data(i2s_lcd_obj_t *i2s_lcd_obj, uint8_t *data, size_t len
             out[cnt] = in[cnt];
         }
         lcd_dma_set_left(i2s_lcd_obj, x, left);
+        if (x && uxQueueMessagesWaiting(i2s_lcd_obj->event_queue)) {
+            i2s_lcd_obj->common.stall_cnt++;
+        }
         xQueueReceive(i2s_lcd_obj->event_queue, (void *)&event, portMAX_DELAY);
+        lcd_i2s_wait_idle(i2s_lcd_obj->i2s_dev);
         lcd_i2s_start(i2s_lcd_obj->i2s_dev, ((uint32_t)&i2s_lcd_obj->dma[(x % 2) * i2s_lcd_obj->dma_half_node_cnt]) & 0xfffff, left);
     }
     xQueueReceive(i2s_lcd_obj->event_queue, (void *)&event, portMAX_DELAY);
+    LCD_PERF_WRITE_END(&i2s_lcd_obj->common.perf);
 }
 
 static esp_err_t i2s_lcd_reg_config(i2s_dev_t *i2s_dev, uint16_t data_width, uint32_t clk_freq)
@@ -255,34 +458,48 @@ static esp_err_t lcd_set_pin(const i2s_lcd_config_t *config)
     return ESP_OK;
 }
 
-static esp_err_t lcd_dma_config(i2s_lcd_obj_t *i2s_lcd_obj, uint32_t max_dma_buffer_size)
+static void lcd_dma_free(i2s_lcd_obj_t *i2s_lcd_obj)
 {
-    int cnt = 0;
-    if (LCD_CAM_DMA_NODE_BUFFER_MAX_SIZE % 2 != 0) {
-        ESP_LOGE(TAG, "ESP32 only supports 2-byte aligned data length");
-        return ESP_FAIL;
+    if (i2s_lcd_obj->dma) {
+        free(i2s_lcd_obj->dma);
+        i2s_lcd_obj->dma = NULL;
     }
-    if (max_dma_buffer_size >= LCD_CAM_DMA_NODE_BUFFER_MAX_SIZE * 2) {
-        i2s_lcd_obj->dma_node_buffer_size = LCD_CAM_DMA_NODE_BUFFER_MAX_SIZE;
-        for (cnt = 0; cnt < max_dma_buffer_size - 8; cnt++) { // Find a buffer size that can divide dma_size
-            if ((max_dma_buffer_size - cnt) % (i2s_lcd_obj->dma_node_buffer_size * 2) == 0) {
-                break;
-            }
-        }
-        i2s_lcd_obj->dma_buffer_size = max_dma_buffer_size - cnt;
-    } else {
-        i2s_lcd_obj->dma_node_buffer_size = max_dma_buffer_size / 2;
-        i2s_lcd_obj->dma_buffer_size = i2s_lcd_obj->dma_node_buffer_size * 2;
+    if (i2s_lcd_obj->dma_buffer) {
+        free(i2s_lcd_obj->dma_buffer);
+        i2s_lcd_obj->dma_buffer = NULL;
     }
+}
 
-    i2s_lcd_obj->dma_half_buffer_size = i2s_lcd_obj->dma_buffer_size / 2;
-    i2s_lcd_obj->dma_node_cnt = (i2s_lcd_obj->dma_buffer_size) / i2s_lcd_obj->dma_node_buffer_size; // Number of DMA nodes
-    i2s_lcd_obj->dma_half_node_cnt = i2s_lcd_obj->dma_node_cnt / 2;
+static esp_err_t lcd_dma_config(i2s_lcd_obj_t *i2s_lcd_obj, uint32_t max_dma_buffer_size, uint32_t dma_node_size)
+{
+    i2s_lcd_dma_layout_t layout;
+    esp_err_t ret = i2s_lcd_dma_layout_calc(max_dma_buffer_size, dma_node_size, &layout);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    dma_node_size = layout.node_size;
+    uint32_t dma_buffer_size = layout.buffer_size;
+    uint32_t dma_node_cnt = dma_buffer_size / dma_node_size; // Number of DMA nodes
+
+    // Allocate the new layout before releasing the current one, so a failure leaves the driver usable
+    lldesc_t *dma = (lldesc_t *)heap_caps_malloc(dma_node_cnt * sizeof(lldesc_t), MALLOC_CAP_DMA | MALLOC_CAP_8BIT);
+    uint8_t *dma_buffer = (uint8_t *)heap_caps_malloc(dma_buffer_size * sizeof(uint8_t), MALLOC_CAP_DMA | MALLOC_CAP_8BIT);
+    if (dma == NULL || dma_buffer == NULL) {
+        ESP_LOGE(TAG, "dma buffer malloc error");
+        free(dma);
+        free(dma_buffer);
+        return ESP_ERR_NO_MEM;
+    }
+    lcd_dma_free(i2s_lcd_obj);
+    i2s_lcd_obj->dma = dma;
+    i2s_lcd_obj->dma_buffer = dma_buffer;
+    i2s_lcd_obj->dma_node_buffer_size = dma_node_size;
+    i2s_lcd_obj->dma_buffer_size = dma_buffer_size;
+    i2s_lcd_obj->dma_half_buffer_size = dma_buffer_size / 2;
+    i2s_lcd_obj->dma_node_cnt = dma_node_cnt;
+    i2s_lcd_obj->dma_half_node_cnt = dma_node_cnt / 2;
 
     ESP_LOGI(TAG, "lcd_buffer_size: %"PRIu32", lcd_dma_size: %"PRIu32", lcd_dma_node_cnt: %"PRIu32"", i2s_lcd_obj->dma_buffer_size, i2s_lcd_obj->dma_node_buffer_size, i2s_lcd_obj->dma_node_cnt);
-
-    i2s_lcd_obj->dma    = (lldesc_t *)heap_caps_malloc(i2s_lcd_obj->dma_node_cnt * sizeof(lldesc_t), MALLOC_CAP_DMA | MALLOC_CAP_8BIT);
-    i2s_lcd_obj->dma_buffer = (uint8_t *)heap_caps_malloc(i2s_lcd_obj->dma_buffer_size * sizeof(uint8_t), MALLOC_CAP_DMA | MALLOC_CAP_8BIT);
     return ESP_OK;
 }
 
@@ -292,6 +509,12 @@ static esp_err_t lcd_cam_deinit(i2s_lcd_driver_t *drv)
         return ESP_FAIL;
     }
 
+    if (drv->i2s_lcd_obj->common.idle_sem) {
+        if (drv->i2s_lcd_obj->lcd_cam_intr_handle) { // A transfer can only be in flight once init has completed
+            i2s_lcd_async_wait(&drv->i2s_lcd_obj->common, portMAX_DELAY);
+        }
+        vSemaphoreDelete(drv->i2s_lcd_obj->common.idle_sem);
+    }
     if (drv->i2s_lcd_obj->event_queue) {
         vQueueDelete(drv->i2s_lcd_obj->event_queue);
     }
@@ -338,7 +561,7 @@ static esp_err_t lcd_cam_init(i2s_lcd_driver_t *drv, const i2s_lcd_config_t *con
     }
 
     ret |= lcd_set_pin(config);
-    ret |= lcd_dma_config(i2s_lcd_obj, config->buffer_size);
+    ret |= lcd_dma_config(i2s_lcd_obj, config->buffer_size, config->dma_node_size);
 
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "lcd config fail!");
@@ -347,14 +570,16 @@ static esp_err_t lcd_cam_init(i2s_lcd_driver_t *drv, const i2s_lcd_config_t *con
     }
 
     i2s_lcd_obj->event_queue = xQueueCreate(1, sizeof(int));
+    i2s_lcd_obj->common.idle_sem = xSemaphoreCreateBinary();
     i2s_lcd_obj->width = config->data_width;
     i2s_lcd_obj->swap_data = config->swap_data;
 
-    if (i2s_lcd_obj->event_queue == NULL) {
+    if (i2s_lcd_obj->event_queue == NULL || i2s_lcd_obj->common.idle_sem == NULL) {
         ESP_LOGE(TAG, "lcd config fail!");
         lcd_cam_deinit(drv);
         return ESP_FAIL;
     }
+    xSemaphoreGive(i2s_lcd_obj->common.idle_sem);
 
     ret |= esp_intr_alloc(ETS_I2S0_INTR_SOURCE, ESP_INTR_FLAG_LOWMED | ESP_INTR_FLAG_IRAM, i2s_isr, i2s_lcd_obj, &i2s_lcd_obj->lcd_cam_intr_handle);
 
@@ -412,7 +637,10 @@ i2s_lcd_handle_t i2s_lcd_driver_init(const i2s_lcd_config_t *config)
 
     gpio_pad_select_gpio(config->pin_num_rs);
     gpio_set_direction(config->pin_num_rs, GPIO_MODE_OUTPUT);
+    gpio_set_level(config->pin_num_rs, LCD_DATA_LEV);
     i2s_lcd_drv->rs_io_num = config->pin_num_rs;
+    i2s_lcd_drv->i2s_lcd_obj->rs_io_num = config->pin_num_rs;
+    i2s_lcd_drv->i2s_lcd_obj->rs_level = LCD_DATA_LEV;
     return (i2s_lcd_handle_t)i2s_lcd_drv;
 }
 
@@ -438,6 +666,7 @@ esp_err_t i2s_lcd_write_cmd(i2s_lcd_handle_t handle, uint16_t cmd)
 {
     i2s_lcd_driver_t *i2s_lcd_drv = (i2s_lcd_driver_t *)handle;
     I2S_CHECK(NULL != i2s_lcd_drv, "handle pointer invalid", ESP_ERR_INVALID_ARG);
+    i2s_lcd_async_wait(&i2s_lcd_drv->i2s_lcd_obj->common, portMAX_DELAY);
     gpio_set_level(i2s_lcd_drv->rs_io_num, LCD_CMD_LEV);
     i2s_write_data(i2s_lcd_drv->i2s_lcd_obj, (uint8_t *)&cmd, i2s_lcd_drv->i2s_lcd_obj->width == 16 ? 2 : 1);
     gpio_set_level(i2s_lcd_drv->rs_io_num, LCD_DATA_LEV);
@@ -448,6 +677,7 @@ esp_err_t i2s_lcd_write_command(i2s_lcd_handle_t handle, const uint8_t *cmd, uin
 {
     i2s_lcd_driver_t *i2s_lcd_drv = (i2s_lcd_driver_t *)handle;
     I2S_CHECK(NULL != i2s_lcd_drv, "handle pointer invalid", ESP_ERR_INVALID_ARG);
+    i2s_lcd_async_wait(&i2s_lcd_drv->i2s_lcd_obj->common, portMAX_DELAY);
     gpio_set_level(i2s_lcd_drv->rs_io_num, LCD_CMD_LEV);
     i2s_write_data(i2s_lcd_drv->i2s_lcd_obj, (uint8_t *)cmd, length);
     gpio_set_level(i2s_lcd_drv->rs_io_num, LCD_DATA_LEV);
@@ -463,6 +693,71 @@ esp_err_t i2s_lcd_write(i2s_lcd_handle_t handle, const uint8_t *data, uint32_t l
     return ESP_OK;
 }
 
+esp_err_t i2s_lcd_write_async(i2s_lcd_handle_t handle, const uint8_t *data, uint32_t length, i2s_lcd_trans_done_cb_t done_cb, void *user_ctx)
+{
+    i2s_lcd_driver_t *i2s_lcd_drv = (i2s_lcd_driver_t *)handle;
+    I2S_CHECK(NULL != i2s_lcd_drv, "handle pointer invalid", ESP_ERR_INVALID_ARG);
+    I2S_CHECK(NULL != data, "data pointer invalid", ESP_ERR_INVALID_ARG);
+    I2S_CHECK(length > 0 && 0 == length % (i2s_lcd_drv->i2s_lcd_obj->width == 16 ? 4 : 2), "wrong len!", ESP_ERR_INVALID_SIZE);
+    if (!esp_ptr_internal(data)) {
+        // PSRAM and flash can't be read from the IRAM interrupt while the cache is disabled,
+        // stream them through the internal bounce buffers from this task instead
+        i2s_write_data(i2s_lcd_drv->i2s_lcd_obj, (uint8_t *)data, length);
+        if (done_cb) {
+            // Called from this task, there is no interrupt to yield from
+            (void)done_cb(handle, user_ctx);
+        }
+        return ESP_OK;
+    }
+    lcd_write_async(i2s_lcd_drv->i2s_lcd_obj, handle, data, length, done_cb, user_ctx);
+    return ESP_OK;
+}
+
+esp_err_t i2s_lcd_write_trans(i2s_lcd_handle_t handle, const i2s_lcd_trans_t *trans, uint32_t count)
+{
+    i2s_lcd_driver_t *i2s_lcd_drv = (i2s_lcd_driver_t *)handle;
+    I2S_CHECK(NULL != i2s_lcd_drv, "handle pointer invalid", ESP_ERR_INVALID_ARG);
+    uint32_t bus_bytes = i2s_lcd_drv->i2s_lcd_obj->width == 16 ? 2 : 1;
+    esp_err_t ret = i2s_lcd_trans_check(trans, count, bus_bytes);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    const i2s_lcd_trans_t *last = &trans[count - 1];
+    lcd_write_trans(i2s_lcd_drv->i2s_lcd_obj, trans, count);
+    if (last->length && !esp_ptr_internal(last->data)) {
+        i2s_write_data(i2s_lcd_drv->i2s_lcd_obj, (uint8_t *)last->data, last->length);
+    }
+    return ESP_OK;
+}
+
+esp_err_t i2s_lcd_set_dma_layout(i2s_lcd_handle_t handle, uint32_t buffer_size, uint32_t node_size)
+{
+    i2s_lcd_driver_t *i2s_lcd_drv = (i2s_lcd_driver_t *)handle;
+    I2S_CHECK(NULL != i2s_lcd_drv, "handle pointer invalid", ESP_ERR_INVALID_ARG);
+    i2s_lcd_obj_t *i2s_lcd_obj = i2s_lcd_drv->i2s_lcd_obj;
+    // Holding idle_sem keeps asynchronous writes out while the buffers are replaced
+    xSemaphoreTake(i2s_lcd_obj->common.idle_sem, portMAX_DELAY);
+    esp_err_t ret = lcd_dma_config(i2s_lcd_obj, buffer_size, node_size);
+    xSemaphoreGive(i2s_lcd_obj->common.idle_sem);
+    return ret;
+}
+
+esp_err_t i2s_lcd_get_dma_layout(i2s_lcd_handle_t handle, i2s_lcd_dma_layout_t *layout)
+{
+    i2s_lcd_driver_t *i2s_lcd_drv = (i2s_lcd_driver_t *)handle;
+    I2S_CHECK(NULL != i2s_lcd_drv, "handle pointer invalid", ESP_ERR_INVALID_ARG);
+    I2S_CHECK(NULL != layout, "layout pointer invalid", ESP_ERR_INVALID_ARG);
+    layout->buffer_size = i2s_lcd_drv->i2s_lcd_obj->dma_buffer_size;
+    layout->node_size = i2s_lcd_drv->i2s_lcd_obj->dma_node_buffer_size;
+    return ESP_OK;
+}
+
+i2s_lcd_common_t *i2s_lcd_get_common(i2s_lcd_handle_t handle)
+{
+    i2s_lcd_driver_t *i2s_lcd_drv = (i2s_lcd_driver_t *)handle;
+    return i2s_lcd_drv ? &i2s_lcd_drv->i2s_lcd_obj->common : NULL;
+}
+
 esp_err_t i2s_lcd_acquire(i2s_lcd_handle_t handle)
 {
     i2s_lcd_driver_t *i2s_lcd_drv = (i2s_lcd_driver_t *)handle;
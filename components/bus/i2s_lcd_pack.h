@@ -0,0 +1,151 @@
+/*
+ * SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef   __I2S_LCD_PACK_H__
+#define   __I2S_LCD_PACK_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * Word-wide packing kernels which convert pixel data into the FIFO layout of the ESP32 I2S LCD mode
+ * (tx_fifo_mod = 1). The output buffer must be 4-byte aligned, the input buffer may have any alignment.
+ * Aligned input is read one word at a time, unaligned input falls back to byte loads but still
+ * produces word stores.
+ */
+
+static inline __attribute__((always_inline)) uint32_t i2s_lcd_pack_load32(const uint8_t *in)
+{
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+/**
+ * @brief Pack 8-bit bus data, every input byte takes one 16-bit FIFO slot
+ *
+ * Equivalent to the byte loop
+ *     out[y + 3] = in[(y >> 1) + 0]; out[y + 1] = in[(y >> 1) + 1];   (swap = false)
+ *     out[y + 1] = in[(y >> 1) + 0]; out[y + 3] = in[(y >> 1) + 1];   (swap = true)
+ * with the unused bytes out[y + 0] and out[y + 2] written as zero.
+ *
+ * @param out Destination, 4-byte aligned, len * 2 bytes
+ * @param in Source data
+ * @param len Number of input bytes, must be a multiple of 2
+ * @param swap Swap the 2 bytes of each FIFO word
+ */
+static inline __attribute__((always_inline)) void i2s_lcd_pack_8bit(uint32_t *out, const uint8_t *in, size_t len, bool swap)
+{
+    size_t x = 0;
+    if (((uintptr_t)in & 3) == 0) {
+        const uint32_t *in32 = (const uint32_t *)in;
+        if (!swap) {
+            for (; x + 8 <= len; x += 8) {
+                uint32_t w0 = in32[0];
+                uint32_t w1 = in32[1];
+                out[0] = (w0 << 24) | (w0 & 0xff00);
+                out[1] = ((w0 << 8) & 0xff000000) | ((w0 >> 16) & 0xff00);
+                out[2] = (w1 << 24) | (w1 & 0xff00);
+                out[3] = ((w1 << 8) & 0xff000000) | ((w1 >> 16) & 0xff00);
+                in32 += 2;
+                out += 4;
+            }
+        } else {
+            for (; x + 8 <= len; x += 8) {
+                uint32_t w0 = in32[0];
+                uint32_t w1 = in32[1];
+                out[0] = ((w0 & 0xff) << 8) | ((w0 & 0xff00) << 16);
+                out[1] = ((w0 >> 8) & 0xff00) | (w0 & 0xff000000);
+                out[2] = ((w1 & 0xff) << 8) | ((w1 & 0xff00) << 16);
+                out[3] = ((w1 >> 8) & 0xff00) | (w1 & 0xff000000);
+                in32 += 2;
+                out += 4;
+            }
+        }
+    } else {
+        for (; x + 4 <= len; x += 4) {
+            uint32_t w = i2s_lcd_pack_load32(in + x);
+            if (!swap) {
+                out[0] = (w << 24) | (w & 0xff00);
+                out[1] = ((w << 8) & 0xff000000) | ((w >> 16) & 0xff00);
+            } else {
+                out[0] = ((w & 0xff) << 8) | ((w & 0xff00) << 16);
+                out[1] = ((w >> 8) & 0xff00) | (w & 0xff000000);
+            }
+            out += 2;
+        }
+    }
+    // Tail, one FIFO word per 2 input bytes
+    for (; x + 2 <= len; x += 2) {
+        if (!swap) {
+            *out++ = ((uint32_t)in[x] << 24) | ((uint32_t)in[x + 1] << 8);
+        } else {
+            *out++ = ((uint32_t)in[x] << 8) | ((uint32_t)in[x + 1] << 24);
+        }
+    }
+}
+
+/**
+ * @brief Pack 16-bit bus data, every 2 pixels take one FIFO word
+ *
+ * Equivalent to the byte loop
+ *     out[y + 2] = in[y + 0]; out[y + 3] = in[y + 1]; out[y + 0] = in[y + 2]; out[y + 1] = in[y + 3];   (swap = false)
+ *     out[y + 3] = in[y + 0]; out[y + 2] = in[y + 1]; out[y + 1] = in[y + 2]; out[y + 0] = in[y + 3];   (swap = true)
+ *
+ * @param out Destination, 4-byte aligned, len bytes
+ * @param in Source data
+ * @param len Number of input bytes, must be a multiple of 4
+ * @param swap Swap the 2 bytes of RGB565 color
+ */
+static inline __attribute__((always_inline)) void i2s_lcd_pack_16bit(uint32_t *out, const uint8_t *in, size_t len, bool swap)
+{
+    size_t x = 0;
+    if (((uintptr_t)in & 3) == 0) {
+        const uint32_t *in32 = (const uint32_t *)in;
+        if (!swap) {
+            for (; x + 16 <= len; x += 16) {
+                uint32_t w0 = in32[0], w1 = in32[1], w2 = in32[2], w3 = in32[3];
+                out[0] = (w0 << 16) | (w0 >> 16);
+                out[1] = (w1 << 16) | (w1 >> 16);
+                out[2] = (w2 << 16) | (w2 >> 16);
+                out[3] = (w3 << 16) | (w3 >> 16);
+                in32 += 4;
+                out += 4;
+            }
+            for (; x + 4 <= len; x += 4) {
+                uint32_t w = *in32++;
+                *out++ = (w << 16) | (w >> 16);
+            }
+        } else {
+            for (; x + 16 <= len; x += 16) {
+                out[0] = __builtin_bswap32(in32[0]);
+                out[1] = __builtin_bswap32(in32[1]);
+                out[2] = __builtin_bswap32(in32[2]);
+                out[3] = __builtin_bswap32(in32[3]);
+                in32 += 4;
+                out += 4;
+            }
+            for (; x + 4 <= len; x += 4) {
+                *out++ = __builtin_bswap32(*in32++);
+            }
+        }
+    } else {
+        for (; x + 4 <= len; x += 4) {
+            uint32_t w = i2s_lcd_pack_load32(in + x);
+            *out++ = swap ? __builtin_bswap32(w) : ((w << 16) | (w >> 16));
+        }
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
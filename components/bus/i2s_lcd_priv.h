@@ -0,0 +1,207 @@
+/*
+ * SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef   __I2S_LCD_PRIV_H__
+#define   __I2S_LCD_PRIV_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "sdkconfig.h"
+#include "esp_idf_version.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "i2s_lcd_driver.h"
+#if CONFIG_LCD_PERF_STATS
+#include "esp_timer.h"
+#if (ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0))
+#include "esp_cpu.h"
+#else
+#include "hal/cpu_hal.h"
+#endif
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#if CONFIG_LCD_PERF_STATS
+/**
+ * Performance counters kept in i2s_lcd_common_t, read with i2s_lcd_get_stats
+ */
+typedef struct {
+    uint32_t transfers;
+    uint64_t bytes;
+    uint64_t busy_us;
+    int64_t start_us;           /*!< Start of the write in flight */
+    uint64_t isr_cycles;
+    uint32_t isr_cycles_max;
+} i2s_lcd_perf_t;
+
+static inline __attribute__((always_inline)) uint32_t i2s_lcd_perf_cycles(void)
+{
+#if (ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0))
+    return esp_cpu_get_cycle_count();
+#else
+    return cpu_hal_get_cycle_count();
+#endif
+}
+
+static inline __attribute__((always_inline)) void i2s_lcd_perf_isr_end(i2s_lcd_perf_t *perf, uint32_t start)
+{
+    uint32_t cycles = i2s_lcd_perf_cycles() - start;
+    perf->isr_cycles += cycles;
+    if (cycles > perf->isr_cycles_max) {
+        perf->isr_cycles_max = cycles;
+    }
+}
+
+static inline __attribute__((always_inline)) void i2s_lcd_perf_write_start(i2s_lcd_perf_t *perf, size_t len)
+{
+    perf->transfers++;
+    perf->bytes += len;
+    perf->start_us = esp_timer_get_time();
+}
+
+static inline __attribute__((always_inline)) void i2s_lcd_perf_write_end(i2s_lcd_perf_t *perf)
+{
+    perf->busy_us += esp_timer_get_time() - perf->start_us;
+}
+
+#define LCD_PERF_ISR_START()              uint32_t perf_isr_start = i2s_lcd_perf_cycles()
+#define LCD_PERF_ISR_END(perf)            i2s_lcd_perf_isr_end(perf, perf_isr_start)
+#define LCD_PERF_WRITE_START(perf, len)   i2s_lcd_perf_write_start(perf, len)
+#define LCD_PERF_WRITE_END(perf)          i2s_lcd_perf_write_end(perf)
+#else
+#define LCD_PERF_ISR_START()
+#define LCD_PERF_ISR_END(perf)
+#define LCD_PERF_WRITE_START(perf, len)
+#define LCD_PERF_WRITE_END(perf)
+#endif
+
+/**
+ * State shared by the target drivers, embedded in their driver object and handled by i2s_lcd_common.c
+ */
+typedef struct {
+    SemaphoreHandle_t idle_sem;     // Given while no asynchronous write is in flight
+    volatile bool async_busy;
+    bool async_pending;             // The half at async_slot is filled and waits to be started
+    uint32_t async_slot;
+    const uint8_t *async_data;
+    size_t async_left;
+    i2s_lcd_trans_done_cb_t async_cb;
+    void *async_ctx;
+    i2s_lcd_handle_t async_handle;
+    uint32_t isr_cnt;               // DMA EOF interrupts, LCD trans done interrupts on ESP32-S3
+    uint32_t stall_cnt;             // Halves refilled only after the other one had run dry
+#if CONFIG_LCD_PERF_STATS
+    i2s_lcd_perf_t perf;
+#endif
+} i2s_lcd_common_t;
+
+/**
+ * Packs one command or parameter segment of i2s_lcd_write_trans into out, returns the end of the packed segment
+ */
+typedef uint8_t *(*i2s_lcd_trans_seg_cb_t)(void *arg, uint8_t *out, const uint8_t *in, size_t len, uint32_t rs_level);
+
+/**
+ * @brief Get the shared state of an i2s lcd driver, implemented by each target driver
+ *
+ * @param handle Handle of i2s lcd driver
+ *
+ * @return Shared state of the driver, NULL for a NULL handle
+ */
+i2s_lcd_common_t *i2s_lcd_get_common(i2s_lcd_handle_t handle);
+
+/**
+ * @brief Read the raw DMA counters of an i2s lcd driver
+ *
+ * @param handle Handle of i2s lcd driver
+ * @param isr_cnt Number of DMA EOF interrupts since init, LCD trans done interrupts on ESP32-S3
+ * @param stall_cnt Number of halves refilled only after the other one had run dry since init
+ *
+ * @return
+ *     - ESP_OK Success
+ *     - ESP_ERR_INVALID_ARG Parameter error
+ */
+esp_err_t i2s_lcd_get_dma_counters(i2s_lcd_handle_t handle, uint32_t *isr_cnt, uint32_t *stall_cnt);
+
+/**
+ * @brief Work out the DMA layout for a buffer size, the largest one up to max_buffer_size made of two halves of whole nodes
+ *
+ * @param max_buffer_size Upper bound of the ping-pong buffer size
+ * @param node_size Size of the buffer behind one DMA descriptor, 0 picks the largest one which fits
+ * @param layout Returned layout
+ *
+ * @return
+ *     - ESP_OK Success
+ *     - ESP_ERR_INVALID_ARG Unsupported node size
+ *     - ESP_ERR_INVALID_SIZE Buffer size smaller than two nodes
+ */
+esp_err_t i2s_lcd_dma_layout_calc(uint32_t max_buffer_size, uint32_t node_size, i2s_lcd_dma_layout_t *layout);
+
+/**
+ * @brief Check the arguments of i2s_lcd_write_trans
+ *
+ * @param trans Transactions to send
+ * @param count Number of transactions
+ * @param bus_bytes Bytes per bus word
+ *
+ * @return
+ *     - ESP_OK Success
+ *     - ESP_ERR_INVALID_ARG Parameter error
+ *     - ESP_ERR_INVALID_SIZE Wrong count or length
+ */
+esp_err_t i2s_lcd_trans_check(const i2s_lcd_trans_t *trans, uint32_t count, uint32_t bus_bytes);
+
+/**
+ * @brief Pack the commands and parameters of checked transactions into segments, in bus order
+ *
+ * @param trans Transactions to send
+ * @param count Number of transactions
+ * @param bus_bytes Bytes per bus word
+ * @param out Buffer of the segments
+ * @param add_seg Target packing of one segment
+ * @param arg Passed to add_seg
+ *
+ * @return Number of command and parameter bytes
+ */
+size_t i2s_lcd_trans_pack(const i2s_lcd_trans_t *trans, uint32_t count, uint32_t bus_bytes, uint8_t *out, i2s_lcd_trans_seg_cb_t add_seg, void *arg);
+
+/**
+ * @brief Wait until no asynchronous write is in flight
+ *
+ * @param common Shared state of the driver
+ * @param ticks_to_wait Maximum time to wait
+ *
+ * @return
+ *     - ESP_OK Success
+ *     - ESP_ERR_TIMEOUT Write still in flight
+ */
+esp_err_t i2s_lcd_async_wait(i2s_lcd_common_t *common, TickType_t ticks_to_wait);
+
+/**
+ * @brief Take the driver for an asynchronous write of len bytes from data, the target fills and starts the halves
+ */
+void i2s_lcd_async_begin(i2s_lcd_common_t *common, i2s_lcd_handle_t handle, const uint8_t *data, size_t len, i2s_lcd_trans_done_cb_t done_cb, void *user_ctx);
+
+/* Called from the interrupt once the last half of an asynchronous write has been sent */
+static inline __attribute__((always_inline)) void i2s_lcd_async_done_isr(i2s_lcd_common_t *common, BaseType_t *HPTaskAwoken)
+{
+    common->async_busy = false;
+    LCD_PERF_WRITE_END(&common->perf);
+    if (common->async_cb && common->async_cb(common->async_handle, common->async_ctx)) {
+        *HPTaskAwoken = pdTRUE;
+    }
+    xSemaphoreGiveFromISR(common->idle_sem, HPTaskAwoken);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
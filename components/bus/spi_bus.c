@@ -120,6 +120,8 @@ spi_bus_device_handle_t spi_bus_device_create(spi_bus_handle_t bus_handle, const
     SPI_BUS_CHECK_GOTO(ESP_OK == ret, "add spi device failed", cleanup_device);
     spi_dev->mutex = xSemaphoreCreateMutex();
     SPI_BUS_CHECK_GOTO(NULL != spi_dev->mutex, "spi device create mutex failed", cleanup_device);
+    /* names the mutex in scheduling traces, a no-op without a queue registry */
+    vQueueAddToRegistry(spi_dev->mutex, "spi_dev");
     spi_dev->spi_bus = bus_handle;
     memcpy(&spi_dev->conf, &devcfg, sizeof(spi_device_interface_config_t));
     ESP_LOGI(TAG, "SPI%d bus device added, CS=%d Mode=%u Speed=%d", spi_bus->host_id + 1, device_conf->cs_io_num, device_conf->mode, device_conf->clock_speed_hz);
@@ -139,6 +141,7 @@ esp_err_t spi_bus_device_delete(spi_bus_device_handle_t *p_dev_handle)
     esp_err_t ret = spi_bus_remove_device(spi_dev->handle);
     SPI_DEVICE_MUTEX_GIVE(spi_dev, ESP_FAIL);
     SPI_BUS_CHECK(ESP_OK == ret, "spi bus delete device failed", ret);
+    vQueueUnregisterQueue(spi_dev->mutex);
     vSemaphoreDelete(spi_dev->mutex);
     ESP_LOGI(TAG, "SPI%d device removed, CS=%d", spi_bus->host_id + 1, spi_dev->conf.spics_io_num);
     free(spi_dev);
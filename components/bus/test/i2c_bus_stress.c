@@ -0,0 +1,263 @@
+/*
+ * SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_timer.h"
+#include "i2c_bus_stress.h"
+
+#define I2C_BUS_STRESS_STACK 3072
+
+typedef struct {
+    const i2c_bus_stress_config_t *config;
+    i2c_bus_device_handle_t device;
+    uint8_t *buf;
+    size_t length;
+    i2c_bus_stress_task_t *result;
+    TaskHandle_t handle;
+    QueueHandle_t done;
+    int index;
+} i2c_bus_stress_worker_t;
+
+static volatile bool s_stop;
+
+/* bucket of a latency, the same bounds as the wait histogram of i2c_bus_stats_t */
+static int i2c_bus_stress_bucket(uint32_t us)
+{
+    int bucket = 0;
+
+    while (bucket < I2C_BUS_STRESS_BUCKETS - 1 && us >= (16UL << bucket)) {
+        bucket++;
+    }
+
+    return bucket;
+}
+
+static void i2c_bus_stress_task(void *arg)
+{
+    i2c_bus_stress_worker_t *worker = (i2c_bus_stress_worker_t *)arg;
+    i2c_bus_stress_task_t *result = worker->result;
+
+    /* all tasks start together */
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    int64_t last = esp_timer_get_time();
+
+    while (!s_stop) {
+        int64_t start = esp_timer_get_time();
+        esp_err_t ret = i2c_bus_read_bytes(worker->device, worker->config->mem_address, worker->length, worker->buf);
+        int64_t now = esp_timer_get_time();
+
+        if (ret == ESP_ERR_TIMEOUT) {
+            result->timeouts++;
+        } else {
+            uint32_t latency_us = (uint32_t)(now - start);
+            uint32_t gap_us = (uint32_t)(now - last);
+
+            /* any other error than a timeout also had the bus, the device just did not answer */
+            result->reads++;
+            if (ret == ESP_OK) {
+                result->bytes += worker->length;
+            } else {
+                result->nacks++;
+            }
+            result->latency_us += latency_us;
+            if (latency_us > result->latency_max_us) {
+                result->latency_max_us = latency_us;
+            }
+            result->latency_hist[i2c_bus_stress_bucket(latency_us)]++;
+            if (gap_us > result->gap_max_us) {
+                result->gap_max_us = gap_us;
+            }
+            last = now;
+        }
+
+        if (worker->config->think_ms > 0) {
+            vTaskDelay(pdMS_TO_TICKS(worker->config->think_ms));
+        }
+    }
+
+    /* a task that lost the bus until the end starved as well */
+    uint32_t gap_us = (uint32_t)(esp_timer_get_time() - last);
+    if (gap_us > result->gap_max_us) {
+        result->gap_max_us = gap_us;
+    }
+
+    xQueueSend(worker->done, &worker->index, portMAX_DELAY);
+    vTaskDelete(NULL);
+}
+
+esp_err_t i2c_bus_stress_run(i2c_bus_handle_t bus_handle, const i2c_bus_stress_config_t *config, i2c_bus_stress_result_t *result)
+{
+    if (bus_handle == NULL || config == NULL || result == NULL || config->tasks < 1 || config->tasks > I2C_BUS_STRESS_MAX_TASKS
+            || config->addresses == NULL || config->address_num < 1 || config->length == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    i2c_bus_stress_worker_t workers[I2C_BUS_STRESS_MAX_TASKS] = {0};
+    esp_err_t ret = ESP_OK;
+    int started = 0;
+
+    memset(result, 0, sizeof(i2c_bus_stress_result_t));
+    s_stop = false;
+
+    QueueHandle_t done = xQueueCreate(config->tasks, sizeof(int));
+    if (done == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (int i = 0; i < config->tasks; i++) {
+        i2c_bus_stress_worker_t *worker = &workers[i];
+        worker->config = config;
+        worker->length = i == 0 && config->hog_length > 0 ? config->hog_length : config->length;
+        worker->result = &result->task[i];
+        worker->done = done;
+        worker->index = i;
+        worker->device = i2c_bus_device_create(bus_handle, config->addresses[i % config->address_num], config->clk_speed);
+        worker->buf = malloc(worker->length);
+        if (worker->device == NULL || worker->buf == NULL) {
+            ret = ESP_ERR_NO_MEM;
+            break;
+        }
+    }
+
+    if (ret == ESP_OK) {
+        i2c_bus_reset_stats(bus_handle);
+
+        for (; started < config->tasks; started++) {
+            char name[24];
+            snprintf(name, sizeof(name), "i2c_stress%d", started);
+            /* spread over the cores, so the tasks really run at the same time */
+            if (xTaskCreatePinnedToCore(i2c_bus_stress_task, name, I2C_BUS_STRESS_STACK, &workers[started], config->priority,
+                                        &workers[started].handle, started % portNUM_PROCESSORS) != pdPASS) {
+                ret = ESP_ERR_NO_MEM;
+                s_stop = true;
+                break;
+            }
+        }
+
+        int64_t start = esp_timer_get_time();
+        for (int i = 0; i < started; i++) {
+            xTaskNotifyGive(workers[i].handle);
+        }
+
+        if (ret == ESP_OK) {
+            vTaskDelay(pdMS_TO_TICKS(config->duration_ms));
+        }
+        s_stop = true;
+
+        for (int i = 0; i < started; i++) {
+            int index;
+            xQueueReceive(done, &index, portMAX_DELAY);
+        }
+        result->elapsed_us = (uint32_t)(esp_timer_get_time() - start);
+        result->lock_valid = i2c_bus_get_stats(bus_handle, &result->lock) == ESP_OK;
+    }
+
+    for (int i = 0; i < config->tasks; i++) {
+        if (workers[i].device != NULL) {
+            i2c_bus_device_delete(&workers[i].device);
+        }
+        free(workers[i].buf);
+    }
+    vQueueDelete(done);
+
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    /* Jain's fairness index over the reads of each task */
+    double sum = 0;
+    double sum_squares = 0;
+    for (int i = 0; i < config->tasks; i++) {
+        const i2c_bus_stress_task_t *task = &result->task[i];
+        result->reads += task->reads;
+        result->timeouts += task->timeouts;
+        result->bytes += task->bytes;
+        if (task->gap_max_us > config->starve_ms * 1000) {
+            result->starved++;
+        }
+        sum += task->reads;
+        sum_squares += (double)task->reads * task->reads;
+    }
+    result->fairness = sum_squares > 0 ? (float)(sum * sum / (config->tasks * sum_squares)) : 0;
+
+    return ESP_OK;
+}
+
+uint32_t i2c_bus_stress_percentile(const uint32_t *hist, int buckets, int percent)
+{
+    uint64_t total = 0;
+    for (int i = 0; i < buckets; i++) {
+        total += hist[i];
+    }
+
+    /* rank of the value, rounded up */
+    uint64_t rank = (total * percent + 99) / 100;
+    uint64_t count = 0;
+    for (int i = 0; i < buckets - 1; i++) {
+        count += hist[i];
+        if (count >= rank && count > 0) {
+            return 16UL << i;
+        }
+    }
+
+    return UINT32_MAX;
+}
+
+/* prints a bound of i2c_bus_stress_percentile */
+static void i2c_bus_stress_print_bound(uint32_t bound)
+{
+    if (bound == UINT32_MAX) {
+        printf(" %9s", "inf");
+    } else {
+        printf("  <%7"PRIu32, bound);
+    }
+}
+
+void i2c_bus_stress_print(const i2c_bus_stress_config_t *config, const i2c_bus_stress_result_t *result)
+{
+    double seconds = result->elapsed_us / 1e6;
+
+    printf("i2c_bus stress: %d tasks, %u bytes per read", config->tasks, (unsigned)config->length);
+    if (config->hog_length > 0) {
+        printf(" (task 0 %u)", (unsigned)config->hog_length);
+    }
+    printf(", think %"PRIu32" ms, %"PRIu32" ms, lock timeout %d ms\n", config->think_ms, config->duration_ms, CONFIG_I2C_MS_TO_WAIT);
+
+    printf("task    reads  reads/s     KB/s  nacks timeouts  avg us    p50 us    p99 us    max us    gap ms\n");
+    for (int i = 0; i < config->tasks; i++) {
+        const i2c_bus_stress_task_t *task = &result->task[i];
+        printf("%4d %8"PRIu32" %8.0f %8.1f %6"PRIu32" %8"PRIu32" %7"PRIu64, i, task->reads, task->reads / seconds,
+               task->bytes / seconds / 1024, task->nacks, task->timeouts, task->reads > 0 ? task->latency_us / task->reads : 0);
+        i2c_bus_stress_print_bound(i2c_bus_stress_percentile(task->latency_hist, I2C_BUS_STRESS_BUCKETS, 50));
+        i2c_bus_stress_print_bound(i2c_bus_stress_percentile(task->latency_hist, I2C_BUS_STRESS_BUCKETS, 99));
+        printf(" %9"PRIu32" %9"PRIu32"%s\n", task->latency_max_us, task->gap_max_us / 1000,
+               task->gap_max_us > config->starve_ms * 1000 ? " starved" : "");
+    }
+
+    printf("all  %8"PRIu32" %8.0f %8.1f, fairness %.3f, %d starved (gap > %"PRIu32" ms), %"PRIu32" timeouts\n",
+           result->reads, result->reads / seconds, result->bytes / seconds / 1024, result->fairness, result->starved,
+           config->starve_ms, result->timeouts);
+
+    if (result->lock_valid) {
+        const i2c_bus_stats_t *lock = &result->lock;
+        printf("lock: %"PRIu32" takes, %"PRIu32" timeouts, wait avg %"PRIu64" us", lock->takes, lock->timeouts,
+               lock->takes > 0 ? lock->wait_us / lock->takes : 0);
+        printf(" p50");
+        i2c_bus_stress_print_bound(i2c_bus_stress_percentile(lock->wait_hist, I2C_BUS_STATS_BUCKETS, 50));
+        printf(" p99");
+        i2c_bus_stress_print_bound(i2c_bus_stress_percentile(lock->wait_hist, I2C_BUS_STATS_BUCKETS, 99));
+        printf(" max %"PRIu32" us, held %.1f%% of the time, longest %"PRIu32" us\n", lock->wait_max_us,
+               100.0 * lock->hold_us / result->elapsed_us, lock->hold_max_us);
+    } else {
+        printf("lock: enable CONFIG_I2C_BUS_STATS for the mutex wait distribution\n");
+    }
+}
@@ -0,0 +1,114 @@
+/*
+ * SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _I2C_BUS_STRESS_H_
+#define _I2C_BUS_STRESS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "i2c_bus.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * Contention workload of i2c_bus, shared by the on-target test and the host benchmark in bench/.
+ * Every task reads from its own device on one bus as fast as it can, and the run reports the
+ * throughput, the latency each task sees, how fairly the bus was shared, the tasks that went
+ * without the bus for too long and the transfers that timed out after CONFIG_I2C_MS_TO_WAIT.
+ */
+
+#define I2C_BUS_STRESS_MAX_TASKS 8 /*!< tasks of one run */
+#define I2C_BUS_STRESS_BUCKETS 16  /*!< buckets of the latency histograms, bucket i counts the values below 2^(i+4) us */
+
+/**
+ * @brief Workload of one run
+ *
+ */
+typedef struct {
+    int tasks;                   /*!< Tasks hammering the bus, at most I2C_BUS_STRESS_MAX_TASKS */
+    const uint8_t *addresses;    /*!< Device addresses, task i reads from addresses[i % address_num] */
+    int address_num;             /*!< Number of addresses */
+    uint8_t mem_address;         /*!< Register read from, NULL_I2C_MEM_ADDR for plain reads */
+    uint32_t clk_speed;          /*!< Clock of the devices, 0 for the clock of the bus */
+    size_t length;               /*!< Bytes per read */
+    size_t hog_length;           /*!< Bytes per read of task 0, 0 for length, makes it hold the bus longer */
+    uint32_t think_ms;           /*!< Delay between two reads of a task, 0 to retry at once */
+    uint32_t duration_ms;        /*!< Length of the run */
+    uint32_t starve_ms;          /*!< Longest time a task may go without the bus before it counts as starved */
+    UBaseType_t priority;        /*!< Priority of the tasks, all the same */
+} i2c_bus_stress_config_t;
+
+/**
+ * @brief What one task saw
+ *
+ */
+typedef struct {
+    uint32_t reads;              /*!< Reads that got the bus, acknowledged or not */
+    uint32_t nacks;              /*!< Reads the device did not acknowledge, ESP_FAIL */
+    uint32_t timeouts;           /*!< Reads that gave up waiting, ESP_ERR_TIMEOUT */
+    uint64_t bytes;              /*!< Bytes of the acknowledged reads */
+    uint64_t latency_us;         /*!< Time from call to return of the reads that got the bus */
+    uint32_t latency_max_us;     /*!< Longest of them */
+    uint32_t gap_max_us;         /*!< Longest time between two reads that got the bus, from the start for the first */
+    uint32_t latency_hist[I2C_BUS_STRESS_BUCKETS]; /*!< Latencies by length, the last bucket counts everything above */
+} i2c_bus_stress_task_t;
+
+/**
+ * @brief Result of one run
+ *
+ */
+typedef struct {
+    uint32_t elapsed_us;         /*!< Time from the start of the tasks until the last one stopped */
+    i2c_bus_stress_task_t task[I2C_BUS_STRESS_MAX_TASKS]; /*!< Per task */
+    uint32_t reads;              /*!< Reads of all tasks that got the bus */
+    uint32_t timeouts;           /*!< Reads of all tasks that timed out */
+    uint64_t bytes;              /*!< Bytes read by all tasks */
+    float fairness;              /*!< Jain's index of the reads per task, 1 for an even share, 1/tasks if one task got all */
+    int starved;                 /*!< Tasks whose gap_max_us exceeded starve_ms */
+    bool lock_valid;             /*!< lock holds the statistics of the bus, CONFIG_I2C_BUS_STATS is enabled */
+    i2c_bus_stats_t lock;        /*!< Lock statistics of the bus during the run */
+} i2c_bus_stress_result_t;
+
+/**
+ * @brief Run the workload on a bus, blocks for config->duration_ms
+ *
+ * @param bus_handle I2C bus handle, the devices are created and deleted by the run
+ * @param config Workload
+ * @param result Returned result
+ * @return esp_err_t
+ *     - ESP_OK Success, even if tasks starved or timed out
+ *     - ESP_ERR_INVALID_ARG config is invalid
+ *     - ESP_ERR_NO_MEM the tasks or their buffers could not be created
+ */
+esp_err_t i2c_bus_stress_run(i2c_bus_handle_t bus_handle, const i2c_bus_stress_config_t *config, i2c_bus_stress_result_t *result);
+
+/**
+ * @brief Upper bound of a percentile of a latency histogram
+ *
+ * @param hist Histogram of I2C_BUS_STRESS_BUCKETS or I2C_BUS_STATS_BUCKETS buckets, both have the same bounds
+ * @param buckets Number of buckets
+ * @param percent Percentile, 0-100
+ * @return uint32_t the bound in us of the bucket the percentile falls into, UINT32_MAX for the last one
+ */
+uint32_t i2c_bus_stress_percentile(const uint32_t *hist, int buckets, int percent);
+
+/**
+ * @brief Print the result as a table on stdout
+ *
+ * @param config Workload of the run
+ * @param result Result of the run
+ */
+void i2c_bus_stress_print(const i2c_bus_stress_config_t *config, const i2c_bus_stress_result_t *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
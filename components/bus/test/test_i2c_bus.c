@@ -10,6 +10,7 @@
 #include "test_utils.h"
 #include "unity_config.h"
 #include "i2c_bus.h"
+#include "i2c_bus_stress.h"
 #include "esp_system.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -260,3 +261,49 @@ TEST_CASE("i2c bus init-deinit test", "[bus][i2c_bus]")
     i2c_bus_init_deinit_test();
     i2c_bus_device_add_test();
 }
+
+TEST_CASE("i2c bus contention test", "[bus][i2c_bus][stress]")
+{
+    /* the panel and the gesture sensor of the station, reads NACK on a board without them */
+    const uint8_t addresses[] = {0x3C, 0x39};
+    i2c_config_t conf = {
+        .mode = I2C_MODE_MASTER,
+        .sda_io_num = I2C_MASTER_SDA_IO,
+        .sda_pullup_en = GPIO_PULLUP_ENABLE,
+        .scl_io_num = I2C_MASTER_SCL_IO,
+        .scl_pullup_en = GPIO_PULLUP_ENABLE,
+        .master.clk_speed = I2C_MASTER_FREQ_HZ,
+    };
+    i2c_bus_stress_config_t stress = {
+        .tasks = 4,
+        .addresses = addresses,
+        .address_num = sizeof(addresses),
+        .mem_address = NULL_I2C_MEM_ADDR,
+        .clk_speed = 0,
+        .length = 16,
+        .hog_length = 0,
+        .think_ms = 0,
+        .duration_ms = 2000,
+        .starve_ms = CONFIG_I2C_MS_TO_WAIT / 2,
+        .priority = 5,
+    };
+    i2c_bus_handle_t i2c0_bus = i2c_bus_create(I2C_NUM_0, &conf);
+    TEST_ASSERT(i2c0_bus != NULL);
+
+    i2c_bus_stress_result_t result;
+    TEST_ESP_OK(i2c_bus_stress_run(i2c0_bus, &stress, &result));
+    i2c_bus_stress_print(&stress, &result);
+
+    for (int i = 0; i < stress.tasks; i++) {
+        TEST_ASSERT(result.task[i].reads > 0);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, result.timeouts);
+    TEST_ASSERT_EQUAL(0, result.starved);
+#if CONFIG_I2C_BUS_STATS
+    TEST_ASSERT(result.lock_valid);
+    TEST_ASSERT_EQUAL_UINT32(result.reads, result.lock.takes);
+#endif
+
+    TEST_ASSERT(ESP_OK == i2c_bus_delete(&i2c0_bus));
+    TEST_ASSERT(i2c0_bus == NULL);
+}
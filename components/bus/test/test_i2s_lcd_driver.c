@@ -0,0 +1,197 @@
+/*
+ * SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "unity.h"
+#include "esp_system.h"
+#include "esp_heap_caps.h"
+#include "i2s_lcd_driver.h"
+
+#define LCD_TEST_BUFFER_SIZE  16000
+#define LCD_TEST_LENGTH       9600   /*!< One 320x15 RGB565 band */
+
+static i2s_lcd_handle_t lcd_test_init(void)
+{
+    i2s_lcd_config_t config = {
+        .data_width = 8,
+#if CONFIG_IDF_TARGET_ESP32
+        .pin_data_num = {33, 13, 14, 15, 16, 19, 21, 22},
+        .pin_num_wr = 4,
+        .pin_num_rs = 2,
+#else
+        .pin_data_num = {1, 2, 3, 4, 5, 6, 7, 8},
+        .pin_num_wr = 9,
+        .pin_num_rs = 10,
+#endif
+        .pin_num_cs = -1,
+        .clk_freq = 10000000,
+        .i2s_port = I2S_NUM_0,
+        .swap_data = false,
+        .buffer_size = LCD_TEST_BUFFER_SIZE,
+    };
+    return i2s_lcd_driver_init(&config);
+}
+
+TEST_CASE("i2s lcd dma layout test", "[bus][i2s_lcd]")
+{
+    i2s_lcd_handle_t handle = lcd_test_init();
+    TEST_ASSERT_NOT_NULL(handle);
+    uint8_t *data = (uint8_t *)heap_caps_malloc(LCD_TEST_LENGTH, MALLOC_CAP_DMA);
+    TEST_ASSERT_NOT_NULL(data);
+    esp_fill_random(data, LCD_TEST_LENGTH);
+
+    i2s_lcd_dma_layout_t layout;
+    TEST_ASSERT_EQUAL(ESP_OK, i2s_lcd_get_dma_layout(handle, &layout));
+    TEST_ASSERT_EQUAL_UINT32(16000, layout.buffer_size);
+    TEST_ASSERT_EQUAL_UINT32(4000, layout.node_size);
+
+    // Rounded down to two halves of whole nodes
+    TEST_ASSERT_EQUAL(ESP_OK, i2s_lcd_set_dma_layout(handle, 10000, 1024));
+    TEST_ASSERT_EQUAL(ESP_OK, i2s_lcd_get_dma_layout(handle, &layout));
+    TEST_ASSERT_EQUAL_UINT32(8192, layout.buffer_size);
+    TEST_ASSERT_EQUAL_UINT32(1024, layout.node_size);
+    TEST_ASSERT_EQUAL(ESP_OK, i2s_lcd_write(handle, data, LCD_TEST_LENGTH));
+
+    // Invalid layouts keep the current one
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, i2s_lcd_set_dma_layout(handle, 16000, 4002));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, i2s_lcd_set_dma_layout(handle, 1000, 1024));
+    TEST_ASSERT_EQUAL(ESP_OK, i2s_lcd_get_dma_layout(handle, &layout));
+    TEST_ASSERT_EQUAL_UINT32(8192, layout.buffer_size);
+    TEST_ASSERT_EQUAL(ESP_OK, i2s_lcd_write(handle, data, LCD_TEST_LENGTH));
+
+    heap_caps_free(data);
+    TEST_ASSERT_EQUAL(ESP_OK, i2s_lcd_driver_deinit(handle));
+}
+
+static esp_err_t lcd_test_write_async(i2s_lcd_handle_t handle, const uint8_t *data, uint32_t length, void *user_ctx)
+{
+    return i2s_lcd_write_async(handle, data, length, NULL, NULL);
+}
+
+TEST_CASE("i2s lcd dma calibration test", "[bus][i2s_lcd]")
+{
+    i2s_lcd_handle_t handle = lcd_test_init();
+    TEST_ASSERT_NOT_NULL(handle);
+    uint8_t *data = (uint8_t *)heap_caps_malloc(LCD_TEST_LENGTH, MALLOC_CAP_DMA);
+    TEST_ASSERT_NOT_NULL(data);
+    esp_fill_random(data, LCD_TEST_LENGTH);
+
+    i2s_lcd_calibration_t result;
+    TEST_ASSERT_EQUAL(ESP_OK, i2s_lcd_calibrate(handle, data, LCD_TEST_LENGTH, 32000, NULL, NULL, &result));
+    printf("best layout: buffer %"PRIu32", node %"PRIu32", %"PRIu32" KB/s, %"PRIu32" isr/s, %"PRIu32" stalls\n",
+           result.layout.buffer_size, result.layout.node_size, result.bytes_per_sec / 1024, result.isr_per_sec, result.stalls);
+    TEST_ASSERT(result.bytes_per_sec > 0);
+
+    // Through the write of the application, refilled from the interrupt
+    TEST_ASSERT_EQUAL(ESP_OK, i2s_lcd_calibrate(handle, data, LCD_TEST_LENGTH, 32000, lcd_test_write_async, NULL, &result));
+    printf("best async layout: buffer %"PRIu32", node %"PRIu32", %"PRIu32" KB/s, %"PRIu32" isr/s, %"PRIu32" stalls\n",
+           result.layout.buffer_size, result.layout.node_size, result.bytes_per_sec / 1024, result.isr_per_sec, result.stalls);
+    TEST_ASSERT(result.bytes_per_sec > 0);
+
+    // The best layout is left applied
+    i2s_lcd_dma_layout_t layout;
+    TEST_ASSERT_EQUAL(ESP_OK, i2s_lcd_get_dma_layout(handle, &layout));
+    TEST_ASSERT_EQUAL_UINT32(result.layout.buffer_size, layout.buffer_size);
+    TEST_ASSERT_EQUAL_UINT32(result.layout.node_size, layout.node_size);
+
+    // A failing write skips every layout and is reported
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, i2s_lcd_calibrate(handle, data, LCD_TEST_LENGTH - 1, 32000, lcd_test_write_async, NULL, &result));
+    TEST_ASSERT_EQUAL(ESP_FAIL, i2s_lcd_calibrate(handle, data, LCD_TEST_LENGTH, 1000, NULL, NULL, &result));
+
+    heap_caps_free(data);
+    TEST_ASSERT_EQUAL(ESP_OK, i2s_lcd_driver_deinit(handle));
+}
+
+TEST_CASE("i2s lcd transaction test", "[bus][i2s_lcd]")
+{
+    i2s_lcd_handle_t handle = lcd_test_init();
+    TEST_ASSERT_NOT_NULL(handle);
+    uint8_t *data = (uint8_t *)heap_caps_malloc(LCD_TEST_LENGTH, MALLOC_CAP_DMA);
+    TEST_ASSERT_NOT_NULL(data);
+    esp_fill_random(data, LCD_TEST_LENGTH);
+
+    // Window of a 320x15 band followed by its pixels, then a window without pixels
+    uint8_t caset[4] = {0x00, 0x00, 0x01, 0x3F};
+    uint8_t raset[4] = {0x00, 0x00, 0x00, 0x0E};
+    i2s_lcd_trans_t trans[3] = {
+        { .cmd = 0x2A, .param = caset, .param_len = sizeof(caset) },
+        { .cmd = 0x2B, .param = raset, .param_len = sizeof(raset) },
+        { .cmd = 0x2C, .data = data, .length = LCD_TEST_LENGTH },
+    };
+    TEST_ASSERT_EQUAL(ESP_OK, i2s_lcd_write_trans(handle, trans, 3));
+    TEST_ASSERT_EQUAL(ESP_OK, i2s_lcd_wait_done(handle, portMAX_DELAY));
+    trans[2].data = NULL;
+    trans[2].length = 0;
+    TEST_ASSERT_EQUAL(ESP_OK, i2s_lcd_write_trans(handle, trans, 3));
+    // Blocking writes queue up behind the transaction
+    TEST_ASSERT_EQUAL(ESP_OK, i2s_lcd_write(handle, data, LCD_TEST_LENGTH));
+
+    // Block data is only allowed in the last transaction
+    trans[0].data = data;
+    trans[0].length = LCD_TEST_LENGTH;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, i2s_lcd_write_trans(handle, trans, 3));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, i2s_lcd_write_trans(handle, trans, I2S_LCD_TRANS_MAX + 1));
+
+    heap_caps_free(data);
+    TEST_ASSERT_EQUAL(ESP_OK, i2s_lcd_driver_deinit(handle));
+}
+
+#if CONFIG_LCD_PERF_STATS
+TEST_CASE("i2s lcd perf stats test", "[bus][i2s_lcd]")
+{
+    i2s_lcd_handle_t handle = lcd_test_init();
+    TEST_ASSERT_NOT_NULL(handle);
+    uint8_t *data = (uint8_t *)heap_caps_malloc(LCD_TEST_LENGTH, MALLOC_CAP_DMA);
+    TEST_ASSERT_NOT_NULL(data);
+    esp_fill_random(data, LCD_TEST_LENGTH);
+
+    TEST_ASSERT_EQUAL(ESP_OK, i2s_lcd_reset_stats(handle));
+    for (int i = 0; i < 10; i++) {
+        TEST_ASSERT_EQUAL(ESP_OK, i2s_lcd_write(handle, data, LCD_TEST_LENGTH));
+    }
+    TEST_ASSERT_EQUAL(ESP_OK, i2s_lcd_write_async(handle, data, LCD_TEST_LENGTH, NULL, NULL));
+    TEST_ASSERT_EQUAL(ESP_OK, i2s_lcd_wait_done(handle, portMAX_DELAY));
+
+    i2s_lcd_stats_t stats;
+    TEST_ASSERT_EQUAL(ESP_OK, i2s_lcd_get_stats(handle, &stats));
+    printf("%"PRIu32" transfers, %"PRIu32" KB/s, %"PRIu32" isr, max isr %"PRIu32" cycles, %"PRIu32" underruns\n",
+           stats.transfers, stats.bytes_per_sec / 1024, stats.isr_count, stats.isr_cycles_max, stats.underruns);
+    TEST_ASSERT_EQUAL_UINT32(11, stats.transfers);
+    TEST_ASSERT(stats.bytes == 11ULL * LCD_TEST_LENGTH);
+    TEST_ASSERT(stats.bytes_per_sec > 0);
+    TEST_ASSERT(stats.isr_count > 0);
+    TEST_ASSERT(stats.isr_cycles_max > 0);
+
+    heap_caps_free(data);
+    TEST_ASSERT_EQUAL(ESP_OK, i2s_lcd_driver_deinit(handle));
+}
+
+TEST_CASE("i2s lcd async underrun test", "[bus][i2s_lcd]")
+{
+    i2s_lcd_handle_t handle = lcd_test_init();
+    TEST_ASSERT_NOT_NULL(handle);
+    uint8_t *data = (uint8_t *)heap_caps_malloc(LCD_TEST_LENGTH, MALLOC_CAP_DMA);
+    TEST_ASSERT_NOT_NULL(data);
+    esp_fill_random(data, LCD_TEST_LENGTH);
+
+    // Halves of a single word drain before the interrupt has refilled the other one
+    TEST_ASSERT_EQUAL(ESP_OK, i2s_lcd_set_dma_layout(handle, 8, 4));
+    TEST_ASSERT_EQUAL(ESP_OK, i2s_lcd_reset_stats(handle));
+    TEST_ASSERT_EQUAL(ESP_OK, i2s_lcd_write_async(handle, data, 960, NULL, NULL));
+    TEST_ASSERT_EQUAL(ESP_OK, i2s_lcd_wait_done(handle, portMAX_DELAY));
+
+    i2s_lcd_stats_t stats;
+    TEST_ASSERT_EQUAL(ESP_OK, i2s_lcd_get_stats(handle, &stats));
+    printf("%"PRIu32" isr, %"PRIu32" underruns\n", stats.isr_count, stats.underruns);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.transfers);
+    TEST_ASSERT(stats.underruns > 0);
+    TEST_ASSERT(stats.underruns < stats.isr_count);
+
+    heap_caps_free(data);
+    TEST_ASSERT_EQUAL(ESP_OK, i2s_lcd_driver_deinit(handle));
+}
+#endif
@@ -0,0 +1,116 @@
+/*
+ * SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "unity.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "i2s_lcd_pack.h"
+
+#define PACK_TEST_LENGTH     4000  /*!< Input length of the throughput test, same as one DMA node */
+#define PACK_TEST_ROUNDS     200   /*!< Number of packed buffers per throughput measurement */
+
+/* Reference byte loops, as used by i2s_lcd_esp32_driver.c before the word-wide kernels */
+static void pack_8bit_ref(uint8_t *out, const uint8_t *in, size_t len, bool swap)
+{
+    for (size_t y = 0; y < len * 2; y += 4) {
+        if (!swap) {
+            out[y + 3] = in[(y >> 1) + 0];
+            out[y + 1] = in[(y >> 1) + 1];
+        } else {
+            out[y + 1] = in[(y >> 1) + 0];
+            out[y + 3] = in[(y >> 1) + 1];
+        }
+    }
+}
+
+static void pack_16bit_ref(uint8_t *out, const uint8_t *in, size_t len, bool swap)
+{
+    for (size_t y = 0; y < len; y += 4) {
+        if (swap) {
+            out[y + 3] = in[y + 0];
+            out[y + 2] = in[y + 1];
+            out[y + 1] = in[y + 2];
+            out[y + 0] = in[y + 3];
+        } else {
+            out[y + 2] = in[y + 0];
+            out[y + 3] = in[y + 1];
+            out[y + 0] = in[y + 2];
+            out[y + 1] = in[y + 3];
+        }
+    }
+}
+
+TEST_CASE("i2s lcd pack correctness test", "[bus][i2s_lcd]")
+{
+    uint8_t *in = (uint8_t *)malloc(256 + 4);
+    uint32_t *out = (uint32_t *)heap_caps_calloc(1, 512, MALLOC_CAP_32BIT);
+    uint32_t *ref = (uint32_t *)heap_caps_calloc(1, 512, MALLOC_CAP_32BIT);
+    TEST_ASSERT(in != NULL && out != NULL && ref != NULL);
+    esp_fill_random(in, 256 + 4);
+
+    for (int offset = 0; offset < 4; offset++) {
+        for (int swap = 0; swap < 2; swap++) {
+            for (size_t len = 0; len <= 256; len += 2) {
+                memset(out, 0, 512);
+                memset(ref, 0, 512);
+                i2s_lcd_pack_8bit(out, in + offset, len, swap);
+                pack_8bit_ref((uint8_t *)ref, in + offset, len, swap);
+                TEST_ASSERT_EQUAL_HEX8_ARRAY(ref, out, 512);
+                if (len % 4) {
+                    continue;
+                }
+                memset(out, 0, 512);
+                memset(ref, 0, 512);
+                i2s_lcd_pack_16bit(out, in + offset, len, swap);
+                pack_16bit_ref((uint8_t *)ref, in + offset, len, swap);
+                TEST_ASSERT_EQUAL_HEX8_ARRAY(ref, out, 512);
+            }
+        }
+    }
+    free(in);
+    heap_caps_free(out);
+    heap_caps_free(ref);
+}
+
+TEST_CASE("i2s lcd pack throughput test", "[bus][i2s_lcd]")
+{
+    uint8_t *in = (uint8_t *)heap_caps_malloc(PACK_TEST_LENGTH, MALLOC_CAP_32BIT);
+    uint32_t *out = (uint32_t *)heap_caps_malloc(PACK_TEST_LENGTH * 2, MALLOC_CAP_DMA);
+    TEST_ASSERT(in != NULL && out != NULL);
+    esp_fill_random(in, PACK_TEST_LENGTH);
+
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < PACK_TEST_ROUNDS; i++) {
+        pack_8bit_ref((uint8_t *)out, in, PACK_TEST_LENGTH, false);
+    }
+    int64_t ref_8bit = esp_timer_get_time() - start;
+    start = esp_timer_get_time();
+    for (int i = 0; i < PACK_TEST_ROUNDS; i++) {
+        i2s_lcd_pack_8bit(out, in, PACK_TEST_LENGTH, false);
+    }
+    int64_t word_8bit = esp_timer_get_time() - start;
+
+    start = esp_timer_get_time();
+    for (int i = 0; i < PACK_TEST_ROUNDS; i++) {
+        pack_16bit_ref((uint8_t *)out, in, PACK_TEST_LENGTH, true);
+    }
+    int64_t ref_16bit = esp_timer_get_time() - start;
+    start = esp_timer_get_time();
+    for (int i = 0; i < PACK_TEST_ROUNDS; i++) {
+        i2s_lcd_pack_16bit(out, in, PACK_TEST_LENGTH, true);
+    }
+    int64_t word_16bit = esp_timer_get_time() - start;
+
+    uint64_t bytes = (uint64_t)PACK_TEST_LENGTH * PACK_TEST_ROUNDS;
+    printf("8bit  pack: byte loop %llu KB/s, word kernel %llu KB/s\n", bytes * 1000000 / ref_8bit / 1024, bytes * 1000000 / word_8bit / 1024);
+    printf("16bit pack: byte loop %llu KB/s, word kernel %llu KB/s\n", bytes * 1000000 / ref_16bit / 1024, bytes * 1000000 / word_16bit / 1024);
+
+    heap_caps_free(in);
+    heap_caps_free(out);
+}
@@ -12,6 +12,21 @@
 
 #define PACK8 __attribute__((aligned( __alignof__( uint8_t ) ), packed ))
 
+// The transport is chosen by CONFIG_SPI_INTERFACE or CONFIG_I2C_INTERFACE, so draw and flush paths call it directly
+#if CONFIG_I2C_INTERFACE
+#define ssd1306_bus_init(dev, width, height)				i2c_init(dev, width, height)
+#define ssd1306_bus_display_image(dev, page, seg, images, width)	i2c_display_image(dev, page, seg, images, width)
+#define ssd1306_bus_contrast(dev, contrast)				i2c_contrast(dev, contrast)
+#define ssd1306_bus_display_on(dev, on)					i2c_display_on(dev, on)
+#define ssd1306_bus_hardware_scroll(dev, scroll)			i2c_hardware_scroll(dev, scroll)
+#else
+#define ssd1306_bus_init(dev, width, height)				spi_init(dev, width, height)
+#define ssd1306_bus_display_image(dev, page, seg, images, width)	spi_display_image(dev, page, seg, images, width)
+#define ssd1306_bus_contrast(dev, contrast)				spi_contrast(dev, contrast)
+#define ssd1306_bus_display_on(dev, on)					spi_display_on(dev, on)
+#define ssd1306_bus_hardware_scroll(dev, scroll)			spi_hardware_scroll(dev, scroll)
+#endif
+
 typedef union out_column_t {
 	uint32_t u32;
 	uint8_t  u8[4];
@@ -19,11 +34,7 @@ typedef union out_column_t {
 
 void ssd1306_init(SSD1306_t * dev, int width, int height)
 {
-	if (dev->_address == SPIAddress) {
-		spi_init(dev, width, height);
-	} else {
-		i2c_init(dev, width, height);
-	}
+	ssd1306_bus_init(dev, width, height);
 	// Initialize internal buffer
 	for (int i=0;i<dev->_pages;i++) {
 		memset(dev->_page[i]._segs, 0, 128);
@@ -47,14 +58,8 @@ int ssd1306_get_pages(SSD1306_t * dev)
 
 void ssd1306_show_buffer(SSD1306_t * dev)
 {
-	if (dev->_address == SPIAddress) {
-		for (int page=0; page<dev->_pages;page++) {
-			spi_display_image(dev, page, 0, dev->_page[page]._segs, dev->_width);
-		}
-	} else {
-		for (int page=0; page<dev->_pages;page++) {
-			i2c_display_image(dev, page, 0, dev->_page[page]._segs, dev->_width);
-		}
+	for (int page=0; page<dev->_pages;page++) {
+		ssd1306_bus_display_image(dev, page, 0, dev->_page[page]._segs, dev->_width);
 	}
 }
 
@@ -78,11 +83,7 @@ void ssd1306_get_buffer(SSD1306_t * dev, uint8_t * buffer)
 
 void ssd1306_display_image(SSD1306_t * dev, int page, int seg, uint8_t * images, int width)
 {
-	if (dev->_address == SPIAddress) {
-		spi_display_image(dev, page, seg, images, width);
-	} else {
-		i2c_display_image(dev, page, seg, images, width);
-	}
+	ssd1306_bus_display_image(dev, page, seg, images, width);
 	// Set to internal buffer
 	memcpy(&dev->_page[page]._segs[seg], images, width);
 }
@@ -100,13 +101,6 @@ void ssd1306_display_text(SSD1306_t * dev, int page, char * text, int text_len,
 		if (invert) ssd1306_invert(image, 8);
 		if (dev->_flip) ssd1306_flip(image, 8);
 		ssd1306_display_image(dev, page, seg, image, 8);
-#if 0
-		if (dev->_address == SPIAddress) {
-			spi_display_image(dev, page, seg, image, 8);
-		} else {
-			i2c_display_image(dev, page, seg, image, 8);
-		}
-#endif
 		seg = seg + 8;
 	}
 }
@@ -154,11 +148,7 @@ ssd1306_display_text_x3(SSD1306_t * dev, int page, char * text, int text_len, bo
 			}
 			if (invert) ssd1306_invert(image, 24);
 			if (dev->_flip) ssd1306_flip(image, 24);
-			if (dev->_address == SPIAddress) {
-				spi_display_image(dev, page+yy, seg, image, 24);
-			} else {
-				i2c_display_image(dev, page+yy, seg, image, 24);
-			}
+			ssd1306_bus_display_image(dev, page+yy, seg, image, 24);
 			memcpy(&dev->_page[page+yy]._segs[seg], image, 24);
 		}
 		seg = seg + 24;
@@ -183,11 +173,13 @@ void ssd1306_clear_line(SSD1306_t * dev, int page, bool invert)
 
 void ssd1306_contrast(SSD1306_t * dev, int contrast)
 {
-	if (dev->_address == SPIAddress) {
-		spi_contrast(dev, contrast);
-	} else {
-		i2c_contrast(dev, contrast);
-	}
+	ssd1306_bus_contrast(dev, contrast);
+}
+
+// The panel keeps its RAM while it is off, switching it on again shows the last frame without a redraw
+void ssd1306_display_on(SSD1306_t * dev, bool on)
+{
+	ssd1306_bus_display_on(dev, on);
 }
 
 void ssd1306_software_scroll(SSD1306_t * dev, int start, int end)
@@ -212,13 +204,6 @@ void ssd1306_scroll_text(SSD1306_t * dev, char * text, int text_len, bool invert
 	ESP_LOGD(TAG, "dev->_scEnable=%d", dev->_scEnable);
 	if (dev->_scEnable == false) return;
 
-	void (*func)(SSD1306_t * dev, int page, int seg, uint8_t * images, int width);
-	if (dev->_address == SPIAddress) {
-		func = spi_display_image;
-	} else {
-		func = i2c_display_image;
-	}
-
 	int srcIndex = dev->_scEnd - dev->_scDirection;
 	while(1) {
 		int dstIndex = srcIndex + dev->_scDirection;
@@ -226,7 +211,7 @@ void ssd1306_scroll_text(SSD1306_t * dev, char * text, int text_len, bool invert
 		for(int seg = 0; seg < dev->_width; seg++) {
 			dev->_page[dstIndex]._segs[seg] = dev->_page[srcIndex]._segs[seg];
 		}
-		(*func)(dev, dstIndex, 0, dev->_page[dstIndex]._segs, sizeof(dev->_page[dstIndex]._segs));
+		ssd1306_bus_display_image(dev, dstIndex, 0, dev->_page[dstIndex]._segs, sizeof(dev->_page[dstIndex]._segs));
 		if (srcIndex == dev->_scStart) break;
 		srcIndex = srcIndex - dev->_scDirection;
 	}
@@ -255,11 +240,7 @@ void ssd1306_scroll_clear(SSD1306_t * dev)
 
 void ssd1306_hardware_scroll(SSD1306_t * dev, ssd1306_scroll_type_t scroll)
 {
-	if (dev->_address == SPIAddress) {
-		spi_hardware_scroll(dev, scroll);
-	} else {
-		i2c_hardware_scroll(dev, scroll);
-	}
+	ssd1306_bus_hardware_scroll(dev, scroll);
 }
 
 // delay = 0 : display with no wait
@@ -399,11 +380,7 @@ void ssd1306_wrap_arround(SSD1306_t * dev, ssd1306_scroll_type_t scroll, int sta
 
 	if (delay >= 0) {
 		for (int page=0;page<dev->_pages;page++) {
-			if (dev->_address == SPIAddress) {
-				spi_display_image(dev, page, 0, dev->_page[page]._segs, 128);
-			} else {
-				i2c_display_image(dev, page, 0, dev->_page[page]._segs, 128);
-			}
+			ssd1306_bus_display_image(dev, page, 0, dev->_page[page]._segs, 128);
 			if (delay) vTaskDelay(delay);
 		}
 	}
@@ -580,13 +557,6 @@ uint8_t ssd1306_rotate_byte(uint8_t ch1) {
 
 void ssd1306_fadeout(SSD1306_t * dev)
 {
-	void (*func)(SSD1306_t * dev, int page, int seg, uint8_t * images, int width);
-	if (dev->_address == SPIAddress) {
-		func = spi_display_image;
-	} else {
-		func = i2c_display_image;
-	}
-
 	uint8_t image[1];
 	for(int page=0; page<dev->_pages; page++) {
 		image[0] = 0xFF;
@@ -597,7 +567,7 @@ void ssd1306_fadeout(SSD1306_t * dev)
 				image[0] = image[0] << 1;
 			}
 			for(int seg=0; seg<128; seg++) {
-				(*func)(dev, page, seg, image, 1);
+				ssd1306_bus_display_image(dev, page, seg, image, 1);
 				dev->_page[page]._segs[seg] = image[0];
 			}
 		}
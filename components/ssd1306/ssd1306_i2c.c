@@ -166,6 +166,19 @@ void i2c_contrast(SSD1306_t * dev, int contrast) {
 	i2c_cmd_link_delete(cmd);
 }
 
+void i2c_display_on(SSD1306_t * dev, bool on) {
+	i2c_cmd_handle_t cmd;
+
+	cmd = i2c_cmd_link_create();
+	i2c_master_start(cmd);
+	i2c_master_write_byte(cmd, (dev->_address << 1) | I2C_MASTER_WRITE, true);
+	i2c_master_write_byte(cmd, OLED_CONTROL_BYTE_CMD_STREAM, true);
+	i2c_master_write_byte(cmd, on ? OLED_CMD_DISPLAY_ON : OLED_CMD_DISPLAY_OFF, true);	// AF / AE
+	i2c_master_stop(cmd);
+	i2c_master_cmd_begin(I2C_NUM, cmd, 10/portTICK_PERIOD_MS);
+	i2c_cmd_link_delete(cmd);
+}
+
 
 void i2c_hardware_scroll(SSD1306_t * dev, ssd1306_scroll_type_t scroll) {
 	esp_err_t espRc;
@@ -187,6 +187,10 @@ void spi_contrast(SSD1306_t * dev, int contrast) {
 	spi_master_write_command(dev, _contrast);
 }
 
+void spi_display_on(SSD1306_t * dev, bool on) {
+	spi_master_write_command(dev, on ? OLED_CMD_DISPLAY_ON : OLED_CMD_DISPLAY_OFF);	// AF / AE
+}
+
 void spi_hardware_scroll(SSD1306_t * dev, ssd1306_scroll_type_t scroll)
 {
 
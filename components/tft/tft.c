@@ -0,0 +1,336 @@
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "driver/gpio.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+
+#include "tft.h"
+#include "font8x8_basic.h"
+
+#define TAG "TFT"
+
+static void tft_write_command(TFT_t * dev, uint8_t cmd, const uint8_t * params, int len)
+{
+	i2s_lcd_trans_t trans = { .cmd = cmd, .param = params, .param_len = len };
+	i2s_lcd_write_trans(dev->_bus, &trans, 1);
+}
+
+// Set the window and send its first pixels in the same transfer, pixels can be NULL
+static void tft_write_window(TFT_t * dev, int x0, int y0, int x1, int y1, const uint16_t * pixels, size_t len)
+{
+	uint8_t caset[4] = { x0 >> 8, x0 & 0xFF, x1 >> 8, x1 & 0xFF };
+	uint8_t raset[4] = { y0 >> 8, y0 & 0xFF, y1 >> 8, y1 & 0xFF };
+	i2s_lcd_trans_t trans[3] = {
+		{ .cmd = TFT_CMD_CASET, .param = caset, .param_len = 4 },
+		{ .cmd = TFT_CMD_RASET, .param = raset, .param_len = 4 },
+		{ .cmd = TFT_CMD_RAMWR, .data = (const uint8_t *)pixels, .length = len * sizeof(uint16_t) },
+	};
+	i2s_lcd_write_trans(dev->_bus, trans, 3);
+}
+
+esp_err_t tft_init(TFT_t * dev, const i2s_lcd_config_t * bus_config, int width, int height, int16_t reset)
+{
+	if (reset >= 0) {
+		gpio_reset_pin(reset);
+		gpio_set_direction(reset, GPIO_MODE_OUTPUT);
+		gpio_set_level(reset, 0);
+		vTaskDelay(pdMS_TO_TICKS(100));
+		gpio_set_level(reset, 1);
+		vTaskDelay(pdMS_TO_TICKS(120));
+	}
+
+	dev->_bus = i2s_lcd_driver_init(bus_config);
+	if (dev->_bus == NULL) {
+		ESP_LOGE(TAG, "i2s_lcd_driver_init failed");
+		return ESP_FAIL;
+	}
+
+	// Scale the 128x64 grid by the largest integer factor which fits and center it
+	dev->_width = width;
+	dev->_height = height;
+	dev->_scale = width / TFT_GRID_WIDTH;
+	if (height / TFT_GRID_HEIGHT < dev->_scale) dev->_scale = height / TFT_GRID_HEIGHT;
+	if (dev->_scale < 1) dev->_scale = 1;
+	dev->_originX = (width - TFT_GRID_WIDTH * dev->_scale) / 2;
+	dev->_originY = (height - TFT_GRID_HEIGHT * dev->_scale) / 2;
+	dev->_fg = TFT_WHITE;
+	dev->_bg = TFT_BLACK;
+	ESP_LOGI(TAG, "Panel is %dx%d, grid scale %d", width, height, dev->_scale);
+
+	// Two small bands are kept in RAM, never the whole frame
+	dev->_bandLen = CONFIG_TFT_BAND_SIZE / sizeof(uint16_t);
+	dev->_bandIndex = 0;
+	if (dev->_bandLen < (size_t)width) {
+		ESP_LOGE(TAG, "band of %u pixels can't hold one panel line", (unsigned)dev->_bandLen);
+		tft_deinit(dev);
+		return ESP_ERR_INVALID_SIZE;
+	}
+	for (int i = 0; i < 2; i++) {
+		dev->_band[i] = heap_caps_malloc(dev->_bandLen * sizeof(uint16_t), MALLOC_CAP_DMA | MALLOC_CAP_32BIT);
+		if (dev->_band[i] == NULL) {
+			ESP_LOGE(TAG, "band malloc failed");
+			tft_deinit(dev);
+			return ESP_ERR_NO_MEM;
+		}
+	}
+
+	dev->_frame = NULL;
+#if CONFIG_TFT_FRAMEBUFFER_PSRAM
+	// Aligned so that the DMA can read the rows in place where the target supports it
+	dev->_frame = heap_caps_aligned_alloc(64, width * height * sizeof(uint16_t), MALLOC_CAP_SPIRAM);
+	if (dev->_frame == NULL) {
+		ESP_LOGE(TAG, "frame malloc failed");
+		tft_deinit(dev);
+		return ESP_ERR_NO_MEM;
+	}
+#endif
+	dev->_dirtyY0 = height;
+	dev->_dirtyY1 = 0;
+
+	tft_write_command(dev, TFT_CMD_SWRESET, NULL, 0);
+	vTaskDelay(pdMS_TO_TICKS(150));
+	tft_write_command(dev, TFT_CMD_SLPOUT, NULL, 0);
+	vTaskDelay(pdMS_TO_TICKS(120));
+	uint8_t colmod = TFT_COLMOD_RGB565;
+	tft_write_command(dev, TFT_CMD_COLMOD, &colmod, 1);
+#if CONFIG_TFT_ST7789
+	uint8_t madctl = TFT_MADCTL_MV;
+	tft_write_command(dev, TFT_CMD_MADCTL, &madctl, 1);
+	tft_write_command(dev, TFT_CMD_INVON, NULL, 0);
+#else
+	uint8_t madctl = TFT_MADCTL_MV | TFT_MADCTL_BGR;
+	tft_write_command(dev, TFT_CMD_MADCTL, &madctl, 1);
+#endif
+	tft_write_command(dev, TFT_CMD_DISPON, NULL, 0);
+
+	tft_clear_screen(dev, false);
+	tft_flush(dev);
+	return ESP_OK;
+}
+
+void tft_deinit(TFT_t * dev)
+{
+	if (dev->_bus) {
+		i2s_lcd_wait_done(dev->_bus, portMAX_DELAY);
+		i2s_lcd_driver_deinit(dev->_bus);
+		dev->_bus = NULL;
+	}
+	for (int i = 0; i < 2; i++) {
+		heap_caps_free(dev->_band[i]);
+		dev->_band[i] = NULL;
+	}
+	heap_caps_free(dev->_frame);
+	dev->_frame = NULL;
+}
+
+void tft_set_colors(TFT_t * dev, uint16_t fg, uint16_t bg)
+{
+	dev->_fg = fg;
+	dev->_bg = bg;
+}
+
+// Open a partial update window, the next RAMWR data fills it
+void tft_set_window(TFT_t * dev, int x0, int y0, int x1, int y1)
+{
+	tft_write_window(dev, x0, y0, x1, y1, NULL, 0);
+}
+
+/*
+ * Render a region into the PSRAM frame. Bands are still rendered in internal RAM, which is much faster
+ * to write than PSRAM, and copied into the frame row by row.
+ */
+static void tft_render_frame(TFT_t * dev, int x, int y, int width, int height, int lines, tft_band_draw_t draw, void * ctx)
+{
+	// The frame may still be read by the previous flush
+	i2s_lcd_wait_done(dev->_bus, portMAX_DELAY);
+	uint16_t * band = dev->_band[0];
+	for (int row = 0; row < height; row += lines) {
+		int _lines = height - row < lines ? height - row : lines;
+		draw(band, x, y + row, width, _lines, ctx);
+		for (int j = 0; j < _lines; j++) {
+			memcpy(dev->_frame + (y + row + j) * dev->_width + x, band + j * width, width * sizeof(uint16_t));
+		}
+	}
+	if (y < dev->_dirtyY0) dev->_dirtyY0 = y;
+	if (y + height > dev->_dirtyY1) dev->_dirtyY1 = y + height;
+}
+
+/*
+ * Stream a region through the two band buffers. The region is cut into bands of as many full lines
+ * as fit into one buffer. A band is rendered while the previous one is still transferred by DMA,
+ * i2s_lcd_write_async only waits when the bus is busy with it. A region which fits into one band,
+ * e.g. a line of text, goes out together with its window commands.
+ */
+void tft_render_region(TFT_t * dev, int x, int y, int width, int height, tft_band_draw_t draw, void * ctx)
+{
+	if (width <= 0 || height <= 0) return;
+	int lines = dev->_bandLen / width;
+
+	if (dev->_frame) {
+		tft_render_frame(dev, x, y, width, height, lines, draw, ctx);
+		return;
+	}
+
+	if (height <= lines) {
+		uint16_t * band = dev->_band[dev->_bandIndex];
+		dev->_bandIndex ^= 1;
+		draw(band, x, y, width, height, ctx);
+		tft_write_window(dev, x, y, x + width - 1, y + height - 1, band, width * height);
+		return;
+	}
+
+	tft_set_window(dev, x, y, x + width - 1, y + height - 1);
+	for (int row = 0; row < height; row += lines) {
+		int _lines = height - row < lines ? height - row : lines;
+		uint16_t * band = dev->_band[dev->_bandIndex];
+		dev->_bandIndex ^= 1;
+		draw(band, x, y + row, width, _lines, ctx);
+		i2s_lcd_write_async(dev->_bus, (uint8_t *)band, width * _lines * sizeof(uint16_t), NULL, NULL);
+	}
+}
+
+static void tft_band_fill(uint16_t * band, int stride, int x, int y, int width, int height, uint16_t color)
+{
+	for (int j = 0; j < height; j++) {
+		uint16_t * out = band + (y + j) * stride + x;
+		for (int i = 0; i < width; i++) {
+			out[i] = color;
+		}
+	}
+}
+
+// Draw the part of a text widget between columns x0..x1 and rows y0..y1 of the panel
+static void tft_band_text(uint16_t * band, int stride, int bx, int by, const tft_widget_t * widget, int x0, int y0, int x1, int y1)
+{
+	int scale = widget->scale;
+	for (int py = y0; py < y1; py++) {
+		int gy = (py - widget->y) / scale;
+		uint16_t * out = band + (py - by) * stride + (x0 - bx);
+		int gx = (x0 - widget->x) / scale;
+		int sub = (x0 - widget->x) % scale;
+		for (int px = x0; px < x1; px++) {
+			// Transposed font, one byte per glyph column with the top row in bit 0
+			uint8_t bits = font8x8_basic_tr[(uint8_t)widget->text[gx >> 3] & 0x7F][gx & 7];
+			*out++ = ((bits >> gy) & 0x01) ? widget->fg : widget->bg;
+			if (++sub == scale) {
+				sub = 0;
+				gx++;
+			}
+		}
+	}
+}
+
+typedef struct {
+	uint16_t bg;
+	const tft_widget_t * widgets;
+	int count;
+} tft_widgets_ctx_t;
+
+static void tft_draw_widgets(uint16_t * band, int x, int y, int width, int height, void * ctx)
+{
+	tft_widgets_ctx_t * _ctx = ctx;
+	tft_band_fill(band, width, 0, 0, width, height, _ctx->bg);
+	for (int i = 0; i < _ctx->count; i++) {
+		const tft_widget_t * widget = &_ctx->widgets[i];
+		int w = widget->width;
+		int h = widget->height;
+		if (widget->type == TFT_WIDGET_TEXT) {
+			w = widget->text_len * 8 * widget->scale;
+			h = 8 * widget->scale;
+		}
+		// Clip the widget to the band
+		int x0 = widget->x > x ? widget->x : x;
+		int y0 = widget->y > y ? widget->y : y;
+		int x1 = widget->x + w < x + width ? widget->x + w : x + width;
+		int y1 = widget->y + h < y + height ? widget->y + h : y + height;
+		if (x0 >= x1 || y0 >= y1) continue;
+		if (widget->type == TFT_WIDGET_TEXT) {
+			tft_band_text(band, width, x, y, widget, x0, y0, x1, y1);
+		} else {
+			tft_band_fill(band, width, x0 - x, y0 - y, x1 - x0, y1 - y0, widget->fg);
+		}
+	}
+}
+
+// Render a list of widgets over a background, later widgets are drawn on top
+void tft_render_widgets(TFT_t * dev, int x, int y, int width, int height, uint16_t bg, const tft_widget_t * widgets, int count)
+{
+	tft_widgets_ctx_t ctx = {
+		.bg = bg,
+		.widgets = widgets,
+		.count = count,
+	};
+	tft_render_region(dev, x, y, width, height, tft_draw_widgets, &ctx);
+}
+
+void tft_fill_rect(TFT_t * dev, int x, int y, int width, int height, uint16_t color)
+{
+	tft_render_widgets(dev, x, y, width, height, color, NULL, 0);
+}
+
+void tft_display_text(TFT_t * dev, int line, char * text, int text_len, bool invert)
+{
+	if (line >= TFT_GRID_HEIGHT / 8) return;
+	int _text_len = text_len;
+	if (_text_len > TFT_GRID_COLUMNS) _text_len = TFT_GRID_COLUMNS;
+	if (_text_len <= 0) return;
+
+	tft_widget_t widget = {
+		.type = TFT_WIDGET_TEXT,
+		.x = dev->_originX,
+		.y = dev->_originY + line * 8 * dev->_scale,
+		.fg = invert ? dev->_bg : dev->_fg,
+		.bg = invert ? dev->_fg : dev->_bg,
+		.text = text,
+		.text_len = _text_len,
+		.scale = dev->_scale,
+	};
+	tft_render_widgets(dev, widget.x, widget.y, _text_len * 8 * dev->_scale, 8 * dev->_scale, widget.bg, &widget, 1);
+}
+
+void tft_clear_screen(TFT_t * dev, bool invert)
+{
+	tft_fill_rect(dev, 0, 0, dev->_width, dev->_height, invert ? dev->_fg : dev->_bg);
+}
+
+void tft_clear_line(TFT_t * dev, int line, bool invert)
+{
+	int height = 8 * dev->_scale;
+	tft_fill_rect(dev, dev->_originX, dev->_originY + line * height, TFT_GRID_WIDTH * dev->_scale, height, invert ? dev->_fg : dev->_bg);
+}
+
+void tft_contrast(TFT_t * dev, int contrast)
+{
+	uint8_t _contrast = contrast;
+	if (contrast < 0x0) _contrast = 0;
+	if (contrast > 0xFF) _contrast = 0xFF;
+	tft_write_command(dev, TFT_CMD_WRDISBV, &_contrast, 1);
+}
+
+/*
+ * Blank the panel or show it again. The panel RAM is kept, so the last frame comes back without a
+ * redraw.
+ */
+void tft_display_on(TFT_t * dev, bool on)
+{
+	tft_write_command(dev, on ? TFT_CMD_DISPON : TFT_CMD_DISPOFF, NULL, 0);
+}
+
+/*
+ * Send the rows of the PSRAM frame changed since the last flush, as one window of full panel lines.
+ * Without a frame, wait until everything drawn so far is on the panel.
+ */
+void tft_flush(TFT_t * dev)
+{
+	if (dev->_frame && dev->_dirtyY0 < dev->_dirtyY1) {
+		int y0 = dev->_dirtyY0;
+		int y1 = dev->_dirtyY1;
+		dev->_dirtyY0 = dev->_height;
+		dev->_dirtyY1 = 0;
+		tft_write_window(dev, 0, y0, dev->_width - 1, y1 - 1, dev->_frame + y0 * dev->_width, (y1 - y0) * dev->_width);
+	}
+	i2s_lcd_wait_done(dev->_bus, portMAX_DELAY);
+}
@@ -0,0 +1,101 @@
+#ifndef MAIN_TFT_H_
+#define MAIN_TFT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "i2s_lcd_driver.h"
+
+// MIPI DCS commands shared by ILI9341 and ST7789
+#define TFT_CMD_SWRESET     0x01
+#define TFT_CMD_SLPOUT      0x11
+#define TFT_CMD_INVON       0x21
+#define TFT_CMD_DISPOFF     0x28
+#define TFT_CMD_DISPON      0x29
+#define TFT_CMD_CASET       0x2A
+#define TFT_CMD_RASET       0x2B
+#define TFT_CMD_RAMWR       0x2C
+#define TFT_CMD_MADCTL      0x36
+#define TFT_CMD_COLMOD      0x3A
+#define TFT_CMD_WRDISBV     0x51
+
+#define TFT_MADCTL_MV       0x20    // Row/column exchange, landscape
+#define TFT_MADCTL_BGR      0x08
+#define TFT_COLMOD_RGB565   0x55
+
+// RGB565 colours
+#define TFT_BLACK           0x0000
+#define TFT_WHITE           0xFFFF
+#define TFT_RGB565(r, g, b) ((((r) & 0xF8) << 8) | (((g) & 0xFC) << 3) | ((b) >> 3))
+
+// The UI is laid out on the 128x64 text grid of the SSD1306, 16 columns by 8 lines of 8x8 glyphs
+#define TFT_GRID_WIDTH      128
+#define TFT_GRID_HEIGHT     64
+#define TFT_GRID_COLUMNS    16
+
+typedef struct {
+	i2s_lcd_handle_t _bus;
+	int _width;
+	int _height;
+	int _scale;			// Size of one grid pixel in panel pixels
+	int _originX;		// Top left corner of the grid on the panel
+	int _originY;
+	uint16_t _fg;
+	uint16_t _bg;
+	uint16_t * _band[2];	// Ping-pong band buffers, one is rendered while the other one is transferred
+	int _bandIndex;
+	size_t _bandLen;	// Size of one band buffer in pixels
+	uint16_t * _frame;	// Frame in PSRAM, NULL when bands go straight to the panel
+	int _dirtyY0;		// Rows of the frame not yet sent to the panel
+	int _dirtyY1;
+} TFT_t;
+
+typedef enum {
+	TFT_WIDGET_RECT = 0,
+	TFT_WIDGET_TEXT,
+} tft_widget_type_t;
+
+// UI element drawn by the band renderer, coordinates are in panel pixels
+typedef struct {
+	tft_widget_type_t type;
+	int x;
+	int y;
+	int width;			// Ignored for text, it follows from the text length
+	int height;			// Ignored for text
+	uint16_t fg;		// Fill colour of a rect
+	uint16_t bg;
+	const char * text;
+	int text_len;
+	int scale;			// Size of one glyph pixel in panel pixels
+} tft_widget_t;
+
+/**
+ * Renders one band of a region. The band holds width * height pixels, row by row, and covers the
+ * panel rectangle starting at x, y.
+ */
+typedef void (*tft_band_draw_t)(uint16_t * band, int x, int y, int width, int height, void * ctx);
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+esp_err_t tft_init(TFT_t * dev, const i2s_lcd_config_t * bus_config, int width, int height, int16_t reset);
+void tft_deinit(TFT_t * dev);
+void tft_set_colors(TFT_t * dev, uint16_t fg, uint16_t bg);
+void tft_set_window(TFT_t * dev, int x0, int y0, int x1, int y1);
+void tft_render_region(TFT_t * dev, int x, int y, int width, int height, tft_band_draw_t draw, void * ctx);
+void tft_render_widgets(TFT_t * dev, int x, int y, int width, int height, uint16_t bg, const tft_widget_t * widgets, int count);
+void tft_fill_rect(TFT_t * dev, int x, int y, int width, int height, uint16_t color);
+void tft_display_text(TFT_t * dev, int line, char * text, int text_len, bool invert);
+void tft_clear_screen(TFT_t * dev, bool invert);
+void tft_clear_line(TFT_t * dev, int line, bool invert);
+void tft_contrast(TFT_t * dev, int contrast);
+void tft_display_on(TFT_t * dev, bool on);
+void tft_flush(TFT_t * dev);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MAIN_TFT_H_ */
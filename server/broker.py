@@ -0,0 +1,168 @@
+import asyncio
+import argparse
+
+# Local stand-in for broker.hivemq.com, MQTT 3.1.1 with what the station and server.py use:
+# QoS 0 and 1, retained messages, '+' and '#' filters. No sessions are kept, no will, no auth.
+
+CONNECT = 1
+CONNACK = 2
+PUBLISH = 3
+PUBACK = 4
+SUBSCRIBE = 8
+SUBACK = 9
+UNSUBSCRIBE = 10
+UNSUBACK = 11
+PINGREQ = 12
+PINGRESP = 13
+DISCONNECT = 14
+
+
+def encode_length(length):
+    out = bytearray()
+    while True:
+        byte = length % 128
+        length //= 128
+        out.append(byte | 0x80 if length else byte)
+        if not length:
+            return bytes(out)
+
+
+def encode_str(text):
+    return len(text).to_bytes(2, "big") + text
+
+
+def packet(kind, flags, body):
+    return bytes([kind << 4 | flags]) + encode_length(len(body)) + body
+
+
+def matches(topic_filter, topic):
+    filter_levels = topic_filter.split(b"/")
+    topic_levels = topic.split(b"/")
+    for i, level in enumerate(filter_levels):
+        if level == b"#":
+            return True
+        if i >= len(topic_levels) or (level != b"+" and level != topic_levels[i]):
+            return False
+    return len(filter_levels) == len(topic_levels)
+
+
+class Client:
+    def __init__(self, writer):
+        self.writer = writer
+        self.subscriptions = {}
+        self.packet_id = 0
+
+    def publish(self, topic, payload, qos, retain):
+        body = encode_str(topic)
+        if qos:
+            self.packet_id = self.packet_id % 0xffff + 1
+            body += self.packet_id.to_bytes(2, "big")
+        self.writer.write(packet(PUBLISH, qos << 1 | retain, body + payload))
+
+
+class Broker:
+    def __init__(self, verbose):
+        self.clients = set()
+        self.retained = {}
+        self.verbose = verbose
+        self.messages = 0
+
+    def route(self, topic, payload, qos):
+        self.messages += 1
+        for client in self.clients:
+            granted = [q for f, q in client.subscriptions.items() if matches(f, topic)]
+            if granted:
+                client.publish(topic, payload, min(qos, max(granted)), 0)
+
+    async def read_packet(self, reader):
+        header = (await reader.readexactly(1))[0]
+        length, shift = 0, 0
+        while True:
+            byte = (await reader.readexactly(1))[0]
+            length |= (byte & 0x7f) << shift
+            shift += 7
+            if not byte & 0x80:
+                break
+        return header >> 4, header & 0x0f, await reader.readexactly(length)
+
+    async def handle(self, reader, writer):
+        client = Client(writer)
+        self.clients.add(client)
+        try:
+            while True:
+                kind, flags, body = await self.read_packet(reader)
+
+                if kind == CONNECT:
+                    writer.write(packet(CONNACK, 0, b"\x00\x00"))
+                elif kind == PUBLISH:
+                    qos = flags >> 1 & 0x03
+                    topic_len = int.from_bytes(body[:2], "big")
+                    topic = body[2:2 + topic_len]
+                    offset = 2 + topic_len
+                    if qos:
+                        writer.write(packet(PUBACK, 0, body[offset:offset + 2]))
+                        offset += 2
+                    payload = body[offset:]
+                    if flags & 0x01:
+                        if payload:
+                            self.retained[topic] = (payload, qos)
+                        else:
+                            self.retained.pop(topic, None)
+                    if self.verbose:
+                        print(f"{topic.decode()}: {payload[:60]!r}")
+                    self.route(topic, payload, qos)
+                elif kind == SUBSCRIBE:
+                    offset, granted = 2, bytearray()
+                    while offset < len(body):
+                        filter_len = int.from_bytes(body[offset:offset + 2], "big")
+                        topic_filter = body[offset + 2:offset + 2 + filter_len]
+                        qos = min(body[offset + 2 + filter_len], 1)
+                        offset += 3 + filter_len
+                        client.subscriptions[topic_filter] = qos
+                        granted.append(qos)
+                    writer.write(packet(SUBACK, 0, body[:2] + bytes(granted)))
+                    # Retained messages go out after the SUBACK, like a real broker
+                    for topic, (payload, retained_qos) in self.retained.items():
+                        for topic_filter, qos in client.subscriptions.items():
+                            if matches(topic_filter, topic):
+                                client.publish(topic, payload, min(qos, retained_qos), 1)
+                                break
+                elif kind == UNSUBSCRIBE:
+                    offset = 2
+                    while offset < len(body):
+                        filter_len = int.from_bytes(body[offset:offset + 2], "big")
+                        client.subscriptions.pop(body[offset + 2:offset + 2 + filter_len], None)
+                        offset += 2 + filter_len
+                    writer.write(packet(UNSUBACK, 0, body[:2]))
+                elif kind == PINGREQ:
+                    writer.write(packet(PINGRESP, 0, b""))
+                elif kind == DISCONNECT:
+                    break
+
+                await writer.drain()
+        except (asyncio.IncompleteReadError, ConnectionError):
+            pass
+        finally:
+            self.clients.discard(client)
+            writer.close()
+
+
+async def main():
+    parser = argparse.ArgumentParser(description="Local MQTT broker for the station and server.py")
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=1883)
+    parser.add_argument("--verbose", action="store_true", help="print every published message")
+    args = parser.parse_args()
+
+    broker = Broker(args.verbose)
+    server = await asyncio.start_server(broker.handle, args.host, args.port)
+    print(f"Broker listening on {args.host}:{args.port}", flush=True)
+    async with server:
+        await server.serve_forever()
+
+
+if __name__ == "__main__":
+    try:
+        asyncio.run(main())
+    except KeyboardInterrupt:
+        print("Exiting broker.")
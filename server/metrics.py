@@ -0,0 +1,194 @@
+import argparse
+import os
+import re
+import sys
+import time
+
+# Fleet view of the [METRICS] lines of the stations, see src/metrics.h for the format.
+# Reads them from the broker, or from log files or stdin with --file, and prints per period the
+# totals and rates of the counters, the spread of the gauges and the percentiles of the merged
+# histograms.
+
+PREFIX_METRICS = "[METRICS]"
+
+# Colours of the ESP-IDF log, the reset code ends every line of a serial log
+ANSI_COLOR = re.compile(r"\x1b\[[0-9;]*m")
+
+# Bucket i counts values below 2^(BUCKET_MIN_SHIFT + i) us, the last one everything above
+BUCKET_MIN_SHIFT = 7
+BUCKETS = 15
+
+PERCENTILES = (50, 90, 99)
+
+
+def parse(line):
+    line = ANSI_COLOR.sub("", line)
+    start = line.find(PREFIX_METRICS)
+    if start < 0:
+        return None
+
+    sample = {"counters": {}, "gauges": {}, "histograms": {}}
+    for field in line[start + len(PREFIX_METRICS):].split():
+        key, _, value = field.partition("=")
+        if key in ("id", "up"):
+            sample[key] = value if key == "id" else int(value)
+            continue
+
+        for item in filter(None, value.split(",")):
+            name, _, data = item.partition(":")
+            if key == "c":
+                sample["counters"][name] = int(data)
+            elif key == "g":
+                sample["gauges"][name] = int(data)
+            elif key == "h":
+                count, total, maximum, buckets = data.split("/")
+                sample["histograms"][name] = {
+                    "count": int(count),
+                    "sum": int(total),
+                    "max": int(maximum),
+                    "buckets": [int(b) for b in buckets.split(".")],
+                }
+
+    return sample if "id" in sample else None
+
+
+def bucket_bound(i):
+    return "inf" if i == BUCKETS - 1 else 2 ** (BUCKET_MIN_SHIFT + i)
+
+
+def percentile(buckets, p):
+    total = sum(buckets)
+    if total == 0:
+        return None
+    rank = p / 100 * total
+    seen = 0
+    for i, count in enumerate(buckets):
+        seen += count
+        if seen >= rank:
+            return i
+    return len(buckets) - 1
+
+
+class Fleet:
+    def __init__(self):
+        self.latest = {}
+        self.previous = {}
+
+    def add(self, sample):
+        station = sample["id"]
+        # A smaller uptime is a reboot, the counters start again from zero
+        if station in self.latest and sample.get("up", 0) >= self.latest[station].get("up", 0):
+            self.previous[station] = self.latest[station]
+        else:
+            self.previous.pop(station, None)
+        self.latest[station] = sample
+
+    def report(self):
+        if not self.latest:
+            print("No metrics yet")
+            return
+
+        print(f"--- {len(self.latest)} stations ---")
+
+        counters = {}
+        rates = {}
+        for station, sample in self.latest.items():
+            previous = self.previous.get(station)
+            for name, value in sample["counters"].items():
+                counters[name] = counters.get(name, 0) + value
+                if previous and name in previous["counters"] and sample["up"] > previous["up"]:
+                    delta = value - previous["counters"][name]
+                    rates[name] = rates.get(name, 0) + delta / (sample["up"] - previous["up"])
+        for name, value in counters.items():
+            rate = f"  {rates[name]:.2f}/s" if name in rates else ""
+            print(f"{name:20} {value:>12}{rate}")
+
+        gauges = {}
+        for sample in self.latest.values():
+            for name, value in sample["gauges"].items():
+                gauges.setdefault(name, []).append(value)
+        for name, values in gauges.items():
+            print(f"{name:20} min={min(values)} avg={sum(values) // len(values)} max={max(values)}")
+
+        histograms = {}
+        for sample in self.latest.values():
+            for name, data in sample["histograms"].items():
+                merged = histograms.setdefault(name, {"count": 0, "sum": 0, "max": 0, "buckets": []})
+                merged["count"] += data["count"]
+                merged["sum"] += data["sum"]
+                merged["max"] = max(merged["max"], data["max"])
+                buckets = merged["buckets"]
+                buckets.extend([0] * (len(data["buckets"]) - len(buckets)))
+                for i, count in enumerate(data["buckets"]):
+                    buckets[i] += count
+        for name, data in histograms.items():
+            if data["count"] == 0:
+                print(f"{name:20} no values")
+                continue
+            # Percentiles are the upper bound of their bucket
+            text = " ".join(f"p{p}<{bucket_bound(percentile(data['buckets'], p))}" for p in PERCENTILES)
+            print(f"{name:20} n={data['count']} avg={data['sum'] // data['count']} max={data['max']} {text}")
+
+        # Where the time from a gesture to the panel goes, the stages of src/latency.h by their share
+        motion = histograms.get("motion_us")
+        stages = {name: data for name, data in histograms.items() if name.startswith("stage_") and data["count"]}
+        if motion and motion["count"] and stages:
+            total = motion["sum"] / motion["count"]
+            print("gesture stages by share of motion_us:")
+            for name, data in sorted(stages.items(), key=lambda item: -item[1]["sum"] / item[1]["count"]):
+                avg = data["sum"] / data["count"]
+                print(f"  {name[len('stage_'):-len('_us')]:18} avg={avg:.0f} {100 * avg / total:5.1f}%")
+
+
+def from_files(paths):
+    fleet = Fleet()
+    for path in paths:
+        with (sys.stdin if path == "-" else open(path, errors="replace")) as lines:
+            for line in lines:
+                sample = parse(line)
+                if sample:
+                    fleet.add(sample)
+    fleet.report()
+
+
+def from_broker(broker, topic, period):
+    import paho.mqtt.client as mqtt
+
+    fleet = Fleet()
+
+    def on_connect(client, userdata, flags, rc):
+        print(f"Connected with result code {rc}")
+        client.subscribe(topic)
+
+    def on_message(client, userdata, msg):
+        sample = parse(msg.payload.decode(errors="replace"))
+        if sample:
+            fleet.add(sample)
+
+    client = mqtt.Client()
+    client.on_connect = on_connect
+    client.on_message = on_message
+    client.connect(broker, 1883, 60)
+    client.loop_start()
+
+    try:
+        while True:
+            time.sleep(period)
+            fleet.report()
+    except KeyboardInterrupt:
+        print("Exiting loop.")
+    client.loop_stop()
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Aggregate the metrics of all stations")
+    parser.add_argument("--broker", default=os.environ.get("MQTT_BROKER", "broker.hivemq.com"))
+    parser.add_argument("--topic", default="test/metrics")
+    parser.add_argument("--period", type=int, default=60, help="seconds between reports")
+    parser.add_argument("--file", nargs="+", help="read serial logs instead, - for stdin")
+    args = parser.parse_args()
+
+    if args.file:
+        from_files(args.file)
+    else:
+        from_broker(args.broker, args.topic, args.period)
@@ -0,0 +1,143 @@
+import argparse
+import os
+import re
+import shutil
+import subprocess
+import sys
+
+# Symbolizer of the [PROF] lines of the sampling profiler, see src/profiler.h for the format.
+# Reads serial logs from files or stdin, resolves the addresses against the ELF of the firmware with
+# addr2line and writes folded stacks (task;caller;function count), the input of flamegraph.pl.
+# With --svg it runs flamegraph.pl itself, and it always prints the functions with the most samples.
+
+PREFIX_PROFILER = "[PROF]"
+
+# Colours of the ESP-IDF log, the reset code ends every line of a serial log
+ANSI_COLOR = re.compile(r"\x1b\[[0-9;]*m")
+
+ADDR2LINE = "xtensa-esp32-elf-addr2line"
+
+
+def parse(lines):
+    """Returns the task names and the sample counts of all captures in the log, merged."""
+    names = {}
+    counts = {}
+    captures = 0
+    lost = 0
+
+    for line in lines:
+        line = ANSI_COLOR.sub("", line)
+        start = line.find(PREFIX_PROFILER)
+        if start < 0:
+            continue
+
+        fields = line[start + len(PREFIX_PROFILER):].split()
+        if not fields:
+            continue
+        if fields[0] == "begin":
+            captures += 1
+            for field in fields[1:]:
+                key, _, value = field.partition("=")
+                if key == "lost":
+                    lost += int(value)
+        elif fields[0] == "task" and len(fields) >= 3:
+            names[fields[1]] = fields[2]
+        elif len(fields) == 4:
+            task, pc, caller, count = fields
+            key = (task, int(pc, 16), int(caller, 16))
+            counts[key] = counts.get(key, 0) + int(count)
+
+    return names, counts, captures, lost
+
+
+def symbolize(elf, addr2line, addresses):
+    """Maps every address to its function name, the hex address where it is unknown."""
+    symbols = {address: f"0x{address:08x}" for address in addresses}
+    if not elf or not addresses:
+        return symbols
+
+    ordered = sorted(addresses)
+    result = subprocess.run(
+        [addr2line, "-f", "-C", "-e", elf] + [f"0x{address:08x}" for address in ordered],
+        capture_output=True, text=True, check=True)
+
+    # Two lines per address, the function and the file:line
+    lines = result.stdout.splitlines()
+    for i, address in enumerate(ordered):
+        function = lines[2 * i] if 2 * i < len(lines) else "??"
+        if function != "??":
+            symbols[address] = function
+
+    return symbols
+
+
+def fold(names, counts, symbols):
+    """Folded stacks, the caller is left out where it does not resolve to a function."""
+    stacks = {}
+    for (task, pc, caller), count in counts.items():
+        frames = [names.get(task, task)]
+        # a0 holds no return address yet in the first instructions of a function, or one of a leaf
+        if not symbols[caller].startswith("0x") or symbols[pc].startswith("0x"):
+            frames.append(symbols[caller])
+        frames.append(symbols[pc])
+        stack = ";".join(frame.replace(";", ":") for frame in frames)
+        stacks[stack] = stacks.get(stack, 0) + count
+
+    return stacks
+
+
+def report(names, counts, symbols, top):
+    total = sum(counts.values())
+    functions = {}
+    tasks = {}
+    for (task, pc, caller), count in counts.items():
+        functions[symbols[pc]] = functions.get(symbols[pc], 0) + count
+        tasks[names.get(task, task)] = tasks.get(names.get(task, task), 0) + count
+
+    print(f"{total} samples", file=sys.stderr)
+    for name, count in sorted(tasks.items(), key=lambda item: -item[1]):
+        print(f"  {name:24} {count:>8} {100 * count / total:6.1f}%", file=sys.stderr)
+    print(f"Top {top} functions:", file=sys.stderr)
+    for name, count in sorted(functions.items(), key=lambda item: -item[1])[:top]:
+        print(f"  {name:48} {count:>8} {100 * count / total:6.1f}%", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Turn the profiler dumps of a serial log into folded stacks")
+    parser.add_argument("--elf", help="ELF of the firmware, addresses stay hex without it")
+    parser.add_argument("--addr2line", default=os.environ.get("ADDR2LINE", ADDR2LINE))
+    parser.add_argument("--file", nargs="+", default=["-"], help="serial logs, - for stdin")
+    parser.add_argument("--output", help="folded stacks file, stdout by default")
+    parser.add_argument("--svg", help="also render a flame graph with flamegraph.pl")
+    parser.add_argument("--top", type=int, default=20, help="functions in the summary")
+    args = parser.parse_args()
+
+    lines = []
+    for path in args.file:
+        with (sys.stdin if path == "-" else open(path, errors="replace")) as f:
+            lines.extend(f)
+
+    names, counts, captures, lost = parse(lines)
+    if not counts:
+        sys.exit("No profiler samples in the input")
+    print(f"{captures} captures, {lost} samples lost", file=sys.stderr)
+
+    addresses = {pc for _, pc, _ in counts} | {caller for _, _, caller in counts}
+    symbols = symbolize(args.elf, args.addr2line, addresses)
+    stacks = fold(names, counts, symbols)
+    folded = "".join(f"{stack} {count}\n" for stack, count in sorted(stacks.items()))
+
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(folded)
+    elif not args.svg:
+        sys.stdout.write(folded)
+
+    if args.svg:
+        tool = shutil.which("flamegraph.pl")
+        if tool is None:
+            sys.exit("flamegraph.pl is not in PATH, see https://github.com/brendangregg/FlameGraph")
+        with open(args.svg, "w") as f:
+            subprocess.run([tool, "--title", "station cpu profile"], input=folded, stdout=f, text=True, check=True)
+
+    report(names, counts, symbols, args.top)
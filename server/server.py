@@ -1,4 +1,5 @@
 import paho.mqtt.client as mqtt
+import os
 import time
 
 DATA = {
@@ -18,6 +19,9 @@ DATA = {
         "visibility": "99.7 %"
     }
 }
+# Public broker by default, MQTT_BROKER=127.0.0.1 for the local one in broker.py
+BROKER = os.environ.get("MQTT_BROKER", "broker.hivemq.com")
+
 PREFIX_DATA = "[DATA]"
 PREFIX_CITIES = "[CITIES]"
 PREFIX_CITY = "[CITY]"
@@ -25,6 +29,10 @@ PREFIX_CITY = "[CITY]"
 CITY = list(DATA.keys())[0]
 
 
+def publish_data(client):
+    # Retained, so a station waking from deep sleep gets the data right after it subscribes
+    client.publish("test", f"{PREFIX_DATA} {','.join(list(DATA[CITY].values()))}\n", retain=True)
+
 def on_connect(client, userdata, flags, rc):
     print(f"Connected with result code {rc}")
     client.subscribe("test")
@@ -35,7 +43,9 @@ def on_message(client, userdata, msg):
     if PREFIX_CITY in message:
         _, city = message.split(" ")
         if city in DATA.keys():
-            CITY = city
+            if city != CITY:
+                CITY = city
+                publish_data(client)
         else:
             print(f"City {city} is not in {DATA.keys()}")
 
@@ -43,7 +53,7 @@ client = mqtt.Client()
 client.on_connect = on_connect
 client.on_message = on_message
 
-client.connect("broker.hivemq.com", 1883, 60)
+client.connect(BROKER, 1883, 60)
 
 client.loop_start() 
 
@@ -53,7 +63,7 @@ while not client.is_connected():
 try:
     while True:
         time.sleep(5)
-        client.publish("test", f"{PREFIX_DATA} {','.join(list(DATA[CITY].values()))}\n")
+        publish_data(client)
         client.publish("test", f"{PREFIX_CITIES} {','.join(list(DATA.keys()))}\n")
 except KeyboardInterrupt:
     print("Exiting loop.")
@@ -0,0 +1,301 @@
+import argparse
+import json
+import re
+import struct
+import sys
+
+# Converter of the [TRACE] dumps of the scheduling trace, see src/trace.h for the format.
+# Reads serial logs from files or stdin and writes Chrome trace JSON, which Perfetto
+# (ui.perfetto.dev) and chrome://tracing open:
+#   - one track per core with the running tasks, the interrupts and arrows from a send or give
+#     to the receive it woke up,
+#   - one track per task with the time it was blocked on a queue, semaphore or mutex and the
+#     priority inheritance it got,
+#   - one track per mutex with the task that held it.
+# It also prints the longest waits, who held the mutex meanwhile and what ran on its core instead.
+
+PREFIX_TRACE = "[TRACE]"
+
+# Colours of the ESP-IDF log, the reset code ends every line of a serial log
+ANSI_COLOR = re.compile(r"\x1b\[[0-9;]*m")
+
+# Event types of src/trace_hooks.h
+TASK_SWITCH = 1
+QUEUE_SEND = 2
+QUEUE_SEND_BLOCK = 3
+QUEUE_SEND_FAILED = 4
+QUEUE_RECEIVE = 5
+QUEUE_RECEIVE_BLOCK = 6
+QUEUE_RECEIVE_FAILED = 7
+QUEUE_SEND_ISR = 8
+QUEUE_RECEIVE_ISR = 9
+PRIORITY_INHERIT = 10
+PRIORITY_DISINHERIT = 11
+ISR_ENTER = 12
+ISR_EXIT = 13
+
+# ucQueueType of FreeRTOS
+QUEUE_TYPES = {0: "queue", 1: "mutex", 2: "counting semaphore", 3: "binary semaphore", 4: "recursive mutex"}
+MUTEXES = (1, 4)
+
+RECORD = struct.Struct("<IIBBH")
+
+PID_CORES = 1
+PID_TASKS = 2
+PID_OBJECTS = 3
+
+
+def parse(lines):
+    """Returns the dumps in the log, each with its tasks, object names and records per core."""
+    dumps = []
+    dump = None
+
+    for line in lines:
+        line = ANSI_COLOR.sub("", line)
+        start = line.find(PREFIX_TRACE)
+        if start < 0:
+            continue
+
+        fields = line[start + len(PREFIX_TRACE):].split()
+        if not fields:
+            continue
+        if fields[0] == "begin":
+            values = dict(field.partition("=")[::2] for field in fields[1:])
+            dump = {"now": int(values.get("now", 0)), "overwritten": int(values.get("overwritten", 0)),
+                    "tasks": {}, "objects": {}, "cores": {}}
+        elif dump is None:
+            continue
+        elif fields[0] == "task" and len(fields) >= 4:
+            dump["tasks"][int(fields[1], 16)] = (int(fields[2]), " ".join(fields[3:]))
+        elif fields[0] == "object" and len(fields) >= 3:
+            dump["objects"][int(fields[1], 16)] = " ".join(fields[2:])
+        elif fields[0] == "core" and len(fields) == 3:
+            dump["cores"].setdefault(int(fields[1]), bytearray()).extend(bytes.fromhex(fields[2]))
+        elif fields[0] == "end":
+            dumps.append(dump)
+            dump = None
+
+    return dumps
+
+
+def decode(dump):
+    """Records of all cores as (time, core, type, object, arg), oldest first, times in us before the dump."""
+    now = dump["now"]
+    events = []
+
+    for core, data in dump["cores"].items():
+        for i, (time, obj, kind, arg, _) in enumerate(RECORD.iter_unpack(bytes(data[:len(data) // 12 * 12]))):
+            # The records keep 32 bits of the time, they are all older than the dump
+            events.append((now - ((now - time) & 0xffffffff), core, i, kind, obj, arg))
+
+    events.sort()
+    start = events[0][0] if events else 0
+    return [(time - start, core, kind, obj, arg) for time, core, _, kind, obj, arg in events]
+
+
+class Timeline:
+    def __init__(self, dump):
+        self.tasks = dump["tasks"]
+        self.objects = dump["objects"]
+        self.out = []
+        self.tids = {}
+        self.running = {}       # core -> (task, since)
+        self.isrs = {}          # core -> [(number, since)]
+        self.waits = {}         # task -> (object, kind, since, holder)
+        self.holders = {}       # mutex -> (task, since)
+        self.flows = {}         # object -> flow id of the last send to a waiter
+        self.runs = []          # (task, core, start, end)
+        self.waited = []        # (task, object, start, end, timed out, holder)
+        self.types = {}
+        self.next_flow = 1
+
+    def task_name(self, task):
+        return self.tasks.get(task, (None, f"0x{task:08x}"))[1]
+
+    def priority(self, task):
+        return self.tasks.get(task, (None, None))[0]
+
+    def object_name(self, obj):
+        if obj in self.objects:
+            return self.objects[obj]
+        return f"{QUEUE_TYPES.get(self.types.get(obj), 'queue')} 0x{obj:08x}"
+
+    def tid(self, pid, key, name):
+        if (pid, key) not in self.tids:
+            self.tids[(pid, key)] = len(self.tids) + 1
+            self.out.append({"ph": "M", "name": "thread_name", "pid": pid, "tid": self.tids[(pid, key)],
+                             "args": {"name": name}})
+        return self.tids[(pid, key)]
+
+    def core_tid(self, core):
+        return self.tid(PID_CORES, core, f"core {core}")
+
+    def task_tid(self, task):
+        return self.tid(PID_TASKS, task, self.task_name(task))
+
+    def object_tid(self, obj):
+        return self.tid(PID_OBJECTS, obj, self.object_name(obj))
+
+    def slice(self, pid, tid, name, start, end, args=None):
+        event = {"ph": "X", "name": name, "pid": pid, "tid": tid, "ts": start, "dur": max(end - start, 0)}
+        if args:
+            event["args"] = args
+        self.out.append(event)
+
+    def actor(self, core, kind):
+        if kind in (QUEUE_SEND_ISR, QUEUE_RECEIVE_ISR) or self.isrs.get(core):
+            return None
+        return self.running.get(core, (None, 0))[0]
+
+    def switch(self, time, core, task):
+        if core in self.running:
+            previous, since = self.running[core]
+            self.slice(PID_CORES, self.core_tid(core), self.task_name(previous), since, time,
+                       {"priority": self.priority(previous)})
+            self.runs.append((previous, core, since, time))
+        self.running[core] = (task, time)
+
+    def block(self, time, task, obj, kind):
+        if task is None or task in self.waits:
+            return
+        holder = self.holders.get(obj, (None, 0))[0]
+        self.waits[task] = (obj, kind, time, holder)
+
+    def unblock(self, time, core, task, obj, failed):
+        if task is None or task not in self.waits or self.waits[task][0] != obj:
+            return
+        _, kind, since, holder = self.waits.pop(task)
+        action = "send to" if kind == QUEUE_SEND_BLOCK else "receive from"
+        name = f"{'timeout' if failed else 'blocked'} on {action} {self.object_name(obj)}"
+        self.slice(PID_TASKS, self.task_tid(task), name, since, time,
+                   {"holder": self.task_name(holder)} if holder is not None else None)
+        self.waited.append((task, obj, since, time, failed, holder))
+
+        flow = self.flows.pop(obj, None)
+        if flow is not None and not failed:
+            self.out.append({"ph": "f", "bp": "e", "name": "wake", "cat": "wake", "id": flow,
+                             "pid": PID_CORES, "tid": self.core_tid(core), "ts": time})
+
+    def wake(self, time, core, obj):
+        if not any(wait[0] == obj for wait in self.waits.values()):
+            return
+        self.flows[obj] = self.next_flow
+        self.out.append({"ph": "s", "name": "wake", "cat": "wake", "id": self.next_flow,
+                         "pid": PID_CORES, "tid": self.core_tid(core), "ts": time})
+        self.next_flow += 1
+
+    def event(self, time, core, kind, obj, arg):
+        if kind == TASK_SWITCH:
+            self.switch(time, core, obj)
+            return
+        if kind == ISR_ENTER:
+            self.isrs.setdefault(core, []).append((arg, time))
+            return
+        if kind == ISR_EXIT:
+            if self.isrs.get(core):
+                number, since = self.isrs[core].pop()
+                self.slice(PID_CORES, self.core_tid(core), f"isr {number}", since, time)
+            return
+        if kind in (PRIORITY_INHERIT, PRIORITY_DISINHERIT):
+            name = "inherits" if kind == PRIORITY_INHERIT else "back to"
+            self.out.append({"ph": "i", "s": "t", "name": f"{name} priority {arg}", "pid": PID_TASKS,
+                             "tid": self.task_tid(obj), "ts": time})
+            return
+
+        self.types[obj] = arg
+        task = self.actor(core, kind)
+        if kind in (QUEUE_SEND_BLOCK, QUEUE_RECEIVE_BLOCK):
+            self.block(time, task, obj, kind)
+        elif kind in (QUEUE_SEND_FAILED, QUEUE_RECEIVE_FAILED):
+            self.unblock(time, core, task, obj, True)
+        elif kind in (QUEUE_RECEIVE, QUEUE_RECEIVE_ISR):
+            self.unblock(time, core, task, obj, False)
+            if arg in MUTEXES and task is not None:
+                self.holders[obj] = (task, time)
+        elif kind in (QUEUE_SEND, QUEUE_SEND_ISR):
+            self.unblock(time, core, task, obj, False)
+            holder = self.holders.get(obj)
+            if arg in MUTEXES and holder is not None and holder[0] == task:
+                self.slice(PID_OBJECTS, self.object_tid(obj), f"held by {self.task_name(task)}", holder[1], time)
+                del self.holders[obj]
+            self.wake(time, core, obj)
+
+    def finish(self, end):
+        for core in list(self.running):
+            self.switch(end, core, None)
+        for obj, (task, since) in self.holders.items():
+            self.slice(PID_OBJECTS, self.object_tid(obj), f"held by {self.task_name(task)}", since, end)
+        self.out.append({"ph": "M", "name": "process_name", "pid": PID_CORES, "args": {"name": "cores"}})
+        self.out.append({"ph": "M", "name": "process_name", "pid": PID_TASKS, "args": {"name": "tasks"}})
+        self.out.append({"ph": "M", "name": "process_name", "pid": PID_OBJECTS, "args": {"name": "mutexes"}})
+
+
+def report(timeline, top):
+    """Prints the longest waits, with the holder of the mutex and what ran on its core meanwhile."""
+    waits = sorted(timeline.waited, key=lambda wait: wait[2] - wait[3])[:top]
+    print(f"Longest {len(waits)} waits:", file=sys.stderr)
+
+    for task, obj, start, end, failed, holder in waits:
+        line = (f"  {(end - start) / 1000:8.3f} ms {timeline.task_name(task)} (priority {timeline.priority(task)}) "
+                f"{'timed out' if failed else 'waited'} on {timeline.object_name(obj)}")
+        print(line, file=sys.stderr)
+        if holder is None:
+            continue
+
+        # The holder's core is the one it ran on last before the wait
+        cores = [run[1] for run in timeline.runs if run[0] == holder and run[2] <= start]
+        ran = sum(min(run[3], end) - max(run[2], start) for run in timeline.runs
+                  if run[0] == holder and run[2] < end and run[3] > start)
+        print(f"      held by {timeline.task_name(holder)} (priority {timeline.priority(holder)}), "
+              f"ran {ran / 1000:.3f} ms of it", file=sys.stderr)
+        if not cores:
+            continue
+
+        others = {}
+        for other, core, run_start, run_end in timeline.runs:
+            if core == cores[-1] and other not in (holder, None) and run_start < end and run_end > start:
+                others[other] = others.get(other, 0) + min(run_end, end) - max(run_start, start)
+        for other, us in sorted(others.items(), key=lambda item: -item[1])[:3]:
+            priority = timeline.priority(other)
+            waiter = timeline.priority(task)
+            inversion = priority is not None and waiter is not None and priority < waiter \
+                and not timeline.task_name(other).startswith("IDLE")
+            print(f"      core {cores[-1]} ran {timeline.task_name(other)} (priority {priority}) {us / 1000:.3f} ms"
+                  f"{', priority inversion' if inversion else ''}", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Turn the scheduling trace of a serial log into Chrome trace JSON")
+    parser.add_argument("--file", nargs="+", default=["-"], help="serial logs, - for stdin")
+    parser.add_argument("--dump", type=int, default=-1, help="dump to convert, the last one by default")
+    parser.add_argument("--output", help="JSON file, stdout by default")
+    parser.add_argument("--top", type=int, default=10, help="waits in the summary")
+    args = parser.parse_args()
+
+    lines = []
+    for path in args.file:
+        with (sys.stdin if path == "-" else open(path, errors="replace")) as f:
+            lines.extend(f)
+
+    dumps = parse(lines)
+    if not dumps:
+        sys.exit("No complete trace dump in the input")
+    dump = dumps[args.dump]
+
+    events = decode(dump)
+    timeline = Timeline(dump)
+    for event in events:
+        timeline.event(*event)
+    timeline.finish(events[-1][0] if events else 0)
+
+    print(f"{len(dumps)} dumps, {len(events)} events over {(events[-1][0] if events else 0) / 1000:.3f} ms, "
+          f"{dump['overwritten']} overwritten", file=sys.stderr)
+
+    trace = {"traceEvents": timeline.out, "displayTimeUnit": "ms"}
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(trace, f)
+    else:
+        json.dump(trace, sys.stdout)
+
+    report(timeline, args.top)
@@ -0,0 +1,188 @@
+/**
+ * @file apds9960_model.c
+ * @brief APDS9960 gesture sensor of the simulator on the I2C bus, see sim.h.
+ *
+ * The registers are a plain memory the driver writes and reads back, apart from the gesture
+ * engine. A queued gesture is played as two FIFO datasets, the hand entering on one side and
+ * leaving on the other, which is the sequence apds9960_read_gesture() classifies. GSTATUS reports
+ * valid data and GFLVL one dataset while any of them is left.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#include <pthread.h>
+
+#include "apds9960.h"
+
+#include "sim.h"
+
+// Queued FIFO datasets, two per gesture
+#define APDS9960_MAX_PHASES 32
+
+// Reflection of the hand on a photodiode, with the difference the driver needs on an axis
+#define APDS9960_LEVEL 100
+#define APDS9960_SWING 40
+
+// Registers of the gesture engine
+#define APDS9960_REG_GFLVL 0xAE
+#define APDS9960_REG_GSTATUS 0xAF
+#define APDS9960_REG_GFIFO_U 0xFC
+#define APDS9960_REG_GFIFO_R 0xFF
+
+typedef struct {
+    uint8_t up;
+    uint8_t down;
+    uint8_t left;
+    uint8_t right;
+} apds9960_phase_t;
+
+typedef struct {
+    sim_i2c_device_t dev;
+    pthread_mutex_t lock;
+
+    uint8_t regs[256];
+    uint8_t pointer;
+    bool pointer_next;      // The next written byte is the register address
+
+    apds9960_phase_t phases[APDS9960_MAX_PHASES];
+    int phase_head;
+    int phase_count;
+} apds9960_model_t;
+
+static apds9960_model_t apds9960_model;
+
+/**
+ * @brief Queues one FIFO dataset.
+ */
+static void apds9960_push(apds9960_model_t* model, apds9960_phase_t phase) {
+    if (model->phase_count < APDS9960_MAX_PHASES) {
+        model->phases[(model->phase_head + model->phase_count) % APDS9960_MAX_PHASES] = phase;
+        model->phase_count++;
+    }
+}
+
+static void apds9960_start(sim_i2c_device_t* dev, bool read) {
+    apds9960_model_t* model = (apds9960_model_t*)dev;
+
+    pthread_mutex_lock(&model->lock);
+    model->pointer_next = !read;
+    pthread_mutex_unlock(&model->lock);
+}
+
+static void apds9960_write(sim_i2c_device_t* dev, uint8_t byte) {
+    apds9960_model_t* model = (apds9960_model_t*)dev;
+
+    pthread_mutex_lock(&model->lock);
+    if (model->pointer_next) {
+        model->pointer = byte;
+        model->pointer_next = false;
+    }
+    else {
+        model->regs[model->pointer++] = byte;
+    }
+    pthread_mutex_unlock(&model->lock);
+}
+
+static uint8_t apds9960_read(sim_i2c_device_t* dev) {
+    apds9960_model_t* model = (apds9960_model_t*)dev;
+    uint8_t value;
+
+    pthread_mutex_lock(&model->lock);
+    apds9960_phase_t* phase = &model->phases[model->phase_head];
+    switch (model->pointer) {
+    case APDS9960_WHO_AM_I_REG:
+        value = APDS9960_WHO_AM_I_VAL;
+        break;
+    case APDS9960_REG_GSTATUS:
+        value = model->phase_count > 0 ? 0x01 : 0x00;
+        break;
+    case APDS9960_REG_GFLVL:
+        // The driver reads GFLVL bytes from the FIFO, one dataset of four
+        value = model->phase_count > 0 ? 4 : 0;
+        break;
+    case APDS9960_REG_GFIFO_U:
+        value = model->phase_count > 0 ? phase->up : 0;
+        break;
+    case APDS9960_REG_GFIFO_U + 1:
+        value = model->phase_count > 0 ? phase->down : 0;
+        break;
+    case APDS9960_REG_GFIFO_U + 2:
+        value = model->phase_count > 0 ? phase->left : 0;
+        break;
+    case APDS9960_REG_GFIFO_R:
+        value = model->phase_count > 0 ? phase->right : 0;
+        // The dataset is consumed with its last byte
+        if (model->phase_count > 0) {
+            model->phase_head = (model->phase_head + 1) % APDS9960_MAX_PHASES;
+            model->phase_count--;
+        }
+        break;
+    default:
+        value = model->regs[model->pointer];
+        break;
+    }
+
+    // Reads inside the FIFO stay in it
+    model->pointer = model->pointer == APDS9960_REG_GFIFO_R ? APDS9960_REG_GFIFO_U : model->pointer + 1;
+    pthread_mutex_unlock(&model->lock);
+
+    return value;
+}
+
+static void apds9960_stop(sim_i2c_device_t* dev) {
+}
+
+void sim_apds9960_init() {
+    apds9960_model = (apds9960_model_t) {
+        .dev = {
+            .address = APDS9960_I2C_ADDRESS,
+            .start = apds9960_start,
+            .write = apds9960_write,
+            .read = apds9960_read,
+            .stop = apds9960_stop,
+        },
+        .lock = PTHREAD_MUTEX_INITIALIZER,
+    };
+
+    sim_i2c_attach(&apds9960_model.dev);
+}
+
+void sim_apds9960_gesture(uint8_t gesture) {
+    // The hand covers the first photodiode of the axis, then the opposite one
+    apds9960_phase_t first = { APDS9960_LEVEL, APDS9960_LEVEL, APDS9960_LEVEL, APDS9960_LEVEL };
+    apds9960_phase_t second = first;
+
+    switch (gesture) {
+    case APDS9960_UP:
+        first.up += APDS9960_SWING;
+        second.down += APDS9960_SWING;
+        break;
+    case APDS9960_DOWN:
+        first.down += APDS9960_SWING;
+        second.up += APDS9960_SWING;
+        break;
+    case APDS9960_LEFT:
+        first.left += APDS9960_SWING;
+        second.right += APDS9960_SWING;
+        break;
+    case APDS9960_RIGHT:
+        first.right += APDS9960_SWING;
+        second.left += APDS9960_SWING;
+        break;
+    default:
+        return;
+    }
+
+    pthread_mutex_lock(&apds9960_model.lock);
+    apds9960_push(&apds9960_model, first);
+    apds9960_push(&apds9960_model, second);
+    pthread_mutex_unlock(&apds9960_model.lock);
+}
+
+int sim_apds9960_pending() {
+    pthread_mutex_lock(&apds9960_model.lock);
+    int pending = (apds9960_model.phase_count + 1) / 2;
+    pthread_mutex_unlock(&apds9960_model.lock);
+
+    return pending;
+}
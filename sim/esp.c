@@ -0,0 +1,450 @@
+/**
+ * @file esp.c
+ * @brief ESP-IDF system services of the simulator: logging, esp_timer, NVS, GPIO and the chip info.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "esp_err.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_random.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "driver/gpio.h"
+#include "nvs_flash.h"
+
+#include "sim.h"
+
+// Internal heap of an ESP32 running the firmware, reported by the heap gauges
+#define SIM_HEAP_FREE (160 * 1024)
+
+// Entries of the in-memory NVS
+#define SIM_NVS_ENTRIES 16
+#define SIM_NVS_KEY_LEN 16
+#define SIM_NVS_BLOB_LEN 64
+
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void* arg;
+    const char* name;
+    int64_t alarm;      // sim_time_us() of the next call, -1 when stopped
+    uint64_t period;    // 0 for a one-shot timer
+    struct esp_timer* next;
+};
+
+typedef struct {
+    bool used;
+    char name[SIM_NVS_KEY_LEN];
+    char key[SIM_NVS_KEY_LEN];
+    size_t length;
+    uint8_t value[SIM_NVS_BLOB_LEN];
+} sim_nvs_entry_t;
+
+static esp_log_level_t sim_log_level = ESP_LOG_VERBOSE;
+static pthread_mutex_t sim_log_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static struct esp_timer* sim_timers = NULL;
+static pthread_mutex_t sim_timer_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sim_timer_changed;
+static pthread_t sim_timer_thread;
+static bool sim_timer_started = false;
+
+static sim_nvs_entry_t sim_nvs[SIM_NVS_ENTRIES];
+static char sim_nvs_names[SIM_NVS_ENTRIES][SIM_NVS_KEY_LEN];
+static pthread_mutex_t sim_nvs_lock = PTHREAD_MUTEX_INITIALIZER;
+
+const char* esp_err_to_name(esp_err_t code) {
+    switch (code) {
+    case ESP_OK:
+        return "ESP_OK";
+    case ESP_FAIL:
+        return "ESP_FAIL";
+    case ESP_ERR_NO_MEM:
+        return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:
+        return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE:
+        return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE:
+        return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND:
+        return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED:
+        return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT:
+        return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_NVS_NOT_FOUND:
+        return "ESP_ERR_NVS_NOT_FOUND";
+    default:
+        return "UNKNOWN ERROR";
+    }
+}
+
+void esp_log_write(esp_log_level_t level, const char* tag, const char* format, ...) {
+    if (level > sim_log_level) {
+        return;
+    }
+
+    va_list args;
+    va_start(args, format);
+    // One line at a time, the tasks log from several threads
+    pthread_mutex_lock(&sim_log_lock);
+    vprintf(format, args);
+    fflush(stdout);
+    pthread_mutex_unlock(&sim_log_lock);
+    va_end(args);
+}
+
+uint32_t esp_log_timestamp() {
+    return (uint32_t)(sim_time_us() / 1000);
+}
+
+void esp_log_level_set(const char* tag, esp_log_level_t level) {
+    // Only the level of all tags, "*"
+    if (strcmp(tag, "*") == 0) {
+        sim_log_level = level;
+    }
+}
+
+int64_t esp_timer_get_time() {
+    return sim_time_us();
+}
+
+/**
+ * @brief Timer thread, calls the callbacks of the expired timers one after another.
+ *
+ * @param arg Thread argument (unused).
+ */
+static void* sim_timer_task(void* arg) {
+    pthread_mutex_lock(&sim_timer_lock);
+    while (1) {
+        struct esp_timer* next = NULL;
+        for (struct esp_timer* timer = sim_timers; timer != NULL; timer = timer->next) {
+            if (timer->alarm >= 0 && (next == NULL || timer->alarm < next->alarm)) {
+                next = timer;
+            }
+        }
+
+        if (next == NULL) {
+            pthread_cond_wait(&sim_timer_changed, &sim_timer_lock);
+            continue;
+        }
+
+        int64_t now = sim_time_us();
+        if (next->alarm > now) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_MONOTONIC, &deadline);
+            int64_t ns = deadline.tv_nsec + (next->alarm - now) * 1000;
+            deadline.tv_sec += ns / 1000000000LL;
+            deadline.tv_nsec = ns % 1000000000LL;
+            pthread_cond_timedwait(&sim_timer_changed, &sim_timer_lock, &deadline);
+            continue;
+        }
+
+        next->alarm = next->period > 0 ? next->alarm + (int64_t)next->period : -1;
+
+        // The callback may start or stop timers
+        pthread_mutex_unlock(&sim_timer_lock);
+        next->callback(next->arg);
+        pthread_mutex_lock(&sim_timer_lock);
+    }
+
+    return NULL;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* handle) {
+    struct esp_timer* timer = calloc(1, sizeof(struct esp_timer));
+    if (timer == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    timer->callback = args->callback;
+    timer->arg = args->arg;
+    timer->name = args->name;
+    timer->alarm = -1;
+
+    pthread_mutex_lock(&sim_timer_lock);
+    if (!sim_timer_started) {
+        pthread_condattr_t attr;
+        pthread_condattr_init(&attr);
+        pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+        pthread_cond_init(&sim_timer_changed, &attr);
+        pthread_condattr_destroy(&attr);
+
+        pthread_create(&sim_timer_thread, NULL, sim_timer_task, NULL);
+        pthread_detach(sim_timer_thread);
+        sim_timer_started = true;
+    }
+    timer->next = sim_timers;
+    sim_timers = timer;
+    pthread_mutex_unlock(&sim_timer_lock);
+
+    *handle = timer;
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Arms a timer, like esp_timer it fails when the timer is already running.
+ */
+static esp_err_t sim_timer_start(esp_timer_handle_t timer, uint64_t timeout_us, uint64_t period_us) {
+    esp_err_t ret = ESP_OK;
+
+    pthread_mutex_lock(&sim_timer_lock);
+    if (timer->alarm >= 0) {
+        ret = ESP_ERR_INVALID_STATE;
+    }
+    else {
+        timer->alarm = sim_time_us() + (int64_t)timeout_us;
+        timer->period = period_us;
+        pthread_cond_signal(&sim_timer_changed);
+    }
+    pthread_mutex_unlock(&sim_timer_lock);
+
+    return ret;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+    return sim_timer_start(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us) {
+    return sim_timer_start(timer, period_us, period_us);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    esp_err_t ret = ESP_OK;
+
+    pthread_mutex_lock(&sim_timer_lock);
+    if (timer->alarm < 0) {
+        ret = ESP_ERR_INVALID_STATE;
+    }
+    timer->alarm = -1;
+    pthread_mutex_unlock(&sim_timer_lock);
+
+    return ret;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+    pthread_mutex_lock(&sim_timer_lock);
+    for (struct esp_timer** link = &sim_timers; *link != NULL; link = &(*link)->next) {
+        if (*link == timer) {
+            *link = timer->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&sim_timer_lock);
+
+    free(timer);
+
+    return ESP_OK;
+}
+
+void esp_restart() {
+    // The firmware only restarts after an error, the run failed
+    fflush(stdout);
+    fprintf(stderr, "sim: esp_restart() called, stopping\n");
+    exit(3);
+}
+
+uint32_t esp_get_free_heap_size() {
+    return SIM_HEAP_FREE;
+}
+
+uint32_t esp_get_minimum_free_heap_size() {
+    return SIM_HEAP_FREE;
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+    return SIM_HEAP_FREE;
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps) {
+    return SIM_HEAP_FREE;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps) {
+    return SIM_HEAP_FREE;
+}
+
+uint32_t esp_random() {
+    static bool seeded = false;
+
+    if (!seeded) {
+        srandom((unsigned)getpid());
+        seeded = true;
+    }
+
+    return (uint32_t)random();
+}
+
+esp_err_t esp_read_mac(uint8_t* mac, esp_mac_type_t type) {
+    // Locally administered address with the process ID, so parallel runs are told apart
+    pid_t pid = getpid();
+    const uint8_t sim_mac[6] = { 0x02, 0x51, (pid >> 24) & 0xff, (pid >> 16) & 0xff, (pid >> 8) & 0xff, pid & 0xff };
+
+    memcpy(mac, sim_mac, sizeof(sim_mac));
+
+    return ESP_OK;
+}
+
+esp_err_t esp_efuse_mac_get_default(uint8_t* mac) {
+    return esp_read_mac(mac, ESP_MAC_WIFI_STA);
+}
+
+esp_err_t gpio_reset_pin(gpio_num_t gpio_num) {
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t mode) {
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level) {
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num) {
+    // Every input is pulled up
+    return 1;
+}
+
+esp_err_t gpio_hold_en(gpio_num_t gpio_num) {
+    return ESP_OK;
+}
+
+esp_err_t gpio_hold_dis(gpio_num_t gpio_num) {
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_init() {
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase() {
+    pthread_mutex_lock(&sim_nvs_lock);
+    memset(sim_nvs, 0, sizeof(sim_nvs));
+    pthread_mutex_unlock(&sim_nvs_lock);
+
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char* name, nvs_open_mode_t open_mode, nvs_handle_t* out_handle) {
+    esp_err_t ret = ESP_ERR_NVS_NOT_FOUND;
+
+    // The handle is the index of the namespace plus one
+    pthread_mutex_lock(&sim_nvs_lock);
+    for (int i = 0; i < SIM_NVS_ENTRIES; i++) {
+        if (strncmp(sim_nvs_names[i], name, SIM_NVS_KEY_LEN) == 0) {
+            *out_handle = i + 1;
+            ret = ESP_OK;
+            break;
+        }
+        if (sim_nvs_names[i][0] == '\0') {
+            // Like on the target a namespace only exists once something was written to it
+            if (open_mode == NVS_READWRITE) {
+                strncpy(sim_nvs_names[i], name, SIM_NVS_KEY_LEN - 1);
+                *out_handle = i + 1;
+                ret = ESP_OK;
+            }
+            break;
+        }
+    }
+    pthread_mutex_unlock(&sim_nvs_lock);
+
+    return ret;
+}
+
+void nvs_close(nvs_handle_t handle) {
+}
+
+/**
+ * @brief Finds an entry, with sim_nvs_lock held.
+ */
+static sim_nvs_entry_t* sim_nvs_find(nvs_handle_t handle, const char* key) {
+    for (int i = 0; i < SIM_NVS_ENTRIES; i++) {
+        if (sim_nvs[i].used && strcmp(sim_nvs[i].name, sim_nvs_names[handle - 1]) == 0 &&
+            strncmp(sim_nvs[i].key, key, SIM_NVS_KEY_LEN) == 0) {
+            return &sim_nvs[i];
+        }
+    }
+
+    return NULL;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char* key, void* out_value, size_t* length) {
+    esp_err_t ret = ESP_OK;
+
+    pthread_mutex_lock(&sim_nvs_lock);
+    sim_nvs_entry_t* entry = sim_nvs_find(handle, key);
+    if (entry == NULL) {
+        ret = ESP_ERR_NVS_NOT_FOUND;
+    }
+    else if (out_value == NULL) {
+        *length = entry->length;
+    }
+    else if (*length < entry->length) {
+        ret = ESP_ERR_INVALID_SIZE;
+    }
+    else {
+        memcpy(out_value, entry->value, entry->length);
+        *length = entry->length;
+    }
+    pthread_mutex_unlock(&sim_nvs_lock);
+
+    return ret;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char* key, const void* value, size_t length) {
+    esp_err_t ret = ESP_ERR_NO_MEM;
+
+    if (length > SIM_NVS_BLOB_LEN) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    pthread_mutex_lock(&sim_nvs_lock);
+    sim_nvs_entry_t* entry = sim_nvs_find(handle, key);
+    for (int i = 0; entry == NULL && i < SIM_NVS_ENTRIES; i++) {
+        if (!sim_nvs[i].used) {
+            entry = &sim_nvs[i];
+            entry->used = true;
+            strncpy(entry->name, sim_nvs_names[handle - 1], SIM_NVS_KEY_LEN - 1);
+            strncpy(entry->key, key, SIM_NVS_KEY_LEN - 1);
+        }
+    }
+    if (entry != NULL) {
+        memcpy(entry->value, value, length);
+        entry->length = length;
+        ret = ESP_OK;
+    }
+    pthread_mutex_unlock(&sim_nvs_lock);
+
+    return ret;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char* key) {
+    esp_err_t ret = ESP_ERR_NVS_NOT_FOUND;
+
+    pthread_mutex_lock(&sim_nvs_lock);
+    sim_nvs_entry_t* entry = sim_nvs_find(handle, key);
+    if (entry != NULL) {
+        memset(entry, 0, sizeof(*entry));
+        ret = ESP_OK;
+    }
+    pthread_mutex_unlock(&sim_nvs_lock);
+
+    return ret;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+    return ESP_OK;
+}
@@ -0,0 +1,488 @@
+/**
+ * @file freertos.c
+ * @brief FreeRTOS API of the simulator on POSIX threads.
+ *
+ * Every kernel object is guarded by one lock and waits on its own condition variable against
+ * CLOCK_MONOTONIC, so the timeouts are not affected by changes of the wall clock. The tick count is
+ * derived from the same clock at CONFIG_FREERTOS_HZ.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include "sim.h"
+
+// Length of a task name, like configMAX_TASK_NAME_LEN
+#define SIM_TASK_NAME_LEN 16
+
+struct sim_task {
+    char name[SIM_TASK_NAME_LEN];
+    pthread_t thread;
+    TaskFunction_t code;
+    void* param;
+    UBaseType_t priority;
+    BaseType_t core;
+    uint32_t notify;
+    pthread_cond_t notified;
+};
+
+struct sim_queue {
+    uint8_t* items;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t count;
+    UBaseType_t head;
+    pthread_cond_t changed;
+};
+
+struct sim_event_group {
+    EventBits_t bits;
+    pthread_cond_t changed;
+};
+
+// Guards all kernel objects
+static pthread_mutex_t sim_kernel_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Critical sections of all portMUX_TYPE locks, nests like the spinlocks do
+static pthread_mutex_t sim_critical_lock;
+static pthread_once_t sim_critical_once = PTHREAD_ONCE_INIT;
+
+static __thread struct sim_task* sim_current = NULL;
+
+static struct timespec sim_start;
+static pthread_once_t sim_start_once = PTHREAD_ONCE_INIT;
+
+static void sim_start_init() {
+    clock_gettime(CLOCK_MONOTONIC, &sim_start);
+}
+
+int64_t sim_time_us() {
+    struct timespec now;
+
+    pthread_once(&sim_start_once, sim_start_init);
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec - sim_start.tv_sec) * 1000000LL + (now.tv_nsec - sim_start.tv_nsec) / 1000;
+}
+
+void sim_deadline(TickType_t ticks, struct timespec* deadline) {
+    int64_t ns = (int64_t)ticks * (1000000000LL / configTICK_RATE_HZ);
+
+    clock_gettime(CLOCK_MONOTONIC, deadline);
+    deadline->tv_sec += ns / 1000000000LL;
+    deadline->tv_nsec += ns % 1000000000LL;
+    if (deadline->tv_nsec >= 1000000000L) {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000L;
+    }
+}
+
+void sim_sleep_us(int64_t us) {
+    struct timespec delay = {
+        .tv_sec = us / 1000000,
+        .tv_nsec = (us % 1000000) * 1000,
+    };
+
+    while (nanosleep(&delay, &delay) != 0) {
+    }
+}
+
+/**
+ * @brief Initializes a condition variable that times out against CLOCK_MONOTONIC.
+ */
+static void sim_cond_init(pthread_cond_t* cond) {
+    pthread_condattr_t attr;
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+/**
+ * @brief Waits on a kernel object, with sim_kernel_lock held.
+ *
+ * @param cond Condition variable of the object.
+ * @param ticks Timeout of the call, portMAX_DELAY waits forever.
+ * @param deadline Deadline computed by the first wait of the call.
+ * @return False if the timeout expired.
+ */
+static bool sim_wait(pthread_cond_t* cond, TickType_t ticks, const struct timespec* deadline) {
+    if (ticks == 0) {
+        return false;
+    }
+
+    if (ticks == portMAX_DELAY) {
+        pthread_cond_wait(cond, &sim_kernel_lock);
+        return true;
+    }
+
+    return pthread_cond_timedwait(cond, &sim_kernel_lock, deadline) == 0;
+}
+
+static void sim_critical_init() {
+    pthread_mutexattr_t attr;
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&sim_critical_lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+void sim_critical_enter(portMUX_TYPE* mux) {
+    pthread_once(&sim_critical_once, sim_critical_init);
+    pthread_mutex_lock(&sim_critical_lock);
+    mux->owner++;
+}
+
+void sim_critical_exit(portMUX_TYPE* mux) {
+    mux->owner--;
+    pthread_mutex_unlock(&sim_critical_lock);
+}
+
+/**
+ * @brief Creates the task of a thread that was not started by xTaskCreatePinnedToCore().
+ */
+static struct sim_task* sim_task_alloc(const char* name) {
+    struct sim_task* task = calloc(1, sizeof(struct sim_task));
+    if (task == NULL) {
+        return NULL;
+    }
+
+    strncpy(task->name, name, SIM_TASK_NAME_LEN - 1);
+    task->thread = pthread_self();
+    task->core = tskNO_AFFINITY;
+    sim_cond_init(&task->notified);
+
+    return task;
+}
+
+static void* sim_task_entry(void* arg) {
+    struct sim_task* task = arg;
+
+    sim_current = task;
+    task->code(task->param);
+
+    // A FreeRTOS task must not return, it deletes itself
+    fprintf(stderr, "sim: task %s returned\n", task->name);
+    vTaskDelete(NULL);
+
+    return NULL;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char* name, uint32_t stack_depth, void* param,
+                                   UBaseType_t priority, TaskHandle_t* created, BaseType_t core) {
+    struct sim_task* task = sim_task_alloc(name);
+    if (task == NULL) {
+        return pdFAIL;
+    }
+
+    task->code = code;
+    task->param = param;
+    task->priority = priority;
+    task->core = core;
+
+    // The stack depth is in bytes on the ESP32, the host needs more for libc, so it only sets a minimum
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_attr_setstacksize(&attr, stack_depth < 65536 ? 65536 : stack_depth);
+
+    if (pthread_create(&task->thread, &attr, sim_task_entry, task) != 0) {
+        pthread_attr_destroy(&attr);
+        free(task);
+        return pdFAIL;
+    }
+    pthread_attr_destroy(&attr);
+
+    if (created != NULL) {
+        *created = task;
+    }
+
+    return pdPASS;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    if (sim_current == NULL) {
+        // The main thread runs app_main, like the main task does
+        sim_current = sim_task_alloc("main");
+    }
+
+    return sim_current;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if (task != NULL && task != xTaskGetCurrentTaskHandle()) {
+        // Threads cannot be stopped from outside, no code of the firmware does it
+        fprintf(stderr, "sim: vTaskDelete of another task is not supported\n");
+        abort();
+    }
+
+    pthread_exit(NULL);
+}
+
+void vTaskDelay(TickType_t ticks) {
+    sim_sleep_us((int64_t)ticks * (1000000LL / configTICK_RATE_HZ));
+}
+
+TickType_t xTaskGetTickCount() {
+    return (TickType_t)(sim_time_us() / (1000000LL / configTICK_RATE_HZ));
+}
+
+char* pcTaskGetName(TaskHandle_t task) {
+    return task == NULL ? xTaskGetCurrentTaskHandle()->name : task->name;
+}
+
+void vTaskSetTimeOutState(TimeOut_t* timeout) {
+    timeout->start = xTaskGetTickCount();
+}
+
+BaseType_t xTaskCheckForTimeOut(TimeOut_t* timeout, TickType_t* remaining) {
+    if (*remaining == portMAX_DELAY) {
+        return pdFALSE;
+    }
+
+    TickType_t now = xTaskGetTickCount();
+    TickType_t elapsed = now - timeout->start;
+
+    if (elapsed >= *remaining) {
+        *remaining = 0;
+        return pdTRUE;
+    }
+
+    *remaining -= elapsed;
+    timeout->start = now;
+
+    return pdFALSE;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    pthread_mutex_lock(&sim_kernel_lock);
+    task->notify++;
+    pthread_cond_signal(&task->notified);
+    pthread_mutex_unlock(&sim_kernel_lock);
+
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks) {
+    struct sim_task* task = xTaskGetCurrentTaskHandle();
+    struct timespec deadline;
+    uint32_t value;
+
+    if (ticks != portMAX_DELAY) {
+        sim_deadline(ticks, &deadline);
+    }
+
+    pthread_mutex_lock(&sim_kernel_lock);
+    while (task->notify == 0 && sim_wait(&task->notified, ticks, &deadline)) {
+    }
+
+    value = task->notify;
+    if (value > 0) {
+        task->notify = clear_on_exit ? 0 : value - 1;
+    }
+    pthread_mutex_unlock(&sim_kernel_lock);
+
+    return value;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    struct sim_queue* queue = calloc(1, sizeof(struct sim_queue));
+    if (queue == NULL) {
+        return NULL;
+    }
+
+    // Semaphores have items of no size
+    if (item_size > 0) {
+        queue->items = calloc(length, item_size);
+        if (queue->items == NULL) {
+            free(queue);
+            return NULL;
+        }
+    }
+
+    queue->length = length;
+    queue->item_size = item_size;
+    sim_cond_init(&queue->changed);
+
+    return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    pthread_cond_destroy(&queue->changed);
+    free(queue->items);
+    free(queue);
+}
+
+/**
+ * @brief Copies an item to the back of the queue, with sim_kernel_lock held and a free slot.
+ */
+static void sim_queue_push(struct sim_queue* queue, const void* item) {
+    if (queue->item_size > 0) {
+        UBaseType_t tail = (queue->head + queue->count) % queue->length;
+        memcpy(queue->items + tail * queue->item_size, item, queue->item_size);
+    }
+
+    queue->count++;
+    pthread_cond_broadcast(&queue->changed);
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks) {
+    struct timespec deadline;
+    BaseType_t sent = pdFALSE;
+
+    if (ticks != portMAX_DELAY) {
+        sim_deadline(ticks, &deadline);
+    }
+
+    pthread_mutex_lock(&sim_kernel_lock);
+    while (queue->count == queue->length && sim_wait(&queue->changed, ticks, &deadline)) {
+    }
+
+    if (queue->count < queue->length) {
+        sim_queue_push(queue, item);
+        sent = pdTRUE;
+    }
+    pthread_mutex_unlock(&sim_kernel_lock);
+
+    return sent;
+}
+
+BaseType_t xQueueOverwrite(QueueHandle_t queue, const void* item) {
+    pthread_mutex_lock(&sim_kernel_lock);
+    // Only meant for queues of one item
+    queue->count = 0;
+    sim_queue_push(queue, item);
+    pthread_mutex_unlock(&sim_kernel_lock);
+
+    return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks) {
+    struct timespec deadline;
+    BaseType_t received = pdFALSE;
+
+    if (ticks != portMAX_DELAY) {
+        sim_deadline(ticks, &deadline);
+    }
+
+    pthread_mutex_lock(&sim_kernel_lock);
+    while (queue->count == 0 && sim_wait(&queue->changed, ticks, &deadline)) {
+    }
+
+    if (queue->count > 0) {
+        if (queue->item_size > 0) {
+            memcpy(item, queue->items + queue->head * queue->item_size, queue->item_size);
+        }
+        queue->head = (queue->head + 1) % queue->length;
+        queue->count--;
+        pthread_cond_broadcast(&queue->changed);
+        received = pdTRUE;
+    }
+    pthread_mutex_unlock(&sim_kernel_lock);
+
+    return received;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    pthread_mutex_lock(&sim_kernel_lock);
+    UBaseType_t count = queue->count;
+    pthread_mutex_unlock(&sim_kernel_lock);
+
+    return count;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+    SemaphoreHandle_t mutex = xQueueCreate(1, 0);
+
+    // A mutex starts available
+    if (mutex != NULL) {
+        xSemaphoreGive(mutex);
+    }
+
+    return mutex;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+    return xQueueCreate(1, 0);
+}
+
+EventGroupHandle_t xEventGroupCreate() {
+    struct sim_event_group* group = calloc(1, sizeof(struct sim_event_group));
+    if (group == NULL) {
+        return NULL;
+    }
+
+    sim_cond_init(&group->changed);
+
+    return group;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits) {
+    pthread_mutex_lock(&sim_kernel_lock);
+    group->bits |= bits;
+    EventBits_t value = group->bits;
+    pthread_cond_broadcast(&group->changed);
+    pthread_mutex_unlock(&sim_kernel_lock);
+
+    return value;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits) {
+    pthread_mutex_lock(&sim_kernel_lock);
+    // Returns the bits before they were cleared
+    EventBits_t value = group->bits;
+    group->bits &= ~bits;
+    pthread_mutex_unlock(&sim_kernel_lock);
+
+    return value;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group) {
+    pthread_mutex_lock(&sim_kernel_lock);
+    EventBits_t value = group->bits;
+    pthread_mutex_unlock(&sim_kernel_lock);
+
+    return value;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clear_on_exit,
+                                BaseType_t wait_for_all, TickType_t ticks) {
+    struct timespec deadline;
+
+    if (ticks != portMAX_DELAY) {
+        sim_deadline(ticks, &deadline);
+    }
+
+    pthread_mutex_lock(&sim_kernel_lock);
+    while (1) {
+        EventBits_t set = group->bits & bits;
+        if (wait_for_all ? set == bits : set != 0) {
+            break;
+        }
+        if (!sim_wait(&group->changed, ticks, &deadline)) {
+            break;
+        }
+    }
+
+    // Returns the bits when the wait ended, before they are cleared
+    EventBits_t value = group->bits;
+    EventBits_t set = value & bits;
+    if (clear_on_exit && (wait_for_all ? set == bits : set != 0)) {
+        group->bits &= ~bits;
+    }
+    pthread_mutex_unlock(&sim_kernel_lock);
+
+    return value;
+}
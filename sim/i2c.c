@@ -0,0 +1,324 @@
+/**
+ * @file i2c.c
+ * @brief Legacy I2C master driver of the simulator, see driver/i2c.h.
+ *
+ * A command link is recorded as a list of operations and replayed by i2c_master_cmd_begin()
+ * against the attached device models. The address byte after a start selects the device, an
+ * address nobody answers is NACKed like on the wire. The calling task then sleeps for the time
+ * the bytes take at the configured clock, so the timing of the UI and the bus contention stay
+ * close to the target.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "driver/i2c.h"
+#include "esp_log.h"
+
+#include "sim.h"
+
+#define TAG_SIM_I2C "SIM_I2C"
+
+// Attached device models
+#define SIM_I2C_MAX_DEVICES 8
+
+// Bits on the wire per byte, 8 data bits and the acknowledge
+#define SIM_I2C_BITS_PER_BYTE 9
+
+// Start and stop conditions, about one bit time each
+#define SIM_I2C_BITS_PER_CONDITION 1
+
+typedef enum {
+    SIM_I2C_START,
+    SIM_I2C_WRITE,
+    SIM_I2C_READ,
+    SIM_I2C_STOP,
+} sim_i2c_op_type_t;
+
+typedef struct sim_i2c_op {
+    sim_i2c_op_type_t type;
+    bool ack_en;
+    uint8_t* data;
+    size_t len;
+    struct sim_i2c_op* next;
+    uint8_t bytes[];    // Copy of the written data
+} sim_i2c_op_t;
+
+struct sim_i2c_cmd {
+    sim_i2c_op_t* head;
+    sim_i2c_op_t* tail;
+};
+
+typedef struct {
+    bool configured;
+    bool installed;
+    uint32_t clk_speed;
+    pthread_mutex_t lock;
+} sim_i2c_port_t;
+
+static sim_i2c_device_t* sim_i2c_devices[SIM_I2C_MAX_DEVICES];
+static int sim_i2c_device_count = 0;
+
+static sim_i2c_port_t sim_i2c_ports[I2C_NUM_MAX] = {
+    { .lock = PTHREAD_MUTEX_INITIALIZER },
+    { .lock = PTHREAD_MUTEX_INITIALIZER },
+};
+
+static sim_i2c_stats_t sim_i2c_stats;
+static pthread_mutex_t sim_i2c_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void sim_i2c_attach(sim_i2c_device_t* dev) {
+    if (sim_i2c_device_count < SIM_I2C_MAX_DEVICES) {
+        sim_i2c_devices[sim_i2c_device_count++] = dev;
+    }
+}
+
+void sim_i2c_get_stats(sim_i2c_stats_t* stats) {
+    pthread_mutex_lock(&sim_i2c_stats_lock);
+    *stats = sim_i2c_stats;
+    pthread_mutex_unlock(&sim_i2c_stats_lock);
+}
+
+esp_err_t i2c_param_config(i2c_port_t i2c_num, const i2c_config_t* i2c_conf) {
+    if (i2c_num < 0 || i2c_num >= I2C_NUM_MAX || i2c_conf->mode != I2C_MODE_MASTER) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (i2c_conf->master.clk_speed == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    sim_i2c_ports[i2c_num].clk_speed = i2c_conf->master.clk_speed;
+    sim_i2c_ports[i2c_num].configured = true;
+
+    return ESP_OK;
+}
+
+esp_err_t i2c_driver_install(i2c_port_t i2c_num, i2c_mode_t mode, size_t slv_rx_buf_len, size_t slv_tx_buf_len,
+                             int intr_alloc_flags) {
+    if (i2c_num < 0 || i2c_num >= I2C_NUM_MAX || mode != I2C_MODE_MASTER) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (sim_i2c_ports[i2c_num].installed) {
+        ESP_LOGE(TAG_SIM_I2C, "i2c%d driver install error", i2c_num);
+        return ESP_FAIL;
+    }
+
+    sim_i2c_ports[i2c_num].installed = true;
+
+    return ESP_OK;
+}
+
+esp_err_t i2c_driver_delete(i2c_port_t i2c_num) {
+    if (i2c_num < 0 || i2c_num >= I2C_NUM_MAX || !sim_i2c_ports[i2c_num].installed) {
+        return ESP_FAIL;
+    }
+
+    pthread_mutex_lock(&sim_i2c_ports[i2c_num].lock);
+    sim_i2c_ports[i2c_num].installed = false;
+    pthread_mutex_unlock(&sim_i2c_ports[i2c_num].lock);
+
+    return ESP_OK;
+}
+
+i2c_cmd_handle_t i2c_cmd_link_create() {
+    return calloc(1, sizeof(struct sim_i2c_cmd));
+}
+
+void i2c_cmd_link_delete(i2c_cmd_handle_t cmd_handle) {
+    if (cmd_handle == NULL) {
+        return;
+    }
+
+    sim_i2c_op_t* op = cmd_handle->head;
+    while (op != NULL) {
+        sim_i2c_op_t* next = op->next;
+        free(op);
+        op = next;
+    }
+    free(cmd_handle);
+}
+
+/**
+ * @brief Appends one operation to the command link.
+ *
+ * @param cmd Command link.
+ * @param type Operation.
+ * @param copy Bytes to copy into the operation, written ones.
+ * @param len Number of bytes.
+ * @return Operation, NULL if out of memory.
+ */
+static sim_i2c_op_t* sim_i2c_append(i2c_cmd_handle_t cmd, sim_i2c_op_type_t type, const uint8_t* copy, size_t len) {
+    sim_i2c_op_t* op = calloc(1, sizeof(sim_i2c_op_t) + (copy != NULL ? len : 0));
+    if (op == NULL) {
+        return NULL;
+    }
+
+    op->type = type;
+    op->len = len;
+    if (copy != NULL) {
+        memcpy(op->bytes, copy, len);
+        op->data = op->bytes;
+    }
+
+    if (cmd->tail != NULL) {
+        cmd->tail->next = op;
+    }
+    else {
+        cmd->head = op;
+    }
+    cmd->tail = op;
+
+    return op;
+}
+
+esp_err_t i2c_master_start(i2c_cmd_handle_t cmd_handle) {
+    return sim_i2c_append(cmd_handle, SIM_I2C_START, NULL, 0) != NULL ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+esp_err_t i2c_master_write_byte(i2c_cmd_handle_t cmd_handle, uint8_t data, bool ack_en) {
+    return i2c_master_write(cmd_handle, &data, 1, ack_en);
+}
+
+esp_err_t i2c_master_write(i2c_cmd_handle_t cmd_handle, const uint8_t* data, size_t data_len, bool ack_en) {
+    sim_i2c_op_t* op = sim_i2c_append(cmd_handle, SIM_I2C_WRITE, data, data_len);
+    if (op == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    op->ack_en = ack_en;
+
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_read_byte(i2c_cmd_handle_t cmd_handle, uint8_t* data, i2c_ack_type_t ack) {
+    return i2c_master_read(cmd_handle, data, 1, ack);
+}
+
+esp_err_t i2c_master_read(i2c_cmd_handle_t cmd_handle, uint8_t* data, size_t data_len, i2c_ack_type_t ack) {
+    sim_i2c_op_t* op = sim_i2c_append(cmd_handle, SIM_I2C_READ, NULL, data_len);
+    if (op == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    op->data = data;
+
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_stop(i2c_cmd_handle_t cmd_handle) {
+    return sim_i2c_append(cmd_handle, SIM_I2C_STOP, NULL, 0) != NULL ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+/**
+ * @brief Finds the device answering the address byte.
+ */
+static sim_i2c_device_t* sim_i2c_find(uint8_t address_byte) {
+    for (int i = 0; i < sim_i2c_device_count; i++) {
+        if (sim_i2c_devices[i]->address == address_byte >> 1) {
+            return sim_i2c_devices[i];
+        }
+    }
+
+    return NULL;
+}
+
+esp_err_t i2c_master_cmd_begin(i2c_port_t i2c_num, i2c_cmd_handle_t cmd_handle, TickType_t ticks_to_wait) {
+    if (i2c_num < 0 || i2c_num >= I2C_NUM_MAX || cmd_handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    sim_i2c_port_t* port = &sim_i2c_ports[i2c_num];
+    if (ticks_to_wait == portMAX_DELAY) {
+        pthread_mutex_lock(&port->lock);
+    }
+    else {
+        struct timespec deadline;
+        sim_deadline(ticks_to_wait, &deadline);
+        if (pthread_mutex_clocklock(&port->lock, CLOCK_MONOTONIC, &deadline) == ETIMEDOUT) {
+            return ESP_ERR_TIMEOUT;
+        }
+    }
+
+    if (!port->installed) {
+        pthread_mutex_unlock(&port->lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t ret = ESP_OK;
+    sim_i2c_device_t* dev = NULL;
+    bool address_next = false;
+    uint64_t bytes = 0;
+    uint64_t bits = 0;
+
+    for (sim_i2c_op_t* op = cmd_handle->head; op != NULL && ret == ESP_OK; op = op->next) {
+        switch (op->type) {
+        case SIM_I2C_START:
+            // Repeated start ends the transfer with the current device
+            if (dev != NULL) {
+                dev->stop(dev);
+                dev = NULL;
+            }
+            address_next = true;
+            bits += SIM_I2C_BITS_PER_CONDITION;
+            break;
+        case SIM_I2C_WRITE:
+            for (size_t i = 0; i < op->len; i++) {
+                bytes++;
+                if (address_next) {
+                    address_next = false;
+                    dev = sim_i2c_find(op->data[i]);
+                    if (dev == NULL) {
+                        // Nobody pulls SDA low, the master only fails if it checks the acknowledge
+                        if (op->ack_en) {
+                            ret = ESP_FAIL;
+                            break;
+                        }
+                        continue;
+                    }
+                    dev->start(dev, op->data[i] & 0x01);
+                }
+                else if (dev != NULL) {
+                    dev->write(dev, op->data[i]);
+                }
+            }
+            break;
+        case SIM_I2C_READ:
+            for (size_t i = 0; i < op->len; i++) {
+                bytes++;
+                // An unanswered bus reads as idle high
+                op->data[i] = dev != NULL ? dev->read(dev) : 0xff;
+            }
+            break;
+        case SIM_I2C_STOP:
+            if (dev != NULL) {
+                dev->stop(dev);
+                dev = NULL;
+            }
+            bits += SIM_I2C_BITS_PER_CONDITION;
+            break;
+        }
+    }
+
+    if (dev != NULL) {
+        dev->stop(dev);
+    }
+
+    bits += bytes * SIM_I2C_BITS_PER_BYTE;
+    int64_t busy_us = bits * 1000000 / port->clk_speed;
+    sim_sleep_us(busy_us);
+
+    pthread_mutex_unlock(&port->lock);
+
+    pthread_mutex_lock(&sim_i2c_stats_lock);
+    sim_i2c_stats.transactions++;
+    sim_i2c_stats.nacks += ret == ESP_FAIL;
+    sim_i2c_stats.bytes += bytes;
+    sim_i2c_stats.busy_us += busy_us;
+    pthread_mutex_unlock(&sim_i2c_stats_lock);
+
+    return ret;
+}
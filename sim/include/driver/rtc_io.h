@@ -0,0 +1,13 @@
+/**
+ * @file rtc_io.h
+ * @brief RTC GPIO driver of the simulator, only for the headers of the firmware.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#ifndef SIM_DRIVER_RTC_IO_H
+#define SIM_DRIVER_RTC_IO_H
+
+#include "driver/gpio.h"
+
+#endif
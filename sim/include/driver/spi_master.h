@@ -0,0 +1,20 @@
+/**
+ * @file spi_master.h
+ * @brief SPI master types of the simulator, the panel is simulated on I2C only.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#ifndef SIM_DRIVER_SPI_MASTER_H
+#define SIM_DRIVER_SPI_MASTER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "driver/gpio.h"
+
+typedef struct spi_device_t* spi_device_handle_t;
+
+#endif
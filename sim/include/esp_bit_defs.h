@@ -0,0 +1,21 @@
+/**
+ * @file esp_bit_defs.h
+ * @brief Bit masks of the simulator.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#ifndef SIM_ESP_BIT_DEFS_H
+#define SIM_ESP_BIT_DEFS_H
+
+#define BIT(n) (1UL << (n))
+#define BIT0 BIT(0)
+#define BIT1 BIT(1)
+#define BIT2 BIT(2)
+#define BIT3 BIT(3)
+#define BIT4 BIT(4)
+#define BIT5 BIT(5)
+#define BIT6 BIT(6)
+#define BIT7 BIT(7)
+
+#endif
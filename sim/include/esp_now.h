@@ -0,0 +1,13 @@
+/**
+ * @file esp_now.h
+ * @brief ESP-NOW of the simulator, there is no radio, so only the headers of the firmware.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#ifndef SIM_ESP_NOW_H
+#define SIM_ESP_NOW_H
+
+#include "esp_wifi.h"
+
+#endif
@@ -0,0 +1,13 @@
+/**
+ * @file esp_pm.h
+ * @brief Power management of the simulator, only for the headers of the firmware.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#ifndef SIM_ESP_PM_H
+#define SIM_ESP_PM_H
+
+#include "esp_err.h"
+
+#endif
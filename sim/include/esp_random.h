@@ -0,0 +1,15 @@
+/**
+ * @file esp_random.h
+ * @brief Random numbers of the simulator.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#ifndef SIM_ESP_RANDOM_H
+#define SIM_ESP_RANDOM_H
+
+#include <stdint.h>
+
+uint32_t esp_random();
+
+#endif
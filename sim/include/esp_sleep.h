@@ -0,0 +1,13 @@
+/**
+ * @file esp_sleep.h
+ * @brief Sleep modes of the simulator, only for the headers of the firmware.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#ifndef SIM_ESP_SLEEP_H
+#define SIM_ESP_SLEEP_H
+
+#include "esp_err.h"
+
+#endif
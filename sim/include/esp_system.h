@@ -0,0 +1,23 @@
+/**
+ * @file esp_system.h
+ * @brief System functions of the simulator.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#ifndef SIM_ESP_SYSTEM_H
+#define SIM_ESP_SYSTEM_H
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+/**
+ * @brief Ends the simulator, a restart of the station means the firmware gave up.
+ */
+void esp_restart() __attribute__((noreturn));
+
+uint32_t esp_get_free_heap_size();
+uint32_t esp_get_minimum_free_heap_size();
+
+#endif
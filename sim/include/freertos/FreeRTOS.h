@@ -0,0 +1,62 @@
+/**
+ * @file FreeRTOS.h
+ * @brief FreeRTOS types and macros of the simulator, see sim/freertos.c.
+ *
+ * Only the part of the API the firmware uses. Tasks are POSIX threads: priorities and cores are
+ * recorded but not enforced, the host scheduler runs the threads. A critical section is one global
+ * recursive lock, like a spinlock taken on both cores.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#ifndef SIM_FREERTOS_H
+#define SIM_FREERTOS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "esp_bit_defs.h"
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint32_t StackType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+
+#define configTICK_RATE_HZ CONFIG_FREERTOS_HZ
+#define portTICK_PERIOD_MS ((TickType_t)1000 / configTICK_RATE_HZ)
+#define portTICK_RATE_MS portTICK_PERIOD_MS
+#define pdMS_TO_TICKS(ms) ((TickType_t)(((TickType_t)(ms) * (TickType_t)configTICK_RATE_HZ) / (TickType_t)1000U))
+#define configMAX_PRIORITIES 25
+
+#define portNUM_PROCESSORS 2
+#define tskNO_AFFINITY 0x7fffffff
+
+typedef struct {
+    int owner;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED { 0 }
+
+void sim_critical_enter(portMUX_TYPE* mux);
+void sim_critical_exit(portMUX_TYPE* mux);
+
+#define taskENTER_CRITICAL(mux) sim_critical_enter(mux)
+#define taskEXIT_CRITICAL(mux) sim_critical_exit(mux)
+#define taskENTER_CRITICAL_ISR(mux) sim_critical_enter(mux)
+#define taskEXIT_CRITICAL_ISR(mux) sim_critical_exit(mux)
+#define portENTER_CRITICAL(mux) sim_critical_enter(mux)
+#define portEXIT_CRITICAL(mux) sim_critical_exit(mux)
+
+#define portYIELD_FROM_ISR(...) do { } while (0)
+
+#endif
@@ -0,0 +1,42 @@
+/**
+ * @file task.h
+ * @brief Tasks of the simulator, one POSIX thread each, see sim/freertos.c.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#ifndef SIM_TASK_H
+#define SIM_TASK_H
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct sim_task* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+typedef struct {
+    TickType_t start;
+} TimeOut_t;
+
+#define tskIDLE_PRIORITY ((UBaseType_t)0U)
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char* name, uint32_t stack_depth, void* param,
+                                   UBaseType_t priority, TaskHandle_t* created, BaseType_t core);
+
+static inline BaseType_t xTaskCreate(TaskFunction_t code, const char* name, uint32_t stack_depth, void* param,
+                                     UBaseType_t priority, TaskHandle_t* created) {
+    return xTaskCreatePinnedToCore(code, name, stack_depth, param, priority, created, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount();
+TaskHandle_t xTaskGetCurrentTaskHandle();
+char* pcTaskGetName(TaskHandle_t task);
+
+void vTaskSetTimeOutState(TimeOut_t* timeout);
+BaseType_t xTaskCheckForTimeOut(TimeOut_t* timeout, TickType_t* remaining);
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks);
+
+#endif
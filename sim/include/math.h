@@ -0,0 +1,17 @@
+/**
+ * @file math.h
+ * @brief The C library math.h, with a rename the APDS9960 driver needs on a glibc host.
+ *
+ * glibc declares __powf itself, the driver defines a static helper of the same name.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#ifndef SIM_MATH_H
+#define SIM_MATH_H
+
+#include_next <math.h>
+
+#define __powf apds9960_powf
+
+#endif
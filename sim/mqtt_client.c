@@ -0,0 +1,554 @@
+/**
+ * @file mqtt_client.c
+ * @brief MQTT 3.1.1 client of the simulator behind the esp-mqtt API, see mqtt_client.h.
+ *
+ * One thread per client connects, reads the packets and dispatches the events. Publishing and
+ * subscribing write to the socket from the calling task, like esp-mqtt does when it is connected.
+ * While disconnected they fail, QoS 1 messages are not kept for the next connection.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "esp_log.h"
+#include "mqtt_client.h"
+
+#include "sim.h"
+
+#define TAG_SIM_MQTT "SIM_MQTT"
+
+// MQTT control packet types
+#define MQTT_CONNECT 1
+#define MQTT_CONNACK 2
+#define MQTT_PUBLISH 3
+#define MQTT_PUBACK 4
+#define MQTT_SUBSCRIBE 8
+#define MQTT_SUBACK 9
+#define MQTT_PINGREQ 12
+#define MQTT_PINGRESP 13
+
+// Longest packet body sent or received, longer received packets end the connection
+#define MQTT_MAX_BODY 4096
+
+// Registered handlers per client
+#define MQTT_MAX_HANDLERS 4
+
+// Defaults of esp-mqtt
+#define MQTT_KEEPALIVE_S 120
+#define MQTT_RECONNECT_MS 10000
+
+typedef struct {
+    esp_mqtt_event_id_t event;
+    esp_event_handler_t handler;
+    void* arg;
+} mqtt_handler_t;
+
+struct esp_mqtt_client {
+    char host[64];
+    char port[8];
+    char client_id[32];
+    bool clean_session;
+    bool auto_reconnect;
+    int keepalive;
+    int reconnect_ms;
+
+    mqtt_handler_t handlers[MQTT_MAX_HANDLERS];
+    int handler_count;
+
+    int fd;
+    pthread_mutex_t send_lock;
+    pthread_t thread;
+    volatile bool running;
+    volatile bool connected;
+    uint16_t next_msg_id;
+};
+
+/**
+ * @brief Runs the handlers registered for the event.
+ */
+static void mqtt_dispatch(esp_mqtt_client_handle_t client, esp_mqtt_event_t* event) {
+    event->client = client;
+
+    for (int i = 0; i < client->handler_count; i++) {
+        mqtt_handler_t* handler = &client->handlers[i];
+        if (handler->event == MQTT_EVENT_ANY || handler->event == event->event_id) {
+            handler->handler(handler->arg, "MQTT_EVENTS", event->event_id, event);
+        }
+    }
+}
+
+/**
+ * @brief Writes the whole buffer to the socket.
+ *
+ * @return False if the connection is broken.
+ */
+static bool mqtt_send_all(int fd, const uint8_t* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Reads exactly len bytes from the socket.
+ *
+ * @return False if the connection was closed.
+ */
+static bool mqtt_recv_all(int fd, uint8_t* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = recv(fd, data, len, 0);
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Sends one packet with its fixed header, from any task.
+ *
+ * @param client Client.
+ * @param header First byte of the fixed header.
+ * @param body Variable header and payload.
+ * @param len Length of the body.
+ * @return False if the connection is broken.
+ */
+static bool mqtt_send(esp_mqtt_client_handle_t client, uint8_t header, const uint8_t* body, size_t len) {
+    uint8_t buff[5 + MQTT_MAX_BODY];
+    size_t pos = 0;
+
+    if (len > MQTT_MAX_BODY) {
+        return false;
+    }
+
+    buff[pos++] = header;
+    size_t remaining = len;
+    do {
+        uint8_t byte = remaining % 128;
+        remaining /= 128;
+        buff[pos++] = remaining ? byte | 0x80 : byte;
+    } while (remaining);
+
+    memcpy(buff + pos, body, len);
+
+    pthread_mutex_lock(&client->send_lock);
+    bool sent = client->fd >= 0 && mqtt_send_all(client->fd, buff, pos + len);
+    pthread_mutex_unlock(&client->send_lock);
+
+    return sent;
+}
+
+/**
+ * @brief Reads one packet.
+ *
+ * @param fd Socket.
+ * @param header First byte of the fixed header.
+ * @param body Buffer of MQTT_MAX_BODY bytes for the rest of the packet.
+ * @return Length of the body, -1 if the connection was closed or the packet is too long.
+ */
+static int mqtt_recv(int fd, uint8_t* header, uint8_t* body) {
+    size_t len = 0;
+    int shift = 0;
+    uint8_t byte;
+
+    if (!mqtt_recv_all(fd, header, 1)) {
+        return -1;
+    }
+
+    do {
+        if (!mqtt_recv_all(fd, &byte, 1)) {
+            return -1;
+        }
+        len |= (size_t)(byte & 0x7f) << shift;
+        shift += 7;
+    } while ((byte & 0x80) && shift < 28);
+
+    if (len > MQTT_MAX_BODY || !mqtt_recv_all(fd, body, len)) {
+        return -1;
+    }
+
+    return len;
+}
+
+/**
+ * @brief Appends a length prefixed string.
+ *
+ * @return Position after the string.
+ */
+static size_t mqtt_put_string(uint8_t* buff, size_t pos, const char* text, size_t len) {
+    buff[pos++] = len >> 8;
+    buff[pos++] = len & 0xff;
+    memcpy(buff + pos, text, len);
+
+    return pos + len;
+}
+
+/**
+ * @brief Takes the next packet identifier, never 0.
+ */
+static uint16_t mqtt_msg_id(esp_mqtt_client_handle_t client) {
+    uint16_t id = __atomic_add_fetch(&client->next_msg_id, 1, __ATOMIC_RELAXED);
+
+    if (id == 0) {
+        id = __atomic_add_fetch(&client->next_msg_id, 1, __ATOMIC_RELAXED);
+    }
+
+    return id;
+}
+
+/**
+ * @brief Opens the TCP connection and runs the CONNECT handshake.
+ *
+ * @param client Client.
+ * @param session_present Session present flag of the CONNACK.
+ * @return Socket, -1 on failure.
+ */
+static int mqtt_connect(esp_mqtt_client_handle_t client, int* session_present) {
+    struct addrinfo hints = {
+        .ai_family = AF_UNSPEC,
+        .ai_socktype = SOCK_STREAM,
+    };
+    struct addrinfo* result;
+    int fd = -1;
+
+    if (getaddrinfo(client->host, client->port, &hints, &result) != 0) {
+        ESP_LOGE(TAG_SIM_MQTT, "Cannot resolve %s", client->host);
+        return -1;
+    }
+    for (struct addrinfo* addr = result; addr != NULL; addr = addr->ai_next) {
+        fd = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+        if (connect(fd, addr->ai_addr, addr->ai_addrlen) == 0) {
+            break;
+        }
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(result);
+
+    if (fd < 0) {
+        ESP_LOGE(TAG_SIM_MQTT, "Cannot connect to %s:%s", client->host, client->port);
+        return -1;
+    }
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    uint8_t body[64];
+    size_t pos = mqtt_put_string(body, 0, "MQTT", 4);
+    body[pos++] = 4;    // Protocol level 3.1.1
+    body[pos++] = client->clean_session ? 0x02 : 0x00;
+    body[pos++] = client->keepalive >> 8;
+    body[pos++] = client->keepalive & 0xff;
+    pos = mqtt_put_string(body, pos, client->client_id, strlen(client->client_id));
+
+    client->fd = fd;
+    uint8_t header;
+    uint8_t ack[MQTT_MAX_BODY];
+    if (!mqtt_send(client, MQTT_CONNECT << 4, body, pos) || mqtt_recv(fd, &header, ack) != 2 ||
+        header >> 4 != MQTT_CONNACK || ack[1] != 0) {
+        ESP_LOGE(TAG_SIM_MQTT, "Broker %s:%s refused the connection", client->host, client->port);
+        client->fd = -1;
+        close(fd);
+        return -1;
+    }
+
+    *session_present = ack[0] & 0x01;
+
+    return fd;
+}
+
+/**
+ * @brief Handles one packet from the broker.
+ */
+static void mqtt_handle(esp_mqtt_client_handle_t client, uint8_t header, uint8_t* body, int len) {
+    esp_mqtt_event_t event = { 0 };
+
+    switch (header >> 4) {
+    case MQTT_PUBLISH: {
+        int qos = (header >> 1) & 0x03;
+        int topic_len = (body[0] << 8) | body[1];
+        int pos = 2 + topic_len;
+        int msg_id = 0;
+
+        if (pos > len) {
+            return;
+        }
+        if (qos > 0) {
+            if (pos + 2 > len) {
+                return;
+            }
+            msg_id = (body[pos] << 8) | body[pos + 1];
+            pos += 2;
+        }
+
+        event.event_id = MQTT_EVENT_DATA;
+        event.topic = (char*)body + 2;
+        event.topic_len = topic_len;
+        event.data = (char*)body + pos;
+        event.data_len = len - pos;
+        event.total_data_len = event.data_len;
+        event.msg_id = msg_id;
+        event.qos = qos;
+        event.retain = header & 0x01;
+        mqtt_dispatch(client, &event);
+
+        if (qos == 1) {
+            uint8_t ack[2] = { msg_id >> 8, msg_id & 0xff };
+            mqtt_send(client, MQTT_PUBACK << 4, ack, sizeof(ack));
+        }
+        break;
+    }
+    case MQTT_PUBACK:
+        event.event_id = MQTT_EVENT_PUBLISHED;
+        event.msg_id = (body[0] << 8) | body[1];
+        mqtt_dispatch(client, &event);
+        break;
+    case MQTT_SUBACK:
+        event.event_id = MQTT_EVENT_SUBSCRIBED;
+        event.msg_id = (body[0] << 8) | body[1];
+        mqtt_dispatch(client, &event);
+        break;
+    default:
+        // PINGRESP and everything the firmware does not use
+        break;
+    }
+}
+
+/**
+ * @brief Client thread, keeps the connection up and reads the packets.
+ *
+ * @param arg Client.
+ */
+static void* mqtt_task(void* arg) {
+    esp_mqtt_client_handle_t client = arg;
+    uint8_t* body = malloc(MQTT_MAX_BODY);
+
+    while (client->running) {
+        int session_present = 0;
+        int fd = mqtt_connect(client, &session_present);
+
+        if (fd >= 0) {
+            esp_mqtt_event_t event = {
+                .event_id = MQTT_EVENT_CONNECTED,
+                .session_present = session_present,
+            };
+            client->connected = true;
+            mqtt_dispatch(client, &event);
+
+            int64_t last_send = sim_time_us();
+            while (client->running) {
+                struct pollfd pfd = {
+                    .fd = fd,
+                    .events = POLLIN,
+                };
+
+                // Ping at half the keepalive, the broker drops the client after 1.5 times the keepalive
+                if (poll(&pfd, 1, client->keepalive * 500) == 0 ||
+                    sim_time_us() - last_send > client->keepalive * 500000LL) {
+                    mqtt_send(client, MQTT_PINGREQ << 4, NULL, 0);
+                    last_send = sim_time_us();
+                    continue;
+                }
+
+                uint8_t header;
+                int len = mqtt_recv(fd, &header, body);
+                if (len < 0) {
+                    break;
+                }
+                mqtt_handle(client, header, body, len);
+            }
+
+            pthread_mutex_lock(&client->send_lock);
+            client->connected = false;
+            client->fd = -1;
+            close(fd);
+            pthread_mutex_unlock(&client->send_lock);
+
+            event.event_id = MQTT_EVENT_DISCONNECTED;
+            mqtt_dispatch(client, &event);
+        }
+        else {
+            esp_mqtt_event_t event = {
+                .event_id = MQTT_EVENT_ERROR,
+            };
+            mqtt_dispatch(client, &event);
+        }
+
+        if (!client->auto_reconnect) {
+            break;
+        }
+
+        // Wait before the next attempt, in steps so a stop is not delayed
+        for (int waited = 0; client->running && waited < client->reconnect_ms; waited += 100) {
+            sim_sleep_us(100000);
+        }
+    }
+
+    free(body);
+
+    return NULL;
+}
+
+esp_mqtt_client_handle_t esp_mqtt_client_init(const esp_mqtt_client_config_t* config) {
+    const char* uri = config->broker.address.uri;
+    const char* broker = getenv("MQTT_BROKER");
+
+    esp_mqtt_client_handle_t client = calloc(1, sizeof(struct esp_mqtt_client));
+    if (client == NULL) {
+        return NULL;
+    }
+
+    // mqtt://host[:port][/path], the host of MQTT_BROKER replaces it
+    if (uri != NULL && strncmp(uri, "mqtt://", 7) == 0) {
+        sscanf(uri + 7, "%63[^:/]:%7[0-9]", client->host, client->port);
+    }
+    else if (config->broker.address.hostname != NULL) {
+        snprintf(client->host, sizeof(client->host), "%s", config->broker.address.hostname);
+        snprintf(client->port, sizeof(client->port), "%u", (unsigned)config->broker.address.port);
+    }
+    if (broker != NULL && broker[0] != '\0') {
+        client->port[0] = '\0';
+        sscanf(broker, "%63[^:]:%7[0-9]", client->host, client->port);
+    }
+    if (client->host[0] == '\0') {
+        ESP_LOGE(TAG_SIM_MQTT, "No broker in the configuration");
+        free(client);
+        return NULL;
+    }
+    if (client->port[0] == '\0' || strcmp(client->port, "0") == 0) {
+        strcpy(client->port, "1883");
+    }
+
+    if (config->credentials.client_id != NULL) {
+        snprintf(client->client_id, sizeof(client->client_id), "%s", config->credentials.client_id);
+    }
+    else {
+        // Stable per process, the persistent session of the firmware survives reconnects
+        snprintf(client->client_id, sizeof(client->client_id), "SIM_%d", (int)getpid());
+    }
+
+    client->clean_session = !config->session.disable_clean_session;
+    client->auto_reconnect = !config->network.disable_auto_reconnect;
+    client->keepalive = config->session.keepalive > 0 ? config->session.keepalive : MQTT_KEEPALIVE_S;
+    client->reconnect_ms = config->network.reconnect_timeout_ms > 0 ? config->network.reconnect_timeout_ms
+                                                                    : MQTT_RECONNECT_MS;
+    client->fd = -1;
+    pthread_mutex_init(&client->send_lock, NULL);
+
+    return client;
+}
+
+esp_err_t esp_mqtt_client_register_event(esp_mqtt_client_handle_t client, esp_mqtt_event_id_t event,
+                                         esp_event_handler_t event_handler, void* event_handler_arg) {
+    if (client->handler_count == MQTT_MAX_HANDLERS) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    client->handlers[client->handler_count++] = (mqtt_handler_t) {
+        .event = event,
+        .handler = event_handler,
+        .arg = event_handler_arg,
+    };
+
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_start(esp_mqtt_client_handle_t client) {
+    if (client->running) {
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG_SIM_MQTT, "Connecting to %s:%s as %s", client->host, client->port, client->client_id);
+
+    client->running = true;
+    if (pthread_create(&client->thread, NULL, mqtt_task, client) != 0) {
+        client->running = false;
+        return ESP_FAIL;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_stop(esp_mqtt_client_handle_t client) {
+    if (!client->running) {
+        return ESP_FAIL;
+    }
+
+    // Unblocks the read of the client thread, a closed connection keeps the session on the broker
+    client->running = false;
+    pthread_mutex_lock(&client->send_lock);
+    if (client->fd >= 0) {
+        mqtt_send_all(client->fd, (const uint8_t[]) { 0xe0, 0x00 }, 2);
+        shutdown(client->fd, SHUT_RDWR);
+    }
+    pthread_mutex_unlock(&client->send_lock);
+    pthread_join(client->thread, NULL);
+
+    return ESP_OK;
+}
+
+int esp_mqtt_client_subscribe(esp_mqtt_client_handle_t client, const char* topic, int qos) {
+    uint8_t body[MQTT_MAX_BODY];
+    size_t len = strlen(topic);
+
+    if (!client->connected || len + 5 > sizeof(body)) {
+        return -1;
+    }
+
+    uint16_t msg_id = mqtt_msg_id(client);
+    body[0] = msg_id >> 8;
+    body[1] = msg_id & 0xff;
+    size_t pos = mqtt_put_string(body, 2, topic, len);
+    body[pos++] = qos;
+
+    return mqtt_send(client, (MQTT_SUBSCRIBE << 4) | 0x02, body, pos) ? msg_id : -1;
+}
+
+int esp_mqtt_client_publish(esp_mqtt_client_handle_t client, const char* topic, const char* data, int len, int qos,
+                            int retain) {
+    uint8_t body[MQTT_MAX_BODY];
+    size_t topic_len = strlen(topic);
+
+    if (len <= 0 && data != NULL) {
+        len = strlen(data);
+    }
+    if (!client->connected || topic_len + len + 4 > sizeof(body)) {
+        return -1;
+    }
+
+    // QoS 0 messages have no identifier, esp-mqtt returns 0 for them
+    uint16_t msg_id = qos > 0 ? mqtt_msg_id(client) : 0;
+    size_t pos = mqtt_put_string(body, 0, topic, topic_len);
+    if (qos > 0) {
+        body[pos++] = msg_id >> 8;
+        body[pos++] = msg_id & 0xff;
+    }
+    memcpy(body + pos, data, len);
+    pos += len;
+
+    uint8_t header = (MQTT_PUBLISH << 4) | ((qos > 0 ? 1 : 0) << 1) | (retain ? 1 : 0);
+
+    return mqtt_send(client, header, body, pos) ? msg_id : -1;
+}
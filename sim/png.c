@@ -0,0 +1,137 @@
+/**
+ * @file png.c
+ * @brief Minimal PNG writer of the simulator for the frames of the panel, see sim.h.
+ *
+ * 8 bit grayscale, the image data in stored (uncompressed) deflate blocks. The frames are small,
+ * so a compressor would only add code.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+
+// Largest stored deflate block
+#define PNG_BLOCK_MAX 65535
+
+static uint32_t png_crc_table[256];
+
+/**
+ * @brief Fills the CRC-32 table of the chunks.
+ */
+static void png_crc_init() {
+    for (uint32_t n = 0; n < 256; n++) {
+        uint32_t c = n;
+        for (int k = 0; k < 8; k++) {
+            c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        png_crc_table[n] = c;
+    }
+}
+
+static uint32_t png_crc(uint32_t crc, const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        crc = png_crc_table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+
+    return crc;
+}
+
+static void png_put32(uint8_t* buff, uint32_t value) {
+    buff[0] = value >> 24;
+    buff[1] = value >> 16;
+    buff[2] = value >> 8;
+    buff[3] = value;
+}
+
+/**
+ * @brief Writes one chunk with its length and CRC.
+ */
+static bool png_chunk(FILE* file, const char* type, const uint8_t* data, size_t len) {
+    uint8_t header[8];
+    uint8_t footer[4];
+
+    png_put32(header, len);
+    memcpy(header + 4, type, 4);
+
+    uint32_t crc = png_crc(0xffffffffu, header + 4, 4);
+    crc = png_crc(crc, data, len) ^ 0xffffffffu;
+    png_put32(footer, crc);
+
+    return fwrite(header, 1, 8, file) == 8 && fwrite(data, 1, len, file) == len && fwrite(footer, 1, 4, file) == 4;
+}
+
+bool sim_png_write(const char* path, const uint8_t* pixels, int width, int height) {
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+
+    // Every row starts with filter type 0
+    size_t raw_len = (size_t)(width + 1) * height;
+    size_t blocks = (raw_len + PNG_BLOCK_MAX - 1) / PNG_BLOCK_MAX;
+    size_t zlib_len = 2 + raw_len + blocks * 5 + 4;
+    uint8_t* raw = malloc(raw_len);
+    uint8_t* zlib = malloc(zlib_len);
+    bool ok = false;
+
+    if (raw == NULL || zlib == NULL) {
+        goto end;
+    }
+
+    if (png_crc_table[1] == 0) {
+        png_crc_init();
+    }
+
+    for (int y = 0; y < height; y++) {
+        raw[y * (width + 1)] = 0;
+        memcpy(&raw[y * (width + 1) + 1], &pixels[y * width], width);
+    }
+
+    // zlib stream of stored blocks with the Adler-32 of the raw data
+    size_t pos = 0;
+    zlib[pos++] = 0x78;
+    zlib[pos++] = 0x01;
+    for (size_t offset = 0; offset < raw_len; offset += PNG_BLOCK_MAX) {
+        size_t len = raw_len - offset < PNG_BLOCK_MAX ? raw_len - offset : PNG_BLOCK_MAX;
+        zlib[pos++] = offset + len == raw_len;
+        zlib[pos++] = len & 0xff;
+        zlib[pos++] = len >> 8;
+        zlib[pos++] = ~len & 0xff;
+        zlib[pos++] = (~len >> 8) & 0xff;
+        memcpy(&zlib[pos], &raw[offset], len);
+        pos += len;
+    }
+    uint32_t a = 1;
+    uint32_t b = 0;
+    for (size_t i = 0; i < raw_len; i++) {
+        a = (a + raw[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+    png_put32(&zlib[pos], (b << 16) | a);
+    pos += 4;
+
+    uint8_t ihdr[13];
+    png_put32(ihdr, width);
+    png_put32(ihdr + 4, height);
+    ihdr[8] = 8;    // Bit depth
+    ihdr[9] = 0;    // Grayscale
+    ihdr[10] = 0;   // Deflate
+    ihdr[11] = 0;   // Adaptive filtering
+    ihdr[12] = 0;   // No interlace
+
+    FILE* file = fopen(path, "wb");
+    if (file == NULL) {
+        goto end;
+    }
+    ok = fwrite(signature, 1, sizeof(signature), file) == sizeof(signature) &&
+         png_chunk(file, "IHDR", ihdr, sizeof(ihdr)) && png_chunk(file, "IDAT", zlib, pos) &&
+         png_chunk(file, "IEND", NULL, 0);
+    ok = fclose(file) == 0 && ok;
+
+end:
+    free(raw);
+    free(zlib);
+
+    return ok;
+}
@@ -0,0 +1,19 @@
+#!/bin/sh
+# Builds the simulator, runs a scenario against server/broker.py on a free local port and stops the broker.
+# Arguments go to station_sim, e.g. ./sim/run.sh -p frames sim/scenarios/menu.txt
+set -e
+
+DIR=$(cd "$(dirname "$0")" && pwd)
+PORT=${SIM_PORT:-18831}
+
+cmake -S "$DIR" -B "$DIR/build" > /dev/null
+cmake --build "$DIR/build" > /dev/null
+
+python3 "$DIR/../server/broker.py" --port "$PORT" > /dev/null &
+BROKER=$!
+trap 'kill $BROKER 2> /dev/null' EXIT
+
+# Wait for the broker to listen
+sleep 1
+
+MQTT_BROKER="127.0.0.1:$PORT" "$DIR/build/station_sim" "$@"
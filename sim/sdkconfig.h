@@ -0,0 +1,85 @@
+/**
+ * @file sdkconfig.h
+ * @brief Configuration of the firmware in the host simulator, the defaults of menuconfig.
+ *
+ * The options follow src/Kconfig.projbuild and the Kconfig files of the components. The panel is
+ * the SSD1306 on I2C, which the simulator models. The log ring stays off: it keeps the arguments
+ * of a record as 32 bit words, which cannot hold the pointers of a 64 bit host.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#ifndef SIM_SDKCONFIG_H
+#define SIM_SDKCONFIG_H
+
+// ESP-IDF
+#define CONFIG_FREERTOS_HZ 100
+#define CONFIG_LOG_MAXIMUM_LEVEL 3
+#define CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ 240
+#define CONFIG_XTAL_FREQ 40
+
+// Display
+#define CONFIG_DISPLAY_SSD1306 1
+#define CONFIG_I2C_INTERFACE 1
+#define CONFIG_I2C_PORT_0 1
+#define CONFIG_SSD1306_128x64 1
+#define CONFIG_OFFSETX 0
+#define CONFIG_SDA_GPIO 21
+#define CONFIG_SCL_GPIO 22
+#define CONFIG_RESET_GPIO -1
+#define CONFIG_SSD1306_LOG_LEVEL 2
+
+// I2C bus
+#define CONFIG_I2C_BUS_DYNAMIC_CONFIG 1
+#define CONFIG_I2C_MS_TO_WAIT 200
+#define CONFIG_I2C_BUS_STATS 1
+#define CONFIG_BUS_LOG_LEVEL 3
+
+// Wi-Fi
+#define CONFIG_APP_WIFI_DHCP_CACHED 1
+#define CONFIG_APP_WIFI_IP "192.168.1.50"
+#define CONFIG_APP_WIFI_NETMASK "255.255.255.0"
+#define CONFIG_APP_WIFI_GATEWAY "192.168.1.1"
+#define CONFIG_APP_WIFI_DNS "192.168.1.1"
+#define CONFIG_APP_WIFI_BACKOFF_MIN_MS 200
+#define CONFIG_APP_WIFI_BACKOFF_MAX_MS 30000
+
+// Tasks
+#define CONFIG_APP_NET_CORE 0
+#define CONFIG_APP_UI_CORE 1
+#define CONFIG_APP_MQTT_TASK_PRIORITY 5
+#define CONFIG_APP_MQTT_TASK_STACK_SIZE 8192
+#define CONFIG_APP_UI_TASK_PRIORITY 5
+#define CONFIG_APP_UI_TASK_STACK_SIZE 4096
+
+// Diagnostics, they need FreeRTOS internals the simulator does not have
+#define CONFIG_APP_CPU_LOAD_REPORT 0
+#define CONFIG_APP_CPU_LOAD_PERIOD_MS 10000
+#define CONFIG_APP_HEALTH_REPORT 0
+#define CONFIG_APP_HEALTH_PERIOD_MS 60000
+#define CONFIG_APP_HEALTH_TOPIC "test/health"
+#define CONFIG_APP_HEALTH_STACK_WARN 512
+#define CONFIG_APP_LOG_LEVEL 3
+#define CONFIG_APP_LOG_RING 0
+#define CONFIG_APP_LOG_RING_SIZE 64
+#define CONFIG_APP_METRICS 1
+#define CONFIG_APP_METRICS_PERIOD_MS 10000
+#define CONFIG_APP_METRICS_TOPIC "test/metrics"
+#define CONFIG_APP_PROFILER 0
+#define CONFIG_APP_TRACE 0
+
+// ESP-NOW
+#define CONFIG_APP_ESPNOW_OFF 1
+#define CONFIG_APP_ESPNOW_CHANNEL 1
+
+// Power
+#define CONFIG_APP_IDLE_AWAKE 1
+#define CONFIG_APP_APDS9960_INT_GPIO 33
+#define CONFIG_APP_IDLE_TIMEOUT_MS 30000
+#define CONFIG_APP_STATION_PERIOD_S 600
+#define CONFIG_APP_STATION_AWAKE_TIMEOUT_MS 3000
+#define CONFIG_APP_IDLE_DISPLAY_DIM 1
+#define CONFIG_APP_IDLE_DIM_CONTRAST 8
+#define CONFIG_APP_IDLE_LISTEN_INTERVAL 3
+
+#endif
@@ -0,0 +1,130 @@
+/**
+ * @file sim.h
+ * @brief Internals shared by the parts of the host simulator.
+ *
+ * The firmware in src/ and the drivers in components/ are built unchanged against the headers in
+ * sim/include. This header connects the pieces behind them: the clock, the simulated I2C devices,
+ * the panel and the gesture sensor models, and the statistics printed at the end of a run.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "freertos/FreeRTOS.h"
+
+// Panel size of the SSD1306 model
+#define SIM_PANEL_WIDTH 128
+#define SIM_PANEL_HEIGHT 64
+#define SIM_PANEL_PAGES (SIM_PANEL_HEIGHT / 8)
+
+/**
+ * @brief Microseconds since the start of the simulator, the clock of esp_timer_get_time().
+ */
+int64_t sim_time_us();
+
+/**
+ * @brief Absolute CLOCK_MONOTONIC time a number of ticks from now, for the timed waits.
+ *
+ * @param ticks Ticks to wait, portMAX_DELAY is not allowed.
+ * @param deadline Deadline to fill.
+ */
+void sim_deadline(TickType_t ticks, struct timespec* deadline);
+
+/**
+ * @brief Sleeps for a number of microseconds.
+ */
+void sim_sleep_us(int64_t us);
+
+/**
+ * @brief One device on the simulated I2C buses, it answers on every port.
+ *
+ * The bus calls start() with the direction after the address byte matched, then write() or read()
+ * per byte, and stop() at the end of the transaction or before a repeated start.
+ */
+typedef struct sim_i2c_device {
+    uint8_t address;
+    void (*start)(struct sim_i2c_device* dev, bool read);
+    void (*write)(struct sim_i2c_device* dev, uint8_t byte);
+    uint8_t (*read)(struct sim_i2c_device* dev);
+    void (*stop)(struct sim_i2c_device* dev);
+} sim_i2c_device_t;
+
+/**
+ * @brief Connects a device model to the buses.
+ */
+void sim_i2c_attach(sim_i2c_device_t* dev);
+
+/**
+ * @brief Traffic of the simulated I2C buses since the start.
+ */
+typedef struct {
+    uint32_t transactions;
+    uint32_t nacks;
+    uint64_t bytes;
+    int64_t busy_us;
+} sim_i2c_stats_t;
+
+void sim_i2c_get_stats(sim_i2c_stats_t* stats);
+
+/**
+ * @brief Attaches the SSD1306 model at its I2C address.
+ */
+void sim_ssd1306_init();
+
+/**
+ * @brief Copies the panel as it is seen, one byte per pixel, 0 is dark.
+ *
+ * @param pixels SIM_PANEL_WIDTH * SIM_PANEL_HEIGHT bytes, row by row.
+ * @return Number of changes of the panel so far, it grows with every write to it.
+ */
+uint32_t sim_ssd1306_get_pixels(uint8_t* pixels);
+
+/**
+ * @brief Reads one text line back from the display RAM, by matching the cells against the font.
+ *
+ * @param page Line of 8 pixels, from 0.
+ * @param text Buffer of 17 bytes, cells that match no glyph are '?'.
+ */
+void sim_ssd1306_get_text(int page, char* text);
+
+/**
+ * @brief Time of the last write to the panel, from sim_time_us().
+ */
+int64_t sim_ssd1306_last_change();
+
+/**
+ * @brief Attaches the APDS9960 model at its I2C address.
+ */
+void sim_apds9960_init();
+
+/**
+ * @brief Queues one gesture, the sensor reports it to the next reads of the driver.
+ *
+ * @param gesture APDS9960_UP, APDS9960_DOWN, APDS9960_LEFT or APDS9960_RIGHT, the codes
+ * apds9960_read_gesture() returns.
+ */
+void sim_apds9960_gesture(uint8_t gesture);
+
+/**
+ * @brief Number of queued gestures the driver has not read yet.
+ */
+int sim_apds9960_pending();
+
+/**
+ * @brief Writes a grayscale image as PNG.
+ *
+ * @param path File to write.
+ * @param pixels One byte per pixel, row by row.
+ * @param width Width in pixels.
+ * @param height Height in pixels.
+ * @return False if the file could not be written.
+ */
+bool sim_png_write(const char* path, const uint8_t* pixels, int width, int height);
+
+#endif
@@ -0,0 +1,352 @@
+/**
+ * @file sim_main.c
+ * @brief Entry point of the host simulator, runs the firmware and a scenario against it.
+ *
+ * Usage: station_sim [-q] [-p png_dir] scenario.txt
+ *
+ * The firmware starts from app_main() like on the target, with the panel and the gesture sensor
+ * models on the simulated I2C buses and the MQTT client on the network of the host. The scenario
+ * then drives it one command per line:
+ *
+ *   wait <ms>                  Let the firmware run.
+ *   gesture up|down|left|right Queue a gesture on the sensor, by the codes of the driver.
+ *   expect <line> <text>       Wait until a text line of the panel reads <text>, fail after 3 s.
+ *   publish <topic> <payload>  Publish a message with QoS 1, like the server does.
+ *   png <file>                 Save the panel as it is now.
+ *   # ...                      Comment.
+ *
+ * Every frame that settles on the panel is printed to the terminal (unless -q) and saved as
+ * png_dir/frame_NNNN.png (with -p). The exit status is 1 if an expect failed.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "apds9960.h"
+#include "mqtt_client.h"
+
+#include "sim.h"
+
+// A frame is taken once the panel did not change for this long, the views draw line by line
+#define SIM_SETTLE_US 30000
+
+// Poll period of the renderer and of the expectations
+#define SIM_POLL_US 10000
+
+// Time an expectation waits for the panel
+#define SIM_EXPECT_TIMEOUT_US 3000000
+
+// Time the scenario waits for its MQTT client to connect
+#define SIM_CONNECT_TIMEOUT_US 5000000
+
+// Frames are saved scaled up, one panel pixel is a square of this size
+#define SIM_PNG_SCALE 4
+
+void app_main(void);
+
+static bool quiet = false;
+static const char* png_dir = NULL;
+static int frames = 0;
+
+static esp_mqtt_client_handle_t scenario_client = NULL;
+static volatile bool scenario_connected = false;
+
+/**
+ * @brief Saves the panel pixels as PNG, scaled up.
+ */
+static bool sim_save_png(const char* path, const uint8_t* pixels) {
+    static uint8_t scaled[SIM_PANEL_WIDTH * SIM_PNG_SCALE * SIM_PANEL_HEIGHT * SIM_PNG_SCALE];
+    const int width = SIM_PANEL_WIDTH * SIM_PNG_SCALE;
+
+    for (int y = 0; y < SIM_PANEL_HEIGHT * SIM_PNG_SCALE; y++) {
+        for (int x = 0; x < width; x++) {
+            scaled[y * width + x] = pixels[(y / SIM_PNG_SCALE) * SIM_PANEL_WIDTH + x / SIM_PNG_SCALE];
+        }
+    }
+
+    return sim_png_write(path, scaled, width, SIM_PANEL_HEIGHT * SIM_PNG_SCALE);
+}
+
+/**
+ * @brief Prints the panel with half blocks, two pixel rows per line of the terminal.
+ */
+static void sim_print_frame(const uint8_t* pixels) {
+    // Up to 3 bytes of UTF-8 per column, the border and the newline
+    static char out[(SIM_PANEL_HEIGHT / 2 + 2) * (SIM_PANEL_WIDTH * 3 + 8) + 64];
+    static const char* const blocks[] = { " ", "▀", "▄", "█" };
+    int pos = 0;
+
+    pos += sprintf(out + pos, "+--- frame %d at %lld ms ", frames, (long long)(sim_time_us() / 1000));
+    while (pos < SIM_PANEL_WIDTH + 1) {
+        out[pos++] = '-';
+    }
+    pos += sprintf(out + pos, "+\n");
+
+    for (int y = 0; y < SIM_PANEL_HEIGHT; y += 2) {
+        out[pos++] = '|';
+        for (int x = 0; x < SIM_PANEL_WIDTH; x++) {
+            int top = pixels[y * SIM_PANEL_WIDTH + x] != 0;
+            int bottom = pixels[(y + 1) * SIM_PANEL_WIDTH + x] != 0;
+            pos += sprintf(out + pos, "%s", blocks[top | (bottom << 1)]);
+        }
+        pos += sprintf(out + pos, "|\n");
+    }
+
+    out[pos++] = '+';
+    memset(out + pos, '-', SIM_PANEL_WIDTH);
+    pos += SIM_PANEL_WIDTH;
+    pos += sprintf(out + pos, "+\n");
+
+    fwrite(out, 1, pos, stdout);
+    fflush(stdout);
+}
+
+/**
+ * @brief Renderer thread, takes every frame that settles on the panel.
+ *
+ * @param arg Thread argument (unused).
+ */
+static void* sim_render_task(void* arg) {
+    static uint8_t pixels[SIM_PANEL_WIDTH * SIM_PANEL_HEIGHT];
+    uint32_t shown = 0;
+
+    while (1) {
+        sim_sleep_us(SIM_POLL_US);
+
+        int64_t last_change = sim_ssd1306_last_change();
+        if (last_change == 0 || sim_time_us() - last_change < SIM_SETTLE_US) {
+            continue;
+        }
+
+        uint32_t changes = sim_ssd1306_get_pixels(pixels);
+        if (changes == shown || sim_ssd1306_last_change() != last_change) {
+            continue;
+        }
+        shown = changes;
+        frames++;
+
+        if (!quiet) {
+            sim_print_frame(pixels);
+        }
+        if (png_dir != NULL) {
+            char path[512];
+            snprintf(path, sizeof(path), "%s/frame_%04d.png", png_dir, frames);
+            if (!sim_save_png(path, pixels)) {
+                fprintf(stderr, "Cannot write %s\n", path);
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Events of the MQTT client of the scenario.
+ */
+static void sim_mqtt_event_handler(void* handler_args, esp_event_base_t base, int32_t event_id, void* event_data) {
+    if (event_id == MQTT_EVENT_CONNECTED) {
+        scenario_connected = true;
+    }
+    else if (event_id == MQTT_EVENT_DISCONNECTED) {
+        scenario_connected = false;
+    }
+}
+
+/**
+ * @brief Publishes one message from the scenario, connects on the first use.
+ *
+ * @return False if the broker cannot be reached.
+ */
+static bool sim_publish(const char* topic, const char* payload) {
+    if (scenario_client == NULL) {
+        esp_mqtt_client_config_t config = {
+            .broker.address.uri = "mqtt://127.0.0.1",
+            .credentials.client_id = "station_sim_scenario",
+        };
+        scenario_client = esp_mqtt_client_init(&config);
+        esp_mqtt_client_register_event(scenario_client, MQTT_EVENT_ANY, sim_mqtt_event_handler, NULL);
+        esp_mqtt_client_start(scenario_client);
+    }
+
+    int64_t deadline = sim_time_us() + SIM_CONNECT_TIMEOUT_US;
+    while (!scenario_connected && sim_time_us() < deadline) {
+        sim_sleep_us(SIM_POLL_US);
+    }
+
+    return esp_mqtt_client_publish(scenario_client, topic, payload, strlen(payload), 1, 0) >= 0;
+}
+
+/**
+ * @brief Removes the trailing spaces and the newline.
+ */
+static void sim_trim(char* text) {
+    size_t len = strlen(text);
+
+    while (len > 0 && (text[len - 1] == ' ' || text[len - 1] == '\n' || text[len - 1] == '\r')) {
+        text[--len] = '\0';
+    }
+}
+
+/**
+ * @brief Waits until a text line of the panel reads the expected text.
+ */
+static bool sim_expect(int line, const char* expected) {
+    char text[SIM_PANEL_WIDTH / 8 + 1];
+    int64_t deadline = sim_time_us() + SIM_EXPECT_TIMEOUT_US;
+
+    while (1) {
+        sim_ssd1306_get_text(line, text);
+        sim_trim(text);
+        if (strcmp(text, expected) == 0) {
+            return true;
+        }
+        if (sim_time_us() > deadline) {
+            break;
+        }
+        sim_sleep_us(SIM_POLL_US);
+    }
+
+    fprintf(stderr, "Expected line %d to read \"%s\", the panel shows:\n", line, expected);
+    for (int i = 0; i < SIM_PANEL_PAGES; i++) {
+        sim_ssd1306_get_text(i, text);
+        fprintf(stderr, "  %d: \"%s\"\n", i, text);
+    }
+
+    return false;
+}
+
+/**
+ * @brief Runs one line of the scenario.
+ *
+ * @return False if the command failed.
+ */
+static bool sim_command(char* line, int number) {
+    static const char* const GESTURES[] = {
+        [APDS9960_UP] = "up",
+        [APDS9960_DOWN] = "down",
+        [APDS9960_LEFT] = "left",
+        [APDS9960_RIGHT] = "right",
+    };
+    char name[16];
+    int offset = 0;
+
+    sim_trim(line);
+    if (line[0] == '\0' || line[0] == '#' || sscanf(line, "%15s %n", name, &offset) != 1) {
+        return true;
+    }
+    char* args = line + offset;
+
+    if (strcmp(name, "wait") == 0) {
+        sim_sleep_us(atoll(args) * 1000);
+        return true;
+    }
+    if (strcmp(name, "gesture") == 0) {
+        for (uint8_t gesture = APDS9960_UP; gesture <= APDS9960_RIGHT; gesture++) {
+            if (strcmp(args, GESTURES[gesture]) == 0) {
+                sim_apds9960_gesture(gesture);
+                return true;
+            }
+        }
+    }
+    else if (strcmp(name, "expect") == 0) {
+        // The text starts after one space, leading spaces of the line are part of it
+        char* text = args;
+        int page = strtol(args, &text, 10);
+        if (text != args && page >= 0 && page < SIM_PANEL_PAGES) {
+            return sim_expect(page, *text == ' ' ? text + 1 : text);
+        }
+    }
+    else if (strcmp(name, "publish") == 0) {
+        char topic[128];
+        int payload = 0;
+        if (sscanf(args, "%127s %n", topic, &payload) == 1) {
+            if (sim_publish(topic, args + payload)) {
+                return true;
+            }
+            fprintf(stderr, "line %d: cannot publish, no broker\n", number);
+            return false;
+        }
+    }
+    else if (strcmp(name, "png") == 0) {
+        static uint8_t pixels[SIM_PANEL_WIDTH * SIM_PANEL_HEIGHT];
+        sim_ssd1306_get_pixels(pixels);
+        if (sim_save_png(args, pixels)) {
+            return true;
+        }
+        fprintf(stderr, "line %d: cannot write %s\n", number, args);
+        return false;
+    }
+
+    fprintf(stderr, "line %d: bad command \"%s\"\n", number, line);
+    return false;
+}
+
+int main(int argc, char** argv) {
+    int opt;
+
+    while ((opt = getopt(argc, argv, "qp:")) != -1) {
+        switch (opt) {
+        case 'q':
+            quiet = true;
+            break;
+        case 'p':
+            png_dir = optarg;
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-q] [-p png_dir] scenario.txt\n", argv[0]);
+            return 2;
+        }
+    }
+    if (optind != argc - 1) {
+        fprintf(stderr, "Usage: %s [-q] [-p png_dir] scenario.txt\n", argv[0]);
+        return 2;
+    }
+
+    FILE* scenario = fopen(argv[optind], "r");
+    if (scenario == NULL) {
+        perror(argv[optind]);
+        return 2;
+    }
+
+    // The firmware talks to a public broker on the target, the simulator stays on the host
+    setenv("MQTT_BROKER", "127.0.0.1", 0);
+
+    sim_ssd1306_init();
+    sim_apds9960_init();
+
+    pthread_t render;
+    pthread_create(&render, NULL, sim_render_task, NULL);
+    pthread_detach(render);
+
+    app_main();
+
+    char line[512];
+    int number = 0;
+    int failures = 0;
+    while (fgets(line, sizeof(line), scenario) != NULL) {
+        number++;
+        if (!sim_command(line, number)) {
+            failures++;
+        }
+    }
+    fclose(scenario);
+
+    // Let the last frame settle
+    sim_sleep_us(SIM_SETTLE_US + 2 * SIM_POLL_US);
+
+    sim_i2c_stats_t stats;
+    sim_i2c_get_stats(&stats);
+    printf("\nSimulated %lld ms: %d frames, %u I2C transactions (%u NACKed), %llu bytes, bus busy %lld ms\n",
+           (long long)(sim_time_us() / 1000), frames, stats.transactions, stats.nacks,
+           (unsigned long long)stats.bytes, (long long)(stats.busy_us / 1000));
+    printf("Scenario %s: %d failed command(s)\n", failures == 0 ? "passed" : "FAILED", failures);
+    fflush(stdout);
+
+    // The tasks of the firmware never return
+    exit(failures == 0 ? 0 : 1);
+}
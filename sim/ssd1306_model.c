@@ -0,0 +1,301 @@
+/**
+ * @file ssd1306_model.c
+ * @brief SSD1306 panel of the simulator on the I2C bus, see sim.h.
+ *
+ * The model parses the control bytes, the commands the driver in components/ssd1306 sends and the
+ * display RAM writes in page and horizontal addressing mode. Scrolling is accepted and ignored.
+ * The panel shows the RAM like a module mounted with segment remap (A1) and reverse COM scan (C8),
+ * the configuration of ssd1306_init(), so the picture is upright in that configuration.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#include <pthread.h>
+#include <string.h>
+
+#include "ssd1306.h"
+#include "font8x8_basic.h"
+
+#include "sim.h"
+
+// Longest command, the scroll setups carry 6 arguments
+#define SSD1306_MAX_CMD 8
+
+typedef struct {
+    sim_i2c_device_t dev;
+    pthread_mutex_t lock;
+
+    // Parser of the current transfer
+    bool control_next;      // The next byte is a control byte
+    bool data;              // The bytes are display RAM data
+    bool single;            // Only one byte follows the control byte
+    uint8_t cmd[SSD1306_MAX_CMD];
+    int cmd_len;
+    int cmd_args;
+
+    // Display RAM and its address pointer
+    uint8_t ram[SIM_PANEL_PAGES][SIM_PANEL_WIDTH];
+    int column;
+    int page;
+    bool horizontal;
+    int column_start;
+    int column_end;
+    int page_start;
+    int page_end;
+
+    // Panel state
+    bool on;
+    bool inverted;
+    bool remap;
+    bool com_reverse;
+    uint8_t contrast;
+
+    uint32_t changes;
+    int64_t last_change;
+} ssd1306_model_t;
+
+static ssd1306_model_t ssd1306_model;
+
+/**
+ * @brief Number of argument bytes after a command byte.
+ */
+static int ssd1306_cmd_args(uint8_t cmd) {
+    switch (cmd) {
+    case 0x20:  // Memory addressing mode
+    case 0x81:  // Contrast
+    case 0x8D:  // Charge pump
+    case 0xA8:  // Multiplex ratio
+    case 0xD3:  // Display offset
+    case 0xD5:  // Clock divide
+    case 0xD9:  // Pre-charge period
+    case 0xDA:  // COM pins
+    case 0xDB:  // VCOMH deselect level
+        return 1;
+    case 0x21:  // Column range
+    case 0x22:  // Page range
+    case 0xA3:  // Vertical scroll area
+        return 2;
+    case 0x29:  // Vertical and horizontal scroll
+    case 0x2A:
+        return 5;
+    case 0x26:  // Horizontal scroll
+    case 0x27:
+        return 6;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * @brief Marks a visible change of the panel.
+ */
+static void ssd1306_changed(ssd1306_model_t* model) {
+    model->changes++;
+    model->last_change = sim_time_us();
+}
+
+/**
+ * @brief Runs a complete command.
+ */
+static void ssd1306_command(ssd1306_model_t* model) {
+    uint8_t* cmd = model->cmd;
+
+    if (cmd[0] <= 0x0F) {
+        model->column = (model->column & 0xF0) | (cmd[0] & 0x0F);
+    }
+    else if (cmd[0] <= 0x1F) {
+        model->column = (model->column & 0x0F) | ((cmd[0] & 0x0F) << 4);
+    }
+    else if ((cmd[0] & 0xF8) == 0xB0) {
+        model->page = cmd[0] & 0x07;
+    }
+    else {
+        switch (cmd[0]) {
+        case 0x20:
+            model->horizontal = (cmd[1] & 0x03) == 0x00;
+            break;
+        case 0x21:
+            model->column_start = model->column = cmd[1] & 0x7F;
+            model->column_end = cmd[2] & 0x7F;
+            break;
+        case 0x22:
+            model->page_start = model->page = cmd[1] & 0x07;
+            model->page_end = cmd[2] & 0x07;
+            break;
+        case 0x81:
+            model->contrast = cmd[1];
+            ssd1306_changed(model);
+            break;
+        case 0xA0:
+        case 0xA1:
+            model->remap = cmd[0] & 0x01;
+            ssd1306_changed(model);
+            break;
+        case 0xA6:
+        case 0xA7:
+            model->inverted = cmd[0] & 0x01;
+            ssd1306_changed(model);
+            break;
+        case 0xAE:
+        case 0xAF:
+            model->on = cmd[0] & 0x01;
+            ssd1306_changed(model);
+            break;
+        case 0xC0:
+        case 0xC8:
+            model->com_reverse = cmd[0] & 0x08;
+            ssd1306_changed(model);
+            break;
+        default:
+            // Timing, charge pump, scrolling and the rest do not change the picture of the model
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Writes one byte to the display RAM and moves the address pointer.
+ */
+static void ssd1306_data(ssd1306_model_t* model, uint8_t byte) {
+    model->ram[model->page][model->column] = byte;
+
+    if (model->horizontal) {
+        if (model->column < model->column_end) {
+            model->column++;
+        }
+        else {
+            model->column = model->column_start;
+            model->page = model->page < model->page_end ? model->page + 1 : model->page_start;
+        }
+    }
+    else if (model->column < SIM_PANEL_WIDTH - 1) {
+        // Page addressing wraps to the start of the same page
+        model->column++;
+    }
+    else {
+        model->column = 0;
+    }
+}
+
+static void ssd1306_start(sim_i2c_device_t* dev, bool read) {
+    ssd1306_model_t* model = (ssd1306_model_t*)dev;
+
+    pthread_mutex_lock(&model->lock);
+    model->control_next = true;
+    model->cmd_len = 0;
+    pthread_mutex_unlock(&model->lock);
+}
+
+static void ssd1306_write(sim_i2c_device_t* dev, uint8_t byte) {
+    ssd1306_model_t* model = (ssd1306_model_t*)dev;
+
+    pthread_mutex_lock(&model->lock);
+    if (model->control_next) {
+        model->control_next = false;
+        model->data = byte & OLED_CONTROL_BYTE_DATA_STREAM;
+        model->single = byte & OLED_CONTROL_BYTE_CMD_SINGLE;
+    }
+    else {
+        if (model->data) {
+            ssd1306_data(model, byte);
+            ssd1306_changed(model);
+        }
+        else {
+            if (model->cmd_len == 0) {
+                model->cmd_args = ssd1306_cmd_args(byte);
+            }
+            model->cmd[model->cmd_len++] = byte;
+            if (model->cmd_len > model->cmd_args) {
+                ssd1306_command(model);
+                model->cmd_len = 0;
+            }
+        }
+
+        // With the continuation bit another control byte follows every byte
+        model->control_next = model->single;
+    }
+    pthread_mutex_unlock(&model->lock);
+}
+
+static uint8_t ssd1306_read(sim_i2c_device_t* dev) {
+    // Status read, the display is never busy
+    ssd1306_model_t* model = (ssd1306_model_t*)dev;
+
+    return model->on ? 0x00 : 0x40;
+}
+
+static void ssd1306_stop(sim_i2c_device_t* dev) {
+}
+
+void sim_ssd1306_init() {
+    ssd1306_model = (ssd1306_model_t) {
+        .dev = {
+            .address = I2CAddress,
+            .start = ssd1306_start,
+            .write = ssd1306_write,
+            .read = ssd1306_read,
+            .stop = ssd1306_stop,
+        },
+        .lock = PTHREAD_MUTEX_INITIALIZER,
+        .column_end = SIM_PANEL_WIDTH - 1,
+        .page_end = SIM_PANEL_PAGES - 1,
+        .contrast = 0x7F,
+    };
+
+    sim_i2c_attach(&ssd1306_model.dev);
+}
+
+uint32_t sim_ssd1306_get_pixels(uint8_t* pixels) {
+    ssd1306_model_t* model = &ssd1306_model;
+
+    pthread_mutex_lock(&model->lock);
+    // Lit pixels follow the contrast, they stay visible at the lowest setting
+    uint8_t lit = 64 + model->contrast * 191 / 255;
+
+    for (int y = 0; y < SIM_PANEL_HEIGHT; y++) {
+        int row = model->com_reverse ? y : SIM_PANEL_HEIGHT - 1 - y;
+        for (int x = 0; x < SIM_PANEL_WIDTH; x++) {
+            int column = model->remap ? x : SIM_PANEL_WIDTH - 1 - x;
+            bool on = (model->ram[row / 8][column] >> (row % 8)) & 0x01;
+            pixels[y * SIM_PANEL_WIDTH + x] = model->on && (on != model->inverted) ? lit : 0;
+        }
+    }
+    uint32_t changes = model->changes;
+    pthread_mutex_unlock(&model->lock);
+
+    return changes;
+}
+
+void sim_ssd1306_get_text(int page, char* text) {
+    ssd1306_model_t* model = &ssd1306_model;
+    uint8_t cell[8];
+    uint8_t inverted[8];
+
+    pthread_mutex_lock(&model->lock);
+    for (int i = 0; i < SIM_PANEL_WIDTH / 8; i++) {
+        memcpy(cell, &model->ram[page][i * 8], 8);
+
+        // Highlighted cells are inverted, the text is the same
+        for (int j = 0; j < 8; j++) {
+            inverted[j] = ~cell[j];
+        }
+
+        text[i] = '?';
+        for (int c = ' '; c < 128; c++) {
+            if (memcmp(cell, font8x8_basic_tr[c], 8) == 0 || memcmp(inverted, font8x8_basic_tr[c], 8) == 0) {
+                text[i] = c;
+                break;
+            }
+        }
+    }
+    text[SIM_PANEL_WIDTH / 8] = '\0';
+    pthread_mutex_unlock(&model->lock);
+}
+
+int64_t sim_ssd1306_last_change() {
+    pthread_mutex_lock(&ssd1306_model.lock);
+    int64_t last_change = ssd1306_model.last_change;
+    pthread_mutex_unlock(&ssd1306_model.lock);
+
+    return last_change;
+}
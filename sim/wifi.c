@@ -0,0 +1,303 @@
+/**
+ * @file wifi.c
+ * @brief Default event loop, network interface and Wi-Fi station of the simulator.
+ *
+ * The station is always associated to one access point: esp_wifi_start() raises
+ * WIFI_EVENT_STA_START and esp_wifi_connect() raises WIFI_EVENT_STA_CONNECTED and
+ * IP_EVENT_STA_GOT_IP. The sockets of the MQTT client use the network of the host.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_event.h"
+#include "esp_log.h"
+#include "esp_netif.h"
+#include "esp_wifi.h"
+
+#define TAG_SIM_WIFI "SIM_WIFI"
+
+// Event data is copied into the event, the largest one of the firmware fits
+#define SIM_EVENT_DATA_LEN 64
+
+// Channel and BSSID of the simulated access point
+#define SIM_AP_CHANNEL 6
+static const uint8_t SIM_AP_BSSID[6] = { 0x02, 0x00, 0x5e, 0x00, 0x00, 0x01 };
+
+ESP_EVENT_DEFINE_BASE(WIFI_EVENT);
+ESP_EVENT_DEFINE_BASE(IP_EVENT);
+
+typedef struct sim_handler {
+    esp_event_base_t base;
+    int32_t id;
+    esp_event_handler_t handler;
+    void* arg;
+    struct sim_handler* next;
+} sim_handler_t;
+
+typedef struct sim_event {
+    esp_event_base_t base;
+    int32_t id;
+    uint8_t data[SIM_EVENT_DATA_LEN];
+    struct sim_event* next;
+} sim_event_t;
+
+struct esp_netif_obj {
+    esp_netif_ip_info_t ip;
+    esp_netif_dns_info_t dns;
+};
+
+static sim_handler_t* sim_handlers = NULL;
+static sim_event_t* sim_events_head = NULL;
+static sim_event_t* sim_events_tail = NULL;
+static pthread_mutex_t sim_event_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sim_event_posted = PTHREAD_COND_INITIALIZER;
+static bool sim_event_loop_created = false;
+
+static struct esp_netif_obj sim_netif;
+static wifi_config_t sim_wifi_config;
+static bool sim_wifi_connected = false;
+
+/**
+ * @brief Event thread, runs the handlers of every posted event in order.
+ *
+ * @param arg Thread argument (unused).
+ */
+static void* sim_event_task(void* arg) {
+    while (1) {
+        pthread_mutex_lock(&sim_event_lock);
+        while (sim_events_head == NULL) {
+            pthread_cond_wait(&sim_event_posted, &sim_event_lock);
+        }
+        sim_event_t* event = sim_events_head;
+        sim_events_head = event->next;
+        if (sim_events_head == NULL) {
+            sim_events_tail = NULL;
+        }
+        sim_handler_t* handlers = sim_handlers;
+        pthread_mutex_unlock(&sim_event_lock);
+
+        // Handlers are only added in front, the list behind the head does not change
+        for (sim_handler_t* handler = handlers; handler != NULL; handler = handler->next) {
+            if ((handler->base == ESP_EVENT_ANY_BASE || handler->base == event->base) &&
+                (handler->id == ESP_EVENT_ANY_ID || handler->id == event->id)) {
+                handler->handler(handler->arg, event->base, event->id, event->data);
+            }
+        }
+
+        free(event);
+    }
+
+    return NULL;
+}
+
+esp_err_t esp_event_loop_create_default() {
+    pthread_t thread;
+
+    if (sim_event_loop_created) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (pthread_create(&thread, NULL, sim_event_task, NULL) != 0) {
+        return ESP_FAIL;
+    }
+    pthread_detach(thread);
+    sim_event_loop_created = true;
+
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_register(esp_event_base_t event_base, int32_t event_id, esp_event_handler_t event_handler,
+                                     void* event_handler_arg) {
+    sim_handler_t* handler = calloc(1, sizeof(sim_handler_t));
+    if (handler == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    handler->base = event_base;
+    handler->id = event_id;
+    handler->handler = event_handler;
+    handler->arg = event_handler_arg;
+
+    pthread_mutex_lock(&sim_event_lock);
+    handler->next = sim_handlers;
+    sim_handlers = handler;
+    pthread_mutex_unlock(&sim_event_lock);
+
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_instance_register(esp_event_base_t event_base, int32_t event_id,
+                                              esp_event_handler_t event_handler, void* event_handler_arg,
+                                              esp_event_handler_instance_t* instance) {
+    return esp_event_handler_register(event_base, event_id, event_handler, event_handler_arg);
+}
+
+esp_err_t esp_event_post(esp_event_base_t event_base, int32_t event_id, const void* event_data,
+                         size_t event_data_size, TickType_t ticks_to_wait) {
+    if (!sim_event_loop_created) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (event_data_size > SIM_EVENT_DATA_LEN) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    sim_event_t* event = calloc(1, sizeof(sim_event_t));
+    if (event == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    event->base = event_base;
+    event->id = event_id;
+    if (event_data != NULL) {
+        memcpy(event->data, event_data, event_data_size);
+    }
+
+    pthread_mutex_lock(&sim_event_lock);
+    if (sim_events_tail != NULL) {
+        sim_events_tail->next = event;
+    }
+    else {
+        sim_events_head = event;
+    }
+    sim_events_tail = event;
+    pthread_cond_signal(&sim_event_posted);
+    pthread_mutex_unlock(&sim_event_lock);
+
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_init() {
+    return ESP_OK;
+}
+
+esp_netif_t* esp_netif_create_default_wifi_sta() {
+    // Loopback, the broker of a simulation runs on the same host
+    esp_netif_str_to_ip4("127.0.0.1", &sim_netif.ip.ip);
+    esp_netif_str_to_ip4("255.0.0.0", &sim_netif.ip.netmask);
+    esp_netif_str_to_ip4("127.0.0.1", &sim_netif.ip.gw);
+    esp_netif_str_to_ip4("127.0.0.1", &sim_netif.dns.ip.u_addr.ip4);
+    sim_netif.dns.ip.type = ESP_IPADDR_TYPE_V4;
+
+    return &sim_netif;
+}
+
+esp_err_t esp_netif_get_ip_info(esp_netif_t* esp_netif, esp_netif_ip_info_t* ip_info) {
+    *ip_info = esp_netif->ip;
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_set_ip_info(esp_netif_t* esp_netif, const esp_netif_ip_info_t* ip_info) {
+    // Setting the address raises IP_EVENT_STA_GOT_IP on the target
+    esp_netif->ip = *ip_info;
+    return esp_event_post(IP_EVENT, IP_EVENT_STA_GOT_IP, NULL, 0, 0);
+}
+
+esp_err_t esp_netif_get_dns_info(esp_netif_t* esp_netif, esp_netif_dns_type_t type, esp_netif_dns_info_t* dns) {
+    *dns = esp_netif->dns;
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_set_dns_info(esp_netif_t* esp_netif, esp_netif_dns_type_t type, esp_netif_dns_info_t* dns) {
+    esp_netif->dns = *dns;
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_dhcpc_start(esp_netif_t* esp_netif) {
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_dhcpc_stop(esp_netif_t* esp_netif) {
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_str_to_ip4(const char* src, esp_ip4_addr_t* dst) {
+    struct in_addr addr;
+
+    if (inet_pton(AF_INET, src, &addr) != 1) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    dst->addr = addr.s_addr;
+
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_init(const wifi_init_config_t* config) {
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_storage(wifi_storage_t storage) {
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode) {
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_config(wifi_interface_t interface, wifi_config_t* conf) {
+    sim_wifi_config = *conf;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_config(wifi_interface_t interface, wifi_config_t* conf) {
+    *conf = sim_wifi_config;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_start() {
+    return esp_event_post(WIFI_EVENT, WIFI_EVENT_STA_START, NULL, 0, 0);
+}
+
+esp_err_t esp_wifi_stop() {
+    sim_wifi_connected = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_connect() {
+    ESP_LOGI(TAG_SIM_WIFI, "Associated with the simulated access point \"%s\"", (char*)sim_wifi_config.sta.ssid);
+    sim_wifi_connected = true;
+
+    // wifi_link sets the address itself in the static and lease reuse modes, DHCP answers otherwise
+    esp_event_post(WIFI_EVENT, WIFI_EVENT_STA_CONNECTED, NULL, 0, 0);
+#if !CONFIG_APP_WIFI_STATIC_IP && !CONFIG_APP_WIFI_LEASE_REUSE
+    esp_event_post(IP_EVENT, IP_EVENT_STA_GOT_IP, NULL, 0, 0);
+#endif
+
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_disconnect() {
+    wifi_event_sta_disconnected_t event = {
+        .reason = 8,    // WIFI_REASON_ASSOC_LEAVE
+    };
+
+    sim_wifi_connected = false;
+
+    return esp_event_post(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, &event, sizeof(event), 0);
+}
+
+esp_err_t esp_wifi_sta_get_ap_info(wifi_ap_record_t* ap_info) {
+    if (!sim_wifi_connected) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    memset(ap_info, 0, sizeof(*ap_info));
+    memcpy(ap_info->bssid, SIM_AP_BSSID, sizeof(SIM_AP_BSSID));
+    memcpy(ap_info->ssid, sim_wifi_config.sta.ssid, sizeof(sim_wifi_config.sta.ssid));
+    ap_info->primary = SIM_AP_CHANNEL;
+    ap_info->rssi = -40;
+
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_ps(wifi_ps_type_t type) {
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_channel(uint8_t primary, wifi_second_chan_t second) {
+    return ESP_OK;
+}
@@ -0,0 +1,139 @@
+/**
+ * @file cpu_load.c
+ * @brief Per task cpu load report built on the FreeRTOS run time counters, see cpu_load.h.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#include "cpu_load.h"
+
+#include <inttypes.h>
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+
+#define TAG_CPU_LOAD "CPU_LOAD"
+
+#if CONFIG_APP_CPU_LOAD_REPORT
+
+// Maximum number of tasks in one report, the app, Wi-Fi, lwIP and esp-mqtt stay well below it
+#define CPU_LOAD_MAX_TASKS 32
+
+typedef struct {
+    TaskHandle_t handle;
+    uint32_t runtime;
+} cpu_load_sample_t;
+
+// Snapshots are kept static, a TaskStatus_t array of this size does not belong on a task stack
+static TaskStatus_t cpu_load_status[CPU_LOAD_MAX_TASKS];
+static cpu_load_sample_t cpu_load_prev[CPU_LOAD_MAX_TASKS];
+static UBaseType_t cpu_load_prev_count = 0;
+static uint32_t cpu_load_prev_total = 0;
+
+/**
+ * @brief Returns the run time counter a task had at the previous report, 0 for a new task.
+ */
+static uint32_t cpu_load_prev_runtime(TaskHandle_t handle) {
+    for (UBaseType_t i = 0; i < cpu_load_prev_count; i++) {
+        if (cpu_load_prev[i].handle == handle) {
+            return cpu_load_prev[i].runtime;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Keeps the counters of the last snapshot for the next report.
+ */
+static void cpu_load_keep(UBaseType_t count, uint32_t total) {
+    for (UBaseType_t i = 0; i < count; i++) {
+        cpu_load_prev[i].handle = cpu_load_status[i].xHandle;
+        cpu_load_prev[i].runtime = cpu_load_status[i].ulRunTimeCounter;
+    }
+    cpu_load_prev_count = count;
+    cpu_load_prev_total = total;
+}
+
+/**
+ * @brief Logs the load of every task and core since the previous report.
+ *
+ * The run time counters count microseconds of esp_timer time. The total returned by
+ * uxTaskGetSystemState is the time of one core, so the load of a task is the share of its core.
+ * Core load is whatever the idle task of that core did not get.
+ */
+static void cpu_load_report() {
+    uint32_t total;
+    UBaseType_t count = uxTaskGetSystemState(cpu_load_status, CPU_LOAD_MAX_TASKS, &total);
+    if (count == 0) {
+        ESP_LOGW(TAG_CPU_LOAD, "More than %d tasks, report skipped", CPU_LOAD_MAX_TASKS);
+        return;
+    }
+
+    uint32_t elapsed = total - cpu_load_prev_total;
+    if (elapsed == 0) {
+        return;
+    }
+
+    uint32_t idle[portNUM_PROCESSORS] = { 0 };
+
+    ESP_LOGI(TAG_CPU_LOAD, "%-16s %4s %4s %6s", "task", "core", "prio", "load");
+    for (UBaseType_t i = 0; i < count; i++) {
+        TaskStatus_t* task = &cpu_load_status[i];
+        uint32_t delta = task->ulRunTimeCounter - cpu_load_prev_runtime(task->xHandle);
+        uint32_t permille = (uint32_t)((uint64_t)delta * 1000 / elapsed);
+        BaseType_t core = xTaskGetAffinity(task->xHandle);
+
+        for (int c = 0; c < portNUM_PROCESSORS; c++) {
+            if (task->xHandle == xTaskGetIdleTaskHandleForCPU(c)) {
+                idle[c] = permille;
+            }
+        }
+
+        if (core == tskNO_AFFINITY) {
+            ESP_LOGI(TAG_CPU_LOAD, "%-16s %4s %4u %3" PRIu32 ".%" PRIu32 "%%", task->pcTaskName, "-",
+                     (unsigned)task->uxCurrentPriority, permille / 10, permille % 10);
+        }
+        else {
+            ESP_LOGI(TAG_CPU_LOAD, "%-16s %4d %4u %3" PRIu32 ".%" PRIu32 "%%", task->pcTaskName, (int)core,
+                     (unsigned)task->uxCurrentPriority, permille / 10, permille % 10);
+        }
+    }
+
+    for (int c = 0; c < portNUM_PROCESSORS; c++) {
+        uint32_t load = idle[c] < 1000 ? 1000 - idle[c] : 0;
+        ESP_LOGI(TAG_CPU_LOAD, "core %d load %" PRIu32 ".%" PRIu32 "%%", c, load / 10, load % 10);
+    }
+
+    // Only overwrite the previous snapshot now, the task order may differ between two snapshots
+    cpu_load_keep(count, total);
+}
+
+/**
+ * @brief Report task, logs the load every CONFIG_APP_CPU_LOAD_PERIOD_MS.
+ *
+ * @param param Task parameter (unused).
+ */
+static void cpu_load_task(void* param) {
+    // Reference snapshot, so the first report covers one period and not the time since boot
+    uint32_t total;
+    UBaseType_t count = uxTaskGetSystemState(cpu_load_status, CPU_LOAD_MAX_TASKS, &total);
+    cpu_load_keep(count, total);
+
+    while (1) {
+        vTaskDelay(CONFIG_APP_CPU_LOAD_PERIOD_MS / portTICK_PERIOD_MS);
+        cpu_load_report();
+    }
+}
+
+void cpu_load_start() {
+    xTaskCreatePinnedToCore(cpu_load_task, "cpu_load", 3072, NULL, tskIDLE_PRIORITY + 1, NULL, CONFIG_APP_NET_CORE);
+}
+
+#else
+
+void cpu_load_start() {
+}
+
+#endif
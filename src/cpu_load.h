@@ -0,0 +1,20 @@
+/**
+ * @file cpu_load.h
+ * @brief Periodic report of the cpu load of every task, enabled by CONFIG_APP_CPU_LOAD_REPORT.
+ *
+ * Every CONFIG_APP_CPU_LOAD_PERIOD_MS the report logs, for each task, its core, priority and the
+ * share of a core it used since the previous report, followed by the load of both cores. It is
+ * used to check that the sensor and UI core stays free while the network core is busy.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#ifndef CPU_LOAD_H
+#define CPU_LOAD_H
+
+/**
+ * @brief Starts the report task on the network core, does nothing when the report is disabled.
+ */
+void cpu_load_start();
+
+#endif
@@ -0,0 +1,112 @@
+/**
+ * @file display.c
+ * @brief Initialisation of the display backend selected in menuconfig, see display.h.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#include "display.h"
+
+#include "driver/gpio.h"
+#include "esp_log.h"
+#include "esp_system.h"
+
+#define TAG_DISPLAY "DISPLAY"
+
+display_dev_t display_dev;
+
+int64_t display_frame_us = -1;
+int64_t display_frame_start = 0;
+int64_t display_frame_done = 0;
+
+/**
+ * @brief Releases the reset line the duty cycled station holds over deep sleep, see station.c.
+ */
+static void display_release_reset() {
+#if CONFIG_APP_IDLE_DEEP_SLEEP
+    if (DISPLAY_RESET_GPIO >= 0) {
+        gpio_hold_dis(DISPLAY_RESET_GPIO);
+    }
+#endif
+}
+
+#if CONFIG_DISPLAY_TFT
+
+// Colours of the UI on the colour panel
+#define DISPLAY_FG TFT_WHITE
+#define DISPLAY_BG TFT_RGB565(0, 32, 96)
+
+void display_init() {
+    display_release_reset();
+
+    ESP_LOGI(TAG_DISPLAY, "INTERFACE is i2s lcd");
+    ESP_LOGI(TAG_DISPLAY, "CONFIG_TFT_WR_GPIO=%d", CONFIG_TFT_WR_GPIO);
+    ESP_LOGI(TAG_DISPLAY, "CONFIG_TFT_RS_GPIO=%d", CONFIG_TFT_RS_GPIO);
+    ESP_LOGI(TAG_DISPLAY, "CONFIG_TFT_CS_GPIO=%d", CONFIG_TFT_CS_GPIO);
+    ESP_LOGI(TAG_DISPLAY, "CONFIG_TFT_RESET_GPIO=%d", CONFIG_TFT_RESET_GPIO);
+
+    i2s_lcd_config_t config = {
+        .data_width = 8,
+        .pin_data_num = {
+            CONFIG_TFT_D0_GPIO, CONFIG_TFT_D1_GPIO, CONFIG_TFT_D2_GPIO, CONFIG_TFT_D3_GPIO,
+            CONFIG_TFT_D4_GPIO, CONFIG_TFT_D5_GPIO, CONFIG_TFT_D6_GPIO, CONFIG_TFT_D7_GPIO,
+        },
+        .pin_num_cs = CONFIG_TFT_CS_GPIO,
+        .pin_num_wr = CONFIG_TFT_WR_GPIO,
+        .pin_num_rs = CONFIG_TFT_RS_GPIO,
+        .clk_freq = CONFIG_TFT_CLK_FREQ,
+        .i2s_port = I2S_NUM_0,
+        .buffer_size = CONFIG_TFT_BUFFER_SIZE,
+        // RGB565 goes out high byte first
+        .swap_data = true,
+    };
+
+    if (tft_init(&display_dev, &config, CONFIG_TFT_WIDTH, CONFIG_TFT_HEIGHT, CONFIG_TFT_RESET_GPIO) != ESP_OK) {
+        ESP_LOGE(TAG_DISPLAY, "tft_init failed");
+        esp_restart();
+    }
+    tft_set_colors(&display_dev, DISPLAY_FG, DISPLAY_BG);
+}
+
+void display_contrast(int contrast) {
+    tft_contrast(&display_dev, contrast);
+}
+
+#else
+
+void display_init() {
+    display_release_reset();
+
+#if CONFIG_I2C_INTERFACE
+    ESP_LOGI(TAG_DISPLAY, "INTERFACE is i2c");
+    ESP_LOGI(TAG_DISPLAY, "CONFIG_SDA_GPIO=%d", CONFIG_SDA_GPIO);
+    ESP_LOGI(TAG_DISPLAY, "CONFIG_SCL_GPIO=%d", CONFIG_SCL_GPIO);
+    ESP_LOGI(TAG_DISPLAY, "CONFIG_RESET_GPIO=%d", CONFIG_RESET_GPIO);
+    i2c_master_init(&display_dev, CONFIG_SDA_GPIO, CONFIG_SCL_GPIO, CONFIG_RESET_GPIO);
+#else
+    ESP_LOGI(TAG_DISPLAY, "INTERFACE is SPI");
+    ESP_LOGI(TAG_DISPLAY, "CONFIG_MOSI_GPIO=%d", CONFIG_MOSI_GPIO);
+    ESP_LOGI(TAG_DISPLAY, "CONFIG_SCLK_GPIO=%d", CONFIG_SCLK_GPIO);
+    ESP_LOGI(TAG_DISPLAY, "CONFIG_CS_GPIO=%d", CONFIG_CS_GPIO);
+    ESP_LOGI(TAG_DISPLAY, "CONFIG_DC_GPIO=%d", CONFIG_DC_GPIO);
+    ESP_LOGI(TAG_DISPLAY, "CONFIG_RESET_GPIO=%d", CONFIG_RESET_GPIO);
+    spi_master_init(&display_dev, CONFIG_MOSI_GPIO, CONFIG_SCLK_GPIO, CONFIG_CS_GPIO, CONFIG_DC_GPIO, CONFIG_RESET_GPIO);
+#endif
+
+#if CONFIG_SSD1306_128x32
+    ESP_LOGI(TAG_DISPLAY, "Panel is 128x32");
+    ssd1306_init(&display_dev, 128, 32);
+#else
+    ESP_LOGI(TAG_DISPLAY, "Panel is 128x64");
+    ssd1306_init(&display_dev, 128, 64);
+#endif
+#if CONFIG_FLIP
+    display_dev._flip = true;
+#endif
+}
+
+void display_contrast(int contrast) {
+    ssd1306_contrast(&display_dev, contrast);
+}
+
+#endif
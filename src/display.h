@@ -0,0 +1,169 @@
+/**
+ * @file display.h
+ * @brief Display HAL used by the views.
+ *
+ * The views draw on a 128x64 text grid of 16 columns and 8 lines. The backend, its transport and
+ * its pixel format are fixed at compile time by menuconfig:
+ *  - CONFIG_DISPLAY_SSD1306: monochrome OLED over SPI or I2C (CONFIG_SPI_INTERFACE / CONFIG_I2C_INTERFACE),
+ *    one bit per pixel in vertical bytes per page.
+ *  - CONFIG_DISPLAY_TFT: colour ILI9341/ST7789 over the i2s/8080 lcd bus, RGB565.
+ * The draw and flush calls are inline and resolve to the backend directly, without any runtime
+ * dispatch.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+#include <stdbool.h>
+
+#include "sdkconfig.h"
+#include "esp_timer.h"
+
+#include "metrics.h"
+
+#if CONFIG_DISPLAY_TFT
+#include "tft.h"
+typedef TFT_t display_dev_t;
+#define DISPLAY_PIXEL_BITS 16   // RGB565
+#define DISPLAY_RESET_GPIO CONFIG_TFT_RESET_GPIO
+#else
+#include "ssd1306.h"
+typedef SSD1306_t display_dev_t;
+#define DISPLAY_PIXEL_BITS 1    // Pages of vertical bytes
+#define DISPLAY_RESET_GPIO CONFIG_RESET_GPIO
+#endif
+
+/**
+ * @brief Device of the backend, only to be used through the functions below.
+ */
+extern display_dev_t display_dev;
+
+/**
+ * @brief Time spent in draw calls since the last flush, -1 if nothing was drawn, for the redraw metric.
+ */
+extern int64_t display_frame_us;
+
+/**
+ * @brief Time the first draw call after the last flush started, when the view began to render.
+ */
+extern int64_t display_frame_start;
+
+/**
+ * @brief Time the last bytes were pushed to the panel, when the view drawn so far became visible.
+ */
+extern int64_t display_frame_done;
+
+/**
+ * @brief Ends one draw call, adds its time to the frame and its bytes to the display metric.
+ *
+ * @param start Time the draw call started.
+ * @param bytes Bytes the call pushed to the panel.
+ */
+static inline void display_draw_done(int64_t start, int bytes) {
+    int64_t end = esp_timer_get_time();
+
+    if (display_frame_us < 0) {
+        display_frame_us = 0;
+        display_frame_start = start;
+    }
+    display_frame_us += end - start;
+
+    if (bytes > 0) {
+        display_frame_done = end;
+        metrics_count(METRICS_DISPLAY_BYTES, bytes);
+    }
+}
+
+/**
+ * @brief Initializes the display selected in menuconfig.
+ */
+void display_init();
+
+/**
+ * @brief Clears the whole screen.
+ *
+ * @param invert Fill with the foreground colour instead of the background.
+ */
+static inline void display_clear_screen(bool invert) {
+    int64_t start = esp_timer_get_time();
+
+#if CONFIG_DISPLAY_TFT
+    tft_clear_screen(&display_dev, invert);
+    display_draw_done(start, display_dev._frame == NULL ? display_dev._width * display_dev._height * 2 : 0);
+#else
+    ssd1306_clear_screen(&display_dev, invert);
+    display_draw_done(start, display_dev._pages * 128);
+#endif
+}
+
+/**
+ * @brief Sets the contrast, or the backlight brightness of a TFT panel.
+ *
+ * @param contrast Value from 0 to 255.
+ */
+void display_contrast(int contrast);
+
+/**
+ * @brief Switches the panel off or on again, the picture on it is kept.
+ *
+ * @param on Show the panel.
+ */
+static inline void display_power(bool on) {
+#if CONFIG_DISPLAY_TFT
+    tft_display_on(&display_dev, on);
+#else
+    ssd1306_display_on(&display_dev, on);
+#endif
+}
+
+/**
+ * @brief Draws a line of text on the grid.
+ *
+ * @param line Line from 0 to 7.
+ * @param text Text to draw, at most 16 characters are shown.
+ * @param text_len Length of the text.
+ * @param invert Swap the foreground and background colours.
+ */
+static inline void display_text(int line, char* text, int text_len, bool invert) {
+    int64_t start = esp_timer_get_time();
+    int chars = text_len < 16 ? text_len : 16;
+
+#if CONFIG_DISPLAY_TFT
+    tft_display_text(&display_dev, line, text, text_len, invert);
+    // 8x8 cells of RGB565 scaled up to the panel, a frame is counted by the flush
+    display_draw_done(start, display_dev._frame == NULL ? chars * 64 * display_dev._scale * display_dev._scale * 2 : 0);
+#else
+    ssd1306_display_text(&display_dev, line, text, text_len, invert);
+    display_draw_done(start, line < display_dev._pages ? chars * 8 : 0);
+#endif
+}
+
+/**
+ * @brief Pushes everything drawn so far to the panel.
+ *
+ * Only the TFT with a PSRAM frame buffers the drawing, the other backends draw immediately.
+ */
+static inline void display_flush() {
+    int64_t start = esp_timer_get_time();
+    bool drawn = display_frame_us >= 0;     // A flush without any draw before it is not a redraw
+
+#if CONFIG_DISPLAY_TFT
+    int bytes = 0;
+    if (display_dev._frame != NULL && display_dev._dirtyY0 < display_dev._dirtyY1) {
+        bytes = (display_dev._dirtyY1 - display_dev._dirtyY0) * display_dev._width * 2;
+    }
+    tft_flush(&display_dev);
+    display_draw_done(start, bytes);
+#else
+    display_draw_done(start, 0);
+#endif
+
+    if (drawn) {
+        metrics_observe(METRICS_REDRAW_US, display_frame_us);
+    }
+    display_frame_us = -1;
+}
+
+#endif
@@ -0,0 +1,153 @@
+/**
+ * @file espnow_link.c
+ * @brief Broadcast of compact telemetry frames over ESP-NOW, see espnow_link.h.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#include "espnow_link.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "sdkconfig.h"
+#include "esp_log.h"
+#include "esp_now.h"
+#include "esp_wifi.h"
+
+#define TAG_ESPNOW "ESPNOW"
+
+#if CONFIG_APP_ESPNOW_GATEWAY || CONFIG_APP_ESPNOW_DISPLAY
+
+static const uint8_t ESPNOW_LINK_BROADCAST[ESP_NOW_ETH_ALEN] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+
+static espnow_link_telemetry_cb_t espnow_link_on_telemetry = NULL;
+static espnow_link_city_cb_t espnow_link_on_city = NULL;
+
+// Sequence number of the next frame, lets a display log lost frames
+static uint16_t espnow_link_seq = 0;
+
+/**
+ * @brief Converts a reading like "24.4 C" into tenths of its unit.
+ *
+ * @param text Reading as received over MQTT.
+ * @return Tenths of the value, ESPNOW_LINK_NO_VALUE if there is no number.
+ */
+static int16_t espnow_link_encode(const char* text) {
+    char* end;
+    float value = strtof(text, &end);
+
+    if (end == text || value * 10 > INT16_MAX || value * 10 <= INT16_MIN) {
+        return ESPNOW_LINK_NO_VALUE;
+    }
+
+    return (int16_t)(value * 10 + (value < 0 ? -0.5f : 0.5f));
+}
+
+/**
+ * @brief Sends one frame to every station on the channel.
+ *
+ * @param frame Frame with everything but magic, version and seq set.
+ */
+static void espnow_link_broadcast(espnow_link_frame_t* frame) {
+    frame->magic = ESPNOW_LINK_MAGIC;
+    frame->version = ESPNOW_LINK_VERSION;
+    frame->seq = espnow_link_seq++;
+
+    esp_err_t ret = esp_now_send(ESPNOW_LINK_BROADCAST, (const uint8_t*)frame, sizeof(*frame));
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG_ESPNOW, "Frame not sent: %s", esp_err_to_name(ret));
+    }
+}
+
+/**
+ * @brief ESP-NOW receive callback, runs in the Wi-Fi task.
+ *
+ * @param info Sender of the frame.
+ * @param data Frame.
+ * @param len Length of the frame.
+ */
+static void espnow_link_recv(const esp_now_recv_info_t* info, const uint8_t* data, int len) {
+    if (len != sizeof(espnow_link_frame_t)) {
+        return;
+    }
+
+    // The frame may be unaligned in the receive buffer
+    espnow_link_frame_t frame;
+    memcpy(&frame, data, sizeof(frame));
+
+    if (frame.magic != ESPNOW_LINK_MAGIC || frame.version != ESPNOW_LINK_VERSION) {
+        return;
+    }
+
+    if (frame.type == ESPNOW_LINK_TELEMETRY && espnow_link_on_telemetry != NULL) {
+        espnow_link_on_telemetry(&frame);
+    }
+    else if (frame.type == ESPNOW_LINK_CITY && espnow_link_on_city != NULL) {
+        ESP_LOGI(TAG_ESPNOW, "City %d requested by " MACSTR, frame.city, MAC2STR(info->src_addr));
+        espnow_link_on_city(frame.city);
+    }
+}
+
+void espnow_link_init(espnow_link_telemetry_cb_t on_telemetry, espnow_link_city_cb_t on_city) {
+    espnow_link_on_telemetry = on_telemetry;
+    espnow_link_on_city = on_city;
+
+#if CONFIG_APP_ESPNOW_DISPLAY
+    // A display is not associated, it listens on the channel of the gateway's access point
+    ESP_ERROR_CHECK(esp_wifi_set_channel(CONFIG_APP_ESPNOW_CHANNEL, WIFI_SECOND_CHAN_NONE));
+#endif
+
+    ESP_ERROR_CHECK(esp_now_init());
+    ESP_ERROR_CHECK(esp_now_register_recv_cb(espnow_link_recv));
+
+    // Channel 0 follows the current channel of the radio, the gateway's one moves with its access point
+    esp_now_peer_info_t peer = {
+        .channel = 0,
+        .ifidx = WIFI_IF_STA,
+        .encrypt = false,
+    };
+    memcpy(peer.peer_addr, ESPNOW_LINK_BROADCAST, ESP_NOW_ETH_ALEN);
+    ESP_ERROR_CHECK(esp_now_add_peer(&peer));
+}
+
+void espnow_link_send_telemetry(int city, const char* temperature, const char* humidity, const char* visibility) {
+#if CONFIG_APP_ESPNOW_GATEWAY
+    espnow_link_frame_t frame = {
+        .type = ESPNOW_LINK_TELEMETRY,
+        .city = city,
+        .temperature = espnow_link_encode(temperature),
+        .humidity = espnow_link_encode(humidity),
+        .visibility = espnow_link_encode(visibility),
+    };
+
+    espnow_link_broadcast(&frame);
+#endif
+}
+
+void espnow_link_request_city(int city) {
+#if CONFIG_APP_ESPNOW_DISPLAY
+    espnow_link_frame_t frame = {
+        .type = ESPNOW_LINK_CITY,
+        .city = city,
+        .temperature = ESPNOW_LINK_NO_VALUE,
+        .humidity = ESPNOW_LINK_NO_VALUE,
+        .visibility = ESPNOW_LINK_NO_VALUE,
+    };
+
+    espnow_link_broadcast(&frame);
+#endif
+}
+
+#else
+
+void espnow_link_init(espnow_link_telemetry_cb_t on_telemetry, espnow_link_city_cb_t on_city) {
+}
+
+void espnow_link_send_telemetry(int city, const char* temperature, const char* humidity, const char* visibility) {
+}
+
+void espnow_link_request_city(int city) {
+}
+
+#endif
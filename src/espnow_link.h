@@ -0,0 +1,82 @@
+/**
+ * @file espnow_link.h
+ * @brief Local ESP-NOW telemetry between stations, enabled by CONFIG_APP_ESPNOW_GATEWAY or
+ *        CONFIG_APP_ESPNOW_DISPLAY.
+ *
+ * The gateway is a normal station that gets the data over MQTT. It broadcasts every [DATA] message
+ * it receives as one compact binary frame. Display stations do not associate with an access point
+ * and do not talk to the broker. They listen on CONFIG_APP_ESPNOW_CHANNEL, which has to be the
+ * channel of the gateway's access point. A display that selects another city broadcasts a request,
+ * and the gateway publishes it to the broker in its place.
+ *
+ * Frames are broadcast and therefore not encrypted. Each one starts with a magic byte and a version.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#ifndef ESPNOW_LINK_H
+#define ESPNOW_LINK_H
+
+#include <stdint.h>
+
+#define ESPNOW_LINK_MAGIC 0x4D    // 'M'
+#define ESPNOW_LINK_VERSION 1
+
+// Value of a reading the gateway could not parse
+#define ESPNOW_LINK_NO_VALUE INT16_MIN
+
+typedef enum {
+    ESPNOW_LINK_TELEMETRY = 0,  // Gateway to displays
+    ESPNOW_LINK_CITY,           // Display to gateway
+} espnow_link_type_t;
+
+// 12 bytes on air instead of the ~40 byte text message, readings in tenths of their unit
+typedef struct __attribute__((packed)) {
+    uint8_t magic;
+    uint8_t version;
+    uint8_t type;
+    uint8_t city;
+    uint16_t seq;
+    int16_t temperature;    // 0.1 C
+    int16_t humidity;       // 0.1 %
+    int16_t visibility;     // 0.1 %
+} espnow_link_frame_t;
+
+/**
+ * @brief Called with every telemetry frame a display receives, from the Wi-Fi task.
+ */
+typedef void (*espnow_link_telemetry_cb_t)(const espnow_link_frame_t* frame);
+
+/**
+ * @brief Called with every city request the gateway receives, from the Wi-Fi task.
+ */
+typedef void (*espnow_link_city_cb_t)(int city);
+
+/**
+ * @brief Starts ESP-NOW, Wi-Fi has to be started before.
+ *
+ * A display also tunes the radio to CONFIG_APP_ESPNOW_CHANNEL. Does nothing when ESP-NOW is disabled.
+ *
+ * @param on_telemetry Telemetry callback of a display, may be NULL on the gateway.
+ * @param on_city City request callback of the gateway, may be NULL on a display.
+ */
+void espnow_link_init(espnow_link_telemetry_cb_t on_telemetry, espnow_link_city_cb_t on_city);
+
+/**
+ * @brief Broadcasts the data of a city to the displays, only on the gateway.
+ *
+ * @param city Index of the city in CITY_CONFIG.
+ * @param temperature Temperature as received over MQTT, "24.4 C".
+ * @param humidity Humidity as received over MQTT, "46.3 %".
+ * @param visibility Visibility as received over MQTT, "98.2 %".
+ */
+void espnow_link_send_telemetry(int city, const char* temperature, const char* humidity, const char* visibility);
+
+/**
+ * @brief Asks the gateway to select another city, only on a display.
+ *
+ * @param city Index of the city in CITY_CONFIG.
+ */
+void espnow_link_request_city(int city);
+
+#endif
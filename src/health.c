@@ -0,0 +1,135 @@
+/**
+ * @file health.c
+ * @brief Stack high water marks and heap usage per capability, see health.h.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#include "health.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#define TAG_HEALTH "HEALTH"
+
+#define PREFIX_HEALTH "[HEALTH]"
+
+#if CONFIG_APP_HEALTH_REPORT
+
+// Maximum number of tasks in one snapshot
+#define HEALTH_MAX_TASKS 32
+
+// Size of one snapshot line, fits the heap of three capabilities and about 30 tasks
+#define HEALTH_MAX_BUFF 768
+
+typedef struct {
+    const char* name;
+    uint32_t caps;
+} health_heap_t;
+
+// Heap capabilities in the snapshot
+static const health_heap_t HEALTH_HEAPS[] = {
+    { "int", MALLOC_CAP_INTERNAL },
+    { "dma", MALLOC_CAP_DMA },
+#if CONFIG_SPIRAM
+    { "spiram", MALLOC_CAP_SPIRAM },
+#endif
+};
+
+// Snapshot buffers of the health task
+static TaskStatus_t health_status[HEALTH_MAX_TASKS];
+static char health_buff[HEALTH_MAX_BUFF];
+
+static esp_mqtt_client_handle_t health_client = NULL;
+
+/**
+ * @brief Formats one snapshot into health_buff.
+ *
+ * Tasks that do not fit into the line any more are left out, the line always stays terminated.
+ * Tasks with less than CONFIG_APP_HEALTH_STACK_WARN bytes of stack left are also logged as a warning.
+ *
+ * @return Length of the snapshot.
+ */
+static int health_snapshot() {
+    int len = snprintf(health_buff, HEALTH_MAX_BUFF, "%s up=%" PRId64 " heap=", PREFIX_HEALTH,
+                       esp_timer_get_time() / 1000000);
+
+    for (int i = 0; i < sizeof(HEALTH_HEAPS) / sizeof(HEALTH_HEAPS[0]); i++) {
+        uint32_t caps = HEALTH_HEAPS[i].caps;
+        len += snprintf(health_buff + len, HEALTH_MAX_BUFF - len, "%s%s:%u/%u/%u", i ? "," : "",
+                        HEALTH_HEAPS[i].name,
+                        (unsigned)heap_caps_get_free_size(caps),
+                        (unsigned)heap_caps_get_minimum_free_size(caps),
+                        (unsigned)heap_caps_get_largest_free_block(caps));
+    }
+
+    len += snprintf(health_buff + len, HEALTH_MAX_BUFF - len, " stack=");
+
+    UBaseType_t count = uxTaskGetSystemState(health_status, HEALTH_MAX_TASKS, NULL);
+    if (count == 0) {
+        ESP_LOGW(TAG_HEALTH, "More than %d tasks, stacks skipped", HEALTH_MAX_TASKS);
+    }
+
+    for (UBaseType_t i = 0; i < count; i++) {
+        TaskStatus_t* task = &health_status[i];
+
+        // The stack of an ESP-IDF task is counted in bytes
+        uint32_t free = task->usStackHighWaterMark;
+        if (free < CONFIG_APP_HEALTH_STACK_WARN) {
+            ESP_LOGW(TAG_HEALTH, "Task %s has only %" PRIu32 " bytes of stack left", task->pcTaskName, free);
+        }
+
+        char item[configMAX_TASK_NAME_LEN + 16];
+        int item_len = snprintf(item, sizeof(item), "%s%s:%" PRIu32, i ? "," : "", task->pcTaskName, free);
+        if (len + item_len >= HEALTH_MAX_BUFF) {
+            break;
+        }
+
+        memcpy(health_buff + len, item, item_len + 1);
+        len += item_len;
+    }
+
+    return len;
+}
+
+/**
+ * @brief Health task, logs and publishes a snapshot every CONFIG_APP_HEALTH_PERIOD_MS.
+ *
+ * @param param Task parameter (unused).
+ */
+static void health_task(void* param) {
+    while (1) {
+        int len = health_snapshot();
+
+        ESP_LOGI(TAG_HEALTH, "%s", health_buff);
+
+        // QoS 0, a lost snapshot is replaced by the next one
+        if (health_client != NULL &&
+            esp_mqtt_client_publish(health_client, CONFIG_APP_HEALTH_TOPIC, health_buff, len, 0, 0) == -1) {
+            ESP_LOGD(TAG_HEALTH, "Snapshot not published, MQTT is not connected");
+        }
+
+        vTaskDelay(CONFIG_APP_HEALTH_PERIOD_MS / portTICK_PERIOD_MS);
+    }
+}
+
+void health_start(esp_mqtt_client_handle_t client) {
+    health_client = client;
+
+    xTaskCreatePinnedToCore(health_task, "health", 2560, NULL, tskIDLE_PRIORITY + 1, NULL, CONFIG_APP_NET_CORE);
+}
+
+#else
+
+void health_start(esp_mqtt_client_handle_t client) {
+}
+
+#endif
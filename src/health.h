@@ -0,0 +1,28 @@
+/**
+ * @file health.h
+ * @brief Periodic stack and heap telemetry, enabled by CONFIG_APP_HEALTH_REPORT.
+ *
+ * Every CONFIG_APP_HEALTH_PERIOD_MS one compact line is logged on the serial console and published
+ * on CONFIG_APP_HEALTH_TOPIC:
+ *
+ *     [HEALTH] up=<s> heap=<cap>:<free>/<min free>/<largest block>,... stack=<task>:<free>,...
+ *
+ * Heap is reported for internal, DMA capable and, when enabled, SPI RAM, all sizes in bytes. The
+ * stack value is the high water mark of each task, the least stack in bytes it ever had left.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#ifndef HEALTH_H
+#define HEALTH_H
+
+#include "mqtt_client.h"
+
+/**
+ * @brief Starts the health task on the network core, does nothing when the report is disabled.
+ *
+ * @param client MQTT client the snapshots are published with, NULL to only log them.
+ */
+void health_start(esp_mqtt_client_handle_t client);
+
+#endif
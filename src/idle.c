@@ -0,0 +1,172 @@
+/**
+ * @file idle.c
+ * @brief Light sleep with gesture interrupt wakeup, see idle.h.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#include "idle.h"
+
+#include <inttypes.h>
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "driver/gpio.h"
+#include "esp_log.h"
+#include "esp_pm.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+
+#include "display.h"
+#include "station.h"
+
+#define TAG_IDLE "IDLE"
+
+#if CONFIG_APP_IDLE_SLEEP
+
+static apds9960_handle_t idle_sensor = NULL;
+
+// Given by the interrupt of the sensor
+static SemaphoreHandle_t idle_wakeup = NULL;
+
+// Time of the last interrupt, to log the wakeup to first frame latency
+static volatile int64_t idle_wakeup_time = 0;
+
+// Held while the UI is in use, keeps the cpu at full speed and the system out of light sleep
+static esp_pm_lock_handle_t idle_active_lock = NULL;
+
+/**
+ * @brief Interrupt of the APDS9960 INT pin.
+ *
+ * INT stays low until the gesture FIFO is read, so the level interrupt disables itself and is
+ * enabled again before the next sleep.
+ *
+ * @param arg Handler argument (unused).
+ */
+static void idle_isr(void* arg) {
+    BaseType_t woken = pdFALSE;
+
+    gpio_intr_disable(CONFIG_APP_APDS9960_INT_GPIO);
+    idle_wakeup_time = esp_timer_get_time();
+    xSemaphoreGiveFromISR(idle_wakeup, &woken);
+
+    if (woken) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+void idle_init(apds9960_handle_t sensor) {
+    idle_sensor = sensor;
+    idle_wakeup = xSemaphoreCreateBinary();
+
+    // INT of the APDS9960 is open drain and active low
+    gpio_config_t io_conf = {
+        .pin_bit_mask = 1ULL << CONFIG_APP_APDS9960_INT_GPIO,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_DISABLE,
+    };
+    ESP_ERROR_CHECK(gpio_config(&io_conf));
+    ESP_ERROR_CHECK(gpio_isr_handler_add(CONFIG_APP_APDS9960_INT_GPIO, idle_isr, NULL));
+
+    // A low level both fires the interrupt and ends a light sleep
+    ESP_ERROR_CHECK(gpio_wakeup_enable(CONFIG_APP_APDS9960_INT_GPIO, GPIO_INTR_LOW_LEVEL));
+    ESP_ERROR_CHECK(esp_sleep_enable_gpio_wakeup());
+    gpio_intr_disable(CONFIG_APP_APDS9960_INT_GPIO);
+
+    // Without a lock the system scales down to the crystal and sleeps whenever both cores are idle
+    esp_pm_config_t pm_conf = {
+        .max_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+        .min_freq_mhz = CONFIG_XTAL_FREQ,
+        .light_sleep_enable = true,
+    };
+    ESP_ERROR_CHECK(esp_pm_configure(&pm_conf));
+
+    ESP_ERROR_CHECK(esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "ui_active", &idle_active_lock));
+    ESP_ERROR_CHECK(esp_pm_lock_acquire(idle_active_lock));
+}
+
+/**
+ * @brief Puts the display, Wi-Fi and the UI task to sleep until the gesture interrupt.
+ */
+static void idle_sleep() {
+    ESP_LOGI(TAG_IDLE, "No gesture for %d ms, going idle", CONFIG_APP_IDLE_TIMEOUT_MS);
+
+#if CONFIG_APP_IDLE_DISPLAY_OFF
+    display_power(false);
+#else
+    display_contrast(CONFIG_APP_IDLE_DIM_CONTRAST);
+#endif
+
+    // Wake the radio only for every CONFIG_APP_IDLE_LISTEN_INTERVAL-th beacon
+    esp_wifi_set_ps(WIFI_PS_MAX_MODEM);
+
+    // A hand over the sensor starts the gesture engine, which pulls INT low once the FIFO fills
+    xSemaphoreTake(idle_wakeup, 0);
+    apds9960_enable_gesture_interrupt(idle_sensor, true);
+    gpio_intr_enable(CONFIG_APP_APDS9960_INT_GPIO);
+
+    esp_pm_lock_release(idle_active_lock);
+    xSemaphoreTake(idle_wakeup, portMAX_DELAY);
+    esp_pm_lock_acquire(idle_active_lock);
+
+    // The picture is still on the panel, show it before anything else
+#if CONFIG_APP_IDLE_DISPLAY_OFF
+    display_power(true);
+#else
+    display_contrast(0xff);
+#endif
+
+    ESP_LOGI(TAG_IDLE, "Woken up, first frame after %" PRId64 " us", esp_timer_get_time() - idle_wakeup_time);
+
+    apds9960_enable_gesture_interrupt(idle_sensor, false);
+    esp_wifi_set_ps(WIFI_PS_MIN_MODEM);
+
+    // Read the waking swipe out of the FIFO and drop it
+    apds9960_read_gesture(idle_sensor);
+}
+
+bool idle_sleep_if_expired(int64_t last_activity) {
+    if (esp_timer_get_time() - last_activity < CONFIG_APP_IDLE_TIMEOUT_MS * 1000LL) {
+        return false;
+    }
+
+    idle_sleep();
+    return true;
+}
+
+#elif CONFIG_APP_IDLE_DEEP_SLEEP
+
+static apds9960_handle_t idle_sensor = NULL;
+
+void idle_init(apds9960_handle_t sensor) {
+    idle_sensor = sensor;
+}
+
+bool idle_sleep_if_expired(int64_t last_activity) {
+    if (esp_timer_get_time() - last_activity < CONFIG_APP_IDLE_TIMEOUT_MS * 1000LL) {
+        return false;
+    }
+
+    ESP_LOGI(TAG_IDLE, "No gesture for %d ms, going to deep sleep", CONFIG_APP_IDLE_TIMEOUT_MS);
+
+    // The sensor stays powered, its next gesture pulls INT low and wakes the UI again
+    apds9960_enable_gesture_interrupt(idle_sensor, true);
+    station_deep_sleep();
+
+    return true;
+}
+
+#else
+
+void idle_init(apds9960_handle_t sensor) {
+}
+
+bool idle_sleep_if_expired(int64_t last_activity) {
+    return false;
+}
+
+#endif
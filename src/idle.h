@@ -0,0 +1,47 @@
+/**
+ * @file idle.h
+ * @brief Idle power mode, enabled by CONFIG_APP_IDLE_SLEEP or CONFIG_APP_IDLE_DEEP_SLEEP.
+ *
+ * After CONFIG_APP_IDLE_TIMEOUT_MS without a gesture the display is dimmed or switched off, Wi-Fi
+ * goes to maximum modem sleep and only listens to every CONFIG_APP_IDLE_LISTEN_INTERVAL-th beacon,
+ * and the UI task blocks on the APDS9960 interrupt on CONFIG_APP_APDS9960_INT_GPIO. With nothing
+ * left to run, the system enters automatic light sleep between beacons until a hand over the sensor
+ * pulls the interrupt low. The panel keeps its picture while idle, so the first frame after the
+ * wakeup costs a single display command.
+ *
+ * With CONFIG_APP_IDLE_DEEP_SLEEP the station enters the deep sleep of the duty cycle instead, see
+ * station.h, and the gesture that wakes it up boots the interactive UI again.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#ifndef IDLE_H
+#define IDLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "apds9960.h"
+
+/**
+ * @brief Sets up the interrupt GPIO as wakeup source and enables automatic light sleep.
+ *
+ * Does nothing when the idle mode is disabled. Must be called from the UI task after the gesture
+ * engine is running.
+ *
+ * @param sensor Sensor whose gesture interrupt wakes the station.
+ */
+void idle_init(apds9960_handle_t sensor);
+
+/**
+ * @brief Goes idle if no gesture came since last_activity for CONFIG_APP_IDLE_TIMEOUT_MS.
+ *
+ * Returns after the wakeup with the display on again. The gesture that woke the station is dropped,
+ * so it does not navigate the views.
+ *
+ * @param last_activity Time of the last gesture, from esp_timer_get_time().
+ * @return True if the station was idle, false if the timeout has not expired or the mode is disabled.
+ */
+bool idle_sleep_if_expired(int64_t last_activity);
+
+#endif
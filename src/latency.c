@@ -0,0 +1,148 @@
+/**
+ * @file latency.c
+ * @brief Motion-to-photon latency per pipeline stage, see latency.h.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#include "latency.h"
+
+#include <inttypes.h>
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+
+#include "display.h"
+#include "log_ring.h"
+#include "metrics.h"
+
+#define TAG_LATENCY "LATENCY"
+
+#if CONFIG_APP_METRICS
+
+#if CONFIG_APP_METRICS_GINT
+#include "driver/gpio.h"
+#include "esp_attr.h"
+
+// INT edges kept, the FIFO of one gesture fills and drains a few times before it is read out
+#define LATENCY_EDGES 4
+#endif
+
+typedef struct {
+    int64_t gint;
+    int64_t valid;
+    int64_t fifo;
+    int64_t classified;
+    int64_t dispatch;   // 0 when no gesture waits for its view
+} latency_stamps_t;
+
+static latency_stamps_t latency_pending;
+
+#if CONFIG_APP_METRICS_GINT
+static int64_t latency_edges[LATENCY_EDGES];
+static int latency_edge = 0;
+static portMUX_TYPE latency_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief Falling edge of INT, the gesture FIFO went over its threshold.
+ *
+ * @param arg Handler argument (unused).
+ */
+static void IRAM_ATTR latency_isr(void* arg) {
+    int64_t now = esp_timer_get_time();
+
+    taskENTER_CRITICAL_ISR(&latency_lock);
+    latency_edges[latency_edge] = now;
+    latency_edge = (latency_edge + 1) % LATENCY_EDGES;
+    taskEXIT_CRITICAL_ISR(&latency_lock);
+}
+
+/**
+ * @brief Returns the last edge up to the first valid poll, the start of the gesture, and forgets all.
+ */
+static int64_t latency_take_edge(int64_t valid) {
+    int64_t edge = 0;
+
+    taskENTER_CRITICAL(&latency_lock);
+    for (int i = 0; i < LATENCY_EDGES; i++) {
+        if (latency_edges[i] != 0 && latency_edges[i] <= valid && latency_edges[i] > edge) {
+            edge = latency_edges[i];
+        }
+        latency_edges[i] = 0;
+    }
+    taskEXIT_CRITICAL(&latency_lock);
+
+    return edge != 0 ? edge : valid;
+}
+#endif
+
+void latency_init(apds9960_handle_t sensor) {
+#if CONFIG_APP_METRICS_GINT
+    // INT of the APDS9960 is open drain and active low
+    gpio_config_t io_conf = {
+        .pin_bit_mask = 1ULL << CONFIG_APP_APDS9960_INT_GPIO,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_NEGEDGE,
+    };
+    ESP_ERROR_CHECK(gpio_config(&io_conf));
+    ESP_ERROR_CHECK(gpio_isr_handler_add(CONFIG_APP_APDS9960_INT_GPIO, latency_isr, NULL));
+    ESP_ERROR_CHECK(apds9960_enable_gesture_interrupt(sensor, true));
+#endif
+}
+
+void latency_dispatch(apds9960_handle_t sensor, int64_t dispatch) {
+    apds9960_gesture_timing_t timing;
+
+    apds9960_get_gesture_timing(sensor, &timing);
+    latency_pending.valid = timing.valid_us;
+    latency_pending.fifo = timing.fifo_us;
+    latency_pending.classified = timing.classified_us;
+    latency_pending.dispatch = dispatch;
+#if CONFIG_APP_METRICS_GINT
+    latency_pending.gint = latency_take_edge(timing.valid_us);
+#else
+    latency_pending.gint = timing.valid_us;
+#endif
+}
+
+void latency_frame_done() {
+    const latency_stamps_t* s = &latency_pending;
+
+    if (s->dispatch == 0 || display_frame_done <= s->dispatch) {
+        return;
+    }
+
+    // The first draw after the gesture started the view, the panel shows it since the last bytes
+    int64_t render = display_frame_start > s->dispatch ? display_frame_start : s->dispatch;
+    int64_t done = display_frame_done;
+
+    metrics_observe(METRICS_STAGE_POLL_US, s->valid - s->gint);
+    metrics_observe(METRICS_STAGE_FIFO_US, s->fifo - s->valid);
+    metrics_observe(METRICS_STAGE_CLASSIFY_US, s->classified - s->fifo);
+    metrics_observe(METRICS_STAGE_DISPATCH_US, s->dispatch - s->classified);
+    metrics_observe(METRICS_STAGE_HANDLE_US, render - s->dispatch);
+    metrics_observe(METRICS_STAGE_RENDER_US, done - render);
+    metrics_observe(METRICS_MOTION_US, done - s->gint);
+
+    LOG_RING_D(TAG_LATENCY, "Gesture to panel %" PRIu32 " us: sensor %" PRIu32 ", view %" PRIu32 ", render %" PRIu32,
+               (uint32_t)(done - s->gint), (uint32_t)(s->classified - s->gint), (uint32_t)(render - s->classified),
+               (uint32_t)(done - render));
+
+    latency_pending.dispatch = 0;
+}
+
+#else
+
+void latency_init(apds9960_handle_t sensor) {
+}
+
+void latency_dispatch(apds9960_handle_t sensor, int64_t dispatch) {
+}
+
+void latency_frame_done() {
+}
+
+#endif
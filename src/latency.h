@@ -0,0 +1,48 @@
+/**
+ * @file latency.h
+ * @brief Motion-to-photon latency of the gestures per pipeline stage, recorded with CONFIG_APP_METRICS.
+ *
+ * Every gesture is stamped at each stage on its way to the panel:
+ *  - gint: falling edge of the APDS9960 INT pin with CONFIG_APP_METRICS_GINT, else the first poll.
+ *  - valid: first poll of the UI task that finds the gesture valid.
+ *  - fifo: end of the first FIFO read, after the 30 ms wait of the driver.
+ *  - classify: direction known, after as many FIFO reads as the driver needs.
+ *  - dispatch: wait_for_gesture() hands it to the view.
+ *  - render: first draw call after that.
+ *  - done: last bytes of the next view pushed to the panel, taken at the next wait_for_gesture().
+ *
+ * The time between two stamps goes into the stage_*_us histograms of the metrics and the whole
+ * path into motion_us, so server/metrics.py reports the percentiles of each stage. Only the INT edge
+ * shows the time a gesture waits while the UI task is busy elsewhere, like the delay of the menus.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+
+#include "apds9960.h"
+
+/**
+ * @brief Timestamps the INT edges of the sensor with CONFIG_APP_METRICS_GINT, does nothing otherwise.
+ *
+ * @param sensor Sensor whose gesture interrupt is enabled.
+ */
+void latency_init(apds9960_handle_t sensor);
+
+/**
+ * @brief Starts the record of a gesture the view is about to handle.
+ *
+ * @param sensor Sensor the gesture was read from.
+ * @param dispatch Time the gesture was handed to the view.
+ */
+void latency_dispatch(apds9960_handle_t sensor, int64_t dispatch);
+
+/**
+ * @brief Ends the record once the view that follows the gesture is complete on the panel.
+ */
+void latency_frame_done();
+
+#endif
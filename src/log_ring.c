@@ -0,0 +1,154 @@
+/**
+ * @file log_ring.c
+ * @brief Ring of binary log entries and the task that prints them, see log_ring.h.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#include "log_ring.h"
+
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#if CONFIG_APP_LOG_RING
+
+// Longest printed message, longer ones are cut
+#define LOG_RING_MAX_BUFF 256
+
+typedef struct {
+    uint32_t time;      // esp_log_timestamp() of the call
+    const char* tag;
+    const char* format;
+    uint8_t level;
+    uint8_t nargs;
+    uint32_t args[LOG_RING_MAX_ARGS];
+} log_ring_entry_t;
+
+// %s arguments are kept as pointers in the 32 bit words, only possible on a 32 bit target
+_Static_assert(sizeof(void*) <= sizeof(uint32_t), "log ring needs 32 bit pointers");
+
+static log_ring_entry_t log_ring[CONFIG_APP_LOG_RING_SIZE];
+
+// Free running indices, head - tail entries are waiting
+static uint32_t log_ring_head = 0;
+static uint32_t log_ring_tail = 0;
+
+// Entries lost to a full ring since the last printed one
+static uint32_t log_ring_dropped = 0;
+
+static portMUX_TYPE log_ring_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static TaskHandle_t log_ring_task_handle = NULL;
+
+// Level letters and colours, like ESP_LOGx prints them
+static const char LOG_RING_LETTERS[] = { 'N', 'E', 'W', 'I', 'D', 'V' };
+static const char* LOG_RING_COLORS[] = { "", LOG_COLOR_E, LOG_COLOR_W, LOG_COLOR_I, LOG_COLOR_D, LOG_COLOR_V };
+
+// Message being printed
+static char log_ring_buff[LOG_RING_MAX_BUFF];
+
+void log_ring_write(esp_log_level_t level, const char* tag, const char* format, int nargs, ...) {
+    log_ring_entry_t entry = {
+        .time = esp_log_timestamp(),
+        .tag = tag,
+        .format = format,
+        .level = level,
+        .nargs = nargs,
+    };
+
+    va_list args;
+    va_start(args, nargs);
+    for (int i = 0; i < nargs && i < LOG_RING_MAX_ARGS; i++) {
+        entry.args[i] = va_arg(args, uint32_t);
+    }
+    va_end(args);
+
+    bool was_empty = false;
+
+    taskENTER_CRITICAL(&log_ring_lock);
+    if (log_ring_head - log_ring_tail < CONFIG_APP_LOG_RING_SIZE) {
+        was_empty = log_ring_head == log_ring_tail;
+        log_ring[log_ring_head % CONFIG_APP_LOG_RING_SIZE] = entry;
+        log_ring_head++;
+    }
+    else {
+        log_ring_dropped++;
+    }
+    taskEXIT_CRITICAL(&log_ring_lock);
+
+    // Only the first entry of a burst wakes the task, it prints everything up to the last one
+    if (was_empty && log_ring_task_handle != NULL) {
+        xTaskNotifyGive(log_ring_task_handle);
+    }
+}
+
+/**
+ * @brief Takes the oldest entry out of the ring.
+ *
+ * @param entry Entry to fill.
+ * @param dropped Entries dropped since the last call.
+ * @return False if the ring is empty.
+ */
+static bool log_ring_take(log_ring_entry_t* entry, uint32_t* dropped) {
+    bool taken = false;
+
+    taskENTER_CRITICAL(&log_ring_lock);
+    if (log_ring_head != log_ring_tail) {
+        *entry = log_ring[log_ring_tail % CONFIG_APP_LOG_RING_SIZE];
+        log_ring_tail++;
+        taken = true;
+    }
+    *dropped = log_ring_dropped;
+    log_ring_dropped = 0;
+    taskEXIT_CRITICAL(&log_ring_lock);
+
+    return taken;
+}
+
+/**
+ * @brief Print task, formats the entries whenever the ring is not empty.
+ *
+ * @param param Task parameter (unused).
+ */
+static void log_ring_task(void* param) {
+    log_ring_entry_t entry;
+    uint32_t dropped;
+
+    while (1) {
+        while (log_ring_take(&entry, &dropped)) {
+            if (dropped > 0) {
+                esp_log_write(ESP_LOG_WARN, "LOG_RING", "%sW (%" PRIu32 ") LOG_RING: %" PRIu32 " entries dropped" LOG_RESET_COLOR "\n",
+                              LOG_RING_COLORS[ESP_LOG_WARN], entry.time, dropped);
+            }
+
+            // Missing arguments are zero, the format only reads the ones it has
+            snprintf(log_ring_buff, sizeof(log_ring_buff), entry.format,
+                     entry.args[0], entry.args[1], entry.args[2], entry.args[3]);
+
+            esp_log_write(entry.level, entry.tag, "%s%c (%" PRIu32 ") %s: %s" LOG_RESET_COLOR "\n",
+                          LOG_RING_COLORS[entry.level], LOG_RING_LETTERS[entry.level], entry.time, entry.tag,
+                          log_ring_buff);
+        }
+
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+}
+
+void log_ring_start() {
+    xTaskCreatePinnedToCore(log_ring_task, "log_ring", 3072, NULL, tskIDLE_PRIORITY + 1, &log_ring_task_handle,
+                            CONFIG_APP_NET_CORE);
+}
+
+#else
+
+void log_ring_start() {
+}
+
+void log_ring_write(esp_log_level_t level, const char* tag, const char* format, int nargs, ...) {
+}
+
+#endif
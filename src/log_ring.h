@@ -0,0 +1,80 @@
+/**
+ * @file log_ring.h
+ * @brief Deferred logging for hot paths, enabled by CONFIG_APP_LOG_RING.
+ *
+ * LOG_RING_E/W/I/D take the same arguments as ESP_LOGE/W/I/D, but the caller only copies the tag,
+ * the format pointer, the time and up to LOG_RING_MAX_ARGS 32-bit arguments into a ring. A task at
+ * the lowest priority on the network core formats and prints them later, with the time of the call.
+ * The caller never formats and never waits for the UART.
+ *
+ * Restrictions of the deferred path:
+ *  - The format and the tag have to be string literals, they are printed after the call returns.
+ *  - At most LOG_RING_MAX_ARGS arguments, each one 32 bits wide: no %lld, %f or 64-bit values.
+ *  - A %s argument has to stay valid until it is printed, a literal or a static buffer.
+ *  - Only from tasks, not from interrupts.
+ * When the ring is full, the newest entries are dropped and counted, the next printed line reports
+ * how many. With CONFIG_APP_LOG_RING disabled the macros are ESP_LOGx.
+ *
+ * Calls above the level compiled into the file (LOG_LOCAL_LEVEL, see CONFIG_APP_LOG_LEVEL) are
+ * removed at compile time in both cases.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#ifndef LOG_RING_H
+#define LOG_RING_H
+
+#include <stdint.h>
+
+#include "sdkconfig.h"
+#include "esp_log.h"
+
+// Arguments one entry keeps
+#define LOG_RING_MAX_ARGS 4
+
+#if CONFIG_APP_LOG_RING
+
+// Number of arguments of a call, from 0 to LOG_RING_MAX_ARGS
+#define LOG_RING_NARGS(...) LOG_RING_NARGS_(0, ##__VA_ARGS__, 4, 3, 2, 1, 0)
+#define LOG_RING_NARGS_(_0, _1, _2, _3, _4, n, ...) n
+
+#define LOG_RING_LEVEL(level, tag, format, ...) do {                                                \
+        _Static_assert(LOG_RING_NARGS(__VA_ARGS__) <= LOG_RING_MAX_ARGS, "Too many log arguments"); \
+        if (LOG_LOCAL_LEVEL >= (level)) {                                                           \
+            log_ring_write((level), (tag), (format), LOG_RING_NARGS(__VA_ARGS__), ##__VA_ARGS__);   \
+        }                                                                                           \
+    } while (0)
+
+#define LOG_RING_E(tag, format, ...) LOG_RING_LEVEL(ESP_LOG_ERROR, tag, format, ##__VA_ARGS__)
+#define LOG_RING_W(tag, format, ...) LOG_RING_LEVEL(ESP_LOG_WARN, tag, format, ##__VA_ARGS__)
+#define LOG_RING_I(tag, format, ...) LOG_RING_LEVEL(ESP_LOG_INFO, tag, format, ##__VA_ARGS__)
+#define LOG_RING_D(tag, format, ...) LOG_RING_LEVEL(ESP_LOG_DEBUG, tag, format, ##__VA_ARGS__)
+
+#else
+
+#define LOG_RING_E(tag, format, ...) ESP_LOGE(tag, format, ##__VA_ARGS__)
+#define LOG_RING_W(tag, format, ...) ESP_LOGW(tag, format, ##__VA_ARGS__)
+#define LOG_RING_I(tag, format, ...) ESP_LOGI(tag, format, ##__VA_ARGS__)
+#define LOG_RING_D(tag, format, ...) ESP_LOGD(tag, format, ##__VA_ARGS__)
+
+#endif
+
+/**
+ * @brief Starts the task that prints the ring, does nothing when the ring is disabled.
+ *
+ * Entries written before are kept and printed once the task runs.
+ */
+void log_ring_start();
+
+/**
+ * @brief Copies one entry into the ring, use the LOG_RING_x macros instead.
+ *
+ * @param level Log level.
+ * @param tag Tag, a string literal.
+ * @param format Format, a string literal.
+ * @param nargs Number of 32-bit arguments that follow.
+ */
+void log_ring_write(esp_log_level_t level, const char* tag, const char* format, int nargs, ...)
+    __attribute__((format(printf, 3, 5)));
+
+#endif
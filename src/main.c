@@ -12,29 +12,18 @@
  */
 #include "main.h"
 
- // Pin configurations for SSD1306 OLED display
-#define CONFIG_CS_GPIO 5
-#define CONFIG_DC_GPIO 27
-#define CONFIG_RESET_GPIO 17
-#define CONFIG_MOSI_GPIO 23
-#define CONFIG_SCLK_GPIO 18
-
-// Pin configurations for I2C communication
-#define CONFIG_SDA_GPIO 25
-#define CONFIG_SCL_GPIO 26
+// Pin configurations for I2C communication, CONFIG_SDA_GPIO/CONFIG_SCL_GPIO belong to the SSD1306 over I2C
+#define APDS9960_SDA_GPIO 25
+#define APDS9960_SCL_GPIO 26
 
 // APDS9960 sensor configurations
 #define APDS9960_ADDR 0x39 
 
 // Tags for logging purposes
-#define TAG_SSD1306 "SSD1306"
 #define TAG_APDS9960 "APDS9960"
 #define TAG_WIFI "WIFI"
 #define TAG_MQTT "MQTT"
-
-// MQTT message prefixes
-#define PREFIX_CITY "[CITY]"
-#define PREFIX_DATA "[DATA]"
+#define TAG_ESPNOW "ESPNOW"
 
 // MQTT broker configuration
 #define CONFIG_BROKER_URL "mqtt://broker.hivemq.com"
@@ -48,16 +37,47 @@
 // Maximum buffer size for data
 #define MAX_BUFF 256
 
-// Buffers for storing sensor data
-char TEMPERATURE[MAX_BUFF] = { 0 };
-char HUMIDITY[MAX_BUFF] = { 0 };
-char VISIBILITY[MAX_BUFF] = { 0 };
-int CITY = 0;
+// Event bit of a duty cycle wakeup
+#define STATION_GOT_DATA_BIT BIT0
+
+// Buffers for storing sensor data, kept over deep sleep in duty cycle mode
+STATION_RTC_ATTR char TEMPERATURE[MAX_BUFF] = { 0 };
+STATION_RTC_ATTR char HUMIDITY[MAX_BUFF] = { 0 };
+STATION_RTC_ATTR char VISIBILITY[MAX_BUFF] = { 0 };
+STATION_RTC_ATTR int CITY = 0;
 
-// Handles for I2C bus, APDS9960 sensor and SSD1306 monitor
+// Buffers updated by the data messages
+const telemetry_store_t TELEMETRY = {
+    .temperature = TEMPERATURE,
+    .humidity = HUMIDITY,
+    .visibility = VISIBILITY,
+    .size = MAX_BUFF,
+};
+
+// Handles for I2C bus and APDS9960 sensor
 i2c_bus_handle_t i2c_bus;
 apds9960_handle_t apds9960;
-SSD1306_t dev;
+
+// Progress of a duty cycle wakeup, NULL otherwise
+EventGroupHandle_t station_events = NULL;
+
+// City change waiting for mqtt_task, one entry that is overwritten, so only the latest change is kept
+QueueHandle_t city_outbox = NULL;
+
+// Set while the MQTT client is connected to the broker
+volatile bool mqtt_connected = false;
+
+// Time of the last gesture, until the view it leads to is on the panel
+int64_t gesture_time = 0;
+
+// QoS 1 publish waiting for its PUBACK, for the round trip metric. The PUBACK may be handled on the
+// client task before esp_mqtt_client_publish() returns the id, then its id and time wait in rtt_acked.
+static portMUX_TYPE rtt_lock = portMUX_INITIALIZER_UNLOCKED;
+static bool rtt_pending = false;
+static int rtt_msg_id = -1;
+static int64_t rtt_start = 0;
+static int rtt_acked_id = -1;
+static int64_t rtt_acked = 0;
 
 /**
  * @brief Cleans up resources before program termination.
@@ -88,25 +108,48 @@ void exit_error(const char* message) {
  * @brief Waits for a valid gesture and returns the detected gesture.
  *
  * This function waits for a valid gesture input from the APDS9960 sensor. It continuously reads
- * gesture data until a non-zero value is obtained, indicating a valid gesture. If an error occurs
- * during the gesture reading process, the function exits the program with an error message.
+ * gesture data until a non-zero value is obtained, indicating a valid gesture. When no gesture comes
+ * for CONFIG_APP_IDLE_TIMEOUT_MS the station goes idle until the sensor interrupt wakes it up, see
+ * idle.h. If an error occurs during the gesture reading process, the function exits the program with
+ * an error message.
  *
  * @return int8_t The detected gesture. A non-zero value indicates a valid gesture, and the specific
  * gesture code is returned. A value of -1 indicates an error during gesture reading.
  */
 int8_t wait_for_gesture() {
     int8_t gesture;     // Variable to store gesture input
+    int64_t last_activity = esp_timer_get_time();  // Start of the idle timeout
 
-    ESP_LOGI(TAG_APDS9960, "Waiting for the gesture...");
+    // Make sure the view is on the screen before blocking
+    display_flush();
+
+    // The view that follows the last gesture is complete on the panel now
+    if (gesture_time != 0 && display_frame_done > gesture_time) {
+        metrics_observe(METRICS_GESTURE_US, display_frame_done - gesture_time);
+        trace_gesture_latency(display_frame_done - gesture_time);
+        latency_frame_done();
+    }
+    gesture_time = 0;
+
+    LOG_RING_I(TAG_APDS9960, "Waiting for the gesture...");
 
     // Wait for a valid gesture input
-    while ((gesture = apds9960_read_gesture(apds9960)) == 0);
+    while ((gesture = apds9960_read_gesture(apds9960)) == 0) {
+        // Sleep when the view was left alone, the timeout starts again after the wakeup
+        if (idle_sleep_if_expired(last_activity)) {
+            last_activity = esp_timer_get_time();
+        }
+    }
 
     // Check error gesture read
     if (gesture == -1) {
         exit_error("Error when reading gesture occured\n");
     }
 
+    gesture_time = esp_timer_get_time();
+    metrics_count(METRICS_GESTURES, 1);
+    latency_dispatch(apds9960, gesture_time);
+
     return gesture;
 }
 
@@ -129,43 +172,78 @@ static void wifi_event_handler(void* arg, esp_event_base_t event_base,
 {
     if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
         ESP_LOGI(TAG_WIFI, "Wi-Fi started");
+#if !CONFIG_APP_ESPNOW_DISPLAY
+        // An ESP-NOW display stays unassociated and only listens
         esp_wifi_connect();
+#endif
     }
     else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_CONNECTED) {
         ESP_LOGI(TAG_WIFI, "Wi-Fi connected");
+
+        // Set the static or cached address instead of asking DHCP, if configured
+        wifi_link_connected();
     }
     else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
-        ESP_LOGE(TAG_WIFI, "Wi-Fi disconnected, trying to reconnect...");
-        esp_wifi_connect();
+        // Reconnect with backoff, the attempt is logged by wifi_link
+        metrics_count(METRICS_WIFI_DISCONNECTS, 1);
+        wifi_link_disconnected(event_data);
     }
     else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
         ESP_LOGI(TAG_WIFI, "Got an IP address");
+
+        // Remember the access point, channel and lease for the next connect
+        wifi_link_got_ip();
     }
 }
 
 /**
- * @brief Parses and extracts data from an MQTT message.
+ * @brief Publishes the selected city to the MQTT broker.
  *
- * This function parses a comma-separated string tokenized from an MQTT message.
- * It extracts specific data elements and updates global variables accordingly.
- * The function is designed to handle messages with multiple data fields, such as temperature,
- * humidity, and visibility, and stores them in corresponding global variables.
+ * The message goes out with QoS 1, so a city change survives a lost packet. The session is persistent,
+ * so esp-mqtt sends it again after a reconnect if it was not acknowledged.
  *
- * @param token The comma-separated string containing data fields.
+ * @param client MQTT client.
+ * @param city Index of the city in CITY_CONFIG.
  */
-void mqtt_parse_data(char* token) {
-    for (int i = 0; token != NULL; token = strtok(NULL, ","), i++) {
-        switch (i) {
-        case 1:
-            strcpy(TEMPERATURE, token);
-            break;
-        case 2:
-            strcpy(HUMIDITY, token);
-            break;
-        case 3:
-            strcpy(VISIBILITY, token);
-            break;
-        }
+void mqtt_publish_city(esp_mqtt_client_handle_t client, int city) {
+    char buff[MAX_BUFF];
+    sprintf(buff, "%s %s", PREFIX_CITY, CITY_CONFIG[city]);
+
+    // Time the round trip of the latest publish, a newer one replaces it
+    int64_t start = esp_timer_get_time();
+    taskENTER_CRITICAL(&rtt_lock);
+    rtt_pending = true;
+    rtt_msg_id = -1;
+    rtt_start = start;
+    rtt_acked_id = -1;
+    taskEXIT_CRITICAL(&rtt_lock);
+
+    // Publish the message to the MQTT broker
+    int msg_id = esp_mqtt_client_publish(client, CONFIG_MQTT_TOPIC, buff, strlen(buff), 1, 0);
+    int64_t rtt = -1;
+
+    taskENTER_CRITICAL(&rtt_lock);
+    if (msg_id == -1) {
+        rtt_pending = false;
+    }
+    else if (rtt_acked_id == msg_id) {
+        rtt = rtt_acked - rtt_start;
+        rtt_pending = false;
+    }
+    else {
+        rtt_msg_id = msg_id;
+    }
+    taskEXIT_CRITICAL(&rtt_lock);
+
+    if (msg_id == -1) {
+        ESP_LOGW(TAG_MQTT, "Error occured when sending message to MQTT broker");
+    }
+    else {
+        LOG_RING_I(TAG_MQTT, "Published message ID: %d", msg_id);
+        metrics_count(METRICS_MQTT_TX, 1);
+    }
+    if (rtt >= 0) {
+        metrics_observe(METRICS_MQTT_RTT_US, rtt);
     }
 }
 
@@ -190,28 +268,36 @@ void mqtt_event_handler(void* handler_args, esp_event_base_t base, int32_t event
     // Switch between different MQTT event types
     switch (event->event_id) {
     case MQTT_EVENT_CONNECTED:
-        // Subscribe to the specified MQTT topic upon successful connection
+        mqtt_connected = true;
+
+        // Subscribe to the specified MQTT topic upon successful connection, also when the broker kept the
+        // session: subscribing again makes it send the retained data. The data is only worth its latest
+        // value, so QoS 0, and the broker queues nothing for the station while it is offline
         if (esp_mqtt_client_subscribe(client, CONFIG_MQTT_TOPIC, 0) == -1) {
             ESP_LOGI(TAG_MQTT, "MQTT_EVENT connection failed");
         }
         else {
-            ESP_LOGI(TAG_MQTT, "MQTT_EVENT_CONNECTED success");
+            ESP_LOGI(TAG_MQTT, "MQTT_EVENT_CONNECTED success, session_present=%d", event->session_present);
+        }
+
+        // Send the current city in the same flight, the station is in sync after one round trip. A duty
+        // cycle only fetches the data: it stops before the PUBACK and the kept session would resend it
+        if (station_events == NULL) {
+            mqtt_publish_city(client, CITY);
         }
-        
         break;
     case MQTT_EVENT_DATA:
-        ESP_LOGI(TAG_MQTT, "MQTT_EVENT_DATA");
-
-        // Process received MQTT data
-        char buff[MAX_BUFF] = { 0 };
-        strncpy(buff, event->data, event->data_len);
+        LOG_RING_I(TAG_MQTT, "MQTT_EVENT_DATA");
+        metrics_count(METRICS_MQTT_RX, 1);
 
-        // Extract the prefix from the received message
-        char* prefix = strtok(buff, " ");
+        // Update the data shown by the views, see telemetry.h
+        if (telemetry_parse(&TELEMETRY, event->data, event->data_len) == TELEMETRY_DATA) {
+            // Pass the data on to the ESP-NOW displays nearby
+            espnow_link_send_telemetry(CITY, TEMPERATURE, HUMIDITY, VISIBILITY);
 
-        // Check if the message contains the expected prefix
-        if (strstr(prefix, PREFIX_DATA) != NULL) {
-            mqtt_parse_data(prefix);
+            if (station_events != NULL) {
+                xEventGroupSetBits(station_events, STATION_GOT_DATA_BIT);
+            }
         }
         else {
             // Unrecognized mqtt message
@@ -220,31 +306,64 @@ void mqtt_event_handler(void* handler_args, esp_event_base_t base, int32_t event
         break;
     case MQTT_EVENT_DISCONNECTED:
         ESP_LOGI(TAG_MQTT, "MQTT_EVENT_DISCONNECTED");
+        mqtt_connected = false;
+        metrics_count(METRICS_MQTT_DISCONNECTS, 1);
         break;
     case MQTT_EVENT_SUBSCRIBED:
-        ESP_LOGI(TAG_MQTT, "MQTT_EVENT_SUBSCRIBED, msg_id=%d", event->msg_id);
+        LOG_RING_I(TAG_MQTT, "MQTT_EVENT_SUBSCRIBED, msg_id=%d", event->msg_id);
         break;
     case MQTT_EVENT_PUBLISHED:
-        ESP_LOGI(TAG_MQTT, "MQTT_EVENT_PUBLISHED, msg_id=%d", event->msg_id);
+        LOG_RING_I(TAG_MQTT, "MQTT_EVENT_PUBLISHED, msg_id=%d", event->msg_id);
+
+        int64_t now = esp_timer_get_time();
+        int64_t rtt = -1;
+
+        taskENTER_CRITICAL(&rtt_lock);
+        if (rtt_pending && event->msg_id == rtt_msg_id) {
+            rtt = now - rtt_start;
+            rtt_pending = false;
+        }
+        else if (rtt_pending && rtt_msg_id == -1) {
+            // The publish has not returned its id yet, it matches this one itself
+            rtt_acked_id = event->msg_id;
+            rtt_acked = now;
+        }
+        taskEXIT_CRITICAL(&rtt_lock);
+
+        if (rtt >= 0) {
+            metrics_observe(METRICS_MQTT_RTT_US, rtt);
+        }
         break;
     default:
         break;
     }
 }
 
+/**
+ * @brief Samples the metrics kept by the drivers, called by the metrics task before every line.
+ */
+void metrics_sample() {
+    if (i2c_bus != NULL) {
+        metrics_counter_set(METRICS_I2C_ERRORS, i2c_bus_get_error_count(i2c_bus));
+    }
+}
+
 /**
  * @brief MQTT task responsible for handling MQTT communication.
  *
  * This function initializes the MQTT client, registers event handlers, and starts the MQTT client.
- * It then enters a loop where it periodically publishes a message containing city information to the MQTT broker.
+ * It then enters a loop where it publishes every city change the UI puts into the outbox. Nothing is
+ * published on a timer. While the client is disconnected the changes are dropped, the connect handler
+ * publishes the city selected at that time.
  *
  * @param param Task parameter (unused).
  */
 static void mqtt_task(void* param)
 {
-    // Configure the MQTT client with the broker's URI
+    // Configure the MQTT client with the broker's URI, the broker keeps the session over reconnects
     esp_mqtt_client_config_t mqtt_cfg = {
-        .broker.address.uri = CONFIG_BROKER_URL
+        .broker.address.uri = CONFIG_BROKER_URL,
+        .session.disable_clean_session = true,
     };
 
     // Initialize the MQTT client
@@ -259,24 +378,98 @@ static void mqtt_task(void* param)
     // Start the MQTT client
     ESP_ERROR_CHECK(esp_mqtt_client_start(client));
 
+    // Publish stack and heap snapshots and the metrics with the same client
+    health_start(client);
+    metrics_start(client, metrics_sample);
+
     while (1) {
-        char buff[MAX_BUFF];
-        sprintf(buff, "%s %s", PREFIX_CITY, CITY_CONFIG[CITY]);
+        int city;
 
-        // Publish the message to the MQTT broker
-        int msg_id = esp_mqtt_client_publish(client, CONFIG_MQTT_TOPIC, buff, strlen(buff), 1, 0);
-        if (msg_id == -1) {
-            ESP_LOGI(TAG_MQTT, "Error occured when sending message to MQTT broker");
-        }
-        else {
-            ESP_LOGI(TAG_MQTT, "Published message ID: %d", msg_id);
+        // Wait for the user to select another city
+        xQueueReceive(city_outbox, &city, portMAX_DELAY);
+
+        if (!mqtt_connected) {
+            LOG_RING_I(TAG_MQTT, "Not connected, the city is sent on connect");
+            continue;
         }
 
-        // Delay before publishing the next message
-        vTaskDelay(5000 / portTICK_PERIOD_MS);
+        mqtt_publish_city(client, city);
     }
 }
 
+/**
+ * @brief Formats one ESP-NOW reading back into the text the views show.
+ *
+ * @param buff Buffer of MAX_BUFF bytes.
+ * @param value Reading in tenths of its unit.
+ * @param unit Unit appended after the value.
+ */
+void espnow_format(char* buff, int16_t value, const char* unit) {
+    if (value == ESPNOW_LINK_NO_VALUE) {
+        strcpy(buff, "-");
+        return;
+    }
+
+    snprintf(buff, MAX_BUFF, "%.1f %s", value / 10.0f, unit);
+}
+
+/**
+ * @brief Stores the data broadcast by the ESP-NOW gateway, on a display.
+ *
+ * The gateway follows the city of the last request from any station, so the city of the frame
+ * replaces the local one.
+ *
+ * @param frame Telemetry frame.
+ */
+void espnow_on_telemetry(const espnow_link_frame_t* frame) {
+    const int SIZE = sizeof(CITY_CONFIG) / sizeof(CITY_CONFIG[0]);  // Number of cities in the list
+
+    if (frame->city >= SIZE) {
+        ESP_LOGW(TAG_ESPNOW, "Unknown city %d", frame->city);
+        return;
+    }
+
+    CITY = frame->city;
+    espnow_format(TEMPERATURE, frame->temperature, "C");
+    espnow_format(HUMIDITY, frame->humidity, "%");
+    espnow_format(VISIBILITY, frame->visibility, "%");
+
+    LOG_RING_I(TAG_ESPNOW, "Telemetry #%u for %s", frame->seq, CITY_CONFIG[CITY]);
+}
+
+/**
+ * @brief Publishes the city requested by an ESP-NOW display, on the gateway.
+ *
+ * @param city Index of the city in CITY_CONFIG.
+ */
+void espnow_on_city(int city) {
+    const int SIZE = sizeof(CITY_CONFIG) / sizeof(CITY_CONFIG[0]);  // Number of cities in the list
+
+    if (city < 0 || city >= SIZE) {
+        ESP_LOGW(TAG_ESPNOW, "Unknown city %d", city);
+        return;
+    }
+
+    CITY = city;
+    xQueueOverwrite(city_outbox, &CITY);
+}
+
+/**
+ * @brief Sends the city selected in the UI towards the server.
+ *
+ * A normal station hands it to mqtt_task, an ESP-NOW display asks the gateway to publish it.
+ *
+ * @param city Index of the city in CITY_CONFIG.
+ */
+void select_city(int city) {
+#if CONFIG_APP_ESPNOW_DISPLAY
+    espnow_link_request_city(city);
+#else
+    // Hand the change to mqtt_task, a newer change replaces one it has not taken yet
+    xQueueOverwrite(city_outbox, &city);
+#endif
+}
+
 /**
  * @brief Initializes the Non-Volatile Storage (NVS) flash.
  *
@@ -306,7 +499,7 @@ void init_nvs_flash() {
  * This function sets up and configures the WiFi driver in station mode. It creates a default event loop,
  * initializes the WiFi driver, registers event handlers for WiFi events, and configures the WiFi connection.
  * The function sets the WiFi SSID and password, sets the WiFi storage mode to RAM, and starts the WiFi driver.
- * It uses default configuration for WiFi initialization.
+ * It uses default configuration for WiFi initialization. The function does not wait for the connection.
  */
 void init_wifi() {
     // Initialize the network interface
@@ -316,7 +509,7 @@ void init_wifi() {
     ESP_ERROR_CHECK(esp_event_loop_create_default());
 
     // Create the default WiFi station interface
-    esp_netif_create_default_wifi_sta();
+    esp_netif_t* netif = esp_netif_create_default_wifi_sta();
 
     // Initialize the WiFi driver with default configuration
     wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
@@ -331,9 +524,16 @@ void init_wifi() {
         .sta = {
             .ssid = SSID,
             .password = PASSWORD,
+#if CONFIG_APP_IDLE_SLEEP
+            // Beacons between two wakeups of the radio in maximum modem sleep
+            .listen_interval = CONFIG_APP_IDLE_LISTEN_INTERVAL,
+#endif
         },
     };
 
+    // Connect straight to the cached access point
+    wifi_link_init(netif, &wifi_config);
+
     // Set WiFi storage mode to RAM
     ESP_ERROR_CHECK(esp_wifi_set_storage(WIFI_STORAGE_RAM));
 
@@ -345,9 +545,6 @@ void init_wifi() {
 
     // Start the WiFi driver
     ESP_ERROR_CHECK(esp_wifi_start());
-
-    // Wait to connect to wifi
-    vTaskDelay(1000 / portTICK_PERIOD_MS);
 }
 
 /**
@@ -359,24 +556,24 @@ void init_wifi() {
 void view_temperature() {
     while (1) {
         // Update OLED screen with temperature information
-        ssd1306_clear_screen(&dev, false);
-        ssd1306_contrast(&dev, 0xff);
-        ssd1306_display_text(&dev, 0, "- <Temperature -", 16, true);
-        ssd1306_display_text(&dev, 4, TEMPERATURE, strlen(TEMPERATURE), false);
+        display_clear_screen(false);
+        display_contrast(0xff);
+        display_text(0, "- <Temperature -", 16, true);
+        display_text(4, TEMPERATURE, strlen(TEMPERATURE), false);
 
         // Process gesture data
         switch (wait_for_gesture()) {
         case APDS9960_UP:
-            ESP_LOGI(TAG_APDS9960, "Gesture: DOWN");
+            LOG_RING_I(TAG_APDS9960, "Gesture: DOWN");
             break;
         case APDS9960_DOWN:
-            ESP_LOGI(TAG_APDS9960, "Gesture: UP");
+            LOG_RING_I(TAG_APDS9960, "Gesture: UP");
             break;
         case APDS9960_LEFT:
-            ESP_LOGI(TAG_APDS9960, "Gesture: RIGHT");
+            LOG_RING_I(TAG_APDS9960, "Gesture: RIGHT");
             break;
         case APDS9960_RIGHT:
-            ESP_LOGI(TAG_APDS9960, "Gesture: LEFT");
+            LOG_RING_I(TAG_APDS9960, "Gesture: LEFT");
             return;
         }
     }
@@ -391,24 +588,24 @@ void view_temperature() {
 void view_humidity() {
     while (1) {
         // Update OLED screen with humidity information
-        ssd1306_clear_screen(&dev, false);
-        ssd1306_contrast(&dev, 0xff);
-        ssd1306_display_text(&dev, 0, "-- < Humidity --", 16, true);
-        ssd1306_display_text(&dev, 4, HUMIDITY, strlen(HUMIDITY), false);
+        display_clear_screen(false);
+        display_contrast(0xff);
+        display_text(0, "-- < Humidity --", 16, true);
+        display_text(4, HUMIDITY, strlen(HUMIDITY), false);
 
         // Process gesture data
         switch (wait_for_gesture()) {
         case APDS9960_UP:
-            ESP_LOGI(TAG_APDS9960, "Gesture: DOWN");
+            LOG_RING_I(TAG_APDS9960, "Gesture: DOWN");
             break;
         case APDS9960_DOWN:
-            ESP_LOGI(TAG_APDS9960, "Gesture: UP");
+            LOG_RING_I(TAG_APDS9960, "Gesture: UP");
             break;
         case APDS9960_LEFT:
-            ESP_LOGI(TAG_APDS9960, "Gesture: RIGHT");
+            LOG_RING_I(TAG_APDS9960, "Gesture: RIGHT");
             break;
         case APDS9960_RIGHT:
-            ESP_LOGI(TAG_APDS9960, "Gesture: LEFT");
+            LOG_RING_I(TAG_APDS9960, "Gesture: LEFT");
             return;
         }
     }
@@ -426,24 +623,24 @@ void view_humidity() {
 void view_visibility() {
     while (1) {
         // Update OLED screen with visibility information
-        ssd1306_clear_screen(&dev, false);
-        ssd1306_contrast(&dev, 0xff);
-        ssd1306_display_text(&dev, 0, "- < Visibility -", 16, true);
-        ssd1306_display_text(&dev, 4, VISIBILITY, strlen(VISIBILITY), false);
+        display_clear_screen(false);
+        display_contrast(0xff);
+        display_text(0, "- < Visibility -", 16, true);
+        display_text(4, VISIBILITY, strlen(VISIBILITY), false);
 
         // Process gesture data
         switch (wait_for_gesture()) {
         case APDS9960_UP:
-            ESP_LOGI(TAG_APDS9960, "Gesture: DOWN");
+            LOG_RING_I(TAG_APDS9960, "Gesture: DOWN");
             break;
         case APDS9960_DOWN:
-            ESP_LOGI(TAG_APDS9960, "Gesture: UP");
+            LOG_RING_I(TAG_APDS9960, "Gesture: UP");
             break;
         case APDS9960_LEFT:
-            ESP_LOGI(TAG_APDS9960, "Gesture: RIGHT");
+            LOG_RING_I(TAG_APDS9960, "Gesture: RIGHT");
             break;
         case APDS9960_RIGHT:
-            ESP_LOGI(TAG_APDS9960, "Gesture: LEFT");
+            LOG_RING_I(TAG_APDS9960, "Gesture: LEFT");
             return;
         }
     }
@@ -479,15 +676,15 @@ bool view_confirm() {
         sprintf(buff, "Area: %s", CITY_CONFIG[CITY]);
 
         // Update OLED screen with confirmation prompt
-        ssd1306_clear_screen(&dev, false);
-        ssd1306_contrast(&dev, 0xff);
-        ssd1306_display_text(&dev, 0, "---- <Areas ----", 16, false);
-        ssd1306_display_text(&dev, 1, "Are you sure?", 13, false);
-        ssd1306_display_text(&dev, 7, buff, strlen(buff), false);
+        display_clear_screen(false);
+        display_contrast(0xff);
+        display_text(0, "---- <Areas ----", 16, false);
+        display_text(1, "Are you sure?", 13, false);
+        display_text(7, buff, strlen(buff), false);
 
         // Display confirmation options on the OLED screen
         for (int i = 0; i < SIZE; i++) {
-            ssd1306_display_text(&dev, i + 3, (char*)options[i], strlen(options[i]), opt_idx == i);
+            display_text(i + 3, (char*)options[i], strlen(options[i]), opt_idx == i);
         }
 
         // Delay to prevent rapid menu changes
@@ -496,22 +693,22 @@ bool view_confirm() {
         // Process gesture data
         switch (wait_for_gesture()) {
         case APDS9960_UP:
-            ESP_LOGI(TAG_APDS9960, "Gesture: DOWN");
+            LOG_RING_I(TAG_APDS9960, "Gesture: DOWN");
 
             opt_idx = (opt_idx + 1) % SIZE;
             break;
         case APDS9960_DOWN:
-            ESP_LOGI(TAG_APDS9960, "Gesture: UP");
+            LOG_RING_I(TAG_APDS9960, "Gesture: UP");
 
             opt_idx = (opt_idx - 1 + SIZE) % SIZE;
             break;
         case APDS9960_LEFT:
-            ESP_LOGI(TAG_APDS9960, "Gesture: RIGHT");
+            LOG_RING_I(TAG_APDS9960, "Gesture: RIGHT");
 
             // Return true if the user confirms with "Yes" and false for "No"
             return opt_idx == 0;
         case APDS9960_RIGHT:
-            ESP_LOGI(TAG_APDS9960, "Gesture: LEFT");
+            LOG_RING_I(TAG_APDS9960, "Gesture: LEFT");
 
             // Return false if the user chooses to leave this prompt
             return false;
@@ -544,14 +741,14 @@ void view_cities() {
         sprintf(buff, "Area: %s", CITY_CONFIG[CITY]);
 
         // Update OLED screen with city information
-        ssd1306_clear_screen(&dev, false);
-        ssd1306_contrast(&dev, 0xff);
-        ssd1306_display_text(&dev, 0, "---- <Areas ----", 16, false);
-        ssd1306_display_text(&dev, 7, buff, strlen(buff), false);
+        display_clear_screen(false);
+        display_contrast(0xff);
+        display_text(0, "---- <Areas ----", 16, false);
+        display_text(7, buff, strlen(buff), false);
 
         // Display city options on the OLED screen
         for (int i = 0; i < SIZE; i++) {
-            ssd1306_display_text(&dev, i + 1, (char*)CITY_CONFIG[i], strlen(CITY_CONFIG[i]), city_idx == i);
+            display_text(i + 1, (char*)CITY_CONFIG[i], strlen(CITY_CONFIG[i]), city_idx == i);
         }
 
         // Delay to prevent rapid option changes
@@ -560,23 +757,24 @@ void view_cities() {
         // Process gesture data
         switch (wait_for_gesture()) {
         case APDS9960_UP:
-            ESP_LOGI(TAG_APDS9960, "Gesture: DOWN");
+            LOG_RING_I(TAG_APDS9960, "Gesture: DOWN");
             city_idx = (city_idx + 1) % SIZE;
             break;
         case APDS9960_DOWN:
-            ESP_LOGI(TAG_APDS9960, "Gesture: UP");
+            LOG_RING_I(TAG_APDS9960, "Gesture: UP");
             city_idx = (city_idx - 1 + SIZE) % SIZE;
             break;
         case APDS9960_LEFT:
-            ESP_LOGI(TAG_APDS9960, "Gesture: RIGHT");
+            LOG_RING_I(TAG_APDS9960, "Gesture: RIGHT");
 
             // Prompt for confirmation and update the selected city if confirmed
-            if (!view_confirm(dev, apds9960)) break;
+            if (!view_confirm()) break;
 
             CITY = city_idx;
+            select_city(CITY);
             return;
         case APDS9960_RIGHT:
-            ESP_LOGI(TAG_APDS9960, "Gesture: LEFT");
+            LOG_RING_I(TAG_APDS9960, "Gesture: LEFT");
             return;
         }
     }
@@ -611,14 +809,14 @@ void view_menu() {
         sprintf(buff, "Area: %s", CITY_CONFIG[CITY]);
 
         // Update OLED screen with menu information
-        ssd1306_clear_screen(&dev, false);
-        ssd1306_contrast(&dev, 0xff);
-        ssd1306_display_text(&dev, 0, "----- Menu -----", 16, false);
-        ssd1306_display_text(&dev, 7, buff, strlen(buff), false);
+        display_clear_screen(false);
+        display_contrast(0xff);
+        display_text(0, "----- Menu -----", 16, false);
+        display_text(7, buff, strlen(buff), false);
         
         // Display menu options on the OLED screen
         for (int i = 0; i < MENU_SIZE; i++) {
-            ssd1306_display_text(&dev, i + 1, (char*)MENU_CONFIG[i], strlen(MENU_CONFIG[i]), view_idx == i);
+            display_text(i + 1, (char*)MENU_CONFIG[i], strlen(MENU_CONFIG[i]), view_idx == i);
         }
 
         // Delay to prevent rapid menu changes
@@ -627,17 +825,17 @@ void view_menu() {
         // Process gesture data
         switch (wait_for_gesture()) {
         case APDS9960_UP:
-            ESP_LOGI(TAG_APDS9960, "Gesture: DOWN");
+            LOG_RING_I(TAG_APDS9960, "Gesture: DOWN");
             // Move selection up in the menu
             view_idx = (view_idx + 1) % MENU_SIZE;
             break;
         case APDS9960_DOWN:
-            ESP_LOGI(TAG_APDS9960, "Gesture: UP");
+            LOG_RING_I(TAG_APDS9960, "Gesture: UP");
             // Move selection down in the menu
             view_idx = (view_idx - 1 + MENU_SIZE) % MENU_SIZE;
             break;
         case APDS9960_LEFT:
-            ESP_LOGI(TAG_APDS9960, "Gesture: RIGHT");
+            LOG_RING_I(TAG_APDS9960, "Gesture: RIGHT");
 
             // Get the selected view associated with the menu option
             view = MENU_VIEWS[view_idx];
@@ -646,7 +844,7 @@ void view_menu() {
             view();
             break;
         case APDS9960_RIGHT:
-            ESP_LOGI(TAG_APDS9960, "Gesture: LEFT");
+            LOG_RING_I(TAG_APDS9960, "Gesture: LEFT");
             break;
         }
     }
@@ -664,12 +862,12 @@ void view_menu() {
  */
 void view_welcome() {
     // Clear OLED screen and set contrast
-    ssd1306_clear_screen(&dev, true);
-    ssd1306_contrast(&dev, 0xff);
+    display_clear_screen(true);
+    display_contrast(0xff);
 
     // Display welcome message
-    ssd1306_display_text(&dev, 2, "    Welcome", 11, true);
-    ssd1306_display_text(&dev, 4, "Swipe to launch!", 16, true);
+    display_text(2, "    Welcome", 11, true);
+    display_text(4, "Swipe to launch!", 16, true);
 
     wait_for_gesture();
 
@@ -677,30 +875,47 @@ void view_welcome() {
     view_menu();
 }
 
+/**
+ * @brief Displays the data of the selected area at once, for the duty cycled station.
+ *
+ * This function draws the temperature, humidity and visibility of the selected area on one screen
+ * and pushes it to the panel. It does not wait for a gesture, the station goes to deep sleep with
+ * the screen showing this view.
+ */
+void view_station() {
+    char buff[MAX_BUFF];
+
+    // Display area information on the OLED screen
+    sprintf(buff, "Area: %s", CITY_CONFIG[CITY]);
+
+    // Update OLED screen with all the data
+    display_clear_screen(false);
+    display_contrast(0xff);
+    display_text(0, "--- Station ----", 16, false);
+    display_text(2, TEMPERATURE, strlen(TEMPERATURE), false);
+    display_text(3, HUMIDITY, strlen(HUMIDITY), false);
+    display_text(4, VISIBILITY, strlen(VISIBILITY), false);
+    display_text(7, buff, strlen(buff), false);
+
+    display_flush();
+}
+
 /**
  * @brief Runs the program.
  *
- * This function initializes the SPI monitor, I2C bus for APDS9960 sensor,
+ * This function initializes the display, I2C bus for APDS9960 sensor,
  * and sets up the necessary configurations. It also initializes the gesture
  * engine of the APDS9960 sensor and creates a view with welcome text.
  */
 void app_run() {
-    ESP_LOGI(TAG_SSD1306, "INTERFACE is SPI");
-    ESP_LOGI(TAG_SSD1306, "CONFIG_MOSI_GPIO=%d", CONFIG_MOSI_GPIO);
-    ESP_LOGI(TAG_SSD1306, "CONFIG_SCLK_GPIO=%d", CONFIG_SCLK_GPIO);
-    ESP_LOGI(TAG_SSD1306, "CONFIG_CS_GPIO=%d", CONFIG_CS_GPIO);
-    ESP_LOGI(TAG_SSD1306, "CONFIG_DC_GPIO=%d", CONFIG_DC_GPIO);
-    ESP_LOGI(TAG_SSD1306, "CONFIG_RESET_GPIO=%d", CONFIG_RESET_GPIO);
-    spi_master_init(&dev, CONFIG_MOSI_GPIO, CONFIG_SCLK_GPIO, CONFIG_CS_GPIO, CONFIG_DC_GPIO, CONFIG_RESET_GPIO);
-
-    ESP_LOGI(TAG_SSD1306, "Panel is 128x64");
-    ssd1306_init(&dev, 128, 64);
+    // Initialize the display selected in menuconfig
+    display_init();
 
     // Initialize I2C bus for APDS9960
     i2c_config_t conf = {
         .mode = I2C_MODE_MASTER,
-        .sda_io_num = CONFIG_SDA_GPIO,
-        .scl_io_num = CONFIG_SCL_GPIO,
+        .sda_io_num = APDS9960_SDA_GPIO,
+        .scl_io_num = APDS9960_SCL_GPIO,
         .sda_pullup_en = GPIO_PULLUP_ENABLE,
         .scl_pullup_en = GPIO_PULLUP_ENABLE,
         .master.clk_speed = 100000
@@ -723,37 +938,167 @@ void app_run() {
     // Enable gesture engine
     ESP_ERROR_CHECK(apds9960_enable_gesture_engine(apds9960, true));
 
+    // Wake up from light sleep on the gesture interrupt when idle mode is enabled
+    idle_init(apds9960);
+
+    // Take the start of each gesture from the interrupt when enabled in menuconfig
+    latency_init(apds9960);
+
     // Create view with welcome text
     view_welcome();
 }
 
 
+/**
+ * @brief Sensor and UI task.
+ *
+ * Runs the gesture polling and the views on CONFIG_APP_UI_CORE, away from the Wi-Fi, lwIP and
+ * MQTT tasks on the network core. If the views ever return because of an error, the task cleans
+ * up and restarts the system.
+ *
+ * @param param Task parameter (unused).
+ */
+static void ui_task(void* param) {
+    // Start app
+    app_run();
+
+    // Cleanup
+    cleanup();
+
+    // Restart app if error occured
+    esp_restart();
+}
+
+/**
+ * @brief Runs one timer wakeup of the duty cycled station.
+ *
+ * This function waits for the cached Wi-Fi connection, resumes the MQTT session of the station and
+ * waits for the data the server keeps retained on the topic, which the broker sends right after the
+ * subscription. The data is rendered and the station goes back to deep sleep, so the function does
+ * not return. Whatever happens, the station sleeps again after CONFIG_APP_STATION_AWAKE_TIMEOUT_MS.
+ */
+#if CONFIG_APP_IDLE_DEEP_SLEEP
+void station_cycle() {
+    TimeOut_t timeout;
+    TickType_t remaining = pdMS_TO_TICKS(CONFIG_APP_STATION_AWAKE_TIMEOUT_MS);
+    vTaskSetTimeOutState(&timeout);
+
+    // Initialize the display while Wi-Fi connects
+    display_init();
+
+    // Wait for the cached connection, an expired timeout leaves no ticks remaining
+    xTaskCheckForTimeOut(&timeout, &remaining);
+    if (!wifi_link_wait(remaining)) {
+        ESP_LOGW(TAG_WIFI, "No IP address, dropping the cached connection");
+        wifi_link_forget();
+
+        view_station();
+        station_deep_sleep();
+    }
+
+    // The broker keeps the session of the station, a QoS 0 subscription queues nothing while it sleeps
+    esp_mqtt_client_config_t mqtt_cfg = {
+        .broker.address.uri = CONFIG_BROKER_URL,
+        .session.disable_clean_session = true,
+        .network.disable_auto_reconnect = true,
+    };
+
+    esp_mqtt_client_handle_t client = esp_mqtt_client_init(&mqtt_cfg);
+    if (client == NULL) {
+        exit_error("Error esp_mqtt_client_init parse error\n");
+    }
+
+    ESP_ERROR_CHECK(esp_mqtt_client_register_event(client, (esp_mqtt_event_id_t)ESP_EVENT_ANY_ID, mqtt_event_handler, client));
+    ESP_ERROR_CHECK(esp_mqtt_client_start(client));
+
+    // The retained data arrives right after the subscription in MQTT_EVENT_CONNECTED
+    xTaskCheckForTimeOut(&timeout, &remaining);
+    EventBits_t bits = xEventGroupWaitBits(station_events, STATION_GOT_DATA_BIT, pdFALSE, pdTRUE, remaining);
+    if (!(bits & STATION_GOT_DATA_BIT)) {
+        ESP_LOGW(TAG_MQTT, "No data in this cycle, showing the last one");
+    }
+
+    view_station();
+
+    // Disconnect cleanly, the session stays on the broker
+    esp_mqtt_client_stop(client);
+
+    station_deep_sleep();
+}
+#endif
+
 /**
  * @brief The main function for the program.
  *
  * This function serves as the entry point for the application. It initializes
- * necessary components such as NVS (Non-Volatile Storage), WIFI, and creates
- * a task for handling MQTT events. The main application logic is then executed
- * in `app_run()` function, that creates views. If an error occurs during the application
- * execution, the system is restarted using `esp_restart()`.
+ * necessary components such as NVS (Non-Volatile Storage) and WIFI, then splits the work
+ * between the two cores: the task that publishes to MQTT is pinned to the network core,
+ * next to the Wi-Fi and lwIP tasks, and the sensor and UI task that runs `app_run()` is
+ * pinned to the other core. Priorities and stack sizes come from menuconfig, see
+ * "Task Configuration". The main task ends when this function returns. A timer wakeup of the
+ * duty cycled station runs `station_cycle()` instead, which goes back to deep sleep.
  */
 void app_main(void)
 {
+#if CONFIG_APP_IDLE_SLEEP || CONFIG_APP_METRICS_GINT || (CONFIG_APP_TRACE && CONFIG_APP_TRACE_TRIGGER_GPIO >= 0)
+    // One GPIO interrupt service for the INT pin of the sensor and the trace button, the modules add their handlers
+    ESP_ERROR_CHECK(gpio_install_isr_service(0));
+#endif
+
+    // Record the scheduling trace from the start, when enabled in menuconfig
+    trace_start();
+
+    // Print the deferred logs of the hot paths from a low priority task
+    log_ring_start();
+
     // Initialize NVS
     init_nvs_flash();
 
+#if CONFIG_APP_IDLE_DEEP_SLEEP
+    // A timer wakeup of the duty cycled station only fetches and renders the data
+    if (station_is_cycle_wakeup()) {
+        station_events = xEventGroupCreate();
+        init_wifi();
+        station_cycle();
+    }
+#endif
+
     // Initialize WIFI
     init_wifi();
 
-    // Create a process that handles mqtt events
-    xTaskCreate(mqtt_task, "mqtt_task", 8192, NULL, 5, NULL);
+#if CONFIG_APP_ESPNOW_DISPLAY
+    // A display gets everything from the gateway over ESP-NOW, no IP and no MQTT client
+    espnow_link_init(espnow_on_telemetry, NULL);
 
-    // Start app
-    app_run();
+    // Log stack and heap snapshots and the metrics, there is no client to publish them with
+    health_start(NULL);
+    metrics_start(NULL, metrics_sample);
 
-    // Cleanup
-    cleanup();
+    xTaskCreatePinnedToCore(ui_task, "ui_task", CONFIG_APP_UI_TASK_STACK_SIZE, NULL,
+                            CONFIG_APP_UI_TASK_PRIORITY, NULL, CONFIG_APP_UI_CORE);
+    cpu_load_start();
+    profiler_start();
+    return;
+#endif
 
-    // Restart app if error occured
-    esp_restart();
+    // Wait to connect to wifi, a cached connection is usually up well before the timeout
+    wifi_link_wait(1000 / portTICK_PERIOD_MS);
+
+    // Create the outbox of city changes before the tasks that use it
+    city_outbox = xQueueCreate(1, sizeof(int));
+
+    // Rebroadcast the data to ESP-NOW displays and take their city requests, when this is the gateway
+    espnow_link_init(NULL, espnow_on_city);
+
+    // Create a process that handles mqtt events
+    xTaskCreatePinnedToCore(mqtt_task, "mqtt_publish", CONFIG_APP_MQTT_TASK_STACK_SIZE, NULL,
+                            CONFIG_APP_MQTT_TASK_PRIORITY, NULL, CONFIG_APP_NET_CORE);
+
+    // Create a process that reads gestures and renders the views
+    xTaskCreatePinnedToCore(ui_task, "ui_task", CONFIG_APP_UI_TASK_STACK_SIZE, NULL,
+                            CONFIG_APP_UI_TASK_PRIORITY, NULL, CONFIG_APP_UI_CORE);
+
+    // Report the load of every task and sample where the cycles go, when enabled in menuconfig
+    cpu_load_start();
+    profiler_start();
 }
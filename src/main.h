@@ -7,12 +7,26 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
+#include "freertos/queue.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 
+#include "driver/gpio.h"
 #include "driver/i2c.h"
 
-#include "ssd1306.h"
-#include "font8x8_basic.h"
+#include "display.h"
+#include "cpu_load.h"
+#include "health.h"
+#include "idle.h"
+#include "station.h"
+#include "wifi_link.h"
+#include "espnow_link.h"
+#include "telemetry.h"
+#include "metrics.h"
+#include "log_ring.h"
+#include "profiler.h"
+#include "trace.h"
+#include "latency.h"
 
 #include "apds9960.h"
 #include "mqtt_client.h"
@@ -0,0 +1,243 @@
+/**
+ * @file metrics.c
+ * @brief Registry and export of the metrics, see metrics.h.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#include "metrics.h"
+
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_timer.h"
+
+#define TAG_METRICS "METRICS"
+
+#define PREFIX_METRICS "[METRICS]"
+
+#if CONFIG_APP_METRICS
+
+// Size of one line, fits all metrics with every bucket filled
+#define METRICS_MAX_BUFF 2048
+
+typedef struct {
+    uint32_t count;
+    uint64_t sum;
+    uint32_t max;
+    uint32_t buckets[METRICS_BUCKETS];
+} metrics_histogram_data_t;
+
+// Names in the line, in the order of the enums
+static const char* METRICS_COUNTER_NAMES[METRICS_COUNTERS] = {
+    [METRICS_GESTURES] = "gestures",
+    [METRICS_DISPLAY_BYTES] = "display_bytes",
+    [METRICS_I2C_ERRORS] = "i2c_errors",
+    [METRICS_MQTT_RX] = "mqtt_rx",
+    [METRICS_MQTT_TX] = "mqtt_tx",
+    [METRICS_MQTT_DISCONNECTS] = "mqtt_disconnects",
+    [METRICS_WIFI_DISCONNECTS] = "wifi_disconnects",
+};
+
+static const char* METRICS_GAUGE_NAMES[METRICS_GAUGES] = {
+    [METRICS_HEAP_FREE] = "heap_free",
+    [METRICS_HEAP_MIN_FREE] = "heap_min_free",
+};
+
+static const char* METRICS_HISTOGRAM_NAMES[METRICS_HISTOGRAMS] = {
+    [METRICS_GESTURE_US] = "gesture_us",
+    [METRICS_REDRAW_US] = "redraw_us",
+    [METRICS_MQTT_RTT_US] = "mqtt_rtt_us",
+    [METRICS_MOTION_US] = "motion_us",
+    [METRICS_STAGE_POLL_US] = "stage_poll_us",
+    [METRICS_STAGE_FIFO_US] = "stage_fifo_us",
+    [METRICS_STAGE_CLASSIFY_US] = "stage_classify_us",
+    [METRICS_STAGE_DISPATCH_US] = "stage_dispatch_us",
+    [METRICS_STAGE_HANDLE_US] = "stage_handle_us",
+    [METRICS_STAGE_RENDER_US] = "stage_render_us",
+};
+
+static uint32_t metrics_counters[METRICS_COUNTERS];
+static int32_t metrics_gauges[METRICS_GAUGES];
+static metrics_histogram_data_t metrics_histograms[METRICS_HISTOGRAMS];
+
+// Guards the histograms, a value updates several fields, and the copy of them for the export
+static portMUX_TYPE metrics_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Line and copy of the histograms of the export task
+static char metrics_buff[METRICS_MAX_BUFF];
+static metrics_histogram_data_t metrics_snapshot[METRICS_HISTOGRAMS];
+
+static esp_mqtt_client_handle_t metrics_client = NULL;
+static metrics_sample_cb_t metrics_sample = NULL;
+
+// Station MAC, tells the stations apart on the server
+static char metrics_id[13];
+
+void metrics_count(metrics_counter_t id, uint32_t n) {
+    __atomic_fetch_add(&metrics_counters[id], n, __ATOMIC_RELAXED);
+}
+
+void metrics_counter_set(metrics_counter_t id, uint32_t value) {
+    __atomic_store_n(&metrics_counters[id], value, __ATOMIC_RELAXED);
+}
+
+void metrics_gauge(metrics_gauge_t id, int32_t value) {
+    __atomic_store_n(&metrics_gauges[id], value, __ATOMIC_RELAXED);
+}
+
+void metrics_observe(metrics_histogram_t id, uint32_t us) {
+    // Bucket i ends at 2^(METRICS_BUCKET_MIN_SHIFT + i), the number of bits of the value picks it
+    int bits = us ? 32 - __builtin_clz(us) : 0;
+    int bucket = bits - METRICS_BUCKET_MIN_SHIFT;
+    if (bucket < 0) {
+        bucket = 0;
+    }
+    else if (bucket >= METRICS_BUCKETS) {
+        bucket = METRICS_BUCKETS - 1;
+    }
+
+    metrics_histogram_data_t* histogram = &metrics_histograms[id];
+
+    taskENTER_CRITICAL(&metrics_lock);
+    histogram->count++;
+    histogram->sum += us;
+    if (us > histogram->max) {
+        histogram->max = us;
+    }
+    histogram->buckets[bucket]++;
+    taskEXIT_CRITICAL(&metrics_lock);
+}
+
+/**
+ * @brief Appends to metrics_buff, the line stays terminated when it is full.
+ *
+ * @param len Length of the line so far.
+ * @param format Format of the text to append.
+ * @return Length of the line.
+ */
+__attribute__((format(printf, 2, 3)))
+static int metrics_append(int len, const char* format, ...) {
+    if (len >= METRICS_MAX_BUFF - 1) {
+        return len;
+    }
+
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(metrics_buff + len, METRICS_MAX_BUFF - len, format, args);
+    va_end(args);
+
+    return n < 0 ? len : (len + n < METRICS_MAX_BUFF ? len + n : METRICS_MAX_BUFF - 1);
+}
+
+/**
+ * @brief Formats one line into metrics_buff.
+ *
+ * @return Length of the line.
+ */
+static int metrics_format() {
+    // Gauges the module samples itself, the callback may set more
+    metrics_gauge(METRICS_HEAP_FREE, heap_caps_get_free_size(MALLOC_CAP_INTERNAL));
+    metrics_gauge(METRICS_HEAP_MIN_FREE, heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL));
+    if (metrics_sample != NULL) {
+        metrics_sample();
+    }
+
+    taskENTER_CRITICAL(&metrics_lock);
+    memcpy(metrics_snapshot, metrics_histograms, sizeof(metrics_snapshot));
+    taskEXIT_CRITICAL(&metrics_lock);
+
+    int len = metrics_append(0, "%s id=%s up=%" PRId64 " c=", PREFIX_METRICS, metrics_id,
+                             esp_timer_get_time() / 1000000);
+
+    for (int i = 0; i < METRICS_COUNTERS; i++) {
+        len = metrics_append(len, "%s%s:%" PRIu32, i ? "," : "", METRICS_COUNTER_NAMES[i],
+                             __atomic_load_n(&metrics_counters[i], __ATOMIC_RELAXED));
+    }
+
+    len = metrics_append(len, " g=");
+    for (int i = 0; i < METRICS_GAUGES; i++) {
+        len = metrics_append(len, "%s%s:%" PRId32, i ? "," : "", METRICS_GAUGE_NAMES[i],
+                             __atomic_load_n(&metrics_gauges[i], __ATOMIC_RELAXED));
+    }
+
+    len = metrics_append(len, " h=");
+    for (int i = 0; i < METRICS_HISTOGRAMS; i++) {
+        metrics_histogram_data_t* histogram = &metrics_snapshot[i];
+
+        len = metrics_append(len, "%s%s:%" PRIu32 "/%" PRIu64 "/%" PRIu32 "/", i ? "," : "", METRICS_HISTOGRAM_NAMES[i],
+                             histogram->count, histogram->sum, histogram->max);
+
+        // Trailing empty buckets are left out, an empty histogram still has its first bucket
+        int last = METRICS_BUCKETS - 1;
+        while (last > 0 && histogram->buckets[last] == 0) {
+            last--;
+        }
+
+        for (int b = 0; b <= last; b++) {
+            len = metrics_append(len, "%s%" PRIu32, b ? "." : "", histogram->buckets[b]);
+        }
+    }
+
+    return len;
+}
+
+/**
+ * @brief Export task, logs and publishes a line every CONFIG_APP_METRICS_PERIOD_MS.
+ *
+ * @param param Task parameter (unused).
+ */
+static void metrics_task(void* param) {
+    while (1) {
+        vTaskDelay(CONFIG_APP_METRICS_PERIOD_MS / portTICK_PERIOD_MS);
+
+        int len = metrics_format();
+
+        ESP_LOGI(TAG_METRICS, "%s", metrics_buff);
+
+        // QoS 0, the values count from boot and the next line carries everything this one had
+        if (metrics_client != NULL &&
+            esp_mqtt_client_publish(metrics_client, CONFIG_APP_METRICS_TOPIC, metrics_buff, len, 0, 0) == -1) {
+            ESP_LOGD(TAG_METRICS, "Line not published, MQTT is not connected");
+        }
+    }
+}
+
+void metrics_start(esp_mqtt_client_handle_t client, metrics_sample_cb_t sample) {
+    metrics_client = client;
+    metrics_sample = sample;
+
+    uint8_t mac[6];
+    esp_read_mac(mac, ESP_MAC_WIFI_STA);
+    snprintf(metrics_id, sizeof(metrics_id), "%02x%02x%02x%02x%02x%02x",
+             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+
+    xTaskCreatePinnedToCore(metrics_task, "metrics", 3072, NULL, tskIDLE_PRIORITY + 1, NULL, CONFIG_APP_NET_CORE);
+}
+
+#else
+
+void metrics_start(esp_mqtt_client_handle_t client, metrics_sample_cb_t sample) {
+}
+
+void metrics_count(metrics_counter_t id, uint32_t n) {
+}
+
+void metrics_counter_set(metrics_counter_t id, uint32_t value) {
+}
+
+void metrics_gauge(metrics_gauge_t id, int32_t value) {
+}
+
+void metrics_observe(metrics_histogram_t id, uint32_t us) {
+}
+
+#endif
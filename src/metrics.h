@@ -0,0 +1,108 @@
+/**
+ * @file metrics.h
+ * @brief Counters, gauges and histograms exported over MQTT, enabled by CONFIG_APP_METRICS.
+ *
+ * The metrics are fixed at compile time, one enum entry each, so recording one is an index into a
+ * static table without any lookup or allocation. Every CONFIG_APP_METRICS_PERIOD_MS one line is
+ * published on CONFIG_APP_METRICS_TOPIC:
+ *
+ *     [METRICS] id=<mac> up=<s> c=<name>:<value>,... g=<name>:<value>,... h=<name>:<count>/<sum>/<max>/<b0>.<b1>...,...
+ *
+ * Counters and histograms count from boot, so a lost line does not lose any event and the server
+ * takes the rate from two lines. Histogram values are microseconds. Bucket i counts values below
+ * 2^(METRICS_BUCKET_MIN_SHIFT + i) us, the last one everything above. Trailing empty buckets are
+ * left out. server/metrics.py aggregates the lines of all stations.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+
+#include "mqtt_client.h"
+
+// Upper bound of the first histogram bucket, 128 us
+#define METRICS_BUCKET_MIN_SHIFT 7
+
+// Number of histogram buckets, the last one ends above 1 s
+#define METRICS_BUCKETS 15
+
+typedef enum {
+    METRICS_GESTURES = 0,       // Gestures read from the APDS9960
+    METRICS_DISPLAY_BYTES,      // Bytes pushed to the panel
+    METRICS_I2C_ERRORS,         // Failed transfers on the sensor bus
+    METRICS_MQTT_RX,            // MQTT messages received
+    METRICS_MQTT_TX,            // MQTT messages published
+    METRICS_MQTT_DISCONNECTS,   // Lost connections to the broker
+    METRICS_WIFI_DISCONNECTS,   // Lost connections to the access point
+    METRICS_COUNTERS,
+} metrics_counter_t;
+
+typedef enum {
+    METRICS_HEAP_FREE = 0,      // Free internal heap in bytes
+    METRICS_HEAP_MIN_FREE,      // Least free internal heap since boot in bytes
+    METRICS_GAUGES,
+} metrics_gauge_t;
+
+typedef enum {
+    METRICS_GESTURE_US = 0,     // Gesture read to the next view on the panel
+    METRICS_REDRAW_US,          // Clear of a view to its flush
+    METRICS_MQTT_RTT_US,        // QoS 1 publish to its PUBACK
+    METRICS_MOTION_US,          // Gesture start to the next view on the panel, the sum of the stages
+    METRICS_STAGE_POLL_US,      // Gesture interrupt to the first poll that sees it, see latency.h
+    METRICS_STAGE_FIFO_US,      // First poll to the end of the first FIFO read
+    METRICS_STAGE_CLASSIFY_US,  // First FIFO read to a known direction
+    METRICS_STAGE_DISPATCH_US,  // Known direction to the view handling it
+    METRICS_STAGE_HANDLE_US,    // View handling it to the first draw
+    METRICS_STAGE_RENDER_US,    // First draw to the view complete on the panel
+    METRICS_HISTOGRAMS,
+} metrics_histogram_t;
+
+/**
+ * @brief Called by the export task before every line, to set the gauges and counters it samples.
+ */
+typedef void (*metrics_sample_cb_t)();
+
+/**
+ * @brief Starts the export task on the network core, does nothing when metrics are disabled.
+ *
+ * @param client MQTT client the lines are published with, NULL to only log them.
+ * @param sample Sample callback, may be NULL.
+ */
+void metrics_start(esp_mqtt_client_handle_t client, metrics_sample_cb_t sample);
+
+/**
+ * @brief Adds to a counter, from any task.
+ *
+ * @param id Counter.
+ * @param n Value to add.
+ */
+void metrics_count(metrics_counter_t id, uint32_t n);
+
+/**
+ * @brief Sets a counter kept by someone else, like the error count of a driver.
+ *
+ * @param id Counter.
+ * @param value Total since boot.
+ */
+void metrics_counter_set(metrics_counter_t id, uint32_t value);
+
+/**
+ * @brief Sets a gauge, from any task.
+ *
+ * @param id Gauge.
+ * @param value Current value.
+ */
+void metrics_gauge(metrics_gauge_t id, int32_t value);
+
+/**
+ * @brief Adds one value to a histogram, from any task.
+ *
+ * @param id Histogram.
+ * @param us Value in microseconds.
+ */
+void metrics_observe(metrics_histogram_t id, uint32_t us);
+
+#endif
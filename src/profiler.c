@@ -0,0 +1,236 @@
+/**
+ * @file profiler.c
+ * @brief Sampling profiler on GPTimer interrupts of both cores, see profiler.h.
+ *
+ * On Xtensa the interrupt entry of FreeRTOS saves the registers of the interrupted code in a frame
+ * on its stack and stores the stack pointer in pxTopOfStack, the first field of the TCB. The
+ * sampling interrupt reads PC and a0 from that frame, so it costs a few loads and stores per sample
+ * and no stack unwinding.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#include "profiler.h"
+
+#include <inttypes.h>
+#include <stdlib.h>
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+
+#define TAG_PROFILER "PROFILER"
+
+#define PREFIX_PROFILER "[PROF]"
+
+#if CONFIG_APP_PROFILER
+
+#include "driver/gptimer.h"
+#include "esp_attr.h"
+#include "freertos/xtensa_context.h"
+
+// Tick of the sampling timers
+#define PROFILER_RESOLUTION_HZ 1000000
+
+// Maximum number of tasks named in one dump
+#define PROFILER_MAX_TASKS 32
+
+typedef struct {
+    TaskHandle_t task;
+    uint32_t pc;
+    uint32_t caller;
+} profiler_sample_t;
+
+typedef struct {
+    gptimer_handle_t timer;
+    volatile uint32_t count;
+    volatile uint32_t lost;
+    profiler_sample_t samples[CONFIG_APP_PROFILER_SAMPLES];
+} profiler_ring_t;
+
+// One ring per core, each only written by the interrupt of its core
+static profiler_ring_t profiler_rings[portNUM_PROCESSORS];
+
+static TaskHandle_t profiler_task_handle = NULL;
+
+// Task names of the dump
+static TaskStatus_t profiler_status[PROFILER_MAX_TASKS];
+
+/**
+ * @brief Turns a windowed return address into the address of the call instruction.
+ *
+ * The top two bits of a0 hold the window increment of the call, code runs at 0x40000000 and up.
+ */
+static inline uint32_t IRAM_ATTR profiler_call_site(uint32_t a0) {
+    return ((a0 & 0x3fffffff) | 0x40000000) - 3;
+}
+
+/**
+ * @brief Alarm of the sampling timer, runs on the core the timer interrupt was allocated on.
+ */
+static bool IRAM_ATTR profiler_on_alarm(gptimer_handle_t timer, const gptimer_alarm_event_data_t* edata,
+                                        void* user_ctx) {
+    profiler_ring_t* ring = user_ctx;
+
+    if (ring->count >= CONFIG_APP_PROFILER_SAMPLES) {
+        ring->lost++;
+        return false;
+    }
+
+    // Level 1 interrupts do not nest, so the saved frame is the one of the interrupted task
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    const XtExcFrame* frame = *(XtExcFrame**)task;
+
+    profiler_sample_t* sample = &ring->samples[ring->count];
+    sample->task = task;
+    sample->pc = frame->pc;
+    sample->caller = profiler_call_site(frame->a0);
+    ring->count++;
+
+    return false;
+}
+
+/**
+ * @brief Creates the sampling timer of the core it runs on, the interrupt is allocated there.
+ *
+ * @param param Ring of the core.
+ */
+static void profiler_setup_task(void* param) {
+    profiler_ring_t* ring = param;
+
+    gptimer_config_t config = {
+        .clk_src = GPTIMER_CLK_SRC_DEFAULT,
+        .direction = GPTIMER_COUNT_UP,
+        .resolution_hz = PROFILER_RESOLUTION_HZ,
+    };
+    gptimer_alarm_config_t alarm = {
+        .alarm_count = PROFILER_RESOLUTION_HZ / CONFIG_APP_PROFILER_HZ,
+        .reload_count = 0,
+        .flags.auto_reload_on_alarm = true,
+    };
+    gptimer_event_callbacks_t callbacks = {
+        .on_alarm = profiler_on_alarm,
+    };
+
+    if (gptimer_new_timer(&config, &ring->timer) != ESP_OK ||
+        gptimer_set_alarm_action(ring->timer, &alarm) != ESP_OK ||
+        gptimer_register_event_callbacks(ring->timer, &callbacks, ring) != ESP_OK ||
+        gptimer_enable(ring->timer) != ESP_OK) {
+        ESP_LOGE(TAG_PROFILER, "No sampling timer on core %d", xPortGetCoreID());
+        ring->timer = NULL;
+    }
+
+    xTaskNotifyGive(profiler_task_handle);
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Orders the samples by task, PC and caller, so equal ones are next to each other.
+ */
+static int profiler_compare(const void* a, const void* b) {
+    const profiler_sample_t* x = a;
+    const profiler_sample_t* y = b;
+
+    if (x->task != y->task) {
+        return (uintptr_t)x->task < (uintptr_t)y->task ? -1 : 1;
+    }
+    if (x->pc != y->pc) {
+        return x->pc < y->pc ? -1 : 1;
+    }
+    if (x->caller != y->caller) {
+        return x->caller < y->caller ? -1 : 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Logs the samples of all cores, equal ones once with their count.
+ */
+static void profiler_dump() {
+    uint32_t samples = 0;
+    uint32_t lost = 0;
+
+    for (int c = 0; c < portNUM_PROCESSORS; c++) {
+        samples += profiler_rings[c].count;
+        lost += profiler_rings[c].lost;
+    }
+
+    ESP_LOGI(TAG_PROFILER, "%s begin hz=%d samples=%" PRIu32 " lost=%" PRIu32, PREFIX_PROFILER, CONFIG_APP_PROFILER_HZ, samples,
+             lost);
+
+    UBaseType_t count = uxTaskGetSystemState(profiler_status, PROFILER_MAX_TASKS, NULL);
+    for (UBaseType_t i = 0; i < count; i++) {
+        ESP_LOGI(TAG_PROFILER, "%s task %p %s", PREFIX_PROFILER, profiler_status[i].xHandle,
+                 profiler_status[i].pcTaskName);
+    }
+
+    for (int c = 0; c < portNUM_PROCESSORS; c++) {
+        profiler_ring_t* ring = &profiler_rings[c];
+        qsort(ring->samples, ring->count, sizeof(profiler_sample_t), profiler_compare);
+
+        for (uint32_t i = 0; i < ring->count;) {
+            uint32_t j = i + 1;
+            while (j < ring->count && profiler_compare(&ring->samples[i], &ring->samples[j]) == 0) {
+                j++;
+            }
+            ESP_LOGI(TAG_PROFILER, "%s %p 0x%08" PRIx32 " 0x%08" PRIx32 " %" PRIu32, PREFIX_PROFILER, ring->samples[i].task,
+                     ring->samples[i].pc, ring->samples[i].caller, j - i);
+            i = j;
+        }
+    }
+
+    ESP_LOGI(TAG_PROFILER, "%s end", PREFIX_PROFILER);
+}
+
+/**
+ * @brief Profiler task, runs one capture every CONFIG_APP_PROFILER_PERIOD_MS and dumps it.
+ *
+ * @param param Task parameter (unused).
+ */
+static void profiler_task(void* param) {
+    // Capture long enough for every core to fill its ring
+    const TickType_t CAPTURE_TICKS =
+        pdMS_TO_TICKS((uint64_t)CONFIG_APP_PROFILER_SAMPLES * 1000 / CONFIG_APP_PROFILER_HZ) + 1;
+
+    for (int c = 0; c < portNUM_PROCESSORS; c++) {
+        xTaskCreatePinnedToCore(profiler_setup_task, "profiler_setup", 2560, &profiler_rings[c],
+                                configMAX_PRIORITIES - 1, NULL, c);
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(CONFIG_APP_PROFILER_PERIOD_MS));
+
+        for (int c = 0; c < portNUM_PROCESSORS; c++) {
+            profiler_rings[c].count = 0;
+            profiler_rings[c].lost = 0;
+            if (profiler_rings[c].timer != NULL) {
+                gptimer_set_raw_count(profiler_rings[c].timer, 0);
+                gptimer_start(profiler_rings[c].timer);
+            }
+        }
+
+        vTaskDelay(CAPTURE_TICKS);
+
+        for (int c = 0; c < portNUM_PROCESSORS; c++) {
+            if (profiler_rings[c].timer != NULL) {
+                gptimer_stop(profiler_rings[c].timer);
+            }
+        }
+
+        profiler_dump();
+    }
+}
+
+void profiler_start() {
+    xTaskCreatePinnedToCore(profiler_task, "profiler", 3072, NULL, tskIDLE_PRIORITY + 1, &profiler_task_handle,
+                            CONFIG_APP_NET_CORE);
+}
+
+#else
+
+void profiler_start() {
+}
+
+#endif
@@ -0,0 +1,29 @@
+/**
+ * @file profiler.h
+ * @brief Sampling cpu profiler, enabled by CONFIG_APP_PROFILER.
+ *
+ * Every CONFIG_APP_PROFILER_PERIOD_MS a capture runs: a GPTimer interrupt on each core records, at
+ * CONFIG_APP_PROFILER_HZ, the task that was running, the interrupted PC and its return address
+ * into a RAM ring, until CONFIG_APP_PROFILER_SAMPLES samples per core were taken. The timers are
+ * stopped between captures. The ring is then aggregated and logged on the serial console:
+ *
+ *     [PROF] begin hz=<hz> samples=<n> lost=<n>
+ *     [PROF] task <handle> <name>
+ *     [PROF] <handle> <pc> <caller> <count>
+ *     [PROF] end
+ *
+ * server/profile.py symbolizes the addresses against the ELF and writes folded stacks of the form
+ * task;caller;function count, or a flame graph.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#ifndef PROFILER_H
+#define PROFILER_H
+
+/**
+ * @brief Starts the profiler task on the network core, does nothing when the profiler is disabled.
+ */
+void profiler_start();
+
+#endif
@@ -0,0 +1,57 @@
+/**
+ * @file station.c
+ * @brief Deep sleep of the duty cycled station, see station.h.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#include "station.h"
+
+#include <inttypes.h>
+
+#include "driver/gpio.h"
+#include "driver/rtc_io.h"
+#include "esp_log.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+
+#include "display.h"
+
+#define TAG_STATION "STATION"
+
+#if CONFIG_APP_IDLE_DEEP_SLEEP
+
+bool station_is_cycle_wakeup() {
+    return esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER;
+}
+
+void station_deep_sleep() {
+    ESP_LOGI(TAG_STATION, "Awake for %" PRId64 " ms, sleeping for %d s", esp_timer_get_time() / 1000,
+             CONFIG_APP_STATION_PERIOD_S);
+
+    esp_sleep_enable_timer_wakeup(CONFIG_APP_STATION_PERIOD_S * 1000000ULL);
+
+    // The gesture interrupt pulls INT low, the pull-up of the RTC domain keeps it high meanwhile
+    rtc_gpio_pullup_en(CONFIG_APP_APDS9960_INT_GPIO);
+    rtc_gpio_pulldown_dis(CONFIG_APP_APDS9960_INT_GPIO);
+    esp_sleep_enable_ext0_wakeup(CONFIG_APP_APDS9960_INT_GPIO, 0);
+
+    // Hold the reset line of the panel, so it keeps showing the data while the chip sleeps
+    if (DISPLAY_RESET_GPIO >= 0) {
+        gpio_hold_en(DISPLAY_RESET_GPIO);
+        gpio_deep_sleep_hold_en();
+    }
+
+    esp_deep_sleep_start();
+}
+
+#else
+
+bool station_is_cycle_wakeup() {
+    return false;
+}
+
+void station_deep_sleep() {
+}
+
+#endif
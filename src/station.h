@@ -0,0 +1,46 @@
+/**
+ * @file station.h
+ * @brief Deep sleep duty cycled station, enabled by CONFIG_APP_IDLE_DEEP_SLEEP.
+ *
+ * The station spends its time in deep sleep. Every CONFIG_APP_STATION_PERIOD_S a timer wakes it to
+ * fetch the retained data, render it and sleep again. A gesture on the APDS9960 INT pin wakes the
+ * interactive UI instead, which goes back to deep sleep after the idle timeout.
+ *
+ * The selected city and the last data (STATION_RTC_ATTR) are kept in RTC slow memory. The Wi-Fi
+ * connection comes from the cache of wifi_link.h, so a timer wakeup connects to the known access
+ * point without a scan.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#ifndef STATION_H
+#define STATION_H
+
+#include <stdbool.h>
+
+#include "sdkconfig.h"
+#include "esp_attr.h"
+
+// Keeps a variable over deep sleep in duty cycle mode, plain RAM otherwise
+#if CONFIG_APP_IDLE_DEEP_SLEEP
+#define STATION_RTC_ATTR RTC_DATA_ATTR
+#else
+#define STATION_RTC_ATTR
+#endif
+
+/**
+ * @brief Tells whether this boot is a timer wakeup of the duty cycle.
+ *
+ * @return True after a timer wakeup from deep sleep, false after power on, a gesture wakeup or when
+ * the duty cycle is disabled.
+ */
+bool station_is_cycle_wakeup();
+
+/**
+ * @brief Enters deep sleep until the next cycle or a gesture, does not return.
+ *
+ * Does nothing when the duty cycle is disabled.
+ */
+void station_deep_sleep();
+
+#endif
@@ -0,0 +1,65 @@
+/**
+ * @file telemetry.c
+ * @brief Parsing of the data messages, see telemetry.h.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#include "telemetry.h"
+
+#include <string.h>
+
+/**
+ * @brief Copies one field into a buffer of the store, cut to its size.
+ *
+ * @param dst Buffer of the store.
+ * @param size Size of the buffer.
+ * @param src Start of the field.
+ * @param len Length of the field.
+ */
+static void telemetry_copy(char* dst, size_t size, const char* src, size_t len) {
+    if (len >= size) {
+        len = size - 1;
+    }
+
+    memcpy(dst, src, len);
+    dst[len] = '\0';
+}
+
+telemetry_message_t telemetry_parse(const telemetry_store_t* store, const char* data, int len) {
+    const size_t prefix_len = strlen(PREFIX_DATA);
+
+    if (len < (int)prefix_len || memcmp(data, PREFIX_DATA, prefix_len) != 0) {
+        return TELEMETRY_UNKNOWN;
+    }
+
+    char* fields[] = { store->temperature, store->humidity, store->visibility };
+    const int SIZE = sizeof(fields) / sizeof(fields[0]);  // Number of fields in the store
+
+    const char* end = data + len;
+    const char* field = data + prefix_len;
+
+    // Fields follow the prefix after one space
+    if (field < end && *field == ' ') {
+        field++;
+    }
+
+    for (int i = 0; i < SIZE && field < end; i++) {
+        const char* sep = memchr(field, ',', end - field);
+        const char* field_end = sep != NULL ? sep : end;
+
+        // The server ends the message with a newline, it is not part of the last field
+        while (field_end > field && (field_end[-1] == '\n' || field_end[-1] == '\r')) {
+            field_end--;
+        }
+
+        telemetry_copy(fields[i], store->size, field, field_end - field);
+
+        if (sep == NULL) {
+            break;
+        }
+        field = sep + 1;
+    }
+
+    return TELEMETRY_DATA;
+}
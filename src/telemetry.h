@@ -0,0 +1,46 @@
+/**
+ * @file telemetry.h
+ * @brief Parsing of the messages on the MQTT topic into the data shown by the views.
+ *
+ * Plain C without ESP-IDF dependencies, so the same code runs in the firmware and in the host
+ * benchmark in bench/.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stddef.h>
+
+// MQTT message prefixes
+#define PREFIX_CITY "[CITY]"
+#define PREFIX_DATA "[DATA]"
+
+typedef enum {
+    TELEMETRY_UNKNOWN = 0,  // Not a message for the station
+    TELEMETRY_DATA,         // "[DATA] temperature,humidity,visibility", the store was updated
+} telemetry_message_t;
+
+// Buffers the views show, owned by the caller, each one of size bytes
+typedef struct {
+    char* temperature;
+    char* humidity;
+    char* visibility;
+    size_t size;
+} telemetry_store_t;
+
+/**
+ * @brief Parses one message and updates the store if it is data.
+ *
+ * The message does not need to be terminated. Fields longer than the store are cut, fields after
+ * the visibility are ignored.
+ *
+ * @param store Buffers to update.
+ * @param data Message as received.
+ * @param len Length of the message.
+ * @return Kind of the message.
+ */
+telemetry_message_t telemetry_parse(const telemetry_store_t* store, const char* data, int len);
+
+#endif
@@ -0,0 +1,299 @@
+/**
+ * @file trace.c
+ * @brief Scheduling trace recorder on the FreeRTOS trace macros, see trace.h.
+ *
+ * The hooks run inside the scheduler and from interrupts, so they are in IRAM, take no lock and
+ * only mask the interrupts of their own core while they write one record. Each core writes only
+ * its own ring.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#include "trace.h"
+
+#include <inttypes.h>
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+
+#define TAG_TRACE "TRACE"
+
+#define PREFIX_TRACE "[TRACE]"
+
+#if CONFIG_APP_TRACE
+
+#include "freertos/queue.h"
+#include "driver/gpio.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+
+#include "trace_hooks.h"
+
+// Records per line of the dump
+#define TRACE_EVENTS_PER_LINE 16
+
+// Maximum number of tasks named in one dump
+#define TRACE_MAX_TASKS 32
+
+// Maximum number of objects named in one dump
+#define TRACE_MAX_OBJECTS 16
+
+typedef struct {
+    uint32_t time;      // Low 32 bits of esp_timer_get_time()
+    uint32_t object;    // Task or queue
+    uint8_t type;       // TRACE_* of trace_hooks.h
+    uint8_t arg;        // Priority, queue type or interrupt number
+    uint16_t reserved;
+} trace_event_t;
+
+_Static_assert(sizeof(trace_event_t) == 12, "trace records are 12 bytes");
+
+typedef struct {
+    uint32_t head;      // Records written since the ring was cleared
+    trace_event_t events[CONFIG_APP_TRACE_EVENTS];
+} trace_ring_t;
+
+static trace_ring_t trace_rings[portNUM_PROCESSORS];
+
+static volatile bool trace_recording = false;
+
+static TaskHandle_t trace_task_handle = NULL;
+
+// Task names and named objects of the dump
+static TaskStatus_t trace_status[TRACE_MAX_TASKS];
+static const void* trace_objects[TRACE_MAX_OBJECTS];
+static char trace_line[TRACE_EVENTS_PER_LINE * sizeof(trace_event_t) * 2 + 1];
+
+/**
+ * @brief Appends one record to the ring of the calling core.
+ */
+static inline void IRAM_ATTR trace_record(uint8_t type, const void* object, uint8_t arg) {
+    if (!trace_recording) {
+        return;
+    }
+
+    // Interrupts of the core would write into the same slot
+    UBaseType_t state = portSET_INTERRUPT_MASK_FROM_ISR();
+
+    trace_ring_t* ring = &trace_rings[xPortGetCoreID()];
+    trace_event_t* event = &ring->events[ring->head % CONFIG_APP_TRACE_EVENTS];
+    event->time = (uint32_t)esp_timer_get_time();
+    event->object = (uint32_t)object;
+    event->type = type;
+    event->arg = arg;
+    ring->head++;
+
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(state);
+}
+
+void IRAM_ATTR trace_hook_switched_in(void) {
+    trace_record(TRACE_TASK_SWITCH, xTaskGetCurrentTaskHandle(), 0);
+}
+
+void IRAM_ATTR trace_hook_task(unsigned type, void* task, unsigned priority) {
+    trace_record(type, task, priority);
+}
+
+void IRAM_ATTR trace_hook_queue(unsigned type, void* queue, unsigned queue_type) {
+    trace_record(type, queue, queue_type);
+}
+
+void IRAM_ATTR trace_hook_isr(unsigned type, unsigned number) {
+    trace_record(type, NULL, number);
+}
+
+/**
+ * @brief Formats records as hex into trace_line, byte by byte as they are in memory.
+ */
+static void trace_hex(const trace_event_t* events, int count) {
+    static const char DIGITS[] = "0123456789abcdef";
+    const uint8_t* bytes = (const uint8_t*)events;
+    int len = 0;
+
+    for (int i = 0; i < count * (int)sizeof(trace_event_t); i++) {
+        trace_line[len++] = DIGITS[bytes[i] >> 4];
+        trace_line[len++] = DIGITS[bytes[i] & 0xf];
+    }
+    trace_line[len] = '\0';
+}
+
+/**
+ * @brief Logs the names of the registered queues the rings refer to.
+ */
+static void trace_dump_objects() {
+#if configQUEUE_REGISTRY_SIZE > 0
+    int named = 0;
+
+    for (int c = 0; c < portNUM_PROCESSORS; c++) {
+        const trace_ring_t* ring = &trace_rings[c];
+        uint32_t count = ring->head < CONFIG_APP_TRACE_EVENTS ? ring->head : CONFIG_APP_TRACE_EVENTS;
+
+        for (uint32_t i = 0; i < count && named < TRACE_MAX_OBJECTS; i++) {
+            const trace_event_t* event = &ring->events[i];
+            if (event->type < TRACE_QUEUE_SEND || event->type > TRACE_QUEUE_RECEIVE_ISR) {
+                continue;
+            }
+
+            const void* object = (const void*)event->object;
+            bool known = false;
+            for (int j = 0; j < named && !known; j++) {
+                known = trace_objects[j] == object;
+            }
+            const char* name = known ? NULL : pcQueueGetName((QueueHandle_t)object);
+            if (name != NULL) {
+                trace_objects[named++] = object;
+                ESP_LOGI(TAG_TRACE, "%s object %p %s", PREFIX_TRACE, object, name);
+            }
+        }
+    }
+#endif
+}
+
+/**
+ * @brief Logs the tasks, the named objects and the rings of all cores, oldest record first.
+ */
+static void trace_dump_rings() {
+    uint32_t events = 0;
+    uint32_t overwritten = 0;
+
+    for (int c = 0; c < portNUM_PROCESSORS; c++) {
+        uint32_t head = trace_rings[c].head;
+        events += head < CONFIG_APP_TRACE_EVENTS ? head : CONFIG_APP_TRACE_EVENTS;
+        overwritten += head < CONFIG_APP_TRACE_EVENTS ? 0 : head - CONFIG_APP_TRACE_EVENTS;
+    }
+
+    ESP_LOGI(TAG_TRACE, "%s begin now=%" PRIu32 " events=%" PRIu32 " overwritten=%" PRIu32, PREFIX_TRACE,
+             (uint32_t)esp_timer_get_time(), events, overwritten);
+
+    UBaseType_t count = uxTaskGetSystemState(trace_status, TRACE_MAX_TASKS, NULL);
+    for (UBaseType_t i = 0; i < count; i++) {
+        ESP_LOGI(TAG_TRACE, "%s task %p %u %s", PREFIX_TRACE, trace_status[i].xHandle,
+                 trace_status[i].uxBasePriority, trace_status[i].pcTaskName);
+    }
+
+    trace_dump_objects();
+
+    for (int c = 0; c < portNUM_PROCESSORS; c++) {
+        const trace_ring_t* ring = &trace_rings[c];
+        uint32_t first = ring->head < CONFIG_APP_TRACE_EVENTS ? 0 : ring->head - CONFIG_APP_TRACE_EVENTS;
+
+        // Lines end where the ring wraps, so each line is one contiguous block
+        for (uint32_t i = first; i < ring->head;) {
+            uint32_t slot = i % CONFIG_APP_TRACE_EVENTS;
+            uint32_t n = ring->head - i;
+            if (n > TRACE_EVENTS_PER_LINE) {
+                n = TRACE_EVENTS_PER_LINE;
+            }
+            if (n > CONFIG_APP_TRACE_EVENTS - slot) {
+                n = CONFIG_APP_TRACE_EVENTS - slot;
+            }
+
+            trace_hex(&ring->events[slot], n);
+            ESP_LOGI(TAG_TRACE, "%s core %d %s", PREFIX_TRACE, c, trace_line);
+            i += n;
+        }
+    }
+
+    ESP_LOGI(TAG_TRACE, "%s end", PREFIX_TRACE);
+}
+
+/**
+ * @brief Dump task, logs the rings on every request and records again.
+ *
+ * @param param Task parameter (unused).
+ */
+static void trace_task(void* param) {
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // The requester stopped the recording, wait for a hook that may still write on the other core
+        vTaskDelay(1);
+
+        trace_dump_rings();
+
+        for (int c = 0; c < portNUM_PROCESSORS; c++) {
+            trace_rings[c].head = 0;
+        }
+
+        // Requests that came during the dump would only find the few events since
+        ulTaskNotifyTake(pdTRUE, 0);
+        trace_recording = true;
+    }
+}
+
+#if CONFIG_APP_TRACE_TRIGGER_GPIO >= 0
+/**
+ * @brief Falling edge of the dump button.
+ *
+ * @param arg Handler argument (unused).
+ */
+static void IRAM_ATTR trace_isr(void* arg) {
+    BaseType_t woken = pdFALSE;
+
+    trace_recording = false;
+    vTaskNotifyGiveFromISR(trace_task_handle, &woken);
+
+    if (woken) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+/**
+ * @brief Dumps the trace on a press of the button, the BOOT button of the devkits by default.
+ */
+static void trace_init_button() {
+    gpio_config_t io_conf = {
+        .pin_bit_mask = 1ULL << CONFIG_APP_TRACE_TRIGGER_GPIO,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_NEGEDGE,
+    };
+    ESP_ERROR_CHECK(gpio_config(&io_conf));
+    ESP_ERROR_CHECK(gpio_isr_handler_add(CONFIG_APP_TRACE_TRIGGER_GPIO, trace_isr, NULL));
+}
+#endif
+
+void trace_start() {
+    xTaskCreatePinnedToCore(trace_task, "trace", 3072, NULL, tskIDLE_PRIORITY + 1, &trace_task_handle,
+                            CONFIG_APP_NET_CORE);
+
+#if CONFIG_APP_TRACE_TRIGGER_GPIO >= 0
+    trace_init_button();
+#endif
+
+    trace_recording = true;
+}
+
+void trace_dump() {
+    if (trace_task_handle == NULL) {
+        return;
+    }
+
+    trace_recording = false;
+    xTaskNotifyGive(trace_task_handle);
+}
+
+void trace_gesture_latency(uint32_t us) {
+#if CONFIG_APP_TRACE_TRIGGER_US > 0
+    if (us > CONFIG_APP_TRACE_TRIGGER_US) {
+        trace_dump();
+        ESP_LOGW(TAG_TRACE, "Gesture took %" PRIu32 " us, dumping the trace", us);
+    }
+#endif
+}
+
+#else
+
+void trace_start() {
+}
+
+void trace_dump() {
+}
+
+void trace_gesture_latency(uint32_t us) {
+}
+
+#endif
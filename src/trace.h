@@ -0,0 +1,50 @@
+/**
+ * @file trace.h
+ * @brief Scheduling trace recorder, enabled by CONFIG_APP_TRACE.
+ *
+ * The FreeRTOS trace macros of trace_hooks.h record context switches, sends and receives on
+ * queues, semaphores and mutexes (blocking, success and timeout), priority inheritance and the
+ * interrupts the port reports into a RAM ring per core. Each record is 12 bytes: the time in
+ * microseconds, the task or queue and the event type. The rings keep the last
+ * CONFIG_APP_TRACE_EVENTS events of each core and overwrite older ones.
+ *
+ * A dump stops the recording, logs the rings on the serial console and starts it again:
+ *
+ *     [TRACE] begin now=<us> events=<n> overwritten=<n>
+ *     [TRACE] task <handle> <priority> <name>
+ *     [TRACE] object <handle> <name>
+ *     [TRACE] core <core> <records in hex>
+ *     [TRACE] end
+ *
+ * Objects are named by the FreeRTOS queue registry. server/timeline.py turns the dump into Chrome
+ * trace JSON for Perfetto and lists the longest waits with who held the mutex meanwhile.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+/**
+ * @brief Starts the recording and the dump task on the network core, does nothing when the trace is
+ * disabled.
+ */
+void trace_start();
+
+/**
+ * @brief Stops the recording and has the dump task log the rings, from any task.
+ *
+ * The events up to the call are kept, so call it right after the moment of interest.
+ */
+void trace_dump();
+
+/**
+ * @brief Dumps the trace when a gesture took longer than CONFIG_APP_TRACE_TRIGGER_US.
+ *
+ * @param us Time from the gesture to its view complete on the panel.
+ */
+void trace_gesture_latency(uint32_t us);
+
+#endif
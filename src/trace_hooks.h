@@ -0,0 +1,67 @@
+/**
+ * @file trace_hooks.h
+ * @brief FreeRTOS trace macros of the scheduling trace, see trace.h.
+ *
+ * With CONFIG_APP_TRACE the build forces this header into every C file, so FreeRTOS.h finds the
+ * macros defined before it sets its empty defaults. The macros expand inside tasks.c and queue.c,
+ * where pxQueue is a Queue_t. The header comes before any other include and declares functions only.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#ifndef TRACE_HOOKS_H
+#define TRACE_HOOKS_H
+
+#include "sdkconfig.h"
+
+#if CONFIG_APP_TRACE && !defined(__ASSEMBLER__)
+
+// Event types of the records, server/timeline.py decodes them by these values
+#define TRACE_TASK_SWITCH           1   // Task switched in, object is the task
+#define TRACE_QUEUE_SEND            2   // Send, or give of a semaphore or mutex, succeeded
+#define TRACE_QUEUE_SEND_BLOCK      3   // Sender blocks on a full queue
+#define TRACE_QUEUE_SEND_FAILED     4   // Send timed out
+#define TRACE_QUEUE_RECEIVE         5   // Receive, or take of a semaphore or mutex, succeeded
+#define TRACE_QUEUE_RECEIVE_BLOCK   6   // Receiver blocks on an empty queue or a taken mutex
+#define TRACE_QUEUE_RECEIVE_FAILED  7   // Receive timed out
+#define TRACE_QUEUE_SEND_ISR        8   // Send or give from an interrupt
+#define TRACE_QUEUE_RECEIVE_ISR     9   // Receive or take from an interrupt
+#define TRACE_PRIORITY_INHERIT      10  // Mutex holder raised, arg is the new priority
+#define TRACE_PRIORITY_DISINHERIT   11  // Mutex holder back, arg is its base priority
+#define TRACE_ISR_ENTER             12  // Interrupt reported by the port entered, arg is its number
+#define TRACE_ISR_EXIT              13  // Interrupt left
+
+void trace_hook_switched_in(void);
+void trace_hook_task(unsigned type, void* task, unsigned priority);
+void trace_hook_queue(unsigned type, void* queue, unsigned queue_type);
+void trace_hook_isr(unsigned type, unsigned number);
+
+#define traceTASK_SWITCHED_IN() trace_hook_switched_in()
+
+#define traceQUEUE_SEND(pxQueue) trace_hook_queue(TRACE_QUEUE_SEND, pxQueue, (pxQueue)->ucQueueType)
+#define traceBLOCKING_ON_QUEUE_SEND(pxQueue) \
+    trace_hook_queue(TRACE_QUEUE_SEND_BLOCK, pxQueue, (pxQueue)->ucQueueType)
+#define traceQUEUE_SEND_FAILED(pxQueue) \
+    trace_hook_queue(TRACE_QUEUE_SEND_FAILED, pxQueue, (pxQueue)->ucQueueType)
+#define traceQUEUE_RECEIVE(pxQueue) trace_hook_queue(TRACE_QUEUE_RECEIVE, pxQueue, (pxQueue)->ucQueueType)
+#define traceBLOCKING_ON_QUEUE_RECEIVE(pxQueue) \
+    trace_hook_queue(TRACE_QUEUE_RECEIVE_BLOCK, pxQueue, (pxQueue)->ucQueueType)
+#define traceQUEUE_RECEIVE_FAILED(pxQueue) \
+    trace_hook_queue(TRACE_QUEUE_RECEIVE_FAILED, pxQueue, (pxQueue)->ucQueueType)
+#define traceQUEUE_SEND_FROM_ISR(pxQueue) \
+    trace_hook_queue(TRACE_QUEUE_SEND_ISR, pxQueue, (pxQueue)->ucQueueType)
+#define traceQUEUE_RECEIVE_FROM_ISR(pxQueue) \
+    trace_hook_queue(TRACE_QUEUE_RECEIVE_ISR, pxQueue, (pxQueue)->ucQueueType)
+
+#define traceTASK_PRIORITY_INHERIT(pxTCBOfMutexHolder, uxInheritedPriority) \
+    trace_hook_task(TRACE_PRIORITY_INHERIT, pxTCBOfMutexHolder, uxInheritedPriority)
+#define traceTASK_PRIORITY_DISINHERIT(pxTCBOfMutexHolder, uxOriginalPriority) \
+    trace_hook_task(TRACE_PRIORITY_DISINHERIT, pxTCBOfMutexHolder, uxOriginalPriority)
+
+#define traceISR_ENTER(n) trace_hook_isr(TRACE_ISR_ENTER, n)
+#define traceISR_EXIT() trace_hook_isr(TRACE_ISR_EXIT, 0)
+#define traceISR_EXIT_TO_SCHEDULER() trace_hook_isr(TRACE_ISR_EXIT, 0)
+
+#endif
+
+#endif
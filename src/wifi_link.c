@@ -0,0 +1,233 @@
+/**
+ * @file wifi_link.c
+ * @brief Wi-Fi connection cache in NVS, static address and reconnect backoff, see wifi_link.h.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#include "wifi_link.h"
+
+#include <inttypes.h>
+#include <string.h>
+
+#include "sdkconfig.h"
+#include "freertos/event_groups.h"
+#include "esp_log.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "nvs.h"
+
+#define TAG_WIFI_LINK "WIFI_LINK"
+
+// NVS location of the cache
+#define WIFI_LINK_NVS_NAMESPACE "wifi_link"
+#define WIFI_LINK_NVS_KEY "ap"
+
+// Failed attempts on the cached access point before it is dropped
+#define WIFI_LINK_CACHE_ATTEMPTS 2
+
+#define WIFI_LINK_GOT_IP_BIT BIT0
+
+typedef struct {
+    uint8_t bssid[6];
+    uint8_t channel;
+    esp_netif_ip_info_t ip;
+    esp_netif_dns_info_t dns;
+} wifi_link_cache_t;
+
+static esp_netif_t* wifi_link_netif = NULL;
+static EventGroupHandle_t wifi_link_events = NULL;
+
+// Fires the next attempt after a disconnect
+static esp_timer_handle_t wifi_link_timer = NULL;
+
+// Last connection that got an IP address, valid when wifi_link_cached is set
+static wifi_link_cache_t wifi_link_cache;
+static bool wifi_link_cached = false;
+
+// Failed attempts since the last IP address
+static int wifi_link_attempts = 0;
+
+/**
+ * @brief Timer callback, starts the next attempt.
+ *
+ * @param arg Timer argument (unused).
+ */
+static void wifi_link_reconnect(void* arg) {
+    esp_wifi_connect();
+}
+
+/**
+ * @brief Computes the delay before the next attempt.
+ *
+ * The backoff doubles with every failed attempt up to CONFIG_APP_WIFI_BACKOFF_MAX_MS. Half of it is
+ * random, so stations that lost the same access point do not come back all at once.
+ *
+ * @param attempt Number of failed attempts before this one, from 0.
+ * @return Delay in ms.
+ */
+static uint32_t wifi_link_backoff_ms(int attempt) {
+    uint32_t backoff = CONFIG_APP_WIFI_BACKOFF_MIN_MS;
+
+    for (int i = 0; i < attempt && backoff < CONFIG_APP_WIFI_BACKOFF_MAX_MS; i++) {
+        backoff *= 2;
+    }
+
+    if (backoff > CONFIG_APP_WIFI_BACKOFF_MAX_MS) {
+        backoff = CONFIG_APP_WIFI_BACKOFF_MAX_MS;
+    }
+
+    return backoff / 2 + esp_random() % (backoff / 2 + 1);
+}
+
+#if CONFIG_APP_WIFI_STATIC_IP || CONFIG_APP_WIFI_LEASE_REUSE
+/**
+ * @brief Sets the address without DHCP, falls back to DHCP if it cannot be set.
+ *
+ * @param ip Address, netmask and gateway.
+ * @param dns Main DNS server.
+ */
+static void wifi_link_set_ip(const esp_netif_ip_info_t* ip, const esp_netif_dns_info_t* dns) {
+    // Setting the address raises IP_EVENT_STA_GOT_IP right away
+    esp_netif_dhcpc_stop(wifi_link_netif);
+    if (esp_netif_set_ip_info(wifi_link_netif, ip) != ESP_OK ||
+        esp_netif_set_dns_info(wifi_link_netif, ESP_NETIF_DNS_MAIN, (esp_netif_dns_info_t*)dns) != ESP_OK) {
+        ESP_LOGW(TAG_WIFI_LINK, "Address not set, asking DHCP");
+        esp_netif_dhcpc_start(wifi_link_netif);
+    }
+}
+#endif
+
+void wifi_link_init(esp_netif_t* netif, wifi_config_t* wifi_config) {
+    wifi_link_netif = netif;
+    wifi_link_events = xEventGroupCreate();
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = wifi_link_reconnect,
+        .name = "wifi_link",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &wifi_link_timer));
+
+    // Load the connection of the last boot
+    nvs_handle_t nvs;
+    if (nvs_open(WIFI_LINK_NVS_NAMESPACE, NVS_READONLY, &nvs) == ESP_OK) {
+        size_t len = sizeof(wifi_link_cache);
+        wifi_link_cached = nvs_get_blob(nvs, WIFI_LINK_NVS_KEY, &wifi_link_cache, &len) == ESP_OK &&
+                           len == sizeof(wifi_link_cache);
+        nvs_close(nvs);
+    }
+
+    if (!wifi_link_cached) {
+        ESP_LOGI(TAG_WIFI_LINK, "No cached access point, scanning");
+        return;
+    }
+
+    // Connect to the known access point on its channel, without a scan of the other channels
+    memcpy(wifi_config->sta.bssid, wifi_link_cache.bssid, sizeof(wifi_link_cache.bssid));
+    wifi_config->sta.bssid_set = true;
+    wifi_config->sta.channel = wifi_link_cache.channel;
+
+    ESP_LOGI(TAG_WIFI_LINK, "Connecting to cached access point " MACSTR " on channel %d",
+             MAC2STR(wifi_link_cache.bssid), wifi_link_cache.channel);
+}
+
+void wifi_link_connected() {
+#if CONFIG_APP_WIFI_STATIC_IP
+    esp_netif_ip_info_t ip = { 0 };
+    esp_netif_dns_info_t dns = { 0 };
+
+    esp_netif_str_to_ip4(CONFIG_APP_WIFI_IP, &ip.ip);
+    esp_netif_str_to_ip4(CONFIG_APP_WIFI_NETMASK, &ip.netmask);
+    esp_netif_str_to_ip4(CONFIG_APP_WIFI_GATEWAY, &ip.gw);
+    esp_netif_str_to_ip4(CONFIG_APP_WIFI_DNS, &dns.ip.u_addr.ip4);
+    dns.ip.type = ESP_IPADDR_TYPE_V4;
+
+    wifi_link_set_ip(&ip, &dns);
+#elif CONFIG_APP_WIFI_LEASE_REUSE
+    if (wifi_link_cached) {
+        wifi_link_set_ip(&wifi_link_cache.ip, &wifi_link_cache.dns);
+    }
+#endif
+}
+
+void wifi_link_disconnected(const wifi_event_sta_disconnected_t* event) {
+    xEventGroupClearBits(wifi_link_events, WIFI_LINK_GOT_IP_BIT);
+
+    wifi_link_attempts++;
+
+    // The cached access point may be gone or have moved to another channel
+    if (wifi_link_cached && wifi_link_attempts >= WIFI_LINK_CACHE_ATTEMPTS) {
+        ESP_LOGW(TAG_WIFI_LINK, "Cached access point not reachable, scanning");
+        wifi_link_forget();
+    }
+
+    uint32_t delay = wifi_link_backoff_ms(wifi_link_attempts - 1);
+    ESP_LOGW(TAG_WIFI_LINK, "Disconnected (reason %d), attempt %d in %" PRIu32 " ms", event->reason,
+             wifi_link_attempts + 1, delay);
+
+    esp_timer_stop(wifi_link_timer);
+    esp_timer_start_once(wifi_link_timer, delay * 1000ULL);
+}
+
+void wifi_link_got_ip() {
+    wifi_link_cache_t cache;
+    wifi_ap_record_t ap;
+
+    wifi_link_attempts = 0;
+    xEventGroupSetBits(wifi_link_events, WIFI_LINK_GOT_IP_BIT);
+
+    // Zeroed, so the padding compares equal as well
+    memset(&cache, 0, sizeof(cache));
+    if (esp_wifi_sta_get_ap_info(&ap) != ESP_OK ||
+        esp_netif_get_ip_info(wifi_link_netif, &cache.ip) != ESP_OK ||
+        esp_netif_get_dns_info(wifi_link_netif, ESP_NETIF_DNS_MAIN, &cache.dns) != ESP_OK) {
+        return;
+    }
+    memcpy(cache.bssid, ap.bssid, sizeof(cache.bssid));
+    cache.channel = ap.primary;
+
+    // Usually nothing changed, do not wear the flash then
+    if (wifi_link_cached && memcmp(&cache, &wifi_link_cache, sizeof(cache)) == 0) {
+        return;
+    }
+
+    wifi_link_cache = cache;
+    wifi_link_cached = true;
+
+    nvs_handle_t nvs;
+    if (nvs_open(WIFI_LINK_NVS_NAMESPACE, NVS_READWRITE, &nvs) != ESP_OK) {
+        return;
+    }
+    if (nvs_set_blob(nvs, WIFI_LINK_NVS_KEY, &cache, sizeof(cache)) != ESP_OK || nvs_commit(nvs) != ESP_OK) {
+        ESP_LOGW(TAG_WIFI_LINK, "Connection not cached");
+    }
+    nvs_close(nvs);
+}
+
+bool wifi_link_wait(TickType_t timeout) {
+    return xEventGroupWaitBits(wifi_link_events, WIFI_LINK_GOT_IP_BIT, pdFALSE, pdTRUE, timeout) & WIFI_LINK_GOT_IP_BIT;
+}
+
+void wifi_link_forget() {
+    wifi_link_cached = false;
+
+    nvs_handle_t nvs;
+    if (nvs_open(WIFI_LINK_NVS_NAMESPACE, NVS_READWRITE, &nvs) == ESP_OK) {
+        nvs_erase_key(nvs, WIFI_LINK_NVS_KEY);
+        nvs_commit(nvs);
+        nvs_close(nvs);
+    }
+
+    // Scan all channels for the SSID again
+    wifi_config_t wifi_config;
+    if (esp_wifi_get_config(WIFI_IF_STA, &wifi_config) == ESP_OK) {
+        wifi_config.sta.bssid_set = false;
+        wifi_config.sta.channel = 0;
+        esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
+    }
+
+#if CONFIG_APP_WIFI_LEASE_REUSE
+    // The cached lease goes with the access point
+    esp_netif_dhcpc_start(wifi_link_netif);
+#endif
+}
@@ -0,0 +1,72 @@
+/**
+ * @file wifi_link.h
+ * @brief Fast connect and reconnect of the Wi-Fi station.
+ *
+ * The BSSID and channel of the last access point that gave the station an IP address are cached in
+ * NVS. The next connect goes straight to that access point on its channel instead of scanning all
+ * channels. After two failed attempts the cache is dropped and the station scans again.
+ *
+ * The address comes from one of the modes in "Wi-Fi Configuration":
+ *  - CONFIG_APP_WIFI_DHCP: plain DHCP.
+ *  - CONFIG_APP_WIFI_DHCP_CACHED: DHCP, requesting the last lease directly (one round trip).
+ *  - CONFIG_APP_WIFI_LEASE_REUSE: the last lease is cached with the access point and set without DHCP.
+ *  - CONFIG_APP_WIFI_STATIC_IP: fixed address from menuconfig, no DHCP.
+ *
+ * After a disconnect the station reconnects with exponential backoff and jitter, from
+ * CONFIG_APP_WIFI_BACKOFF_MIN_MS up to CONFIG_APP_WIFI_BACKOFF_MAX_MS.
+ *
+ * @author Oleksandr Turytsia (xturyt00)
+ * @date 14/11/2023
+ */
+#ifndef WIFI_LINK_H
+#define WIFI_LINK_H
+
+#include <stdbool.h>
+
+#include "freertos/FreeRTOS.h"
+#include "esp_netif.h"
+#include "esp_wifi.h"
+
+/**
+ * @brief Loads the cache and points the station config at the cached access point.
+ *
+ * To be called once before esp_wifi_set_config(), after NVS is initialized.
+ *
+ * @param netif Station interface.
+ * @param wifi_config Config passed to esp_wifi_set_config() afterwards.
+ */
+void wifi_link_init(esp_netif_t* netif, wifi_config_t* wifi_config);
+
+/**
+ * @brief Sets the static or cached address, to be called on WIFI_EVENT_STA_CONNECTED.
+ */
+void wifi_link_connected();
+
+/**
+ * @brief Schedules the next attempt, to be called on WIFI_EVENT_STA_DISCONNECTED.
+ *
+ * @param event Event data of the disconnect.
+ */
+void wifi_link_disconnected(const wifi_event_sta_disconnected_t* event);
+
+/**
+ * @brief Caches the connection and resets the backoff, to be called on IP_EVENT_STA_GOT_IP.
+ */
+void wifi_link_got_ip();
+
+/**
+ * @brief Waits until the station has an IP address.
+ *
+ * @param timeout Ticks to wait at most.
+ * @return True if the station has an address.
+ */
+bool wifi_link_wait(TickType_t timeout);
+
+/**
+ * @brief Drops the cached connection, the next attempt scans all channels.
+ *
+ * With CONFIG_APP_WIFI_LEASE_REUSE the cached lease is dropped as well and DHCP asked again.
+ */
+void wifi_link_forget();
+
+#endif